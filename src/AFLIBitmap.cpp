@@ -0,0 +1,416 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include "AFLIBitmap.h"
+
+
+const C64Color AFLIBitmap::black;
+
+
+/*****************************************************************************/
+AFLIBitmap::AFLIBitmap(void)
+{
+    memset(m_aBitmapRAM, 0, sizeof(m_aBitmapRAM));
+    memset(m_aScreenRAM, 0, sizeof(m_aScreenRAM));
+}
+
+
+/*****************************************************************************/
+AFLIBitmap::~AFLIBitmap(void)
+{
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to a copy of this bitmap created with "new".
+ */
+BitmapBase* AFLIBitmap::Copy() const
+{
+    return new AFLIBitmap(*this);
+}
+
+
+/******************************************************************************/
+/**
+ * Return the width of this image.
+ */
+int AFLIBitmap::GetWidth() const
+{
+    return AFLI_X;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the height of this image.
+ */
+int AFLIBitmap::GetHeight() const
+{
+    return AFLI_Y;
+}
+
+
+/*****************************************************************************/
+/**
+ * Each pixel row of a character has its own colors, so a cell is 8x1.
+ */
+int AFLIBitmap::GetCellWidth() const
+{
+    return AFLIBLOCK_WIDTH;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the height of a cell, which is one pixel row.
+ */
+int AFLIBitmap::GetCellHeight() const
+{
+    return AFLIBLOCK_HEIGHT;
+}
+
+
+/******************************************************************************/
+/**
+ * The first three character columns are covered by the FLI bug.
+ */
+int AFLIBitmap::GetBugAreaWidth() const
+{
+    return AFLIBITMAP_BUG_WIDTH;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of color indexes in this mode.
+ */
+int AFLIBitmap::GetNIndexes() const
+{
+    return 2;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of an index in the cell which contains the given
+ * coordinates. If the coordinates are out of range, return black.
+ */
+const C64Color* AFLIBitmap::GetColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+    {
+        if (index < 2)
+            return C64Color::GetPaletteColor(
+                    GetIndexedColorNumber(x, y, index));
+        else
+            return NULL;
+    }
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of pixels of an index in the cell which contains the
+ * given coordinates. If the coordinates are out of range, return 0.
+ */
+int AFLIBitmap::CountColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return CountIndex(x, y, index);
+    else
+        return 0;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of a pixel. If the coordinates are out of range, return
+ * black.
+ */
+const C64Color* AFLIBitmap::GetColor(int x, int y) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return C64Color::GetPaletteColor(
+                GetIndexedColorNumber(x, y, GetIndex(x, y)));
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ */
+void AFLIBitmap::GetColorRow(int x, int y, int w, unsigned char* pDest) const
+{
+    unsigned             c, xPixel, val;
+    const unsigned char* pRow;
+    const unsigned char* pScreen;
+    unsigned char        aColors[2];
+
+    c       = (y / 8) * AFLIBITMAP_XCHARS + x / AFLIBLOCK_WIDTH;
+    pRow    = m_aBitmapRAM + c * AFLIBITMAP_BYTES_PER_CHAR + y % 8;
+    pScreen = m_aScreenRAM[y % 8];
+    xPixel  = x % AFLIBLOCK_WIDTH;
+
+    while (w > 0)
+    {
+        aColors[0] = pScreen[c] & 0x0f;
+        aColors[1] = pScreen[c] >> 4;
+
+        val = *pRow;
+        for (; xPixel < AFLIBLOCK_WIDTH && w > 0; ++xPixel, --w)
+            *pDest++ = aColors[(val >> (AFLIBLOCK_WIDTH - 1 - xPixel)) & 0x01];
+
+        xPixel = 0;
+        ++c;
+        pRow += AFLIBITMAP_BYTES_PER_CHAR;
+    }
+}
+
+
+/*****************************************************************************
+ * Set the pixel x/y to the color col. This works like HiResBlock::SetPixel,
+ * but for the 8x1 cell which contains the pixel.
+ */
+void AFLIBitmap::SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode)
+{
+    int           aUsage[2];
+    unsigned char c;
+    int           i;
+
+    if ((x < 0) || (y < 0) || (x >= GetWidth()) || (y >= GetHeight()))
+        return;
+
+    c = (unsigned char) col.GetColor();
+
+    // this may change the whole cell
+    Dirty(x & ~(AFLIBLOCK_WIDTH - 1), y, AFLIBLOCK_WIDTH, AFLIBLOCK_HEIGHT);
+
+    // Set colors with fixed index first
+    i = (int)(mode - MCDrawingModeIndex0);
+    if (mode >= MCDrawingModeIndex0 && mode <= MCDrawingModeIndex1)
+    {
+        SetIndexedColor(x, y, i, c);
+        SetIndex(x, y, i);
+        return;
+    }
+    else if (mode >= MCDrawingModeIndex2 && mode <= MCDrawingModeIndex3)
+        return;
+
+    aUsage[0] = CountIndex(x, y, 0);
+    aUsage[1] = AFLIBLOCK_WIDTH - aUsage[0];
+
+    // look for a color used already
+    for (i = 0; i < 2; ++i)
+    {
+        if (aUsage[i] != 0 && GetIndexedColorNumber(x, y, i) == c)
+        {
+            SetIndex(x, y, i);
+            return;
+        }
+    }
+
+    // otherwise a free one
+    for (i = 0; i < 2; ++i)
+    {
+        if (aUsage[i] == 0)
+        {
+            SetIndex(x, y, i);
+            SetIndexedColor(x, y, i, c);
+            return;
+        }
+    }
+
+    // color clash, depends on the mode
+    switch (mode)
+    {
+    case MCDrawingModeForce:
+        // replace the color of this pixel
+        SetIndexedColor(x, y, GetIndex(x, y), c);
+        break;
+
+    case MCDrawingModeLeast:
+        i = aUsage[0] < aUsage[1] ? 0 : 1;
+        SetIndex(x, y, i);
+        SetIndexedColor(x, y, i, c);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: One bitmap byte and
+ * one byte screen RAM.
+ */
+unsigned AFLIBitmap::GetCellDataSize() const
+{
+    return 2;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid.
+ */
+void AFLIBitmap::GetCellData(int xCell, int yCell, unsigned char* pData) const
+{
+    unsigned c = (yCell / 8) * AFLIBITMAP_XCHARS + xCell;
+
+    pData[0] = m_aBitmapRAM[c * AFLIBITMAP_BYTES_PER_CHAR + yCell % 8];
+    pData[1] = m_aScreenRAM[yCell % 8][c];
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ */
+void AFLIBitmap::SetCellData(int xCell, int yCell, const unsigned char* pData)
+{
+    unsigned c = (yCell / 8) * AFLIBITMAP_XCHARS + xCell;
+
+    m_aBitmapRAM[c * AFLIBITMAP_BYTES_PER_CHAR + yCell % 8] = pData[0];
+    m_aScreenRAM[yCell % 8][c] = pData[1];
+
+    Dirty(xCell * AFLIBLOCK_WIDTH, yCell, AFLIBLOCK_WIDTH, AFLIBLOCK_HEIGHT);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy nRows bitmap bytes in VIC order into this image, starting at the
+ * first one. Usually nRows is 8000 to set the complete bitmap.
+ */
+void AFLIBitmap::SetBitmapRows(const uint8_t* pSrc, size_t nRows)
+{
+    if (nRows > sizeof(m_aBitmapRAM))
+        nRows = sizeof(m_aBitmapRAM);
+
+    memcpy(m_aBitmapRAM, pSrc, nRows);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the first nRows bitmap bytes in VIC order to pDest.
+ */
+void AFLIBitmap::GetBitmapRows(uint8_t* pDest, size_t nRows) const
+{
+    if (nRows > sizeof(m_aBitmapRAM))
+        nRows = sizeof(m_aBitmapRAM);
+
+    memcpy(pDest, m_aBitmapRAM, nRows);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy a complete screen RAM (1000 bytes) into this image. Bank n is used
+ * for pixel row n of each character.
+ */
+void AFLIBitmap::SetScreenRAM(unsigned nBank, const unsigned char* pSrc)
+{
+    memcpy(m_aScreenRAM[nBank], pSrc, sizeof(m_aScreenRAM[nBank]));
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the screen RAM of bank nBank (1000 bytes) to pDest.
+ */
+void AFLIBitmap::GetScreenRAM(unsigned nBank, unsigned char* pDest) const
+{
+    memcpy(pDest, m_aScreenRAM[nBank], sizeof(m_aScreenRAM[nBank]));
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color index (0 or 1) of the pixel x/y. The coordinates must be
+ * valid.
+ */
+void AFLIBitmap::SetIndex(unsigned x, unsigned y, int index)
+{
+    unsigned char* pRow;
+    unsigned       shift;
+
+    pRow  = m_aBitmapRAM + ((y / 8) * AFLIBITMAP_XCHARS + x / AFLIBLOCK_WIDTH) *
+            AFLIBITMAP_BYTES_PER_CHAR + y % 8;
+    shift = AFLIBLOCK_WIDTH - 1 - x % AFLIBLOCK_WIDTH;
+    *pRow = (*pRow & ~(0x01 << shift)) | (index << shift);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color of an index in the cell which contains x/y.
+ */
+void AFLIBitmap::SetIndexedColor(unsigned x, unsigned y, int index,
+                                 unsigned char col)
+{
+    unsigned char* pScreen;
+
+    pScreen = &m_aScreenRAM[y % 8][(y / 8) * AFLIBITMAP_XCHARS +
+                                   x / AFLIBLOCK_WIDTH];
+    if (index)
+        *pScreen = (*pScreen & 0x0f) | (col << 4);
+    else
+        *pScreen = (*pScreen & 0xf0) | col;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of pixels in the 8x1 cell containing x/y which use the
+ * given index.
+ */
+int AFLIBitmap::CountIndex(unsigned x, unsigned y, int index) const
+{
+    unsigned char val;
+    int           i, n;
+
+    val = m_aBitmapRAM[((y / 8) * AFLIBITMAP_XCHARS + x / AFLIBLOCK_WIDTH) *
+                       AFLIBITMAP_BYTES_PER_CHAR + y % 8];
+    n = 0;
+    for (i = 0; i < AFLIBLOCK_WIDTH; ++i)
+    {
+        if (((val >> i) & 0x01) == index)
+            ++n;
+    }
+    return n;
+}
@@ -0,0 +1,147 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef AFLIBITMAP_H
+#define AFLIBITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "C64Color.h"
+#include "ToolBase.h"
+#include "BitmapBase.h"
+
+#define AFLI_X 320
+#define AFLI_Y 200
+
+/* An AFLI cell is one row of a character */
+#define AFLIBLOCK_WIDTH  8
+#define AFLIBLOCK_HEIGHT 1
+
+#define AFLIBITMAP_BYTES_PER_CHAR 8
+#define AFLIBITMAP_XCHARS (AFLI_X / 8)
+#define AFLIBITMAP_YCHARS (AFLI_Y / 8)
+#define AFLIBITMAP_NCHARS (AFLIBITMAP_XCHARS * AFLIBITMAP_YCHARS)
+
+/* One screen RAM for each pixel row of a character */
+#define AFLIBITMAP_NBANKS 8
+
+/* The VIC shows garbage in the first 3 character columns of each line */
+#define AFLIBITMAP_BUG_WIDTH (3 * AFLIBLOCK_WIDTH)
+
+/*****************************************************************************/
+/**
+ * A hires FLI (AFLI) bitmap. The VIC gets a new screen RAM for each pixel
+ * row, so each 8x1 cell has two colors of its own.
+ *
+ * The data is stored exactly like the VIC sees it: 8000 bytes bitmap and
+ * 8 * 1000 bytes screen RAM. A cell has only 8 pixels in a single bitmap
+ * byte, so they are counted when needed instead of keeping usage counters.
+ */
+class AFLIBitmap : public BitmapBase
+{
+public:
+    AFLIBitmap(void);
+    ~AFLIBitmap(void);
+    virtual BitmapBase* Copy() const;
+
+    virtual int GetWidth() const;
+    virtual int GetHeight() const;
+
+    virtual int GetCellWidth() const;
+    virtual int GetCellHeight() const;
+
+    virtual int GetBugAreaWidth() const;
+
+    virtual int GetNIndexes() const;
+    virtual const C64Color* GetColorByIndex(int x, int y, int index) const;
+    virtual int CountColorByIndex(int x, int y, int index) const;
+
+    virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
+    virtual void SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode = MCDrawingModeIgnore);
+
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
+    void SetBitmapRows(const uint8_t* pSrc, size_t nRows);
+    void GetBitmapRows(uint8_t* pDest, size_t nRows) const;
+    void SetScreenRAM(unsigned nBank, const unsigned char* pSrc);
+    void GetScreenRAM(unsigned nBank, unsigned char* pDest) const;
+
+    static const C64Color black;
+
+protected:
+    int GetIndex(unsigned x, unsigned y) const;
+    void SetIndex(unsigned x, unsigned y, int index);
+    int GetIndexedColorNumber(unsigned x, unsigned y, int index) const;
+    void SetIndexedColor(unsigned x, unsigned y, int index,
+                         unsigned char col);
+    int CountIndex(unsigned x, unsigned y, int index) const;
+
+    /// Bitmap RAM, 8 bytes per character, in VIC order
+    unsigned char m_aBitmapRAM[AFLIBITMAP_NCHARS * AFLIBITMAP_BYTES_PER_CHAR];
+
+    /// Screen RAM for each pixel row, upper nibble is index 1, lower is 0
+    unsigned char m_aScreenRAM[AFLIBITMAP_NBANKS][AFLIBITMAP_NCHARS];
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the color index (0 or 1) of the pixel x/y. The coordinates must be
+ * valid.
+ */
+inline int AFLIBitmap::GetIndex(unsigned x, unsigned y) const
+{
+    unsigned c = (y / 8) * AFLIBITMAP_XCHARS + x / AFLIBLOCK_WIDTH;
+
+    return (m_aBitmapRAM[c * AFLIBITMAP_BYTES_PER_CHAR + y % 8] >>
+            (AFLIBLOCK_WIDTH - 1 - x % AFLIBLOCK_WIDTH)) & 0x01;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the C64 color number used for the given index in the cell which
+ * contains x/y. The coordinates must be valid.
+ */
+inline int AFLIBitmap::GetIndexedColorNumber(unsigned x, unsigned y,
+                                             int index) const
+{
+    unsigned c = (y / 8) * AFLIBITMAP_XCHARS + x / AFLIBLOCK_WIDTH;
+
+    if (index)
+        return m_aScreenRAM[y % 8][c] >> 4;
+    else
+        return m_aScreenRAM[y % 8][c] & 0x0f;
+}
+
+#endif // AFLIBITMAP_H
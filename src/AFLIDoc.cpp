@@ -0,0 +1,225 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+#include "MCApp.h"
+#include "AFLIDoc.h"
+#include "DocRenderer.h"
+
+#define AFLI_START_ADDR 0x4000
+
+/* Some editors save the whole area up to $7fff */
+#define AFLI_PADDED_SIZE (2 + 0x4000 - 1)
+
+/* File structure of an AFLI image including start address */
+typedef struct afli_s
+{
+   uint8_t ptr[2];               /* start address */
+   uint8_t scr_ram[8][1024];     /* one for each pixel row, 1000 used */
+   uint8_t bitmap[8000];         /* 320 * 200 * 1 bit */
+} afli_t;
+
+/******************************************************************************/
+/**
+ * This is a list of all Filters for this image format.
+ */
+static FormatInfo::Filter m_aFilters[] =
+{
+    { wxT("AFLI files"), wxT("*.afl") },
+    { NULL, NULL }
+};
+
+/**
+ * File sizes and load addresses CheckFormat looks for, terminated by 0.
+ */
+static const unsigned m_aSizes[] = { sizeof(afli_t), AFLI_PADDED_SIZE, 0 };
+static const unsigned m_aLoadAddresses[] = { AFLI_START_ADDR, 0 };
+
+/**
+ * Information about this image format.
+ */
+FormatInfo AFLIDoc::m_formatInfo(
+    wxT("HiRes FLI"),
+    wxT("afl"),
+    m_aFilters,
+    AFLIDoc::Factory,
+    AFLIDoc::CheckFormat,
+    m_aSizes,
+    m_aLoadAddresses);
+
+
+/******************************************************************************/
+/**
+ *
+ */
+AFLIDoc::AFLIDoc()
+    : m_bitmap()
+{
+    PrepareUndo();
+
+    // PrepareUndo sets m_bModified, reset it
+    m_bModified = false;
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class.
+ */
+DocBase* AFLIDoc::Factory()
+{
+    return new AFLIDoc;
+}
+
+
+/******************************************************************************/
+/**
+ * Check how good data matches our document format. Return a sum of
+ * MC_FORMAT_*_MATCH.
+ */
+int AFLIDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                         const wxFileName& fileName)
+{
+    uint16_t addr;
+    int      match = 0;
+
+    if (fileName.GetExt().CmpNoCase(wxT("afl")) == 0)
+        match += MC_FORMAT_EXTENSION_MATCH;
+
+    if (len == sizeof(afli_t) || len == AFLI_PADDED_SIZE)
+        match += MC_FORMAT_SIZE_MATCH;
+
+    if (len < 2)
+        return match;
+
+    addr = pBuff[0] + pBuff[1] * 256;
+    if (addr == AFLI_START_ADDR)
+        match += MC_FORMAT_ADDR_MATCH;
+
+    return match;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our FormatInfo.
+ */
+const FormatInfo* AFLIDoc::GetFormatInfo() const
+{
+    return &m_formatInfo;
+}
+
+
+/******************************************************************************/
+/**
+ * Copy the contents of the given bitmap to our one. The pointer must point to
+ * an object which has actually the same type as our bitmap.
+ */
+void AFLIDoc::SetBitmap(const BitmapBase* pB)
+{
+    m_bitmap = *(AFLIBitmap*) pB;
+}
+
+
+/******************************************************************************/
+/**
+ * Try to load the file from the given memory buffer. Return true for success.
+ */
+bool AFLIDoc::Load(const uint8_t* pBuff, unsigned size)
+{
+    return LoadAFLI(pBuff, size);
+}
+
+
+/******************************************************************************
+ **
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success.
+ */
+bool AFLIDoc::Save(std::vector<uint8_t>* pOut,
+                   const wxFileName& /* fileName */)
+{
+    return SaveAFLI(pOut);
+}
+
+
+/*****************************************************************************/
+/**
+ * Try to load an AFLI picture from the given buffer into this document.
+ * The file may be padded up to $7fff.
+ * Return true if it worked and false otherwise.
+ *
+ * pBuff        Points to bytes from the file
+ * nSize        Size
+ * return       true if the file has been loaded
+ */
+bool AFLIDoc::LoadAFLI(const uint8_t* pBuff, unsigned nSize)
+{
+    const afli_t* pImage;
+    unsigned      i;
+
+    if (nSize != sizeof(afli_t) && nSize != AFLI_PADDED_SIZE)
+        return false;
+
+    pImage = (const afli_t*) pBuff;
+
+    // ignore start addr, 2 bytes
+
+    m_bitmap.SetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
+    for (i = 0; i < AFLIBITMAP_NBANKS; ++i)
+        m_bitmap.SetScreenRAM(i, pImage->scr_ram[i]);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Save an AFLI file into the given buffer.
+ *
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
+ */
+bool AFLIDoc::SaveAFLI(std::vector<uint8_t>* pOut)
+{
+    afli_t*  pImage;
+    unsigned i;
+
+    pOut->assign(sizeof(afli_t), 0);
+    pImage = (afli_t*) &(*pOut)[0];
+
+    // start addr
+    pImage->ptr[0] = AFLI_START_ADDR % 0x100;
+    pImage->ptr[1] = AFLI_START_ADDR / 0x100;
+
+    for (i = 0; i < AFLIBITMAP_NBANKS; ++i)
+        m_bitmap.GetScreenRAM(i, pImage->scr_ram[i]);
+    m_bitmap.GetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
+
+    return true;
+}
@@ -0,0 +1,377 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+
+#include "C64Color.h"
+#include "MCBitmap.h"
+#include "ImageImporter.h"
+#include "BackgroundSearch.h"
+
+/* Number of colors a cell has in addition to the background */
+#define BACKGROUNDSEARCH_CELL_COLORS 3
+
+
+/*****************************************************************************/
+/**
+ * Constructor. Calculate the distances between the colors of the palette.
+ */
+BackgroundSearch::BackgroundSearch() :
+    m_aCells(),
+    m_nSimpleColors(0)
+{
+    ImageImporter::Yuv aPalette[BACKGROUNDSEARCH_COLORS];
+    MC_RGB             rgb;
+    unsigned           i, j;
+
+    for (i = 0; i < BACKGROUNDSEARCH_COLORS; ++i)
+    {
+        rgb = C64Color::GetPaletteColor(i)->GetRGB();
+        aPalette[i] = ImageImporter::ToYuv(MC_RGB_R(rgb), MC_RGB_G(rgb),
+                                           MC_RGB_B(rgb));
+    }
+
+    for (i = 0; i < BACKGROUNDSEARCH_COLORS; ++i)
+    {
+        for (j = 0; j < BACKGROUNDSEARCH_COLORS; ++j)
+            m_aDistance[i][j] = ImageImporter::Distance(aPalette[i],
+                                                        aPalette[j]);
+
+        m_aPresent[i] = 0;
+        m_aError[i]   = 0;
+        m_aSlots[i]   = 0;
+        m_aRanking[i] = i;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Add a cell. aHistogram contains the number of pixels of each of the 16
+ * colors.
+ *
+ * A cell with up to three colors is only remembered by the colors it
+ * contains, it never clashes with any background.
+ */
+void BackgroundSearch::AddCell(const unsigned* aHistogram)
+{
+    Cell     cell;
+    unsigned i, nColors;
+
+    nColors = 0;
+    for (i = 0; i < BACKGROUNDSEARCH_COLORS; ++i)
+    {
+        if (aHistogram[i])
+            ++nColors;
+    }
+
+    if (nColors <= BACKGROUNDSEARCH_CELL_COLORS)
+    {
+        for (i = 0; i < BACKGROUNDSEARCH_COLORS; ++i)
+        {
+            if (aHistogram[i])
+                ++m_aPresent[i];
+        }
+        m_nSimpleColors += nColors;
+    }
+    else
+    {
+        memcpy(cell.aHistogram, aHistogram, sizeof(cell.aHistogram));
+        m_aCells.push_back(cell);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Add all cells of a multicolor bitmap.
+ */
+void BackgroundSearch::AddBitmap(const MCBitmap& bitmap)
+{
+    unsigned aHistogram[BACKGROUNDSEARCH_COLORS];
+    unsigned i;
+
+    for (i = 0; i < MCBITMAP_NBLOCKS; ++i)
+    {
+        bitmap.GetCellHistogram(i, aHistogram);
+        AddCell(aHistogram);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Rate all backgrounds for the cells added. The cells which may clash are
+ * distributed to several threads, each of them sums up its own errors.
+ */
+void BackgroundSearch::Search()
+{
+    std::vector<Worker*> apWorkers;
+    Worker*              pWorker;
+    unsigned             nThreads, nPerThread, nStart, nEnd, nCells;
+    unsigned             nBg, nClash, i, j, tmp;
+    int                  nCPUs;
+
+    nCells = m_aCells.size();
+
+    nCPUs = wxThread::GetCPUCount();
+    nThreads = nCPUs > 0 ? nCPUs : 1;
+    if (nThreads > nCells)
+        nThreads = nCells ? nCells : 1;
+
+    nPerThread = (nCells + nThreads - 1) / nThreads;
+
+    for (nBg = 0; nBg < BACKGROUNDSEARCH_COLORS; ++nBg)
+        m_aError[nBg] = 0;
+
+    // the first cells are evaluated by this thread
+    for (nStart = nPerThread; nStart < nCells; nStart += nPerThread)
+    {
+        nEnd = nStart + nPerThread;
+        if (nEnd > nCells)
+            nEnd = nCells;
+
+        pWorker = new Worker(this, nStart, nEnd);
+        if (pWorker->Create() != wxTHREAD_NO_ERROR ||
+            pWorker->Run() != wxTHREAD_NO_ERROR)
+        {
+            // do it ourselves
+            delete pWorker;
+            EvaluateCells(nStart, nEnd, m_aError);
+            continue;
+        }
+        apWorkers.push_back(pWorker);
+    }
+
+    EvaluateCells(0, nPerThread < nCells ? nPerThread : nCells, m_aError);
+
+    for (i = 0; i < apWorkers.size(); ++i)
+    {
+        apWorkers[i]->Wait();
+        for (nBg = 0; nBg < BACKGROUNDSEARCH_COLORS; ++nBg)
+            m_aError[nBg] += apWorkers[i]->m_aError[nBg];
+        delete apWorkers[i];
+    }
+
+    // cells which may clash use all of their slots with any background
+    nClash = nCells * BACKGROUNDSEARCH_CELL_COLORS;
+    for (nBg = 0; nBg < BACKGROUNDSEARCH_COLORS; ++nBg)
+        m_aSlots[nBg] = m_nSimpleColors - m_aPresent[nBg] + nClash;
+
+    // only 16 entries, a simple insertion sort does it
+    for (i = 0; i < BACKGROUNDSEARCH_COLORS; ++i)
+        m_aRanking[i] = i;
+    for (i = 1; i < BACKGROUNDSEARCH_COLORS; ++i)
+    {
+        tmp = m_aRanking[i];
+        for (j = i; j > 0; --j)
+        {
+            nBg = m_aRanking[j - 1];
+            if (m_aError[nBg] < m_aError[tmp] ||
+                (m_aError[nBg] == m_aError[tmp] &&
+                 m_aSlots[nBg] <= m_aSlots[tmp]))
+                break;
+            m_aRanking[j] = nBg;
+        }
+        m_aRanking[j] = tmp;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Give the bitmap the best background found by Search. The colors of each
+ * cell are chosen again for this background. As far as the cell doesn't
+ * clash, all pixels keep their colors.
+ */
+void BackgroundSearch::Apply(MCBitmap* pBitmap) const
+{
+    unsigned char aData[MCBITMAP_BYTES_PER_BLOCK + 2];
+    unsigned      aHistogram[BACKGROUNDSEARCH_COLORS];
+    unsigned      aKept[BACKGROUNDSEARCH_CELL_COLORS];
+    unsigned      aIndex[BACKGROUNDSEARCH_COLORS];
+    unsigned      xCell, yCell, x, y, i, c, nBg, nBest;
+
+    nBg = m_aRanking[0];
+
+    for (yCell = 0; yCell < MCBITMAP_YBLOCKS; ++yCell)
+    {
+        for (xCell = 0; xCell < MCBITMAP_XBLOCKS; ++xCell)
+        {
+            pBitmap->GetCellHistogram(yCell * MCBITMAP_XBLOCKS + xCell,
+                                      aHistogram);
+            ChooseColors(aHistogram, nBg, aKept);
+
+            // each color gets the index of the nearest color available
+            for (c = 0; c < BACKGROUNDSEARCH_COLORS; ++c)
+            {
+                aIndex[c] = 0;
+                nBest = m_aDistance[c][nBg];
+                for (i = 0; i < BACKGROUNDSEARCH_CELL_COLORS; ++i)
+                {
+                    if (m_aDistance[c][aKept[i]] < nBest)
+                    {
+                        aIndex[c] = i + 1;
+                        nBest = m_aDistance[c][aKept[i]];
+                    }
+                }
+            }
+
+            for (y = 0; y < MCBITMAP_BYTES_PER_BLOCK; ++y)
+            {
+                aData[y] = 0;
+                for (x = 0; x < MCBLOCK_WIDTH; ++x)
+                {
+                    c = pBitmap->GetColor(xCell * MCBLOCK_WIDTH + x,
+                                          yCell * MCBLOCK_HEIGHT + y)->
+                        GetColor();
+                    aData[y] = (aData[y] << 2) | aIndex[c];
+                }
+            }
+            aData[MCBITMAP_BYTES_PER_BLOCK]     = (aKept[0] << 4) | aKept[1];
+            aData[MCBITMAP_BYTES_PER_BLOCK + 1] = aKept[2];
+
+            pBitmap->SetCellData(xCell, yCell, aData);
+        }
+    }
+
+    pBitmap->SetBackground(C64Color(nBg));
+}
+
+
+/*****************************************************************************/
+/**
+ * Choose the colors a cell keeps in addition to nBackground. The three
+ * colors are written to aKept, unused entries are set to the background.
+ *
+ * If the cell has more colors, all combinations of three of them are tried.
+ * The pixels of the other colors are replaced by the nearest color kept.
+ * Return the error of the best combination, this is 0 if the cell doesn't
+ * clash.
+ */
+unsigned BackgroundSearch::ChooseColors(const unsigned* aHistogram,
+                                        unsigned nBackground,
+                                        unsigned* aKept) const
+{
+    unsigned aColors[BACKGROUNDSEARCH_COLORS];
+    unsigned nColors, nError, nBestError, nDist, nMin, c, d, i, j, k;
+
+    nColors = 0;
+    for (c = 0; c < BACKGROUNDSEARCH_COLORS; ++c)
+    {
+        if (aHistogram[c] && c != nBackground)
+            aColors[nColors++] = c;
+    }
+
+    for (i = 0; i < BACKGROUNDSEARCH_CELL_COLORS; ++i)
+        aKept[i] = i < nColors ? aColors[i] : nBackground;
+
+    if (nColors <= BACKGROUNDSEARCH_CELL_COLORS)
+        return 0;
+
+    nBestError = ~0U;
+    for (i = 0; i < nColors - 2; ++i)
+    {
+        for (j = i + 1; j < nColors - 1; ++j)
+        {
+            for (k = j + 1; k < nColors; ++k)
+            {
+                nError = 0;
+                for (d = 0; d < nColors; ++d)
+                {
+                    if (d == i || d == j || d == k)
+                        continue;
+
+                    c    = aColors[d];
+                    nMin = m_aDistance[c][nBackground];
+                    nDist = m_aDistance[c][aColors[i]];
+                    nMin = nDist < nMin ? nDist : nMin;
+                    nDist = m_aDistance[c][aColors[j]];
+                    nMin = nDist < nMin ? nDist : nMin;
+                    nDist = m_aDistance[c][aColors[k]];
+                    nMin = nDist < nMin ? nDist : nMin;
+
+                    nError += aHistogram[c] * nMin;
+                }
+
+                if (nError < nBestError)
+                {
+                    nBestError = nError;
+                    aKept[0] = aColors[i];
+                    aKept[1] = aColors[j];
+                    aKept[2] = aColors[k];
+                }
+            }
+        }
+    }
+
+    return nBestError;
+}
+
+
+/*****************************************************************************/
+/**
+ * Add the errors of the cells nStart to nEnd - 1 for each background to
+ * aError.
+ */
+void BackgroundSearch::EvaluateCells(unsigned nStart, unsigned nEnd,
+                                     uint64_t* aError)
+{
+    unsigned aKept[BACKGROUNDSEARCH_CELL_COLORS];
+    unsigned nCell, nBg;
+
+    for (nCell = nStart; nCell < nEnd; ++nCell)
+    {
+        for (nBg = 0; nBg < BACKGROUNDSEARCH_COLORS; ++nBg)
+            aError[nBg] += ChooseColors(m_aCells[nCell].aHistogram, nBg,
+                                        aKept);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Constructor. The worker evaluates the cells nStart to nEnd - 1.
+ */
+BackgroundSearch::Worker::Worker(BackgroundSearch* pSearch, unsigned nStart,
+                                 unsigned nEnd) :
+    wxThread(wxTHREAD_JOINABLE),
+    m_pSearch(pSearch),
+    m_nStart(nStart),
+    m_nEnd(nEnd)
+{
+    memset(m_aError, 0, sizeof(m_aError));
+}
+
+
+/*****************************************************************************/
+/**
+ * Thread entry: Evaluate our cells.
+ */
+wxThread::ExitCode BackgroundSearch::Worker::Entry()
+{
+    m_pSearch->EvaluateCells(m_nStart, m_nEnd, m_aError);
+    return 0;
+}
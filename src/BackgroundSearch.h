@@ -0,0 +1,165 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef BACKGROUNDSEARCH_H
+#define BACKGROUNDSEARCH_H
+
+#include <stdint.h>
+#include <vector>
+#include <wx/thread.h>
+
+#define BACKGROUNDSEARCH_COLORS 16
+
+class MCBitmap;
+
+/*****************************************************************************/
+/**
+ * Finds the best background color for a multicolor bitmap.
+ *
+ * The input is a histogram for each cell: How many pixels of each of the
+ * 16 colors it contains. A cell can show the background color and three
+ * colors of its own. If a cell has more colors, the ones not kept must be
+ * replaced by the nearest kept color. The error of this clash is the number
+ * of replaced pixels multiplied with the squared distance of the colors.
+ *
+ * Each of the 16 backgrounds is rated by the total clash error. If two are
+ * equally good, the one which leaves more color slots free in the cells
+ * wins.
+ *
+ * Cells with up to three colors never clash, they are only counted per
+ * color when they are added. Only the other cells must be evaluated for
+ * each background, this is distributed to several threads.
+ */
+class BackgroundSearch
+{
+public:
+    BackgroundSearch();
+
+    void AddCell(const unsigned* aHistogram);
+    void AddBitmap(const MCBitmap& bitmap);
+
+    void Search();
+    void Apply(MCBitmap* pBitmap) const;
+
+    unsigned GetBackground(unsigned nRank = 0) const;
+    uint64_t GetError(unsigned nBackground) const;
+    unsigned GetSlots(unsigned nBackground) const;
+
+    unsigned ChooseColors(const unsigned* aHistogram, unsigned nBackground,
+                          unsigned* aKept) const;
+    unsigned GetDistance(unsigned nColor1, unsigned nColor2) const;
+
+protected:
+    /// Pixel counts of all colors of a cell
+    typedef struct Cell_s
+    {
+        unsigned aHistogram[BACKGROUNDSEARCH_COLORS];
+    } Cell;
+
+    class Worker : public wxThread
+    {
+    public:
+        Worker(BackgroundSearch* pSearch, unsigned nStart, unsigned nEnd);
+
+        /// Sum of the errors of our cells for each background
+        uint64_t m_aError[BACKGROUNDSEARCH_COLORS];
+
+    protected:
+        virtual ExitCode Entry();
+
+        BackgroundSearch* m_pSearch;
+        unsigned          m_nStart;
+        unsigned          m_nEnd;
+    };
+
+    void EvaluateCells(unsigned nStart, unsigned nEnd, uint64_t* aError);
+
+    /// Squared distance between each pair of C64 colors
+    unsigned            m_aDistance[BACKGROUNDSEARCH_COLORS]
+                                   [BACKGROUNDSEARCH_COLORS];
+
+    /// Cells with more than three colors, these may clash
+    std::vector<Cell>   m_aCells;
+
+    /// Number of cells with up to three colors which contain each color
+    unsigned            m_aPresent[BACKGROUNDSEARCH_COLORS];
+
+    /// Number of colors in all cells with up to three colors
+    unsigned            m_nSimpleColors;
+
+    /// Total clash error for each background
+    uint64_t            m_aError[BACKGROUNDSEARCH_COLORS];
+
+    /// Number of color slots used in all cells for each background
+    unsigned            m_aSlots[BACKGROUNDSEARCH_COLORS];
+
+    /// The backgrounds ordered from the best to the worst one
+    unsigned            m_aRanking[BACKGROUNDSEARCH_COLORS];
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the background with the given rank after Search, 0 is the best
+ * one.
+ */
+inline unsigned BackgroundSearch::GetBackground(unsigned nRank) const
+{
+    return m_aRanking[nRank];
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the total clash error of a background after Search.
+ */
+inline uint64_t BackgroundSearch::GetError(unsigned nBackground) const
+{
+    return m_aError[nBackground];
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of color slots all cells use with a background after
+ * Search.
+ */
+inline unsigned BackgroundSearch::GetSlots(unsigned nBackground) const
+{
+    return m_aSlots[nBackground];
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the squared distance between two C64 colors.
+ */
+inline unsigned BackgroundSearch::GetDistance(unsigned nColor1,
+                                              unsigned nColor2) const
+{
+    return m_aDistance[nColor1][nColor2];
+}
+
+#endif // BACKGROUNDSEARCH_H
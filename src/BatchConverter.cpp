@@ -0,0 +1,253 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#include "BatchConverter.h"
+#include "DocBase.h"
+
+
+/*****************************************************************************/
+/**
+ * Constructor.
+ */
+BatchConverter::BatchConverter() :
+    m_aJobs(),
+    m_nNextJob(0),
+    m_nFailed(0),
+    m_mutex()
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Add a conversion job for each of the source files given. Sources may
+ * contain wildcards. If there is more than one source file, the target
+ * must contain a '*', which is replaced by the name (without extension)
+ * of each source. E.g. the target "*.ami" turns "pic.koa" into "pic.ami".
+ *
+ * Return false and print a message to stderr if the arguments are not
+ * usable.
+ */
+bool BatchConverter::AddJobs(const wxArrayString& arrayIn,
+                             const wxString& stringOut)
+{
+    wxArrayString arrayFiles;
+    wxString      stringFile;
+    wxString      stringTarget;
+    size_t        i;
+
+    for (i = 0; i < arrayIn.GetCount(); ++i)
+    {
+        if (wxIsWild(arrayIn[i]))
+        {
+            stringFile = wxFindFirstFile(arrayIn[i], wxFILE);
+            if (stringFile.empty())
+            {
+                wxFprintf(stderr, wxT("%s: No matching files\n"),
+                          arrayIn[i].c_str());
+                return false;
+            }
+            while (!stringFile.empty())
+            {
+                arrayFiles.Add(stringFile);
+                stringFile = wxFindNextFile();
+            }
+        }
+        else
+        {
+            arrayFiles.Add(arrayIn[i]);
+        }
+    }
+
+    if (arrayFiles.GetCount() > 1 && stringOut.Find(wxT('*')) == wxNOT_FOUND)
+    {
+        wxFprintf(stderr,
+                  wxT("%s: The target must contain '*' when converting "
+                      "more than one file\n"), stringOut.c_str());
+        return false;
+    }
+
+    for (i = 0; i < arrayFiles.GetCount(); ++i)
+    {
+        stringTarget = stringOut;
+        stringTarget.Replace(wxT("*"), wxFileName(arrayFiles[i]).GetName());
+        AddJob(arrayFiles[i], stringTarget);
+    }
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Convert all files, using up to nThreads threads. 0 means one thread per
+ * CPU. The calling thread does its share of the work.
+ *
+ * Return the exit code for the application: 0 if all files have been
+ * converted, 1 otherwise.
+ */
+int BatchConverter::Run(unsigned nThreads)
+{
+    std::vector<Worker*> apWorkers;
+    Worker*              pWorker;
+    int                  nCPUs;
+    size_t               i;
+
+    if (nThreads == 0)
+    {
+        nCPUs = wxThread::GetCPUCount();
+        nThreads = nCPUs > 0 ? nCPUs : 1;
+    }
+    if (nThreads > m_aJobs.size())
+        nThreads = m_aJobs.size();
+
+    m_nNextJob = 0;
+    m_nFailed  = 0;
+
+    for (i = 1; i < nThreads; ++i)
+    {
+        pWorker = new Worker(this);
+        if (pWorker->Create() != wxTHREAD_NO_ERROR ||
+            pWorker->Run() != wxTHREAD_NO_ERROR)
+        {
+            // go on with the threads we have got
+            delete pWorker;
+            break;
+        }
+        apWorkers.push_back(pWorker);
+    }
+
+    RunJobs();
+
+    for (i = 0; i < apWorkers.size(); ++i)
+    {
+        apWorkers[i]->Wait();
+        delete apWorkers[i];
+    }
+
+    return m_nFailed ? 1 : 0;
+}
+
+
+/*****************************************************************************/
+/**
+ * Add a single job to the list.
+ */
+void BatchConverter::AddJob(const wxString& stringIn,
+                            const wxString& stringOut)
+{
+    Job job;
+
+    job.stringIn  = stringIn;
+    job.stringOut = stringOut;
+    m_aJobs.push_back(job);
+}
+
+
+/*****************************************************************************/
+/**
+ * Take jobs from the list and convert them until the list is exhausted.
+ * This is run by all worker threads and by the main thread.
+ */
+void BatchConverter::RunJobs()
+{
+    Job job;
+
+    while (GetNextJob(&job))
+    {
+        if (!Convert(job))
+        {
+            wxMutexLocker lock(m_mutex);
+            ++m_nFailed;
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Take the next job from the list. Return false if there are no more jobs.
+ */
+bool BatchConverter::GetNextJob(Job* pJob)
+{
+    wxMutexLocker lock(m_mutex);
+
+    if (m_nNextJob >= m_aJobs.size())
+        return false;
+
+    // wxString shares its buffer between copies without locking, so
+    // make a deep copy for the worker thread
+    pJob->stringIn  = m_aJobs[m_nNextJob].stringIn.c_str();
+    pJob->stringOut = m_aJobs[m_nNextJob].stringOut.c_str();
+    ++m_nNextJob;
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Load the source file of the job and save it to the target file.
+ * Return true for success. DocBase reports errors on stderr.
+ */
+bool BatchConverter::Convert(const Job& job)
+{
+    DocBase* pDoc;
+    bool     bSaved;
+
+    pDoc = DocBase::Load(job.stringIn);
+    if (!pDoc)
+        return false;
+
+    bSaved = pDoc->Save(job.stringOut);
+    delete pDoc;
+
+    return bSaved;
+}
+
+
+/*****************************************************************************/
+/**
+ * Constructor of a worker thread. It must be joined using Wait().
+ */
+BatchConverter::Worker::Worker(BatchConverter* pConverter) :
+    wxThread(wxTHREAD_JOINABLE),
+    m_pConverter(pConverter)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Thread function of the worker.
+ */
+wxThread::ExitCode BatchConverter::Worker::Entry()
+{
+    m_pConverter->RunJobs();
+    return 0;
+}
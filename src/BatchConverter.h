@@ -0,0 +1,100 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef BATCHCONVERTER_H
+#define BATCHCONVERTER_H
+
+#include <vector>
+#include <wx/string.h>
+#include <wx/arrstr.h>
+#include <wx/thread.h>
+
+/*****************************************************************************/
+/**
+ * Converts image files from the command line without any GUI.
+ *
+ * Each job loads a file with DocBase::Load, which finds the format, and
+ * saves it with DocBase::Save, which takes the sub-format from the
+ * extension of the target name. The jobs are independent from each other,
+ * so they are distributed to a number of worker threads. Errors are
+ * reported on stderr by DocBase in batch mode.
+ */
+class BatchConverter
+{
+public:
+    BatchConverter();
+
+    bool AddJobs(const wxArrayString& arrayIn, const wxString& stringOut);
+    size_t GetJobCount() const;
+
+    int Run(unsigned nThreads);
+
+protected:
+    typedef struct Job_s
+    {
+        wxString stringIn;
+        wxString stringOut;
+    } Job;
+
+    class Worker : public wxThread
+    {
+    public:
+        Worker(BatchConverter* pConverter);
+
+    protected:
+        virtual ExitCode Entry();
+
+        BatchConverter* m_pConverter;
+    };
+
+    void AddJob(const wxString& stringIn, const wxString& stringOut);
+    void RunJobs();
+    bool GetNextJob(Job* pJob);
+    static bool Convert(const Job& job);
+
+    /// All files to be converted
+    std::vector<Job>    m_aJobs;
+
+    /// Index of the next job to be taken by a worker
+    size_t              m_nNextJob;
+
+    /// Number of jobs which failed
+    unsigned            m_nFailed;
+
+    /// Protects m_nNextJob and m_nFailed while the workers are running
+    wxMutex             m_mutex;
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the number of files to be converted.
+ */
+inline size_t BatchConverter::GetJobCount() const
+{
+    return m_aJobs.size();
+}
+
+#endif // BATCHCONVERTER_H
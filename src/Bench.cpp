@@ -0,0 +1,772 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifdef MC_BENCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <wx/stopwatch.h>
+#include <wx/thread.h>
+
+#include "Bench.h"
+#include "FLIDoc.h"
+#include "AFLIDoc.h"
+#include "Cruncher.h"
+
+/// Each case runs at least this long to get stable numbers
+#define MC_BENCH_MIN_MS 250
+
+/// Number of undo steps recorded and replayed by CheckUndo
+#define MC_BENCH_UNDO_STEPS 20
+
+#if __cplusplus >= 201103L
+#define MC_BENCH_THROW_BAD_ALLOC
+#define MC_BENCH_NOTHROW noexcept
+#else
+#define MC_BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define MC_BENCH_NOTHROW throw()
+#endif
+
+/// Number of allocations since the last reset, counted by operator new
+static unsigned long m_nAllocs;
+
+/// Number of bytes allocated since the last reset
+static unsigned long m_nAllocBytes;
+
+/*****************************************************************************/
+/*
+ * Replacements of the global allocation functions which count the
+ * allocations of the main thread, the benchmarks run there. Allocations of
+ * other threads, e.g. workers started by the code under test, are not
+ * counted, so the counters need no locking.
+ */
+void* operator new(size_t size) MC_BENCH_THROW_BAD_ALLOC
+{
+    void* p;
+
+    if (wxThread::IsMain())
+    {
+        ++m_nAllocs;
+        m_nAllocBytes += size;
+    }
+
+    p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) MC_BENCH_THROW_BAD_ALLOC
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) MC_BENCH_NOTHROW
+{
+    free(p);
+}
+
+void operator delete[](void* p) MC_BENCH_NOTHROW
+{
+    free(p);
+}
+
+/*****************************************************************************/
+/**
+ * All benchmark cases in the order they are run.
+ */
+const Bench::Case Bench::m_aCases[] =
+{
+    { "SetPixel/Ignore",    &Bench::PrepareRandom, &Bench::RunSetPixel,
+      MCDrawingModeIgnore },
+    { "SetPixel/Force",     &Bench::PrepareRandom, &Bench::RunSetPixel,
+      MCDrawingModeForce },
+    { "SetPixel/Least",     &Bench::PrepareRandom, &Bench::RunSetPixel,
+      MCDrawingModeLeast },
+    { "SetPixel/Index0",    &Bench::PrepareRandom, &Bench::RunSetPixel,
+      MCDrawingModeIndex0 },
+    { "SetPixel/Index1",    &Bench::PrepareRandom, &Bench::RunSetPixel,
+      MCDrawingModeIndex1 },
+    { "SetPixel/Index2",    &Bench::PrepareRandom, &Bench::RunSetPixel,
+      MCDrawingModeIndex2 },
+    { "SetPixel/Index3",    &Bench::PrepareRandom, &Bench::RunSetPixel,
+      MCDrawingModeIndex3 },
+    { "Line",               &Bench::PrepareRandom, &Bench::RunLine, 0 },
+    { "Rectangle",          &Bench::PrepareRandom, &Bench::RunRectangle, 0 },
+    { "FloodFill",          &Bench::PrepareFill,   &Bench::RunFloodFill, 0 },
+    { "LoadKoala",          &Bench::PrepareCodec,  &Bench::RunLoadKoala, 0 },
+    { "LoadAmica",          &Bench::PrepareCodec,  &Bench::RunLoadAmica, 0 },
+    { "SaveAmica",          &Bench::PrepareCodec,  &Bench::RunSaveAmica, 0 },
+    { "CrunchKoala",        &Bench::PrepareCodec,  &Bench::RunCrunchKoala, 0 },
+    { "PrepareUndo",        &Bench::PrepareHistory, &Bench::RunPrepareUndo, 0 },
+    { "Undo+Redo",          &Bench::PrepareHistory, &Bench::RunUndo, 0 },
+    { "LinePreview",        &Bench::PrepareRandom, &Bench::RunLinePreview, 0 },
+    { "LinePreview/16",     &Bench::PrepareRender, &Bench::RunLinePreview, 16 },
+    { "AddDirtyRect",       &Bench::PrepareRandom, &Bench::RunDirtyRects, 0 },
+    { "RefreshDirty/16",    &Bench::PrepareRender, &Bench::RunRefreshDirty, 16 },
+    { "DrawScaleSmall/1",   &Bench::PrepareRender, &Bench::RunDrawSmall, 1 },
+    { "DrawScaleSmall/2",   &Bench::PrepareRender, &Bench::RunDrawSmall, 2 },
+    { "DrawScaleSmall/1/TV", &Bench::PrepareRender, &Bench::RunDrawSmallTV, 1 },
+    { "DrawScaleSmall/2/TV", &Bench::PrepareRender, &Bench::RunDrawSmallTV, 2 },
+    { "DrawScaleBig/4",     &Bench::PrepareRender, &Bench::RunDrawBig, 4 },
+    { "DrawScaleBig/8",     &Bench::PrepareRender, &Bench::RunDrawBig, 8 },
+    { "DrawScaleBig/16",    &Bench::PrepareRender, &Bench::RunDrawBig, 16 },
+    { NULL, NULL, NULL, 0 }
+};
+
+
+/*****************************************************************************/
+/**
+ * Constructor.
+ */
+Bench::Bench() :
+    m_nRandom(0),
+    m_doc(),
+    m_renderer(),
+    m_aKoala(),
+    m_aAmica(),
+    m_aBuffer(),
+    m_bitmapRender(),
+    m_dcRender()
+{
+    m_renderer.SetDoc(&m_doc);
+}
+
+
+/*****************************************************************************/
+/**
+ * Destructor.
+ */
+Bench::~Bench()
+{
+    m_dcRender.SelectObject(wxNullBitmap);
+    m_renderer.SetDoc(NULL);
+}
+
+
+/*****************************************************************************/
+/**
+ * Run the checks and all benchmarks and print the results to stdout.
+ *
+ * Return the exit code for the application.
+ */
+int Bench::Run()
+{
+    Bench       bench;
+    FLIDoc      docFLI;
+    AFLIDoc     docAFLI;
+    const Case* pCase;
+    bool        bOK;
+
+    printf("# name\tops\tns/op\tallocs/op\tbytes/op\n");
+
+    bOK = bench.CheckUndo(&bench.m_doc, "MC");
+    bOK = bench.CheckUndo(&docFLI, "FLI") && bOK;
+    bOK = bench.CheckUndo(&docAFLI, "AFLI") && bOK;
+
+    for (pCase = m_aCases; pCase->pName; ++pCase)
+    {
+        bench.RunCase(pCase);
+    }
+
+    return bOK ? 0 : 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Prepare a case and run it with an increasing number of operations until
+ * it takes long enough. Print the result.
+ */
+void Bench::RunCase(const Case* pCase)
+{
+    wxStopWatch   watch;
+    unsigned      nOps;
+    unsigned long nAllocs, nAllocBytes;
+    long          ms;
+
+    m_nRandom = 1;
+    (this->*pCase->prepare)(pCase->param);
+
+    nOps = 1;
+    for (;;)
+    {
+        m_nAllocs     = 0;
+        m_nAllocBytes = 0;
+        watch.Start();
+
+        (this->*pCase->run)(nOps, pCase->param);
+
+        ms          = watch.Time();
+        nAllocs     = m_nAllocs;
+        nAllocBytes = m_nAllocBytes;
+
+        if (ms >= MC_BENCH_MIN_MS || nOps >= 0x10000000)
+            break;
+
+        // aim a bit above the minimum time
+        if (ms < 10)
+            nOps *= 16;
+        else
+            nOps = nOps * (MC_BENCH_MIN_MS * 5 / 4) / ms + 1;
+    }
+
+    printf("%s\t%u\t%.1f\t%.2f\t%.1f\n", pCase->pName, nOps,
+           ms * 1e6 / nOps, (double) nAllocs / nOps,
+           (double) nAllocBytes / nOps);
+    fflush(stdout);
+}
+
+
+/*****************************************************************************/
+/**
+ * A simple linear congruential generator, good enough to spread the
+ * coordinates.
+ */
+unsigned Bench::Random()
+{
+    m_nRandom = m_nRandom * 1103515245u + 12345u;
+    return m_nRandom >> 8;
+}
+
+
+/*****************************************************************************/
+/**
+ * Draw random lines and pixels into the document in MC_BENCH_UNDO_STEPS
+ * undo steps. Then undo all of them and redo them again, after each step
+ * the bitmap must be in the state recorded for it. This catches cells which
+ * share data, like the color RAM of FLI, being recorded wrongly.
+ *
+ * Print the result as comment line, return true if the check passed.
+ */
+bool Bench::CheckUndo(DocBase* pDoc, const char* pName)
+{
+    BitmapBase* pB = pDoc->GetBitmap();
+    std::vector<std::vector<uint8_t> > aStates(MC_BENCH_UNDO_STEPS + 1);
+    std::vector<uint8_t> aState;
+    unsigned    nStep, i, nErrors;
+
+    m_nRandom = 1;
+    pDoc->ClearUndoBuffer();
+    pDoc->PrepareUndo();
+    GetCells(pB, &aStates[0]);
+
+    for (nStep = 1; nStep <= MC_BENCH_UNDO_STEPS; ++nStep)
+    {
+        for (i = 0; i < 4; ++i)
+        {
+            pB->Line(Random() % pB->GetWidth(), Random() % pB->GetHeight(),
+                     Random() % pB->GetWidth(), Random() % pB->GetHeight(),
+                     C64Color(Random() & 0x0f), MCDrawingModeLeast);
+            pB->SetPixel(Random() % pB->GetWidth(), Random() % pB->GetHeight(),
+                         C64Color(Random() & 0x0f), MCDrawingModeLeast);
+        }
+        pDoc->PrepareUndo();
+        GetCells(pB, &aStates[nStep]);
+    }
+
+    nErrors = 0;
+    for (nStep = MC_BENCH_UNDO_STEPS; nStep > 0; --nStep)
+    {
+        pDoc->Undo();
+        GetCells(pB, &aState);
+        if (aState != aStates[nStep - 1])
+            ++nErrors;
+    }
+
+    for (nStep = 1; nStep <= MC_BENCH_UNDO_STEPS; ++nStep)
+    {
+        pDoc->Redo();
+        GetCells(pB, &aState);
+        if (aState != aStates[nStep])
+            ++nErrors;
+    }
+
+    printf("# check Undo+Redo/%s: %s\n", pName, nErrors ? "FAILED" : "ok");
+    fflush(stdout);
+
+    return nErrors == 0;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the global data and the data of all cells of the bitmap to pData.
+ */
+void Bench::GetCells(const BitmapBase* pBitmap, std::vector<uint8_t>* pData)
+{
+    unsigned nGlobalSize, nCellSize, pos;
+    int      xCell, yCell;
+
+    nGlobalSize = pBitmap->GetGlobalDataSize();
+    nCellSize   = pBitmap->GetCellDataSize();
+
+    pData->resize(nGlobalSize +
+                  nCellSize * (pBitmap->GetWidth() / pBitmap->GetCellWidth()) *
+                  (pBitmap->GetHeight() / pBitmap->GetCellHeight()));
+    pBitmap->GetGlobalData(&(*pData)[0]);
+
+    pos = nGlobalSize;
+    for (yCell = 0; yCell < pBitmap->GetHeight() / pBitmap->GetCellHeight();
+         ++yCell)
+    {
+        for (xCell = 0; xCell < pBitmap->GetWidth() / pBitmap->GetCellWidth();
+             ++xCell)
+        {
+            pBitmap->GetCellData(xCell, yCell, &(*pData)[pos]);
+            pos += nCellSize;
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Fill the bitmap with random data.
+ */
+void Bench::PrepareRandom(int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < 8000; ++i)
+        m_doc.GetMCBitmap()->SetBitmapRAM(i, Random());
+
+    for (i = 0; i < 1000; ++i)
+    {
+        m_doc.GetMCBitmap()->SetScreenRAM(i, Random());
+        m_doc.GetMCBitmap()->SetColorRAM(i, Random());
+    }
+    m_doc.GetMCBitmap()->SetBackground(C64Color(0));
+}
+
+
+/*****************************************************************************/
+/**
+ * Clear the bitmap and draw some lines to get a few large areas.
+ */
+void Bench::PrepareFill(int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < 8000; ++i)
+        m_doc.GetMCBitmap()->SetBitmapRAM(i, 0);
+
+    for (i = 0; i < 8; ++i)
+    {
+        m_doc.GetMCBitmap()->Line(Random() % MC_X, Random() % MC_Y,
+                                  Random() % MC_X, Random() % MC_Y,
+                                  C64Color(1), MCDrawingModeLeast);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Fill the bitmap with random data and create the Koala and Amica images.
+ */
+void Bench::PrepareCodec(int param)
+{
+    PrepareRandom(param);
+
+    m_doc.SaveKoala(&m_aKoala);
+    m_doc.SaveAmica(&m_aAmica);
+}
+
+
+/*****************************************************************************/
+/**
+ * Fill the bitmap with random data and create some undo steps.
+ */
+void Bench::PrepareHistory(int param)
+{
+    unsigned i;
+
+    PrepareRandom(param);
+    m_doc.ClearUndoBuffer();
+    m_doc.PrepareUndo();
+
+    for (i = 0; i < 16; ++i)
+    {
+        RunLine(1, 0);
+        m_doc.PrepareUndo();
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Fill the bitmap with random data and create an offscreen DC large enough
+ * for the zoom level given.
+ */
+void Bench::PrepareRender(int nZoom)
+{
+    const BitmapBase* pB = m_doc.GetBitmap();
+
+    PrepareRandom(nZoom);
+
+    m_dcRender.SelectObject(wxNullBitmap);
+    m_bitmapRender.Create(pB->GetWidth() * pB->GetPixelXFactor() * nZoom + 1,
+                          pB->GetHeight() * pB->GetPixelYFactor() * nZoom + 1);
+    m_dcRender.SelectObject(m_bitmapRender);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set pixels at random positions. This is MCBitmap::SetPixel, which finds
+ * the cell and lets MCBlock::SetPixel do the work.
+ */
+void Bench::RunSetPixel(unsigned nOps, int mode)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        m_doc.GetMCBitmap()->SetPixel(Random() % MC_X, Random() % MC_Y,
+                                      C64Color(Random() & 0x0f),
+                                      (MCDrawingMode) mode);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Draw lines between random positions.
+ */
+void Bench::RunLine(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        m_doc.GetMCBitmap()->Line(Random() % MC_X, Random() % MC_Y,
+                                  Random() % MC_X, Random() % MC_Y,
+                                  C64Color(Random() & 0x0f),
+                                  MCDrawingModeLeast);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Draw rectangles between random positions.
+ */
+void Bench::RunRectangle(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        m_doc.GetMCBitmap()->Rectangle(Random() % MC_X, Random() % MC_Y,
+                                       Random() % MC_X, Random() % MC_Y,
+                                       C64Color(Random() & 0x0f),
+                                       MCDrawingModeLeast);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Fill the same area over and over again, alternating between two colors.
+ */
+void Bench::RunFloodFill(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        m_doc.GetMCBitmap()->FloodFill(MC_X / 2, MC_Y / 2,
+                                       C64Color(2 + (i & 1)),
+                                       MCDrawingModeForce);
+    }
+}
+
+
+/*****************************************************************************/
+void Bench::RunLoadKoala(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+        m_doc.LoadKoala(&m_aKoala[0], m_aKoala.size());
+}
+
+
+/*****************************************************************************/
+void Bench::RunLoadAmica(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+        m_doc.LoadAmica(&m_aAmica[0], m_aAmica.size());
+}
+
+
+/*****************************************************************************/
+void Bench::RunSaveAmica(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+        m_doc.SaveAmica(&m_aBuffer);
+}
+
+
+/*****************************************************************************/
+/**
+ * Crunch the Koala image into a self-decrunching PRG.
+ */
+void Bench::RunCrunchKoala(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+        Cruncher::CrunchPRG(m_aKoala, &m_aBuffer);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set a pixel and record it as undo step, like a tool does.
+ */
+void Bench::RunPrepareUndo(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        RunSetPixel(1, MCDrawingModeLeast);
+        m_doc.PrepareUndo();
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Undo the last step and redo it.
+ */
+void Bench::RunUndo(unsigned nOps, int /* param */)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        m_doc.Undo();
+        m_doc.Redo();
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Preview a line from a fixed start point, like ToolLines does for each
+ * mouse move. If nZoom is not 0, the renderer draws the areas refreshed
+ * at this zoom level.
+ */
+void Bench::RunLinePreview(unsigned nOps, int nZoom)
+{
+    std::vector<wxPoint> aPoints;
+    unsigned i;
+
+    m_renderer.m_pRedrawDC   = nZoom ? &m_dcRender : NULL;
+    m_renderer.m_nRedrawZoom = nZoom;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        aPoints.clear();
+        BitmapBase::GetLinePoints(MC_X / 2, MC_Y / 2,
+                                  Random() % MC_X, Random() % MC_Y, &aPoints);
+        m_doc.SetPreview(aPoints, 1);
+    }
+    m_doc.ClearPreview();
+
+    m_renderer.m_pRedrawDC = NULL;
+}
+
+
+/*****************************************************************************/
+/**
+ * Collect the pixels of random freehand strokes as areas to be redrawn,
+ * like a canvas does. They are taken every 64 pixels, i.e. once per frame.
+ */
+void Bench::RunDirtyRects(unsigned nOps, int /* param */)
+{
+    std::vector<wxRect> aRects;
+    unsigned i;
+    int      x, y;
+
+    x = MC_X / 2;
+    y = MC_Y / 2;
+    for (i = 0; i < nOps; ++i)
+    {
+        // a new stroke now and then, otherwise go to a neighbour pixel
+        if (Random() % 256 == 0)
+        {
+            x = Random() % MC_X;
+            y = Random() % MC_Y;
+        }
+        else
+        {
+            x = (x + MC_X + Random() % 3 - 1) % MC_X;
+            y = (y + MC_Y + Random() % 3 - 1) % MC_Y;
+        }
+
+        m_renderer.AddDirtyRect(x, y, x, y);
+        if (i % 64 == 63)
+            m_renderer.TakeDirtyRects(&aRects);
+    }
+    m_renderer.TakeDirtyRects(&aRects);
+}
+
+
+/*****************************************************************************/
+/**
+ * Change two pixels in opposite corners of the bitmap and refresh the
+ * dirty area, like a frame of drawing with two distant changes. The
+ * renderer draws the areas refreshed at zoom level nZoom.
+ */
+void Bench::RunRefreshDirty(unsigned nOps, int nZoom)
+{
+    unsigned i;
+
+    m_renderer.m_pRedrawDC   = &m_dcRender;
+    m_renderer.m_nRedrawZoom = nZoom;
+
+    for (i = 0; i < nOps; ++i)
+    {
+        m_doc.GetMCBitmap()->SetPixel(Random() % 8, Random() % 8,
+                                      C64Color(Random() & 0x0f),
+                                      MCDrawingModeLeast);
+        m_doc.GetMCBitmap()->SetPixel(MC_X - 1 - Random() % 8,
+                                      MC_Y - 1 - Random() % 8,
+                                      C64Color(Random() & 0x0f),
+                                      MCDrawingModeLeast);
+        m_doc.RefreshDirty();
+    }
+
+    m_renderer.m_pRedrawDC = NULL;
+}
+
+
+/*****************************************************************************/
+/**
+ * Render the whole bitmap at zoom 1:1 or 2:1 without TV emulation.
+ */
+void Bench::RunDrawSmall(unsigned nOps, int nZoom)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+        m_renderer.DrawSmall(&m_dcRender, nZoom, false);
+}
+
+
+/*****************************************************************************/
+/**
+ * Render the whole bitmap at zoom 1:1 or 2:1 with TV emulation.
+ */
+void Bench::RunDrawSmallTV(unsigned nOps, int nZoom)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+        m_renderer.DrawSmall(&m_dcRender, nZoom, true);
+}
+
+
+/*****************************************************************************/
+/**
+ * Render the whole bitmap at zoom 4:1 or more.
+ */
+void Bench::RunDrawBig(unsigned nOps, int nZoom)
+{
+    unsigned i;
+
+    for (i = 0; i < nOps; ++i)
+        m_renderer.DrawBig(&m_dcRender, nZoom);
+}
+
+
+/*****************************************************************************/
+/**
+ * Constructor.
+ */
+Bench::Renderer::Renderer() :
+    m_pRedrawDC(NULL),
+    m_nRedrawZoom(1)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Usually nothing to do, we render on demand only. If m_pRedrawDC is set,
+ * the area is drawn like a canvas does when it gets a refresh request.
+ */
+void Bench::Renderer::RedrawDoc(int x1, int y1, int x2, int y2)
+{
+    if (!m_pRedrawDC)
+        return;
+
+    if (m_nRedrawZoom <= 2)
+        DrawScaleSmall(m_pRedrawDC, m_nRedrawZoom, false, x1, y1, x2, y2);
+    else
+        DrawScaleBig(m_pRedrawDC, m_nRedrawZoom, x1, y1, x2, y2);
+}
+
+
+/*****************************************************************************/
+void Bench::Renderer::OnDocMouseMoved(int /* x */, int /* y */)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Render the whole bitmap using DrawScaleSmall.
+ */
+void Bench::Renderer::DrawSmall(wxDC* pDC, unsigned nZoom, bool bEmulateTV)
+{
+    const BitmapBase* pB = m_pDoc->GetBitmap();
+
+    DrawScaleSmall(pDC, nZoom, bEmulateTV,
+                   0, 0, pB->GetWidth() - 1, pB->GetHeight() - 1);
+}
+
+
+/*****************************************************************************/
+/**
+ * Render the whole bitmap using DrawScaleBig.
+ */
+void Bench::Renderer::DrawBig(wxDC* pDC, unsigned nZoom)
+{
+    const BitmapBase* pB = m_pDoc->GetBitmap();
+
+    DrawScaleBig(pDC, nZoom,
+                 0, 0, pB->GetWidth() - 1, pB->GetHeight() - 1);
+}
+
+#endif // MC_BENCH
@@ -0,0 +1,139 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#ifdef MC_BENCH
+
+#include <vector>
+#include <wx/bitmap.h>
+#include <wx/dcmemory.h>
+
+#include "MCDoc.h"
+#include "DocRenderer.h"
+
+/*****************************************************************************/
+/**
+ * Micro benchmarks for the hot paths of bitmap, codecs, undo and renderer.
+ * Only compiled in with MC_BENCH ("make bench"), because it replaces the
+ * global operator new to count allocations.
+ *
+ * Each case is repeated until it ran for at least MC_BENCH_MIN_MS. The
+ * results are written to stdout as tab separated values, one line per
+ * case: name, operations, ns/op, allocations/op, bytes allocated/op.
+ *
+ * Before the benchmarks, CheckUndo makes sure that undo and redo restore
+ * the right cells over several steps. The results are printed as comment
+ * lines, a failure makes Run return 1.
+ */
+class Bench
+{
+public:
+    Bench();
+    ~Bench();
+
+    static int Run();
+
+protected:
+    /// A renderer which makes the drawing functions accessible
+    class Renderer : public DocRenderer
+    {
+    public:
+        Renderer();
+
+        using DocRenderer::AddDirtyRect;
+        using DocRenderer::TakeDirtyRects;
+
+        virtual void RedrawDoc(int x1, int y1, int x2, int y2);
+        virtual void OnDocMouseMoved(int x, int y);
+
+        void DrawSmall(wxDC* pDC, unsigned nZoom, bool bEmulateTV);
+        void DrawBig(wxDC* pDC, unsigned nZoom);
+
+        /// If not NULL, RedrawDoc draws the area to it at m_nRedrawZoom
+        wxDC*       m_pRedrawDC;
+        unsigned    m_nRedrawZoom;
+    };
+
+    typedef struct Case_s
+    {
+        const char* pName;
+        void (Bench::*prepare)(int param);
+        void (Bench::*run)(unsigned nOps, int param);
+        int param;
+    } Case;
+
+    void RunCase(const Case* pCase);
+    unsigned Random();
+
+    bool CheckUndo(DocBase* pDoc, const char* pName);
+    static void GetCells(const BitmapBase* pBitmap,
+                         std::vector<uint8_t>* pData);
+
+    void PrepareRandom(int param);
+    void PrepareFill(int param);
+    void PrepareCodec(int param);
+    void PrepareHistory(int param);
+    void PrepareRender(int param);
+
+    void RunSetPixel(unsigned nOps, int mode);
+    void RunLine(unsigned nOps, int param);
+    void RunRectangle(unsigned nOps, int param);
+    void RunFloodFill(unsigned nOps, int param);
+    void RunLoadKoala(unsigned nOps, int param);
+    void RunLoadAmica(unsigned nOps, int param);
+    void RunSaveAmica(unsigned nOps, int param);
+    void RunCrunchKoala(unsigned nOps, int param);
+    void RunPrepareUndo(unsigned nOps, int param);
+    void RunUndo(unsigned nOps, int param);
+    void RunLinePreview(unsigned nOps, int param);
+    void RunDirtyRects(unsigned nOps, int param);
+    void RunRefreshDirty(unsigned nOps, int nZoom);
+    void RunDrawSmall(unsigned nOps, int nZoom);
+    void RunDrawSmallTV(unsigned nOps, int nZoom);
+    void RunDrawBig(unsigned nOps, int nZoom);
+
+    static const Case m_aCases[];
+
+    /// State of the pseudo random generator, fixed seed for each case
+    unsigned            m_nRandom;
+
+    MCDoc               m_doc;
+    Renderer            m_renderer;
+
+    /// Koala and Amica images of m_doc, target buffer for saving
+    std::vector<uint8_t> m_aKoala;
+    std::vector<uint8_t> m_aAmica;
+    std::vector<uint8_t> m_aBuffer;
+
+    /// Offscreen DC for the renderer
+    wxBitmap            m_bitmapRender;
+    wxMemoryDC          m_dcRender;
+};
+
+#endif // MC_BENCH
+
+#endif // BENCH_H
@@ -23,6 +23,11 @@
  * Thomas Giesel skoe@directbox.com
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
 #include "BitmapBase.h"
 #include "C64Color.h"
 
@@ -32,7 +37,24 @@
  * Constructor.
  */
 BitmapBase::BitmapBase() :
-    m_rectDirty(wxRect(-1, -1, 0, 0))
+    m_rectDirty(wxRect(-1, -1, 0, 0)),
+    m_aDirtyCells(),
+    m_rectChanged(wxRect(-1, -1, 0, 0)),
+    m_aChangedCells(),
+    m_nBitsCellWidth(1),
+    m_nBitsCellHeight(1),
+    m_nBitsXCells(0),
+    m_nBitsYCells(0)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Destructor. Copies are deleted through this base class, e.g. by the
+ * undo buffer.
+ */
+BitmapBase::~BitmapBase()
 {
 }
 
@@ -80,6 +102,107 @@ int BitmapBase::GetPixelYFactor() const
 }
 
 
+/*****************************************************************************/
+/**
+ * Return the number of pixels at the left border which are not shown by a
+ * real C64, e.g. the FLI bug. Most modes don't have such an area.
+ */
+int BitmapBase::GetBugAreaWidth() const
+{
+    return 0;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of frames shown alternately to mix colors, e.g. 2 for
+ * interlaced pictures. Most modes have a single frame.
+ */
+int BitmapBase::GetNFrames() const
+{
+    return 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the frame which is changed by SetPixel or -1 if all frames are
+ * changed at once.
+ */
+int BitmapBase::GetEditFrame() const
+{
+    return -1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Select the frame to be changed by SetPixel, -1 for all frames. Bitmaps
+ * with a single frame ignore this.
+ */
+void BitmapBase::SetEditFrame(int /* nFrame */)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store the data which is not related
+ * to a cell but to the whole bitmap, e.g. the background color. Bitmaps
+ * which do not have such data return 0.
+ */
+unsigned BitmapBase::GetGlobalDataSize() const
+{
+    return 0;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the global data of this bitmap to pData, which must be large enough
+ * to hold GetGlobalDataSize() bytes.
+ */
+void BitmapBase::GetGlobalData(unsigned char* /* pData */) const
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the global data of this bitmap from pData.
+ */
+void BitmapBase::SetGlobalData(const unsigned char* /* pData */)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ *
+ * This default implementation calls GetColor for each pixel, bitmaps
+ * should implement a faster version which works cell by cell.
+ */
+void BitmapBase::GetColorRow(int x, int y, int w, unsigned char* pDest) const
+{
+    while (w-- > 0)
+        *pDest++ = GetColor(x++, y)->GetColor();
+}
+
+
+/*****************************************************************************/
+/**
+ * Like GetColorRow, but for the frame nFrame (0..GetNFrames() - 1) of an
+ * interlaced bitmap. Bitmaps with a single frame return their colors.
+ */
+void BitmapBase::GetFrameColorRow(int /* nFrame */, int x, int y, int w,
+                                  unsigned char* pDest) const
+{
+    GetColorRow(x, y, w, pDest);
+}
+
+
 /*****************************************************************************/
 /*
  * Sort and clip these coordinates so that x1/y1 <= x2/y2 and all of them are
@@ -131,46 +254,226 @@ void BitmapBase::SortAndClip(int* px1, int* py1, int* px2, int* py2)
  */
 void BitmapBase::ResetDirty()
 {
+    m_aDirtyCells.clear();
     m_rectDirty = wxRect(-1, -1, 0, 0);
 }
 
 /*****************************************************************************/
 /**
- * Extend the dirty area to contain x/y.
+ * Extend the dirty area and the changed area to contain x/y.
  */
 void BitmapBase::Dirty(int x, int y)
+{
+    Dirty(x, y, 1, 1);
+}
+
+
+/*****************************************************************************/
+/**
+ * Extend the dirty area and the changed area to contain x/y/w/h.
+ */
+void BitmapBase::Dirty(int x, int y, int w, int h)
 {
     if (m_rectDirty.GetRight() < 0)
+        m_rectDirty = wxRect(x, y, w, h);
+    else
+        m_rectDirty.Union(wxRect(x, y, w, h));
+
+    if (m_rectChanged.GetRight() < 0)
+        m_rectChanged = wxRect(x, y, w, h);
+    else
+        m_rectChanged.Union(wxRect(x, y, w, h));
+
+    MarkCells(x, y, w, h);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the dirty and the changed bits of all cells which overlap x/y/w/h.
+ *
+ * This is called for each pixel drawn, so the size of the bitmap and of its
+ * cells is only asked for when a bit set is empty, i.e. after the last
+ * ResetDirty() or ResetChanged(). A bitmap which changes its size must
+ * reset both areas. A partial cell at the right or bottom border counts as
+ * part of the last cell.
+ */
+void BitmapBase::MarkCells(int x, int y, int w, int h)
+{
+    int      xCell, yCell, x1, y1, x2, y2;
+    unsigned nWords, cell, bit;
+
+    if (m_aDirtyCells.empty() || m_aChangedCells.empty())
     {
-        m_rectDirty.SetX(x);
-        m_rectDirty.SetY(y);
-        m_rectDirty.SetWidth(1);
-        m_rectDirty.SetHeight(1);
+        m_nBitsCellWidth  = GetCellWidth();
+        m_nBitsCellHeight = GetCellHeight();
+        m_nBitsXCells     = GetWidth() / m_nBitsCellWidth;
+        m_nBitsYCells     = GetHeight() / m_nBitsCellHeight;
+
+        nWords = (m_nBitsXCells * m_nBitsYCells + 31) / 32;
+        if (m_aDirtyCells.empty())
+            m_aDirtyCells.assign(nWords, 0);
+        if (m_aChangedCells.empty())
+            m_aChangedCells.assign(nWords, 0);
     }
-    else
+
+    if (w <= 0 || h <= 0 || x + w <= 0 || y + h <= 0)
+        return;
+
+    x1 = std::min(std::max(x / m_nBitsCellWidth, 0), m_nBitsXCells - 1);
+    y1 = std::min(std::max(y / m_nBitsCellHeight, 0), m_nBitsYCells - 1);
+    x2 = std::min((x + w - 1) / m_nBitsCellWidth, m_nBitsXCells - 1);
+    y2 = std::min((y + h - 1) / m_nBitsCellHeight, m_nBitsYCells - 1);
+
+    for (yCell = y1; yCell <= y2; ++yCell)
     {
-        m_rectDirty.Union(wxRect(x, y, 1, 1));
+        for (xCell = x1; xCell <= x2; ++xCell)
+        {
+            cell = yCell * m_nBitsXCells + xCell;
+            bit  = 1u << (cell % 32);
+            m_aDirtyCells[cell / 32]   |= bit;
+            m_aChangedCells[cell / 32] |= bit;
+        }
     }
 }
 
 
 /*****************************************************************************/
 /**
- * Extend the dirty area to contain x/y/w/h.
+ * Return the dirty area as a list of rectangles in *paRects.
+ *
+ * The dirty cells in each cell row are combined to horizontal runs. A run
+ * which covers the same columns as one in the row above extends that
+ * rectangle. So two edits far apart don't redraw everything between them.
+ * Only the cells in the dirty bounding box are scanned, the rectangles are
+ * clipped to it, so pixels which have been marked alone stay small.
  */
-void BitmapBase::Dirty(int x, int y, int w, int h)
+void BitmapBase::GetDirtyRects(std::vector<wxRect>* paRects) const
 {
-    if (m_rectDirty.GetRight() < 0)
+    std::vector<unsigned> aAbove, aThis;
+    int      xCell, yCell, xStart, x1, y1, x2, y2;
+    unsigned i, n, cell;
+
+    paRects->clear();
+    if (m_rectDirty.GetRight() < 0 || m_aDirtyCells.empty())
+        return;
+
+    x1 = std::min(std::max(m_rectDirty.GetLeft() / m_nBitsCellWidth, 0),
+                  m_nBitsXCells - 1);
+    y1 = std::min(std::max(m_rectDirty.GetTop() / m_nBitsCellHeight, 0),
+                  m_nBitsYCells - 1);
+    x2 = std::min(m_rectDirty.GetRight() / m_nBitsCellWidth,
+                  m_nBitsXCells - 1);
+    y2 = std::min(m_rectDirty.GetBottom() / m_nBitsCellHeight,
+                  m_nBitsYCells - 1);
+
+    // rectangles in cell coordinates first
+    for (yCell = y1; yCell <= y2; ++yCell)
     {
-        m_rectDirty.SetX(x);
-        m_rectDirty.SetY(y);
-        m_rectDirty.SetWidth(w);
-        m_rectDirty.SetHeight(h);
+        aThis.clear();
+        xCell = x1;
+        while (xCell <= x2)
+        {
+            cell = yCell * m_nBitsXCells + xCell;
+            if (!(m_aDirtyCells[cell / 32] & (1u << (cell % 32))))
+            {
+                ++xCell;
+                continue;
+            }
+
+            xStart = xCell;
+            do
+            {
+                ++xCell;
+                ++cell;
+            }
+            while (xCell <= x2 &&
+                   (m_aDirtyCells[cell / 32] & (1u << (cell % 32))));
+
+            for (i = 0; i < aAbove.size(); ++i)
+            {
+                wxRect& r = (*paRects)[aAbove[i]];
+                if (r.x == xStart && r.width == xCell - xStart)
+                {
+                    ++r.height;
+                    aThis.push_back(aAbove[i]);
+                    break;
+                }
+            }
+            if (i == aAbove.size())
+            {
+                aThis.push_back(paRects->size());
+                paRects->push_back(wxRect(xStart, yCell, xCell - xStart, 1));
+            }
+        }
+        aAbove.swap(aThis);
     }
-    else
+
+    // convert them to pixels and clip them to the dirty area
+    n = 0;
+    for (i = 0; i < paRects->size(); ++i)
     {
-        m_rectDirty.Union(wxRect(x, y, w, h));
+        const wxRect& r = (*paRects)[i];
+
+        x1 = r.x * m_nBitsCellWidth;
+        y1 = r.y * m_nBitsCellHeight;
+        x2 = r.GetRight() == m_nBitsXCells - 1 ?
+                GetWidth() - 1 : (r.GetRight() + 1) * m_nBitsCellWidth - 1;
+        y2 = r.GetBottom() == m_nBitsYCells - 1 ?
+                GetHeight() - 1 : (r.GetBottom() + 1) * m_nBitsCellHeight - 1;
+
+        x1 = std::max(x1, m_rectDirty.GetLeft());
+        y1 = std::max(y1, m_rectDirty.GetTop());
+        x2 = std::min(x2, m_rectDirty.GetRight());
+        y2 = std::min(y2, m_rectDirty.GetBottom());
+
+        if (x1 <= x2 && y1 <= y2)
+            (*paRects)[n++] = wxRect(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+    }
+    paRects->resize(n);
+}
+
+
+/*****************************************************************************/
+/**
+ * Reset the changed area to size (0, 0). This is done when an undo step
+ * has been recorded.
+ */
+void BitmapBase::ResetChanged()
+{
+    m_aChangedCells.clear();
+    m_rectChanged = wxRect(-1, -1, 0, 0);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of the first cell >= nCell which has been changed since
+ * the last undo step or -1 if there is none. Cells are numbered line by line,
+ * i.e. yCell * (GetWidth() / GetCellWidth()) + xCell. Words without changed
+ * cells are skipped at once.
+ */
+int BitmapBase::GetNextChangedCell(int nCell) const
+{
+    unsigned cell, bits;
+
+    cell = nCell;
+    while (cell / 32 < m_aChangedCells.size())
+    {
+        bits = m_aChangedCells[cell / 32] >> (cell % 32);
+        if (!bits)
+        {
+            cell = (cell | 31) + 1;
+            continue;
+        }
+        while (!(bits & 1))
+        {
+            bits >>= 1;
+            ++cell;
+        }
+        return cell;
     }
+    return -1;
 }
 
 
@@ -178,64 +481,115 @@ void BitmapBase::Dirty(int x, int y, int w, int h)
 /**
  * Fill pixel x/y and the adjacent pixels with the same color as this one
  * with color col. If a color limit is hit, do what the drawing mode requires.
+ *
+ * First the area to be filled is searched line by line: Each seed point on
+ * the stack is extended to a horizontal span, then the lines above and below
+ * this span are scanned for new seeds. So each pixel is only looked at a few
+ * times. When the area is known, it is painted from the top left to the
+ * bottom right, only its bounding box is scanned for this.
  */
 void BitmapBase::FloodFill(unsigned x, unsigned y,
                            const C64Color& col, MCDrawingMode mode)
 {
-    typedef enum { FF_UNCHECKED = 0, FF_TOCHECK, FF_CHECKED } state_t;
     C64Color colOld;
-    bool     bGoOn;
+    unsigned xLeft, xRight, xScan;
+    unsigned xMin, xMax, yMin, yMax;
+    int      yScan;
+    bool     bInSpan;
 
     unsigned w = GetWidth();
     unsigned h = GetHeight();
 
-    state_t  state[h][w];
+    if (x >= w || y >= h)
+        return;
+
+    // one byte per pixel, != 0 if the pixel belongs to the area
+    std::vector<unsigned char> aArea(w * h, 0);
+
+    // seed points which still have to be checked, x and y alternating
+    std::vector<unsigned> aStack;
 
-    memset(&state, FF_UNCHECKED, sizeof(state));
     colOld = *GetColor(x, y);
-    state[y][x] = FF_TOCHECK;
+    xMin = xMax = x;
+    yMin = yMax = y;
+    aStack.push_back(x);
+    aStack.push_back(y);
 
-    do
+    while (!aStack.empty())
     {
-        bGoOn = false;
-        for (y = 0; y < h; ++y)
+        y = aStack.back();
+        aStack.pop_back();
+        x = aStack.back();
+        aStack.pop_back();
+
+        if (aArea[y * w + x])
+            continue;
+
+        // extend the seed to a span to the left and to the right
+        xLeft = x;
+        while (xLeft > 0 && !aArea[y * w + xLeft - 1] &&
+               *GetColor(xLeft - 1, y) == colOld)
+            --xLeft;
+
+        xRight = x;
+        while (xRight + 1 < w && !aArea[y * w + xRight + 1] &&
+               *GetColor(xRight + 1, y) == colOld)
+            ++xRight;
+
+        memset(&aArea[y * w + xLeft], 1, xRight - xLeft + 1);
+        xMin = wxMin(xMin, xLeft);
+        xMax = wxMax(xMax, xRight);
+        yMin = wxMin(yMin, y);
+        yMax = wxMax(yMax, y);
+
+        // push one seed for each run of matching pixels above and below
+        for (yScan = (int) y - 1; yScan <= (int) y + 1; yScan += 2)
         {
-            for (x = 0; x < w; ++x)
+            if (yScan < 0 || yScan >= (int) h)
+                continue;
+
+            bInSpan = false;
+            for (xScan = xLeft; xScan <= xRight; ++xScan)
             {
-                if (state[y][x] == FF_TOCHECK)
+                if (!aArea[yScan * w + xScan] &&
+                    *GetColor(xScan, yScan) == colOld)
                 {
-                    if (x > 0 && state[y][x - 1] == FF_UNCHECKED &&
-                        *GetColor(x - 1, y) == colOld)
-                        state[y][x - 1] = FF_TOCHECK;
-                    if (x + 1 < w && state[y][x + 1] == FF_UNCHECKED &&
-                        *GetColor(x + 1, y) == colOld)
-                        state[y][x + 1] = FF_TOCHECK;
-                    if (y > 0 && state[y - 1][x] == FF_UNCHECKED &&
-                        *GetColor(x, y - 1) == colOld)
-                        state[y - 1][x] = FF_TOCHECK;
-                    if (y + 1 < h && state[y + 1][x] == FF_UNCHECKED &&
-                        *GetColor(x, y + 1) == colOld)
-                        state[y + 1][x] = FF_TOCHECK;
-                    state[y][x] = FF_CHECKED;
-                    SetPixel(x, y, col, mode);
-                    bGoOn = true;
+                    if (!bInSpan)
+                    {
+                        aStack.push_back(xScan);
+                        aStack.push_back(yScan);
+                        bInSpan = true;
+                    }
                 }
+                else
+                    bInSpan = false;
             }
         }
     }
-    while (bGoOn);
+
+    for (y = yMin; y <= yMax; ++y)
+    {
+        for (x = xMin; x <= xMax; ++x)
+        {
+            if (aArea[y * w + x])
+                SetPixel(x, y, col, mode);
+        }
+    }
 }
 
 /*****************************************************************************/
 /**
- * Draw a line with color col.
- * If a color limit is hit, do what the drawing mode requires.
+ * Append the points of a line from x1/y1 to x2/y2 to *pPoints, in the order
+ * Line() draws them. Tools use this to preview a line without drawing it.
  */
-void BitmapBase::Line(int x1, int y1, int x2, int y2,
-                      const C64Color& col, MCDrawingMode mode)
+void BitmapBase::GetLinePoints(int x1, int y1, int x2, int y2,
+                               std::vector<wxPoint>* pPoints)
 {
     int fixx, fixy, step;
 
+    pPoints->reserve(pPoints->size() +
+                     std::max(abs(x2 - x1), abs(y2 - y1)) + 1);
+
     if (abs(x2 - x1) > abs(y2 - y1))
     {
         /* horizontal */
@@ -249,8 +603,8 @@ void BitmapBase::Line(int x1, int y1, int x2, int y2,
         step = x2 == x1 ? 0 : 1024 * (y2 - y1) / (x2 - x1);
         for (fixx = x1 * 1024; fixx <= x2 * 1024; fixx += 1024)
         {
-            SetPixel((fixx + 512) / 1024, (fixy + 512) / 1024,
-                     col, mode);
+            pPoints->push_back(wxPoint((fixx + 512) / 1024,
+                                       (fixy + 512) / 1024));
             fixy += step;
         }
     }
@@ -267,8 +621,8 @@ void BitmapBase::Line(int x1, int y1, int x2, int y2,
         step = y2 == y1 ? 0 : 1024 * (x2 - x1) / (y2 - y1);
         for (fixy = y1 * 1024; fixy <= y2 * 1024; fixy += 1024)
         {
-            SetPixel((fixx + 512) / 1024, (fixy + 512) / 1024,
-                     col, mode);
+            pPoints->push_back(wxPoint((fixx + 512) / 1024,
+                                       (fixy + 512) / 1024));
             fixx += step;
         }
     }
@@ -276,37 +630,70 @@ void BitmapBase::Line(int x1, int y1, int x2, int y2,
 
 /*****************************************************************************/
 /**
- * Draw a rectangle with color col.
- * If a color limit is hit, do what the drawing mode requires.
+ * Append the points of the outline of the rectangle x1/y1..x2/y2 to
+ * *pPoints, in the order Rectangle() draws them. Corners occur twice.
  */
-void BitmapBase::Rectangle(int x1, int y1, int x2, int y2,
-                      const C64Color& col, MCDrawingMode mode)
+void BitmapBase::GetRectanglePoints(int x1, int y1, int x2, int y2,
+                                    std::vector<wxPoint>* pPoints)
 {
-    double fx, fy, step;
-    int    tmp;
-   
+    int x, y, tmp;
+
     if (x2 < x1)
-    {  
+    {
         // swap start and end
         tmp = x1; x1 = x2; x2 = tmp;
     }
 
-    if (y2 < y1)                                            
-    {                                                       
+    if (y2 < y1)
+    {
         // swap start and end
         tmp = y1; y1 = y2; y2 = tmp;
     }
-   
-    for (fx = x1; fx <= x2; fx += 1)
-    {  
-        SetPixel(fx, y1, col, mode);
-        SetPixel(fx, y2, col, mode);
+
+    pPoints->reserve(pPoints->size() + 2 * (x2 - x1 + y2 - y1 + 2));
+
+    for (x = x1; x <= x2; ++x)
+    {
+        pPoints->push_back(wxPoint(x, y1));
+        pPoints->push_back(wxPoint(x, y2));
     }
 
-    for (fy = y1; fy <= y2; fy += 1)
+    for (y = y1; y <= y2; ++y)
     {
-        SetPixel(x1, fy, col, mode);
-        SetPixel(x2, fy, col, mode);
+        pPoints->push_back(wxPoint(x1, y));
+        pPoints->push_back(wxPoint(x2, y));
     }
 }
 
+/*****************************************************************************/
+/**
+ * Draw a line with color col.
+ * If a color limit is hit, do what the drawing mode requires.
+ */
+void BitmapBase::Line(int x1, int y1, int x2, int y2,
+                      const C64Color& col, MCDrawingMode mode)
+{
+    std::vector<wxPoint> aPoints;
+    std::vector<wxPoint>::const_iterator i;
+
+    GetLinePoints(x1, y1, x2, y2, &aPoints);
+    for (i = aPoints.begin(); i != aPoints.end(); ++i)
+        SetPixel(i->x, i->y, col, mode);
+}
+
+/*****************************************************************************/
+/**
+ * Draw a rectangle with color col.
+ * If a color limit is hit, do what the drawing mode requires.
+ */
+void BitmapBase::Rectangle(int x1, int y1, int x2, int y2,
+                      const C64Color& col, MCDrawingMode mode)
+{
+    std::vector<wxPoint> aPoints;
+    std::vector<wxPoint>::const_iterator i;
+
+    GetRectanglePoints(x1, y1, x2, y2, &aPoints);
+    for (i = aPoints.begin(); i != aPoints.end(); ++i)
+        SetPixel(i->x, i->y, col, mode);
+}
+
@@ -26,6 +26,8 @@
 #ifndef BITMAPBASE_H
 #define BITMAPBASE_H
 
+#include <stdint.h>
+#include <vector>
 #include <wx/gdicmn.h>
 
 #include "ToolBase.h"
@@ -36,6 +38,7 @@ class BitmapBase
 {
 public:
     BitmapBase();
+    virtual ~BitmapBase();
     virtual BitmapBase* Copy() const = 0;
 
     virtual int GetWidth() const = 0;
@@ -47,18 +50,43 @@ public:
     virtual int GetPixelXFactor() const;
     virtual int GetPixelYFactor() const;
 
+    virtual int GetBugAreaWidth() const;
+
+    virtual int GetNFrames() const;
+    virtual int GetEditFrame() const;
+    virtual void SetEditFrame(int nFrame);
+
     virtual int GetNIndexes() const = 0;
 
     virtual const C64Color* GetColorByIndex(int x, int y, int index) const = 0;
     virtual int CountColorByIndex(int x, int y, int index) const = 0;
 
+    virtual unsigned GetCellDataSize() const = 0;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const = 0;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData) = 0;
+
+    virtual unsigned GetGlobalDataSize() const;
+    virtual void GetGlobalData(unsigned char* pData) const;
+    virtual void SetGlobalData(const unsigned char* pData);
+
     void SortAndClip(int* px1, int* py1, int* px2, int* py2);
     void ResetDirty();
     void Dirty(int x, int y);
     void Dirty(int x, int y, int w, int h);
     const wxRect& GetDirtyRect() const;
+    void GetDirtyRects(std::vector<wxRect>* paRects) const;
+
+    void ResetChanged();
+    const wxRect& GetChangedRect() const;
+    int GetNextChangedCell(int nCell) const;
 
     virtual const C64Color* GetColor(int x, int y) const = 0;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
+    virtual void GetFrameColorRow(int nFrame, int x, int y, int w,
+                                  unsigned char* pDest) const;
 
     virtual void SetPixel(int x, int y, const C64Color& col,
                           MCDrawingMode mode = MCDrawingModeIgnore) = 0;
@@ -72,8 +100,31 @@ public:
     virtual void Rectangle(int x1, int y1, int x2, int y2,
                       const C64Color& col, MCDrawingMode mode);
 
+    static void GetLinePoints(int x1, int y1, int x2, int y2,
+                              std::vector<wxPoint>* pPoints);
+    static void GetRectanglePoints(int x1, int y1, int x2, int y2,
+                                   std::vector<wxPoint>* pPoints);
+
 protected:
+    void MarkCells(int x, int y, int w, int h);
+
+    /// Area which has to be redrawn
     wxRect m_rectDirty;
+
+    /// One bit per cell, set if it has to be redrawn
+    std::vector<uint32_t> m_aDirtyCells;
+
+    /// Area which has been changed since the last undo step
+    wxRect m_rectChanged;
+
+    /// One bit per cell, set if it has been touched since the last undo step
+    std::vector<uint32_t> m_aChangedCells;
+
+    /// Cell size and number of cells when the bit sets were created
+    int m_nBitsCellWidth;
+    int m_nBitsCellHeight;
+    int m_nBitsXCells;
+    int m_nBitsYCells;
 };
 
 
@@ -82,4 +133,10 @@ inline const wxRect& BitmapBase::GetDirtyRect() const
     return m_rectDirty;
 }
 
+
+inline const wxRect& BitmapBase::GetChangedRect() const
+{
+    return m_rectChanged;
+}
+
 #endif // BITMAPBASE_H
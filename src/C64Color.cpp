@@ -34,6 +34,12 @@ static const MC_RGB m_aRGB[16] = {
     MC_RGB_COLOR(0x80, 0x80, 0x80), MC_RGB_COLOR(0xac, 0xea, 0x88),
     MC_RGB_COLOR(0x7c, 0x70, 0xda), MC_RGB_COLOR(0xab, 0xab, 0xab) };
 
+const C64Color C64Color::m_aPalette[16] = {
+    C64Color(0),  C64Color(1),  C64Color(2),  C64Color(3),
+    C64Color(4),  C64Color(5),  C64Color(6),  C64Color(7),
+    C64Color(8),  C64Color(9),  C64Color(10), C64Color(11),
+    C64Color(12), C64Color(13), C64Color(14), C64Color(15) };
+
 /*****************************************************************************/
 C64Color::C64Color(void)
 {
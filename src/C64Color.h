@@ -82,10 +82,25 @@ public:
 
     MC_RGB GetContrastRGB(void) const;
 
+    static const C64Color* GetPaletteColor(int col);
+
     inline bool operator==(C64Color c2) const
     {
         return (m_color == c2.m_color);
     }
+
+protected:
+    static const C64Color m_aPalette[16];
 };
 
+/*****************************************************************************/
+/**
+ * Return a pointer to a shared C64Color object for the color number col.
+ * This can be used by bitmaps which only store color numbers.
+ */
+inline const C64Color* C64Color::GetPaletteColor(int col)
+{
+    return &m_aPalette[col & 0x0f];
+}
+
 #endif
@@ -0,0 +1,654 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "CharBitmap.h"
+
+
+const C64Color CharBitmap::black;
+
+
+/*****************************************************************************/
+CharBitmap::CharBitmap(void) :
+    m_nBackground(MC_BLACK)
+{
+    memset(m_aPatterns, 0, sizeof(m_aPatterns));
+    memset(m_aColorRAM, MC_WHITE, sizeof(m_aColorRAM));
+    RebuildDictionary();
+}
+
+
+/*****************************************************************************/
+CharBitmap::~CharBitmap(void)
+{
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to a copy of this bitmap created with "new".
+ */
+BitmapBase* CharBitmap::Copy() const
+{
+    return new CharBitmap(*this);
+}
+
+
+/******************************************************************************/
+/**
+ * Return the width of the bitmap in pixels, 40 hires characters.
+ */
+int CharBitmap::GetWidth() const
+{
+    return CHAR_X;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the height of the bitmap in pixels, 25 character rows.
+ */
+int CharBitmap::GetHeight() const
+{
+    return CHAR_Y;
+}
+
+
+/*****************************************************************************/
+/**
+ * Hires characters have the background and the color of their cell.
+ */
+int CharBitmap::GetNIndexes() const
+{
+    return 2;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of an index in the cell which contains the given
+ * coordinates. If the coordinates are out of range, return black.
+ */
+const C64Color* CharBitmap::GetColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+    {
+        if (index == 0)
+            return C64Color::GetPaletteColor(m_nBackground);
+        else if (index == 1)
+            return C64Color::GetPaletteColor(
+                    m_aColorRAM[(y / 8) * CHARBITMAP_XCELLS + x / 8]);
+        else
+            return NULL;
+    }
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of pixels of an index in the cell which contains the
+ * given coordinates. If the coordinates are out of range, return 0.
+ */
+int CharBitmap::CountColorByIndex(int x, int y, int index) const
+{
+    const uint8_t* pPattern;
+    int            i, n;
+
+    if ((x < 0) || (y < 0) || (x >= GetWidth()) || (y >= GetHeight()) ||
+        index > 1)
+        return 0;
+
+    pPattern = m_aPatterns[(y / 8) * CHARBITMAP_XCELLS + x / 8];
+    n = 0;
+    for (i = 0; i < CHARBITMAP_BYTES_PER_CHAR; ++i)
+        n += Distance(pPattern[i], 0);
+
+    return index ? n : 64 - n;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of a pixel. If the coordinates are out of range, return
+ * black.
+ */
+const C64Color* CharBitmap::GetColor(int x, int y) const
+{
+    unsigned c;
+
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+    {
+        c = (y / 8) * CHARBITMAP_XCELLS + x / 8;
+        if (m_aPatterns[c][y % 8] & (0x80 >> (x % 8)))
+            return C64Color::GetPaletteColor(m_aColorRAM[c]);
+        else
+            return C64Color::GetPaletteColor(m_nBackground);
+    }
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ */
+void CharBitmap::GetColorRow(int x, int y, int w, unsigned char* pDest) const
+{
+    unsigned c, xPixel, val;
+
+    c      = (y / 8) * CHARBITMAP_XCELLS + x / 8;
+    xPixel = x % 8;
+
+    while (w > 0)
+    {
+        val = m_aPatterns[c][y % 8];
+        for (; xPixel < 8 && w > 0; ++xPixel, --w)
+            *pDest++ = (val & (0x80 >> xPixel)) ?
+                       m_aColorRAM[c] : m_nBackground;
+
+        xPixel = 0;
+        ++c;
+    }
+}
+
+
+/*****************************************************************************
+ * Set the pixel x/y to the color col. This works like HiResBlock::SetPixel,
+ * but the background is the same for all cells, so only the color RAM
+ * can be replaced in case of a color clash.
+ *
+ * The pattern dictionary is updated on the way.
+ */
+void CharBitmap::SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode)
+{
+    uint64_t      pattern, bit;
+    unsigned      c;
+    unsigned char color;
+    bool          bSet;
+
+    if ((x < 0) || (y < 0) || (x >= GetWidth()) || (y >= GetHeight()))
+        return;
+
+    c       = (y / 8) * CHARBITMAP_XCELLS + x / 8;
+    color   = (unsigned char) col.GetColor();
+    pattern = GetPattern(c);
+    bit     = (uint64_t) 0x80 << (8 * (7 - y % 8)) >> (x % 8);
+
+    if (mode == MCDrawingModeIndex0)
+    {
+        SetBackground(color);
+        bSet = false;
+    }
+    else if (mode == MCDrawingModeIndex1)
+        bSet = true;
+    else if (mode >= MCDrawingModeIndex2)
+        return;
+    else if (color == m_nBackground)
+        bSet = false;
+    else if (color == m_aColorRAM[c] || (pattern & ~bit) == 0 ||
+             mode != MCDrawingModeIgnore)
+    {
+        // the color RAM fits, is free or is replaced
+        bSet = true;
+    }
+    else
+        return;
+
+    // a new color RAM value changes the whole cell
+    if (bSet && m_aColorRAM[c] != color)
+    {
+        m_aColorRAM[c] = color;
+        Dirty(x & ~7, y & ~7, 8, 8);
+    }
+    SetPattern(c, bSet ? (pattern | bit) : (pattern & ~bit));
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: 8 bytes pattern and
+ * one byte color RAM.
+ */
+unsigned CharBitmap::GetCellDataSize() const
+{
+    return CHARBITMAP_BYTES_PER_CHAR + 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid.
+ */
+void CharBitmap::GetCellData(int xCell, int yCell, unsigned char* pData) const
+{
+    unsigned c = yCell * CHARBITMAP_XCELLS + xCell;
+
+    memcpy(pData, m_aPatterns[c], CHARBITMAP_BYTES_PER_CHAR);
+    pData[CHARBITMAP_BYTES_PER_CHAR] = m_aColorRAM[c];
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ */
+void CharBitmap::SetCellData(int xCell, int yCell, const unsigned char* pData)
+{
+    unsigned c = yCell * CHARBITMAP_XCELLS + xCell;
+    uint64_t pattern = 0;
+    int      i;
+
+    for (i = 0; i < CHARBITMAP_BYTES_PER_CHAR; ++i)
+        pattern = (pattern << 8) | pData[i];
+
+    SetPattern(c, pattern);
+    m_aColorRAM[c] = pData[CHARBITMAP_BYTES_PER_CHAR] & 0x0f;
+    Dirty(xCell * 8, yCell * 8, 8, 8);
+}
+
+
+/*****************************************************************************/
+/**
+ * The global data of a character screen is the background color.
+ */
+unsigned CharBitmap::GetGlobalDataSize() const
+{
+    return 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Store the background color in pData[0].
+ */
+void CharBitmap::GetGlobalData(unsigned char* pData) const
+{
+    pData[0] = m_nBackground;
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background color from pData[0].
+ */
+void CharBitmap::SetGlobalData(const unsigned char* pData)
+{
+    SetBackground(pData[0]);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background color of all cells.
+ */
+void CharBitmap::SetBackground(unsigned char col)
+{
+    if (m_nBackground != (col & 0x0f))
+    {
+        m_nBackground = col & 0x0f;
+
+        // this may change the whole bitmap
+        Dirty(0, 0, CHAR_X, CHAR_Y);
+    }
+}
+
+
+/*****************************************************************************/
+unsigned char CharBitmap::GetBackground() const
+{
+    return m_nBackground;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy a complete color RAM (1000 bytes) into this image. The upper nibbles
+ * are not connected on a real C64, so we ignore them.
+ */
+void CharBitmap::SetColorRAM(const unsigned char* pSrc)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(m_aColorRAM); ++i)
+        m_aColorRAM[i] = pSrc[i] & 0x0f;
+
+    Dirty(0, 0, CHAR_X, CHAR_Y);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the complete color RAM (1000 bytes) to pDest.
+ */
+void CharBitmap::GetColorRAM(unsigned char* pDest) const
+{
+    memcpy(pDest, m_aColorRAM, sizeof(m_aColorRAM));
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the patterns of all cells from a character set (256 * 8 bytes) and a
+ * screen (1000 bytes).
+ */
+void CharBitmap::SetCharsetAndScreen(const uint8_t* pCharset,
+                                     const uint8_t* pScreen)
+{
+    unsigned c;
+
+    for (c = 0; c < CHARBITMAP_NCELLS; ++c)
+        memcpy(m_aPatterns[c],
+               pCharset + pScreen[c] * CHARBITMAP_BYTES_PER_CHAR,
+               CHARBITMAP_BYTES_PER_CHAR);
+
+    RebuildDictionary();
+    Dirty(0, 0, CHAR_X, CHAR_Y);
+}
+
+
+/*****************************************************************************/
+/**
+ * Build a character set (256 * 8 bytes) and a screen (1000 bytes) from the
+ * patterns of all cells. The characters are numbered in the order they
+ * appear on the screen, unused ones are empty.
+ *
+ * Return the number of characters needed. If it is more than 256, the
+ * result is incomplete and should not be used.
+ */
+unsigned CharBitmap::GetCharsetAndScreen(uint8_t* pCharset,
+                                         uint8_t* pScreen) const
+{
+    unsigned nChars, c, nFirst;
+
+    memset(pCharset, 0, CHARBITMAP_MAX_CHARS * CHARBITMAP_BYTES_PER_CHAR);
+
+    nChars = 0;
+    for (c = 0; c < CHARBITMAP_NCELLS; ++c)
+    {
+        nFirst = FindFirstCell(c);
+        if (nFirst == c)
+        {
+            // a new character
+            if (nChars < CHARBITMAP_MAX_CHARS)
+                memcpy(pCharset + nChars * CHARBITMAP_BYTES_PER_CHAR,
+                       m_aPatterns[c], CHARBITMAP_BYTES_PER_CHAR);
+            pScreen[c] = (uint8_t) nChars++;
+        }
+        else
+            pScreen[c] = pScreen[nFirst];
+    }
+
+    return nChars;
+}
+
+
+/*****************************************************************************/
+/**
+ * Merge similar patterns until at most nChars different ones are left.
+ * Return true if anything has been changed.
+ *
+ * The patterns are removed one by one. Each one would be replaced by its
+ * nearest neighbour, i.e. the one with the least different pixels. The
+ * cost of this is the number of these pixels times the number of cells
+ * using the pattern. The cheapest replacement is done first. Only patterns
+ * whose neighbour was removed have to look for a new one.
+ */
+bool CharBitmap::Reduce(unsigned nChars)
+{
+    std::vector<uint64_t> aPatterns;
+    std::vector<unsigned> aCount, aNearest, aDistance, aCellPattern;
+    std::vector<bool>     aAlive;
+    unsigned              c, i, j, nBest, nAlive, nCost, nBestCost;
+
+    if (nChars == 0)
+        nChars = 1;
+    if (m_nUniqueChars <= nChars)
+        return false;
+
+    // collect the patterns and how often they are used
+    aCellPattern.resize(CHARBITMAP_NCELLS);
+    for (c = 0; c < CHARBITMAP_NCELLS; ++c)
+    {
+        j = FindFirstCell(c);
+        if (j == c)
+        {
+            aCellPattern[c] = aPatterns.size();
+            aPatterns.push_back(GetPattern(c));
+            aCount.push_back(1);
+        }
+        else
+        {
+            aCellPattern[c] = aCellPattern[j];
+            ++aCount[aCellPattern[j]];
+        }
+    }
+
+    nAlive = aPatterns.size();
+    aAlive.assign(nAlive, true);
+    aNearest.resize(nAlive);
+    aDistance.resize(nAlive);
+
+    for (i = 0; i < aPatterns.size(); ++i)
+    {
+        aDistance[i] = 65;
+        for (j = 0; j < aPatterns.size(); ++j)
+        {
+            if (j != i && Distance(aPatterns[i], aPatterns[j]) <
+                          aDistance[i])
+            {
+                aDistance[i] = Distance(aPatterns[i], aPatterns[j]);
+                aNearest[i]  = j;
+            }
+        }
+    }
+
+    while (nAlive > nChars)
+    {
+        // find the cheapest pattern to be replaced
+        nBest     = 0;
+        nBestCost = ~0U;
+        for (i = 0; i < aPatterns.size(); ++i)
+        {
+            nCost = aCount[i] * aDistance[i];
+            if (aAlive[i] && nCost < nBestCost)
+            {
+                nBestCost = nCost;
+                nBest     = i;
+            }
+        }
+
+        // replace it
+        aAlive[nBest] = false;
+        --nAlive;
+        aCount[aNearest[nBest]] += aCount[nBest];
+
+        // patterns which were near to it need a new neighbour
+        for (i = 0; i < aPatterns.size(); ++i)
+        {
+            if (!aAlive[i] || aNearest[i] != nBest)
+                continue;
+
+            aDistance[i] = 65;
+            for (j = 0; j < aPatterns.size(); ++j)
+            {
+                if (j != i && aAlive[j] &&
+                    Distance(aPatterns[i], aPatterns[j]) < aDistance[i])
+                {
+                    aDistance[i] = Distance(aPatterns[i], aPatterns[j]);
+                    aNearest[i]  = j;
+                }
+            }
+        }
+    }
+
+    // each removed pattern follows the replacements to a remaining one
+    for (c = 0; c < CHARBITMAP_NCELLS; ++c)
+    {
+        i = aCellPattern[c];
+        while (!aAlive[i])
+            i = aNearest[i];
+        SetPattern(c, aPatterns[i]);
+    }
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of pixels which differ in two patterns.
+ */
+unsigned CharBitmap::Distance(uint64_t a, uint64_t b)
+{
+    uint64_t x = a ^ b;
+
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned) ((x * 0x0101010101010101ULL) >> 56);
+}
+
+
+/*****************************************************************************/
+/**
+ * Change the pattern of a cell and keep the dictionary up to date.
+ */
+void CharBitmap::SetPattern(unsigned nCell, uint64_t pattern)
+{
+    int i;
+
+    if (GetPattern(nCell) == pattern)
+        return;
+
+    RemoveFromDictionary(nCell);
+    for (i = CHARBITMAP_BYTES_PER_CHAR - 1; i >= 0; --i)
+    {
+        m_aPatterns[nCell][i] = (uint8_t) pattern;
+        pattern >>= 8;
+    }
+    AddToDictionary(nCell);
+
+    Dirty((nCell % CHARBITMAP_XCELLS) * 8, (nCell / CHARBITMAP_XCELLS) * 8,
+          8, 8);
+}
+
+
+/*****************************************************************************/
+/**
+ * Add a cell to the dictionary. If no other cell has the same pattern, it
+ * is a new character.
+ */
+void CharBitmap::AddToDictionary(unsigned nCell)
+{
+    uint64_t pattern = GetPattern(nCell);
+    unsigned nHash   = Hash(pattern);
+    unsigned c;
+
+    for (c = m_aHashHead[nHash]; c != CHARBITMAP_NO_CELL;
+         c = m_aHashNext[c])
+    {
+        if (GetPattern(c) == pattern)
+            break;
+    }
+    if (c == CHARBITMAP_NO_CELL)
+        ++m_nUniqueChars;
+
+    m_aHashNext[nCell]  = m_aHashHead[nHash];
+    m_aHashHead[nHash]  = nCell;
+}
+
+
+/*****************************************************************************/
+/**
+ * Remove a cell from the dictionary. If it was the last cell with its
+ * pattern, this character isn't needed anymore.
+ */
+void CharBitmap::RemoveFromDictionary(unsigned nCell)
+{
+    uint64_t  pattern = GetPattern(nCell);
+    unsigned  nHash   = Hash(pattern);
+    uint16_t* pLink;
+    unsigned  c;
+
+    pLink = &m_aHashHead[nHash];
+    while (*pLink != nCell)
+        pLink = &m_aHashNext[*pLink];
+    *pLink = m_aHashNext[nCell];
+
+    for (c = m_aHashHead[nHash]; c != CHARBITMAP_NO_CELL; c = m_aHashNext[c])
+    {
+        if (GetPattern(c) == pattern)
+            return;
+    }
+    --m_nUniqueChars;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the lowest number of a cell which has the same pattern as nCell,
+ * this may be nCell itself.
+ */
+unsigned CharBitmap::FindFirstCell(unsigned nCell) const
+{
+    uint64_t pattern = GetPattern(nCell);
+    unsigned c, nFirst;
+
+    nFirst = nCell;
+    for (c = m_aHashHead[Hash(pattern)]; c != CHARBITMAP_NO_CELL;
+         c = m_aHashNext[c])
+    {
+        if (c < nFirst && GetPattern(c) == pattern)
+            nFirst = c;
+    }
+    return nFirst;
+}
+
+
+/*****************************************************************************/
+/**
+ * Build the dictionary from scratch, e.g. after all patterns have been
+ * replaced.
+ */
+void CharBitmap::RebuildDictionary()
+{
+    unsigned c;
+
+    for (c = 0; c < CHARBITMAP_HASH_SIZE; ++c)
+        m_aHashHead[c] = CHARBITMAP_NO_CELL;
+
+    m_nUniqueChars = 0;
+    for (c = 0; c < CHARBITMAP_NCELLS; ++c)
+        AddToDictionary(c);
+}
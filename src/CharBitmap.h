@@ -0,0 +1,182 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef CHARBITMAP_H
+#define CHARBITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "C64Color.h"
+#include "ToolBase.h"
+#include "BitmapBase.h"
+
+#define CHAR_X 320
+#define CHAR_Y 200
+
+#define CHARBITMAP_BYTES_PER_CHAR 8
+#define CHARBITMAP_XCELLS (CHAR_X / 8)
+#define CHARBITMAP_YCELLS (CHAR_Y / 8)
+#define CHARBITMAP_NCELLS (CHARBITMAP_XCELLS * CHARBITMAP_YCELLS)
+
+/* The VIC can use 256 characters */
+#define CHARBITMAP_MAX_CHARS 256
+
+/* Buckets of the pattern dictionary, a power of 2 */
+#define CHARBITMAP_HASH_BITS 10
+#define CHARBITMAP_HASH_SIZE (1 << CHARBITMAP_HASH_BITS)
+
+/* End of a hash chain */
+#define CHARBITMAP_NO_CELL 0xffff
+
+/*****************************************************************************/
+/**
+ * A hires character mode screen: 40x25 cells, each one shows a character
+ * in the color of its color RAM on the common background.
+ *
+ * Each cell keeps its own 8 byte pattern, so drawing is never limited by
+ * the number of characters. A hashed dictionary of the patterns is kept
+ * up to date with each change, it tells how many different characters are
+ * needed. The character set and the screen are built from the patterns
+ * when the picture is saved, this needs at most 256 of them. Reduce
+ * merges the most similar patterns until the number fits.
+ *
+ * The dictionary chains all cells with the same hash value, cells with
+ * equal patterns are in the same chain.
+ */
+class CharBitmap : public BitmapBase
+{
+public:
+    CharBitmap(void);
+    ~CharBitmap(void);
+    virtual BitmapBase* Copy() const;
+
+    virtual int GetWidth() const;
+    virtual int GetHeight() const;
+
+    virtual int GetNIndexes() const;
+    virtual const C64Color* GetColorByIndex(int x, int y, int index) const;
+    virtual int CountColorByIndex(int x, int y, int index) const;
+
+    virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
+    virtual void SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode = MCDrawingModeIgnore);
+
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
+    virtual unsigned GetGlobalDataSize() const;
+    virtual void GetGlobalData(unsigned char* pData) const;
+    virtual void SetGlobalData(const unsigned char* pData);
+
+    void SetBackground(unsigned char col);
+    unsigned char GetBackground() const;
+
+    void SetColorRAM(const unsigned char* pSrc);
+    void GetColorRAM(unsigned char* pDest) const;
+
+    void SetCharsetAndScreen(const uint8_t* pCharset,
+                             const uint8_t* pScreen);
+    unsigned GetCharsetAndScreen(uint8_t* pCharset, uint8_t* pScreen) const;
+
+    unsigned GetNUniqueChars() const;
+    bool Reduce(unsigned nChars);
+
+    static const C64Color black;
+
+protected:
+    static unsigned Hash(uint64_t pattern);
+    static unsigned Distance(uint64_t a, uint64_t b);
+
+    uint64_t GetPattern(unsigned nCell) const;
+    void SetPattern(unsigned nCell, uint64_t pattern);
+    void AddToDictionary(unsigned nCell);
+    void RemoveFromDictionary(unsigned nCell);
+    unsigned FindFirstCell(unsigned nCell) const;
+    void RebuildDictionary();
+
+    /// Pattern of each cell, 8 bytes each, top row first
+    uint8_t  m_aPatterns[CHARBITMAP_NCELLS][CHARBITMAP_BYTES_PER_CHAR];
+
+    /// Color RAM, only the lower nibble is used, it's index 1
+    uint8_t  m_aColorRAM[CHARBITMAP_NCELLS];
+
+    /// Background color, index 0
+    uint8_t  m_nBackground;
+
+    /// First cell of each hash chain
+    uint16_t m_aHashHead[CHARBITMAP_HASH_SIZE];
+
+    /// Next cell in the same hash chain
+    uint16_t m_aHashNext[CHARBITMAP_NCELLS];
+
+    /// Number of different patterns
+    unsigned m_nUniqueChars;
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the number of different characters needed for this screen.
+ */
+inline unsigned CharBitmap::GetNUniqueChars() const
+{
+    return m_nUniqueChars;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the pattern of a cell as a 64 bit number, the top row is the
+ * most significant byte.
+ */
+inline uint64_t CharBitmap::GetPattern(unsigned nCell) const
+{
+    uint64_t pattern = 0;
+    int      i;
+
+    for (i = 0; i < CHARBITMAP_BYTES_PER_CHAR; ++i)
+        pattern = (pattern << 8) | m_aPatterns[nCell][i];
+
+    return pattern;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of the dictionary bucket for a pattern.
+ */
+inline unsigned CharBitmap::Hash(uint64_t pattern)
+{
+    return (unsigned) ((pattern * 0x9e3779b97f4a7c15ULL) >>
+                       (64 - CHARBITMAP_HASH_BITS));
+}
+
+#endif // CHARBITMAP_H
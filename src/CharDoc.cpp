@@ -0,0 +1,257 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+#include "MCApp.h"
+#include "CharDoc.h"
+#include "DocRenderer.h"
+#include "ImageImporter.h"
+
+#define CHARSCREEN_START_ADDR 0x2000
+
+/*
+ * File structure of a character screen including start address. The
+ * character set is followed by the screen, the color RAM and the
+ * background color, so it can be used directly at $2000.
+ */
+typedef struct charscreen_s
+{
+   uint8_t ptr[2];               /* start address */
+   uint8_t charset[2048];        /* $2000: 256 characters */
+   uint8_t screen[1000];         /* $2800: character of each cell */
+   uint8_t col_ram[1000];        /* $2be8: low-nibble only */
+   uint8_t background;           /* $2fd0: $d021 */
+} charscreen_t;
+
+/******************************************************************************/
+/**
+ * This is a list of all Filters for this image format.
+ */
+static FormatInfo::Filter m_aFilters[] =
+{
+    { wxT("Character set and screen files"), wxT("*.chs") },
+    { NULL, NULL }
+};
+
+/**
+ * File sizes and load addresses CheckFormat looks for, terminated by 0.
+ */
+static const unsigned m_aSizes[] =
+    { sizeof(charscreen_t), 0 };
+static const unsigned m_aLoadAddresses[] =
+    { CHARSCREEN_START_ADDR, 0 };
+
+/**
+ * Information about this image format.
+ */
+FormatInfo CharDoc::m_formatInfo(
+    wxT("HiRes Character Mode"),
+    wxT("chs"),
+    m_aFilters,
+    CharDoc::Factory,
+    CharDoc::CheckFormat,
+    m_aSizes,
+    m_aLoadAddresses);
+
+
+/******************************************************************************/
+/**
+ *
+ */
+CharDoc::CharDoc()
+    : m_bitmap()
+{
+    PrepareUndo();
+
+    // PrepareUndo sets m_bModified, reset it
+    m_bModified = false;
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class.
+ */
+DocBase* CharDoc::Factory()
+{
+    return new CharDoc;
+}
+
+
+/******************************************************************************/
+/**
+ * Check how good data matches our document format. Return a sum of
+ * MC_FORMAT_*_MATCH.
+ */
+int CharDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                         const wxFileName& fileName)
+{
+    uint16_t addr;
+    int      match = 0;
+
+    if (fileName.GetExt().CmpNoCase(wxT("chs")) == 0)
+        match += MC_FORMAT_EXTENSION_MATCH;
+
+    if (len == sizeof(charscreen_t))
+        match += MC_FORMAT_SIZE_MATCH;
+
+    if (len < 2)
+        return match;
+
+    addr = pBuff[0] + pBuff[1] * 256;
+    if (addr == CHARSCREEN_START_ADDR)
+        match += MC_FORMAT_ADDR_MATCH;
+
+    return match;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our FormatInfo.
+ */
+const FormatInfo* CharDoc::GetFormatInfo() const
+{
+    return &m_formatInfo;
+}
+
+
+/******************************************************************************/
+/**
+ * Copy the contents of the given bitmap to our one. The pointer must point to
+ * an object which has actually the same type as our bitmap.
+ */
+void CharDoc::SetBitmap(const BitmapBase* pB)
+{
+    m_bitmap = *(CharBitmap*) pB;
+}
+
+
+/******************************************************************************/
+/**
+ * The characters can be reduced to fit into a character set.
+ */
+bool CharDoc::CanReduceChars() const
+{
+    return true;
+}
+
+
+/******************************************************************************/
+/**
+ * Tell how many characters are needed, more than 256 can't be saved.
+ */
+wxString CharDoc::GetStatusText() const
+{
+    return wxString::Format(wxT("%u/%u chars"), m_bitmap.GetNUniqueChars(),
+                            CHARBITMAP_MAX_CHARS);
+}
+
+
+/******************************************************************************/
+/**
+ * Convert an image into our bitmap. Similar cells are not merged, this is
+ * left to ReduceChars.
+ */
+bool CharDoc::ImportImage(ImageImporter* pImporter)
+{
+    pImporter->ImportChars(&m_bitmap);
+    return true;
+}
+
+
+/******************************************************************************/
+/**
+ * Merge the most similar characters until there are at most nChars of them.
+ */
+bool CharDoc::ReduceCharsBitmap(unsigned nChars)
+{
+    return m_bitmap.Reduce(nChars);
+}
+
+
+/******************************************************************************/
+/**
+ * Try to load the file from the given memory buffer. Return true for success.
+ */
+bool CharDoc::Load(const uint8_t* pBuff, unsigned size)
+{
+    const charscreen_t* pImage;
+
+    if (size != sizeof(charscreen_t))
+        return false;
+
+    pImage = (const charscreen_t*) pBuff;
+
+    // ignore start addr, 2 bytes
+
+    m_bitmap.SetCharsetAndScreen(pImage->charset, pImage->screen);
+    m_bitmap.SetColorRAM(pImage->col_ram);
+    m_bitmap.SetBackground(pImage->background);
+
+    return true;
+}
+
+
+/******************************************************************************
+ **
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success. The file name is for informational purposes only, e.g. to
+ * decide which sub-format to use.
+ *
+ * The character set is built from the cells, this fails if they need more
+ * than 256 characters.
+ */
+bool CharDoc::Save(std::vector<uint8_t>* pOut, const wxFileName& fileName)
+{
+    charscreen_t* pImage;
+    unsigned      nChars;
+
+    pOut->assign(sizeof(charscreen_t), 0);
+    pImage = (charscreen_t*) &(*pOut)[0];
+
+    // start addr
+    pImage->ptr[0] = CHARSCREEN_START_ADDR % 0x100;
+    pImage->ptr[1] = CHARSCREEN_START_ADDR / 0x100;
+
+    nChars = m_bitmap.GetCharsetAndScreen(pImage->charset, pImage->screen);
+    if (nChars > CHARBITMAP_MAX_CHARS)
+    {
+        ShowMessage(fileName.GetFullPath(),
+            wxString::Format(wxT("This picture needs %u characters, reduce "
+                                 "them to %u first."),
+                             nChars, CHARBITMAP_MAX_CHARS),
+            wxT("Save Error"));
+        return false;
+    }
+
+    m_bitmap.GetColorRAM(pImage->col_ram);
+    pImage->background = m_bitmap.GetBackground();
+
+    return true;
+}
@@ -0,0 +1,88 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef CHARDOC_H
+#define CHARDOC_H
+
+#include <list>
+#include <vector>
+
+#include "CharBitmap.h"
+#include "DocBase.h"
+#include "FormatInfo.h"
+
+class DocRenderer;
+
+class CharDoc : public DocBase
+{
+public:
+    CharDoc();
+    static DocBase* Factory();
+    static int CheckFormat(const uint8_t* pBuff, unsigned len,
+                           const wxFileName& fileName);
+
+    virtual const FormatInfo* GetFormatInfo() const;
+
+    const BitmapBase* GetBitmap() const;
+    virtual BitmapBase* GetBitmap();
+    virtual void SetBitmap(const BitmapBase*);
+
+    virtual bool CanReduceChars() const;
+    virtual wxString GetStatusText() const;
+
+protected:
+    virtual bool Load(const uint8_t* pBuff, unsigned size);
+    virtual bool Save(std::vector<uint8_t>* pOut, const wxFileName& fileName);
+    virtual bool ImportImage(ImageImporter* pImporter);
+    virtual bool ReduceCharsBitmap(unsigned nChars);
+
+    static FormatInfo m_formatInfo;
+
+    /// The bitmap under work
+    CharBitmap  m_bitmap;
+};
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our bitmap (const).
+ */
+inline const BitmapBase* CharDoc::GetBitmap() const
+{
+    return &m_bitmap;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our bitmap.
+ */
+inline BitmapBase* CharDoc::GetBitmap()
+{
+    return &m_bitmap;
+}
+
+
+#endif // CHARDOC_H
@@ -0,0 +1,576 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+
+#include "Cruncher.h"
+
+#define CRUNCHER_MAX_LITERALS   128
+#define CRUNCHER_MIN_SHORT      2
+#define CRUNCHER_MIN_LONG       3
+#define CRUNCHER_MAX_MATCH      65
+#define CRUNCHER_SHORT_WINDOW   256
+#define CRUNCHER_LONG_WINDOW    65535
+
+#define CRUNCHER_TOKEN_SHORT    0x80
+#define CRUNCHER_TOKEN_LONG     0xc0
+#define CRUNCHER_TOKEN_END      0xff
+
+/* Don't start threads for less data than this */
+#define CRUNCHER_MIN_THREAD_SIZE 2048
+
+#define CRUNCHER_PRG_START      0x0801
+/* Offsets of the operands patched into the decruncher */
+#define CRUNCHER_PRG_SRC_LO     23
+#define CRUNCHER_PRG_SRC_HI     27
+#define CRUNCHER_PRG_DST_LO     31
+#define CRUNCHER_PRG_DST_HI     35
+/* The decrunched data must not overwrite zero page, stack and vectors */
+#define CRUNCHER_PRG_MIN_DST    0x0400
+
+/*****************************************************************************/
+/**
+ * The self-decrunching PRG: load address, BASIC line "10 SYS2061" and the
+ * decruncher. The crunched stream follows directly behind it.
+ */
+static const uint8_t m_aDecruncher[] =
+{
+    0x01, 0x08,                 // load address $0801
+    0x0b, 0x08, 0x0a, 0x00,     // next line $080b, line number 10
+    0x9e, 0x32, 0x30, 0x36,     // SYS2061
+    0x31, 0x00, 0x00, 0x00,     // end of line, end of program
+                                // start:
+    0x78,                       //      sei
+    0xa5, 0x01,                 //      lda $01
+    0x48,                       //      pha
+    0xa9, 0x34,                 //      lda #$34    ; RAM only
+    0x85, 0x01,                 //      sta $01
+    0xa9, 0x00,                 //      lda #<src   ; patched
+    0x85, 0xfb,                 //      sta $fb
+    0xa9, 0x00,                 //      lda #>src   ; patched
+    0x85, 0xfc,                 //      sta $fc
+    0xa9, 0x00,                 //      lda #<dst   ; patched
+    0x85, 0xfd,                 //      sta $fd
+    0xa9, 0x00,                 //      lda #>dst   ; patched
+    0x85, 0xfe,                 //      sta $fe
+    0xa0, 0x00,                 //      ldy #0
+                                // token:
+    0x20, 0x86, 0x08,           //      jsr getbyte
+    0xc9, 0xff,                 //      cmp #$ff
+    0xf0, 0x53,                 //      beq done
+    0xc9, 0x80,                 //      cmp #$80
+    0xb0, 0x0f,                 //      bcs match
+    0xaa,                       //      tax
+    0xe8,                       //      inx
+                                // lit:
+    0x20, 0x86, 0x08,           //      jsr getbyte
+    0x91, 0xfd,                 //      sta ($fd),y
+    0x20, 0x8f, 0x08,           //      jsr incdst
+    0xca,                       //      dex
+    0xd0, 0xf5,                 //      bne lit
+    0xf0, 0xe6,                 //      beq token
+                                // match:
+    0xc9, 0xc0,                 //      cmp #$c0
+    0xb0, 0x10,                 //      bcs long
+    0x29, 0x3f,                 //      and #$3f
+    0xaa,                       //      tax
+    0xe8,                       //      inx
+    0xe8,                       //      inx
+    0x20, 0x86, 0x08,           //      jsr getbyte
+    0x85, 0x02,                 //      sta $02
+    0xa9, 0x00,                 //      lda #0
+    0x85, 0x03,                 //      sta $03
+    0xf0, 0x0d,                 //      beq copy
+                                // long:
+    0xe9, 0xbd,                 //      sbc #$bd
+    0xaa,                       //      tax
+    0x20, 0x86, 0x08,           //      jsr getbyte
+    0x85, 0x02,                 //      sta $02
+    0x20, 0x86, 0x08,           //      jsr getbyte
+    0x85, 0x03,                 //      sta $03
+                                // copy:
+    0x18,                       //      clc         ; ($22) = dst - o - 1
+    0xa5, 0xfd,                 //      lda $fd
+    0xe5, 0x02,                 //      sbc $02
+    0x85, 0x22,                 //      sta $22
+    0xa5, 0xfe,                 //      lda $fe
+    0xe5, 0x03,                 //      sbc $03
+    0x85, 0x23,                 //      sta $23
+                                // cloop:
+    0xb1, 0x22,                 //      lda ($22),y
+    0x91, 0xfd,                 //      sta ($fd),y
+    0xe6, 0x22,                 //      inc $22
+    0xd0, 0x02,                 //      bne +
+    0xe6, 0x23,                 //      inc $23
+    0x20, 0x8f, 0x08,           // +    jsr incdst
+    0xca,                       //      dex
+    0xd0, 0xf0,                 //      bne cloop
+    0xf0, 0xa6,                 //      beq token
+                                // done:
+    0x68,                       //      pla
+    0x85, 0x01,                 //      sta $01
+    0x58,                       //      cli
+    0x60,                       //      rts
+                                // getbyte:
+    0xb1, 0xfb,                 //      lda ($fb),y
+    0xe6, 0xfb,                 //      inc $fb
+    0xd0, 0x02,                 //      bne +
+    0xe6, 0xfc,                 //      inc $fc
+    0x60,                       // +    rts
+                                // incdst:
+    0xe6, 0xfd,                 //      inc $fd
+    0xd0, 0x02,                 //      bne +
+    0xe6, 0xfe,                 //      inc $fe
+    0x60                        // +    rts
+};
+
+
+/*****************************************************************************/
+/**
+ * Constructor. The data must stay valid as long as this object is used.
+ */
+Cruncher::Cruncher(const uint8_t* pData, unsigned nSize) :
+    m_pData(pData),
+    m_nSize(nSize),
+    m_aPrev(),
+    m_aMatches()
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Crunch nSize bytes at pData and append the crunched stream to pOut.
+ * Return true for success.
+ */
+bool Cruncher::Crunch(const uint8_t* pData, unsigned nSize,
+                      std::vector<uint8_t>* pOut)
+{
+    Cruncher cruncher(pData, nSize);
+
+    cruncher.BuildChains();
+    cruncher.FindAllMatches();
+    cruncher.Parse(pOut);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Decrunch the stream of nSize bytes at pData and append the result to pOut.
+ * Return false if the stream is damaged.
+ */
+bool Cruncher::Decrunch(const uint8_t* pData, unsigned nSize,
+                        std::vector<uint8_t>* pOut)
+{
+    unsigned nPos, nStart, nLen, nOffset, i;
+    uint8_t  nToken;
+
+    nStart = pOut->size();
+    nPos = 0;
+    for (;;)
+    {
+        if (nPos >= nSize)
+            return false; // EOF
+
+        nToken = pData[nPos++];
+
+        if (nToken == CRUNCHER_TOKEN_END)
+            break;
+
+        if (nToken < CRUNCHER_TOKEN_SHORT)
+        {
+            nLen = nToken + 1;
+            if (nPos + nLen > nSize)
+                return false;
+
+            pOut->insert(pOut->end(), pData + nPos, pData + nPos + nLen);
+            nPos += nLen;
+            continue;
+        }
+
+        if (nToken < CRUNCHER_TOKEN_LONG)
+        {
+            if (nPos + 1 > nSize)
+                return false;
+            nLen    = (nToken & 0x3f) + CRUNCHER_MIN_SHORT;
+            nOffset = pData[nPos] + 1;
+            nPos   += 1;
+        }
+        else
+        {
+            if (nPos + 2 > nSize)
+                return false;
+            nLen    = nToken - CRUNCHER_TOKEN_LONG + CRUNCHER_MIN_LONG;
+            nOffset = pData[nPos] + 256 * pData[nPos + 1] + 1;
+            nPos   += 2;
+        }
+
+        if (nOffset > pOut->size() - nStart)
+            return false;
+
+        // byte by byte, the match may overlap with its own output
+        for (i = 0; i < nLen; ++i)
+            pOut->push_back((*pOut)[pOut->size() - nOffset]);
+    }
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Crunch the PRG file aPRG, i.e. load address and data, into a
+ * self-decrunching PRG file in pOut.
+ *
+ * Return false if this is not possible because the decrunched data would
+ * overwrite the decruncher, the crunched data or the system area.
+ */
+bool Cruncher::CrunchPRG(const std::vector<uint8_t>& aPRG,
+                         std::vector<uint8_t>* pOut)
+{
+    unsigned nDst, nDstEnd, nSrc, nEnd;
+
+    if (aPRG.size() < 3)
+        return false;
+
+    nDst    = aPRG[0] + 256 * aPRG[1];
+    nDstEnd = nDst + aPRG.size() - 2;
+
+    pOut->assign(m_aDecruncher, m_aDecruncher + sizeof(m_aDecruncher));
+    Crunch(&aPRG[2], aPRG.size() - 2, pOut);
+
+    nSrc = CRUNCHER_PRG_START + sizeof(m_aDecruncher) - 2;
+    nEnd = CRUNCHER_PRG_START + pOut->size() - 2;
+
+    if (nDst < CRUNCHER_PRG_MIN_DST || nDstEnd > 0x10000 ||
+        (nDst < nEnd && nDstEnd > CRUNCHER_PRG_START))
+    {
+        return false;
+    }
+
+    (*pOut)[CRUNCHER_PRG_SRC_LO] = nSrc % 0x100;
+    (*pOut)[CRUNCHER_PRG_SRC_HI] = nSrc / 0x100;
+    (*pOut)[CRUNCHER_PRG_DST_LO] = nDst % 0x100;
+    (*pOut)[CRUNCHER_PRG_DST_HI] = nDst / 0x100;
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return true if the data is a self-decrunching PRG made by CrunchPRG.
+ */
+bool Cruncher::IsCrunchedPRG(const uint8_t* pData, unsigned nSize)
+{
+    unsigned i;
+
+    if (nSize <= sizeof(m_aDecruncher))
+        return false;
+
+    for (i = 0; i < sizeof(m_aDecruncher); ++i)
+    {
+        if (i != CRUNCHER_PRG_SRC_LO && i != CRUNCHER_PRG_SRC_HI &&
+            i != CRUNCHER_PRG_DST_LO && i != CRUNCHER_PRG_DST_HI &&
+            pData[i] != m_aDecruncher[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Decrunch a self-decrunching PRG made by CrunchPRG. pOut gets the original
+ * PRG file, i.e. load address and data. Return false if the data is damaged.
+ */
+bool Cruncher::DecrunchPRG(const uint8_t* pData, unsigned nSize,
+                           std::vector<uint8_t>* pOut)
+{
+    if (!IsCrunchedPRG(pData, nSize))
+        return false;
+
+    pOut->clear();
+    pOut->push_back(pData[CRUNCHER_PRG_DST_LO]);
+    pOut->push_back(pData[CRUNCHER_PRG_DST_HI]);
+
+    return Decrunch(pData + sizeof(m_aDecruncher),
+                    nSize - sizeof(m_aDecruncher), pOut);
+}
+
+
+/*****************************************************************************/
+/**
+ * Link each position to the previous one which starts with the same two
+ * bytes. All candidates for matches at a position can be found by following
+ * these links.
+ */
+void Cruncher::BuildChains()
+{
+    std::vector<int> aHead(0x10000, -1);
+    unsigned         i, nKey;
+
+    m_aPrev.assign(m_nSize, -1);
+    for (i = 0; i + 1 < m_nSize; ++i)
+    {
+        nKey = m_pData[i] | (m_pData[i + 1] << 8);
+        m_aPrev[i] = aHead[nKey];
+        aHead[nKey] = i;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Find the longest matches for the positions nStart to nEnd - 1. The
+ * candidates are checked from the nearest one on, so the search can stop
+ * as soon as no better match is possible.
+ */
+void Cruncher::FindMatches(unsigned nStart, unsigned nEnd)
+{
+    unsigned i, nMax, nLen, nOffset;
+    int      j;
+    Match*   pMatch;
+
+    for (i = nStart; i < nEnd; ++i)
+    {
+        pMatch = &m_aMatches[i];
+        memset(pMatch, 0, sizeof(*pMatch));
+
+        nMax = m_nSize - i;
+        if (nMax > CRUNCHER_MAX_MATCH)
+            nMax = CRUNCHER_MAX_MATCH;
+
+        for (j = m_aPrev[i]; j >= 0; j = m_aPrev[j])
+        {
+            nOffset = i - j;
+            if (nOffset > CRUNCHER_LONG_WINDOW)
+                break;
+            if (nOffset > CRUNCHER_SHORT_WINDOW &&
+                pMatch->nLongLen == nMax)
+                break;
+
+            // the first two bytes are equal, that's what the chain is for
+            nLen = 2;
+            while (nLen < nMax && m_pData[j + nLen] == m_pData[i + nLen])
+                ++nLen;
+
+            if (nOffset <= CRUNCHER_SHORT_WINDOW &&
+                nLen > pMatch->nShortLen)
+            {
+                pMatch->nShortLen    = nLen;
+                pMatch->nShortOffset = nOffset;
+            }
+            if (nLen > pMatch->nLongLen)
+            {
+                pMatch->nLongLen    = nLen;
+                pMatch->nLongOffset = nOffset;
+            }
+
+            if (pMatch->nShortLen == nMax)
+                break;
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Find the longest matches for all positions. The positions are split into
+ * windows which are searched by several threads in parallel.
+ */
+void Cruncher::FindAllMatches()
+{
+    std::vector<Worker*> apWorkers;
+    Worker*              pWorker;
+    unsigned             nThreads, nWindow, nStart;
+    int                  nCPUs;
+    size_t               i;
+
+    m_aMatches.resize(m_nSize);
+
+    nCPUs = wxThread::GetCPUCount();
+    nThreads = nCPUs > 0 ? nCPUs : 1;
+    if (nThreads > m_nSize / CRUNCHER_MIN_THREAD_SIZE)
+        nThreads = m_nSize / CRUNCHER_MIN_THREAD_SIZE;
+    if (nThreads < 1)
+        nThreads = 1;
+
+    nWindow = (m_nSize + nThreads - 1) / nThreads;
+
+    // the first window is searched by this thread
+    for (nStart = nWindow; nStart < m_nSize; nStart += nWindow)
+    {
+        pWorker = new Worker(this, nStart,
+                             nStart + nWindow < m_nSize ?
+                             nStart + nWindow : m_nSize);
+        if (pWorker->Create() != wxTHREAD_NO_ERROR ||
+            pWorker->Run() != wxTHREAD_NO_ERROR)
+        {
+            // do it ourselves
+            delete pWorker;
+            FindMatches(nStart, nStart + nWindow < m_nSize ?
+                                nStart + nWindow : m_nSize);
+            continue;
+        }
+        apWorkers.push_back(pWorker);
+    }
+
+    FindMatches(0, nWindow < m_nSize ? nWindow : m_nSize);
+
+    for (i = 0; i < apWorkers.size(); ++i)
+    {
+        apWorkers[i]->Wait();
+        delete apWorkers[i];
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Find the cheapest sequence of tokens and append it to pOut.
+ *
+ * aCost[i] is the number of bytes needed to encode everything from position
+ * i on. It is calculated from the end to the start, for each position all
+ * literal runs and all lengths of the longest matches are tried. A match
+ * can be shortened, so all lengths up to the longest one are possible.
+ */
+void Cruncher::Parse(std::vector<uint8_t>* pOut)
+{
+    std::vector<unsigned> aCost(m_nSize + 1);
+    std::vector<uint8_t>  aLen(m_nSize);
+    std::vector<uint8_t>  aType(m_nSize);
+    const Match*          pMatch;
+    unsigned              i, n, nMax, nCost, nOffset;
+    enum { LITERAL, SHORT, LONG };
+
+    aCost[m_nSize] = 0;
+    i = m_nSize;
+    while (i-- > 0)
+    {
+        pMatch = &m_aMatches[i];
+
+        nMax = m_nSize - i;
+        if (nMax > CRUNCHER_MAX_LITERALS)
+            nMax = CRUNCHER_MAX_LITERALS;
+
+        aCost[i] = aCost[i + 1] + 2;
+        aLen[i]  = 1;
+        aType[i] = LITERAL;
+        for (n = 2; n <= nMax; ++n)
+        {
+            nCost = aCost[i + n] + 1 + n;
+            if (nCost < aCost[i])
+            {
+                aCost[i] = nCost;
+                aLen[i]  = n;
+            }
+        }
+
+        for (n = CRUNCHER_MIN_SHORT; n <= pMatch->nShortLen; ++n)
+        {
+            nCost = aCost[i + n] + 2;
+            if (nCost < aCost[i])
+            {
+                aCost[i] = nCost;
+                aLen[i]  = n;
+                aType[i] = SHORT;
+            }
+        }
+
+        n = pMatch->nShortLen + 1;
+        if (n < CRUNCHER_MIN_LONG)
+            n = CRUNCHER_MIN_LONG;
+        for (; n <= pMatch->nLongLen; ++n)
+        {
+            nCost = aCost[i + n] + 3;
+            if (nCost < aCost[i])
+            {
+                aCost[i] = nCost;
+                aLen[i]  = n;
+                aType[i] = LONG;
+            }
+        }
+    }
+
+    for (i = 0; i < m_nSize; i += aLen[i])
+    {
+        pMatch = &m_aMatches[i];
+
+        if (aType[i] == LITERAL)
+        {
+            pOut->push_back(aLen[i] - 1);
+            pOut->insert(pOut->end(), m_pData + i, m_pData + i + aLen[i]);
+        }
+        else if (aType[i] == SHORT)
+        {
+            nOffset = pMatch->nShortOffset - 1;
+            pOut->push_back(CRUNCHER_TOKEN_SHORT +
+                            aLen[i] - CRUNCHER_MIN_SHORT);
+            pOut->push_back(nOffset);
+        }
+        else
+        {
+            nOffset = pMatch->nLongOffset - 1;
+            pOut->push_back(CRUNCHER_TOKEN_LONG +
+                            aLen[i] - CRUNCHER_MIN_LONG);
+            pOut->push_back(nOffset % 0x100);
+            pOut->push_back(nOffset / 0x100);
+        }
+    }
+
+    pOut->push_back(CRUNCHER_TOKEN_END);
+}
+
+
+/*****************************************************************************/
+/**
+ * Constructor. The worker searches the matches for the positions nStart to
+ * nEnd - 1.
+ */
+Cruncher::Worker::Worker(Cruncher* pCruncher, unsigned nStart,
+                         unsigned nEnd) :
+    wxThread(wxTHREAD_JOINABLE),
+    m_pCruncher(pCruncher),
+    m_nStart(nStart),
+    m_nEnd(nEnd)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Thread entry: Search the matches of our window.
+ */
+wxThread::ExitCode Cruncher::Worker::Entry()
+{
+    m_pCruncher->FindMatches(m_nStart, m_nEnd);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef CRUNCHER_H
+#define CRUNCHER_H
+
+#include <stdint.h>
+#include <vector>
+#include <wx/thread.h>
+
+/*****************************************************************************/
+/**
+ * LZ cruncher for C64 files.
+ *
+ * The crunched stream consists of these tokens:
+ *
+ * 0x00..0x7f n          n + 1 literal bytes follow
+ * 0x80..0xbf n, o       copy (n & 0x3f) + 2 bytes from offset o + 1
+ * 0xc0..0xfe n, lo, hi  copy n - 0xbd bytes from offset lo + 256 * hi + 1
+ * 0xff                  end of stream
+ *
+ * The offset counts backwards from the current output position. Matches may
+ * overlap with the bytes they produce, they are copied byte by byte.
+ *
+ * The tokens are chosen with optimal parsing: First the longest matches are
+ * searched for each position, this is distributed to several threads. Then
+ * the cheapest way to encode the file is found from its end to its start.
+ *
+ * A PRG file can be wrapped into a self-decrunching PRG which starts with a
+ * BASIC line and a 6502 decruncher at $0801. It decrunches the data to its
+ * original load address and returns to BASIC.
+ */
+class Cruncher
+{
+public:
+    static bool Crunch(const uint8_t* pData, unsigned nSize,
+                       std::vector<uint8_t>* pOut);
+    static bool Decrunch(const uint8_t* pData, unsigned nSize,
+                         std::vector<uint8_t>* pOut);
+
+    static bool CrunchPRG(const std::vector<uint8_t>& aPRG,
+                          std::vector<uint8_t>* pOut);
+    static bool IsCrunchedPRG(const uint8_t* pData, unsigned nSize);
+    static bool DecrunchPRG(const uint8_t* pData, unsigned nSize,
+                            std::vector<uint8_t>* pOut);
+
+protected:
+    /// The longest matches found at one position
+    typedef struct Match_s
+    {
+        /// Longest match with an offset up to 256, 0 if none
+        uint8_t  nShortLen;
+        /// Longest match with any offset, 0 if none
+        uint8_t  nLongLen;
+        /// Offsets of these matches
+        uint16_t nShortOffset;
+        uint16_t nLongOffset;
+    } Match;
+
+    class Worker : public wxThread
+    {
+    public:
+        Worker(Cruncher* pCruncher, unsigned nStart, unsigned nEnd);
+
+    protected:
+        virtual ExitCode Entry();
+
+        Cruncher* m_pCruncher;
+        unsigned  m_nStart;
+        unsigned  m_nEnd;
+    };
+
+    Cruncher(const uint8_t* pData, unsigned nSize);
+
+    void BuildChains();
+    void FindMatches(unsigned nStart, unsigned nEnd);
+    void FindAllMatches();
+    void Parse(std::vector<uint8_t>* pOut);
+
+    /// Data to be crunched
+    const uint8_t*        m_pData;
+
+    /// Size of the data
+    unsigned              m_nSize;
+
+    /// For each position the previous one which starts with the same 2 bytes
+    std::vector<int>      m_aPrev;
+
+    /// The longest matches for each position
+    std::vector<Match>    m_aMatches;
+
+private:
+    /// Copy construtor is private: This can't be copied
+    Cruncher(const Cruncher& r);
+    Cruncher& operator=(const Cruncher& r);
+};
+
+#endif // CRUNCHER_H
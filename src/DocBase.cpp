@@ -23,32 +23,50 @@
  * Thomas Giesel skoe@directbox.com
  */
 
+#include <algorithm>
+#include <iterator>
+
 #include <wx/string.h>
 #include <wx/file.h>
 #include <wx/msgdlg.h>
+#include <wx/image.h>
 
 #include "DocRenderer.h"
 #include "DocBase.h"
 #include "FormatInfo.h"
 #include "BitmapBase.h"
+#include "FileBuffer.h"
+#include "ImageImporter.h"
+#include "Cruncher.h"
 #include "MCApp.h"
 
 
 /// This contains a number for unnamed documents
 unsigned DocBase::m_nDocNumber;
 
+wxCriticalSection DocBase::m_csDocNumber;
+
+bool DocBase::m_bHeadless;
+
 /******************************************************************************/
 /**
  * Constructor.
  */
 DocBase::DocBase() :
     m_fileName(),
+    m_undoBuffer(),
     m_bModified(false),
     m_pointMousePos(-1, -1),
-    m_listUndo(),
-    m_nRedoPos(0)
+    m_aPreview(),
+    m_nPreviewColor(0)
 {
-    m_fileName.SetName(wxString::Format(_T("unnamed%d"), ++m_nDocNumber));
+    unsigned nDocNumber;
+
+    {
+        wxCriticalSectionLocker lock(m_csDocNumber);
+        nDocNumber = ++m_nDocNumber;
+    }
+    m_fileName.SetName(wxString::Format(_T("unnamed%d"), nDocNumber));
 }
 
 
@@ -97,7 +115,8 @@ void DocBase::RemoveRenderer(DocRenderer* pRenderer)
 
 /******************************************************************************/
 /**
- * Refresh all renderers associated with this document.
+ * Refresh all renderers associated with this document. The area is clipped
+ * to the bitmap, by default the whole bitmap is refreshed.
  */
 void DocBase::Refresh(int x1, int y1, int x2, int y2)
 {
@@ -129,26 +148,30 @@ void DocBase::Modify(bool bModified)
     str.Append(m_fileName.GetFullName());
 
     // todo: Is this the right place?
-    wxGetApp().SetDocName(this, str);
+    if (!IsHeadless())
+        wxGetApp().SetDocName(this, str);
 }
 
 
 /******************************************************************************/
 /**
- * Refresh the dirty rectangle in all renderers associated with this document.
- * Then reset the dirty rectangle.
+ * Refresh the dirty rectangles in all renderers associated with this
+ * document. Then reset the dirty area. Areas far apart are refreshed
+ * separately, so only the cells which have been touched are redrawn.
  */
 void DocBase::RefreshDirty()
 {
-    wxRect dirty;
+    std::vector<wxRect> aRects;
+    std::vector<wxRect>::const_iterator i;
 
-    dirty = GetBitmap()->GetDirtyRect();
-    if (dirty.GetRight() >= 0)
-    {
-        Refresh(dirty.GetLeft(), dirty.GetTop(),
-                dirty.GetRight(), dirty.GetBottom());
-        GetBitmap()->ResetDirty();
-    }
+    if (GetBitmap()->GetDirtyRect().GetRight() < 0)
+        return;
+
+    GetBitmap()->GetDirtyRects(&aRects);
+    for (i = aRects.begin(); i != aRects.end(); ++i)
+        Refresh(i->GetLeft(), i->GetTop(), i->GetRight(), i->GetBottom());
+
+    GetBitmap()->ResetDirty();
 }
 
 
@@ -167,7 +190,8 @@ void DocBase::SetMousePos(int x, int y)
         m_pointMousePos.x = x;
         m_pointMousePos.y = y;
 
-        wxGetApp().GetMainFrame()->ShowMousePos(x, y);
+        if (!IsHeadless() && wxGetApp().GetMainFrame())
+            wxGetApp().GetMainFrame()->ShowMousePos(x, y);
 
         for (i  = m_listDocRenderers.begin();
              i != m_listDocRenderers.end();
@@ -179,36 +203,130 @@ void DocBase::SetMousePos(int x, int y)
 }
 
 
+/******************************************************************************/
+/**
+ * Show the given points in color nColor over the bitmap in all renderers,
+ * replacing the previous preview. The bitmap itself is not changed, a tool
+ * draws the real shape when it is finished.
+ *
+ * Only points which are added to or removed from the preview are redrawn.
+ * So dragging a shape only costs the points of its old and new outline.
+ */
+void DocBase::SetPreview(const std::vector<wxPoint>& aPoints, int nColor)
+{
+    std::vector<wxPoint> aNew(aPoints);
+    std::vector<wxPoint> aChanged;
+
+    std::sort(aNew.begin(), aNew.end(), ComparePreviewPoints);
+    aNew.erase(std::unique(aNew.begin(), aNew.end()), aNew.end());
+
+    if (nColor == m_nPreviewColor)
+        std::set_symmetric_difference(m_aPreview.begin(), m_aPreview.end(),
+                                      aNew.begin(), aNew.end(),
+                                      std::back_inserter(aChanged),
+                                      ComparePreviewPoints);
+    else
+        std::set_union(m_aPreview.begin(), m_aPreview.end(),
+                       aNew.begin(), aNew.end(),
+                       std::back_inserter(aChanged),
+                       ComparePreviewPoints);
+
+    m_aPreview.swap(aNew);
+    m_nPreviewColor = nColor;
+
+    RefreshPreviewPoints(aChanged);
+}
+
 
 /******************************************************************************/
 /**
- * Save the current bitmap as undo step and mark the document as being
- * modified.
+ * Remove the preview and redraw the bitmap where it has been.
  */
-void DocBase::PrepareUndo()
+void DocBase::ClearPreview()
 {
-    unsigned i;
+    std::vector<wxPoint> aOld;
 
-    Modify(true);
+    aOld.swap(m_aPreview);
+    RefreshPreviewPoints(aOld);
+}
 
-    // if we are not at the end of the undo list, discard the rest
-    while (m_nRedoPos < m_listUndo.size())
-    {
-        delete m_listUndo.back();
-        m_listUndo.pop_back();
-    }
 
-    // if the list is full, remove the first entry
-    if (m_listUndo.size() >= MC_UNDO_LEN)
+/******************************************************************************/
+/**
+ * Return a pointer to the preview points in line y and their number in
+ * *pnPoints. They are sorted by x.
+ */
+const wxPoint* DocBase::GetPreviewRow(int y, unsigned* pnPoints) const
+{
+    std::vector<wxPoint>::const_iterator i, iEnd;
+
+    i = std::lower_bound(m_aPreview.begin(), m_aPreview.end(),
+                         wxPoint(INT_MIN, y), ComparePreviewPoints);
+    for (iEnd = i; iEnd != m_aPreview.end() && iEnd->y == y; ++iEnd)
+        ;
+
+    *pnPoints = iEnd - i;
+    return *pnPoints ? &*i : NULL;
+}
+
+
+/******************************************************************************/
+/**
+ * Order of the preview points: line by line, from left to right.
+ */
+bool DocBase::ComparePreviewPoints(const wxPoint& a, const wxPoint& b)
+{
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+
+/******************************************************************************/
+/**
+ * Refresh the given sorted points in all renderers. Horizontal runs of
+ * points are refreshed at once.
+ */
+void DocBase::RefreshPreviewPoints(const std::vector<wxPoint>& aPoints)
+{
+    unsigned i, iStart;
+
+    for (iStart = 0; iStart < aPoints.size(); iStart = i)
     {
-        delete m_listUndo.front();
-        m_listUndo.pop_front();
-        --m_nRedoPos;
+        for (i = iStart + 1; i < aPoints.size() &&
+             aPoints[i].y == aPoints[iStart].y &&
+             aPoints[i].x == aPoints[i - 1].x + 1; ++i)
+            ;
+
+        Refresh(aPoints[iStart].x, aPoints[iStart].y,
+                aPoints[i - 1].x, aPoints[iStart].y);
     }
+}
+
+
+
+/******************************************************************************/
+/**
+ * Record the changes since the last call as undo step and mark the document
+ * as being modified.
+ */
+void DocBase::PrepareUndo()
+{
+    Modify(true);
+    m_undoBuffer.Commit(GetBitmap());
+}
 
-    // append current state
-    m_listUndo.push_back(GetBitmap()->Copy());
-    m_nRedoPos++;
+/******************************************************************************/
+/**
+ * Remember the current bitmap state when a tool is started, so the changes
+ * made by the tool become an undo step of their own.
+ *
+ * Nothing is copied: The snapshot of the undo buffer is used as backup.
+ * Changes which have not been recorded yet are committed first, so the
+ * snapshot is the current state.
+ */
+void DocBase::BackupBitmap()
+{
+    if (m_undoBuffer.Commit(GetBitmap()))
+        Modify(true);
 }
 
 /******************************************************************************/
@@ -217,20 +335,10 @@ void DocBase::PrepareUndo()
  */
 void DocBase::Undo()
 {
-    std::list<BitmapBase*>::iterator it;
-    int i;
-
     if (CanUndo())
     {
-        // find the right position in the undo list
-        m_nRedoPos--;
-        it = m_listUndo.begin();
-        for (i = m_nRedoPos - 1; i; --i)
-            ++it;
-
-        if (it != m_listUndo.end())
-            SetBitmap(*it);
-        Refresh();
+        m_undoBuffer.Undo(GetBitmap());
+        RefreshDirty();
     }
 }
 
@@ -240,21 +348,10 @@ void DocBase::Undo()
  */
 void DocBase::Redo()
 {
-    std::list<BitmapBase*>::iterator it;
-    int i;
-
     if (CanRedo())
     {
-        // find the right position in the undo list
-        it = m_listUndo.begin();
-        for (i = m_nRedoPos; i; --i)
-            ++it;
-
-        if (it != m_listUndo.end())
-            SetBitmap(*it);
-
-        m_nRedoPos++;
-        Refresh();
+        m_undoBuffer.Redo(GetBitmap());
+        RefreshDirty();
     }
 }
 
@@ -264,7 +361,7 @@ void DocBase::Redo()
  */
 bool DocBase::CanUndo()
 {
-    return m_nRedoPos > 1;
+    return m_undoBuffer.CanUndo();
 };
 
 /******************************************************************************/
@@ -273,7 +370,7 @@ bool DocBase::CanUndo()
  */
 bool DocBase::CanRedo()
 {
-    return m_nRedoPos < m_listUndo.size();
+    return m_undoBuffer.CanRedo();
 };
 
 
@@ -283,12 +380,91 @@ bool DocBase::CanRedo()
  */
 void DocBase::ClearUndoBuffer()
 {
-    if (m_listUndo.size())
+    m_undoBuffer.Clear();
+}
+
+/******************************************************************************/
+/**
+ * Return true if the colors of this document can be chosen again by
+ * Reoptimise. This is not possible by default.
+ */
+bool DocBase::CanReoptimise() const
+{
+    return false;
+}
+
+/******************************************************************************/
+/**
+ * Choose the colors of the bitmap again, e.g. a better background color.
+ * This is one undo step.
+ */
+void DocBase::Reoptimise()
+{
+    if (ReoptimiseBitmap())
+    {
+        PrepareUndo();
+        RefreshDirty();
+    }
+}
+
+/******************************************************************************/
+/**
+ * Return the number of sprites if this document is a sprite sheet, 0
+ * otherwise.
+ */
+unsigned DocBase::GetNSprites() const
+{
+    return 0;
+}
+
+/******************************************************************************/
+/**
+ * Change the number of sprites of a sprite sheet. This changes the size of
+ * the bitmap, the undo steps recorded so far don't fit to it anymore, so the
+ * undo buffer is cleared.
+ */
+void DocBase::SetNSprites(unsigned nSprites)
+{
+    if (SetNSpritesBitmap(nSprites))
     {
-        delete m_listUndo.front();
-        m_listUndo.pop_front();
+        ClearUndoBuffer();
+        PrepareUndo();
+        RefreshDirty();
     }
-    m_nRedoPos = 0;
+}
+
+/******************************************************************************/
+/**
+ * Return true if this document is made of characters which can be merged
+ * by ReduceChars. This is not possible by default.
+ */
+bool DocBase::CanReduceChars() const
+{
+    return false;
+}
+
+/******************************************************************************/
+/**
+ * Merge similar characters until at most nChars are left. This is one undo
+ * step.
+ */
+void DocBase::ReduceChars(unsigned nChars)
+{
+    if (ReduceCharsBitmap(nChars))
+    {
+        PrepareUndo();
+        RefreshDirty();
+    }
+}
+
+/******************************************************************************/
+/**
+ * Return a short text about the state of this document to be shown in the
+ * status bar. There is nothing to tell by default.
+ */
+wxString DocBase::GetStatusText() const
+{
+    return wxEmptyString;
 }
 
 /******************************************************************************/
@@ -301,73 +477,167 @@ void DocBase::ClearUndoBuffer()
  */
 DocBase* DocBase::Load(const wxString& stringFileName)
 {
-    uint8_t*     pBuff;
-    wxFileOffset len;
-    wxFile       file(stringFileName);
+    FileBuffer   buffer;
     wxFileName   fileName(stringFileName);
     bool         bLoaded = false;
     const FormatInfo* pFormat;
     DocBase*     pDoc = NULL;
+    const uint8_t* pData;
+    unsigned     nSize;
+    std::vector<uint8_t> aDecrunched;
 
-    if (!file.IsOpened())
+    if (!buffer.Open(stringFileName))
     {
-        ::wxMessageBox(wxT("Could not open this file for reading."),
-            wxT("Load Error"), wxOK | wxICON_ERROR);
+        ShowMessage(stringFileName,
+            wxT("Could not read this file."), wxT("Load Error"));
         return NULL;
     }
 
-    len = file.Length();
-    if (len > (wxFileOffset)(MC_MAX_FILE_BUFF_SIZE))
+    if (buffer.GetSize() != (unsigned) buffer.GetSize())
     {
-        ::wxMessageBox(wxT("File too large."), wxT("Load Error"),
-            wxOK | wxICON_ERROR);
-
+        ShowMessage(stringFileName, wxT("File too large."), wxT("Load Error"));
         return NULL;
     }
 
-    pBuff = new unsigned char[len];
-    if (file.Read(pBuff, len) != len)
+    pData = buffer.GetData();
+    nSize = buffer.GetSize();
+
+    // a self-decrunching PRG saved by us contains one of the other formats
+    if (Cruncher::IsCrunchedPRG(pData, nSize))
     {
-        ::wxMessageBox(wxT("File could not be read, it may be broken."),
-            wxT("Load Error"), wxOK | wxICON_ERROR);
-        return NULL;
+        if (!Cruncher::DecrunchPRG(pData, nSize, &aDecrunched))
+        {
+            ShowMessage(stringFileName,
+                wxT("Could not decrunch this file."), wxT("Load Error"));
+            return NULL;
+        }
+        pData = &aDecrunched[0];
+        nSize = aDecrunched.size();
     }
 
-    pFormat = FormatInfo::FindBestFormat(pBuff, len, fileName);
+    pFormat = FormatInfo::FindBestFormat(pData, nSize, fileName);
     if (pFormat)
     {
         pDoc = pFormat->Factory();
-        bLoaded = pDoc->Load(pBuff, len);
+        // set the name early, so the loader can use it in its messages
+        pDoc->SetFileName(fileName);
+        bLoaded = pDoc->Load(pData, nSize);
     }
 
-    delete[] pBuff;
     if (bLoaded)
     {
         pDoc->ClearUndoBuffer();
         pDoc->PrepareUndo();
-        pDoc->SetFileName(fileName);
         pDoc->Modify(false);
     }
     else
     {
-        ::wxMessageBox(wxT("Could not load this file."),
-            wxT("Load Error"), wxOK | wxICON_ERROR);
+        ShowMessage(stringFileName,
+            wxT("Could not load this file."), wxT("Load Error"));
+        delete pDoc;
+        pDoc = NULL;
+    }
+    return pDoc;
+}
+
+
+/******************************************************************************/
+/**
+ * Import an image file of any format wxImage can read into a new document
+ * of the given format. This is a static function like Load.
+ *
+ * Return a pointer to the new document, NULL if the image couldn't be
+ * imported.
+ */
+DocBase* DocBase::Import(const wxString& stringFileName,
+                         const FormatInfo* pFormat, MCDitherMode dither)
+{
+    wxImage       image;
+    ImageImporter importer(image, dither);
+    DocBase*      pDoc;
+
+    if (!image.LoadFile(stringFileName) || !image.Ok())
+    {
+        ShowMessage(stringFileName,
+            wxT("Could not read this image."), wxT("Import Error"));
+        return NULL;
+    }
+
+    pDoc = pFormat->Factory();
+    if (!pDoc->ImportImage(&importer))
+    {
+        ShowMessage(stringFileName,
+            wxT("Images cannot be imported into this format."),
+            wxT("Import Error"));
+        delete pDoc;
+        return NULL;
     }
+
+    pDoc->ClearUndoBuffer();
+    pDoc->PrepareUndo();
+    // it has not been saved yet
+    pDoc->Modify(true);
+
     return pDoc;
 }
 
 
+/******************************************************************************/
+/**
+ * Convert an image into the bitmap of this document. Return false if this
+ * document type can't do this, which is the default.
+ */
+bool DocBase::ImportImage(ImageImporter* /* pImporter */)
+{
+    return false;
+}
+
+
+/******************************************************************************/
+/**
+ * Choose the colors of the bitmap again. Return true if the bitmap has been
+ * changed. The default implementation doesn't change anything.
+ */
+bool DocBase::ReoptimiseBitmap()
+{
+    return false;
+}
+
+
+/******************************************************************************/
+/**
+ * Change the number of sprites of the bitmap. Return true if the bitmap has
+ * been changed. The default implementation doesn't change anything.
+ */
+bool DocBase::SetNSpritesBitmap(unsigned /* nSprites */)
+{
+    return false;
+}
+
+
+/******************************************************************************/
+/**
+ * Merge characters of the bitmap. Return true if the bitmap has been
+ * changed. The default implementation doesn't change anything.
+ */
+bool DocBase::ReduceCharsBitmap(unsigned /* nChars */)
+{
+    return false;
+}
+
+
 /******************************************************************************
  **
  * Save the given buffer into a file. Use the given name if not empty,
  * otherwise use the current name.
  *
+ * The file is encoded into a buffer which is kept for the next time and
+ * written with a single call.
+ *
  * Return true for success.
  */
 bool DocBase::Save(const wxString& stringFileName)
 {
-    unsigned char* pBuff;
-    size_t         len;
     size_t         written;
     wxFile         file;
     bool           bRet = false;
@@ -376,14 +646,11 @@ bool DocBase::Save(const wxString& stringFileName)
     if (stringFileName.length())
         fileNameTmp.Assign(stringFileName);
 
-    pBuff = new unsigned char[MC_MAX_FILE_BUFF_SIZE];
-    len = Save(pBuff, fileNameTmp);
-
-    if (len <= 0)
+    m_aSaveBuffer.clear();
+    if (!Save(&m_aSaveBuffer, fileNameTmp) || m_aSaveBuffer.empty())
     {
-        ::wxMessageBox(wxT("Could not save this file."),
-            wxT("Save Error"), wxOK | wxICON_ERROR);
-        delete[] pBuff;
+        ShowMessage(fileNameTmp.GetFullPath(),
+            wxT("Could not save this file."), wxT("Save Error"));
         return false;
     }
 
@@ -391,26 +658,60 @@ bool DocBase::Save(const wxString& stringFileName)
 
     if (!file.IsOpened())
     {
-        wxMessageBox(wxT("Could not open \"%s\" for writing."),
-                fileNameTmp.GetFullPath());
-        delete[] pBuff;
+        ShowMessage(fileNameTmp.GetFullPath(),
+            wxT("Could not open this file for writing."), wxT("Save Error"));
         return false;
     }
 
-    written = file.Write(pBuff, len);
+    written = file.Write(&m_aSaveBuffer[0], m_aSaveBuffer.size());
 
-    if (written == len)
+    if (written == m_aSaveBuffer.size())
     {
         m_fileName = fileNameTmp.GetFullPath();
         Modify(false);
+        OnSaved(fileNameTmp);
         bRet = true;
     }
     else
     {
-        ::wxMessageBox(wxT("An error occurred while saving."),
-                wxT("Save Error"), wxOK | wxICON_ERROR);
+        ShowMessage(fileNameTmp.GetFullPath(),
+            wxT("An error occurred while saving."), wxT("Save Error"));
     }
 
-    delete[] pBuff;
 	return bRet;
 }
+
+
+/******************************************************************************/
+/**
+ * Called after the document has been written to the file with the given
+ * name. Documents which remember the sub-format of their last file update
+ * it here, so a failed save doesn't change it. The default does nothing.
+ */
+void DocBase::OnSaved(const wxFileName& /* fileName */)
+{
+}
+
+
+/******************************************************************************
+ **
+ * Tell the user about a problem with the given file. In headless mode there is
+ * nobody to click a message box away, so the message goes to stderr,
+ * prefixed with the file name. This may be called from worker threads in
+ * batch mode.
+ */
+void DocBase::ShowMessage(const wxString& stringFileName,
+                          const wxString& stringMessage,
+                          const wxString& stringCaption,
+                          long style)
+{
+    if (IsHeadless())
+    {
+        wxFprintf(stderr, wxT("%s: %s\n"),
+                  stringFileName.c_str(), stringMessage.c_str());
+    }
+    else
+    {
+        ::wxMessageBox(stringMessage, stringCaption, style);
+    }
+}
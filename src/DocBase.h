@@ -25,16 +25,21 @@
 #ifndef DOCBASE_H
 #define DOCBASE_H
 
+#include <limits.h>
 #include <stdint.h>
 #include <list>
+#include <vector>
 #include <wx/filename.h>
 #include <wx/gdicmn.h>
+#include <wx/thread.h>
 
-#define MC_UNDO_LEN 100
+#include "UndoBuffer.h"
+#include "DitherMode.h"
 
 class DocRenderer;
 class BitmapBase;
 class FormatInfo;
+class ImageImporter;
 
 class DocBase
 {
@@ -44,7 +49,7 @@ public:
 
     void AddRenderer(DocRenderer* pRenderer);
     void RemoveRenderer(DocRenderer* pRenderer);
-    void Refresh(int x1 = 0, int y1 = 0, int x2 = 4096, int y2 = 4096);
+    void Refresh(int x1 = 0, int y1 = 0, int x2 = INT_MAX, int y2 = INT_MAX);
 
     bool IsModified();
     void Modify(bool bModified);
@@ -56,8 +61,7 @@ public:
 
     virtual BitmapBase* GetBitmap() = 0;
     virtual void SetBitmap(const BitmapBase*) = 0;
-    virtual void BackupBitmap() = 0;
-    virtual void RestoreBitmap() = 0;
+    void BackupBitmap();
 
     void RefreshDirty();
 
@@ -68,23 +72,64 @@ public:
     bool CanRedo();
     void ClearUndoBuffer();
 
+    virtual bool CanReoptimise() const;
+    void Reoptimise();
+
+    virtual unsigned GetNSprites() const;
+    void SetNSprites(unsigned nSprites);
+
+    virtual bool CanReduceChars() const;
+    void ReduceChars(unsigned nChars);
+
+    virtual wxString GetStatusText() const;
+
     static DocBase* Load(const wxString& stringFileName);
+    static DocBase* Import(const wxString& stringFileName,
+                           const FormatInfo* pFormat, MCDitherMode dither);
     bool Save(const wxString& stringFileName);
 
+    static void SetHeadless(bool bHeadless);
+    static bool IsHeadless();
+
     void SetMousePos(int x, int y);
     const wxPoint& GetMousePos() const;
 
+    void SetPreview(const std::vector<wxPoint>& aPoints, int nColor);
+    void ClearPreview();
+    const wxPoint* GetPreviewRow(int y, unsigned* pnPoints) const;
+    int GetPreviewColor() const;
+
 protected:
-    virtual bool Load(uint8_t* pBuff, unsigned size) = 0;
-    virtual unsigned Save(uint8_t* pBuff, const wxFileName& fileName) = 0;
+    static void ShowMessage(const wxString& stringFileName,
+                            const wxString& stringMessage,
+                            const wxString& stringCaption,
+                            long style = wxOK | wxICON_ERROR);
+
+    virtual bool Load(const uint8_t* pBuff, unsigned size) = 0;
+    virtual bool Save(std::vector<uint8_t>* pOut,
+                      const wxFileName& fileName) = 0;
+    virtual void OnSaved(const wxFileName& fileName);
+    virtual bool ImportImage(ImageImporter* pImporter);
+    virtual bool ReoptimiseBitmap();
+    virtual bool SetNSpritesBitmap(unsigned nSprites);
+    virtual bool ReduceCharsBitmap(unsigned nChars);
+
+    static bool ComparePreviewPoints(const wxPoint& a, const wxPoint& b);
+    void RefreshPreviewPoints(const std::vector<wxPoint>& aPoints);
 
     /// the full path and file name
     wxFileName                  m_fileName;
 
     static unsigned             m_nDocNumber;
 
-    std::list<BitmapBase*>      m_listUndo;
-    unsigned                    m_nRedoPos;
+    /// Protects m_nDocNumber, batch workers create documents in parallel
+    static wxCriticalSection    m_csDocNumber;
+
+    /// true if there is no GUI, e.g. when converting files on the command line
+    static bool                 m_bHeadless;
+
+    /// The undo history, contains only the cells changed in each step
+    UndoBuffer                  m_undoBuffer;
 
     /// true if the document has been changed but not saved
     bool                        m_bModified;
@@ -92,9 +137,18 @@ protected:
     /// last mouse position reported by one of my views (bitmap coordinates)
     wxPoint                     m_pointMousePos;
 
+    /// Shape previewed by a tool, sorted by y and x, not in the bitmap yet
+    std::vector<wxPoint>        m_aPreview;
+
+    /// C64 color number of the preview
+    int                         m_nPreviewColor;
+
     /// A list of all Renderers for this document
     std::list<DocRenderer*>     m_listDocRenderers;
 
+    /// Files are encoded into this buffer before they are written
+    std::vector<uint8_t>        m_aSaveBuffer;
+
 private:
     /// Copy construtor is private: This can't be copied
     DocBase(DocBase &r);
@@ -130,6 +184,28 @@ inline void DocBase::SetFileName(const wxFileName& fileName)
 }
 
 
+/******************************************************************************/
+/**
+ * Switch to headless mode, used when there is no GUI. Documents do not talk
+ * to the main frame then and report problems on stderr. Must be set before
+ * any document is created.
+ */
+inline void DocBase::SetHeadless(bool bHeadless)
+{
+    m_bHeadless = bHeadless;
+}
+
+
+/******************************************************************************/
+/**
+ * Return true if there is no GUI the documents could talk to.
+ */
+inline bool DocBase::IsHeadless()
+{
+    return m_bHeadless;
+}
+
+
 /******************************************************************************/
 /**
  * Get the last mouse position reported by one of my views (bitmap coordinates)
@@ -139,4 +215,14 @@ inline const wxPoint& DocBase::GetMousePos() const
     return m_pointMousePos;
 }
 
+
+/******************************************************************************/
+/**
+ * Get the C64 color number of the preview shape.
+ */
+inline int DocBase::GetPreviewColor() const
+{
+    return m_nPreviewColor;
+}
+
 #endif // DOCBASE_H
@@ -23,23 +23,42 @@
  * Thomas Giesel skoe@directbox.com
  */
 
+#include <limits.h>
+#include <string.h>
+
 #include "BitmapBase.h"
 #include "DocRenderer.h"
 #include "C64Color.h"
 
-#define FIXP_SHIFT 16
-
-/* Ein EWMA-Filter.
- * CONST ist der Exponent fuer die Filterkonstante 1 - 1/(2^CONST)
- */
-#define PAINT_FILTER(F,X,CONST) ( (F)+=(X)-(F) - (((X)-(F))>>(CONST)) )
-
-
 
 /*****************************************************************************/
 DocRenderer::DocRenderer() :
-    m_pDoc(NULL)
+    m_pDoc(NULL),
+    m_tvFilter()
 {
+    MC_RGB rgb, rgb2;
+    int    i, j;
+
+    for (i = 0; i < 16; ++i)
+    {
+        rgb = C64Color::GetPaletteColor(i)->GetRGB();
+        m_aPaletteRGB[i][0] = MC_RGB_R(rgb);
+        m_aPaletteRGB[i][1] = MC_RGB_G(rgb);
+        m_aPaletteRGB[i][2] = MC_RGB_B(rgb);
+
+        m_aBugRGB[i][0] = MC_RGB_R(rgb) / 2;
+        m_aBugRGB[i][1] = MC_RGB_G(rgb) / 2;
+        m_aBugRGB[i][2] = MC_RGB_B(rgb) / 2;
+
+        // interlaced frames are seen as the average of both colors
+        for (j = 0; j < 16; ++j)
+        {
+            rgb2 = C64Color::GetPaletteColor(j)->GetRGB();
+            m_aBlendRGB[i][j][0] = (MC_RGB_R(rgb) + MC_RGB_R(rgb2) + 1) / 2;
+            m_aBlendRGB[i][j][1] = (MC_RGB_G(rgb) + MC_RGB_G(rgb2) + 1) / 2;
+            m_aBlendRGB[i][j][2] = (MC_RGB_B(rgb) + MC_RGB_B(rgb2) + 1) / 2;
+        }
+    }
 }
 
 
@@ -64,12 +83,17 @@ void DocRenderer::SetDoc(DocBase* pDoc)
         m_pDoc->RemoveRenderer(this);
 
     m_pDoc = pDoc;
+    m_aDirtyRects.clear();
 
     // add me to the new document
     if (m_pDoc)
+    {
         m_pDoc->AddRenderer(this);
-
-    RedrawDoc(0, 0, 9999, 9999);
+        RedrawDoc(0, 0, m_pDoc->GetBitmap()->GetWidth() - 1,
+                  m_pDoc->GetBitmap()->GetHeight() - 1);
+    }
+    else
+        RedrawDoc(0, 0, 0, 0);
 }
 
 
@@ -122,7 +146,135 @@ void DocRenderer::DrawMousePos(wxDC* pDC, int x, int y, unsigned nZoom)
 
 /*****************************************************************************/
 /**
- * Paint the scaled bitmap into the cache image at scale 1:1 and 2:1.
+ * Remember the area x1/y1..x2/y2 (bitmap space) to be redrawn later.
+ *
+ * A renderer calls this from RedrawDoc and redraws the collected areas at
+ * most once per frame, so a fast stroke or a long automated edit doesn't
+ * paint the view for each pixel. Areas are joined when their bounding box
+ * contains no pixels which haven't been changed, e.g. neighbours in a row.
+ * If there are too many areas, the two areas which waste the least space
+ * when joined are merged, so only a few boxes are left.
+ */
+void DocRenderer::AddDirtyRect(int x1, int y1, int x2, int y2)
+{
+    wxRect        rect;
+    unsigned      i, j, iBest, jBest;
+    unsigned long nWaste, nBestWaste;
+
+    MergeDirtyRect(wxRect(x1, y1, x2 - x1 + 1, y2 - y1 + 1));
+
+    while (m_aDirtyRects.size() > DOCRENDERER_MAX_DIRTY_RECTS)
+    {
+        iBest      = 0;
+        jBest      = 1;
+        nBestWaste = ULONG_MAX;
+        for (i = 0; i < m_aDirtyRects.size(); ++i)
+        {
+            for (j = i + 1; j < m_aDirtyRects.size(); ++j)
+            {
+                nWaste = GetWaste(m_aDirtyRects[i], m_aDirtyRects[j]);
+                if (nWaste < nBestWaste)
+                {
+                    nBestWaste = nWaste;
+                    iBest = i;
+                    jBest = j;
+                }
+            }
+        }
+
+        rect = m_aDirtyRects[iBest];
+        rect.Union(m_aDirtyRects[jBest]);
+        m_aDirtyRects.erase(m_aDirtyRects.begin() + jBest);
+        m_aDirtyRects.erase(m_aDirtyRects.begin() + iBest);
+        MergeDirtyRect(rect);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Add the area to the collected ones. It is joined with all areas which
+ * can be joined without wasting space.
+ */
+void DocRenderer::MergeDirtyRect(wxRect rect)
+{
+    unsigned i;
+
+    i = 0;
+    while (i < m_aDirtyRects.size())
+    {
+        if (GetWaste(rect, m_aDirtyRects[i]) == 0)
+        {
+            // the larger area may be joined with areas checked already
+            rect.Union(m_aDirtyRects[i]);
+            m_aDirtyRects.erase(m_aDirtyRects.begin() + i);
+            i = 0;
+        }
+        else
+            ++i;
+    }
+    m_aDirtyRects.push_back(rect);
+}
+
+
+/*****************************************************************************/
+/**
+ * Move the collected areas to *paRects, there are none left afterwards.
+ */
+void DocRenderer::TakeDirtyRects(std::vector<wxRect>* paRects)
+{
+    paRects->clear();
+    paRects->swap(m_aDirtyRects);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of pixels in the bounding box of both rectangles which
+ * are in none of them. Overlapping rectangles may be counted as 0.
+ */
+unsigned long DocRenderer::GetWaste(const wxRect& a, const wxRect& b)
+{
+    wxRect        rect(a);
+    unsigned long nUnion, nBoth;
+
+    rect.Union(b);
+    nUnion = (unsigned long) rect.width * rect.height;
+    nBoth  = (unsigned long) a.width * a.height +
+             (unsigned long) b.width * b.height;
+
+    return nUnion > nBoth ? nUnion - nBoth : 0;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bitmap pixels right of a change which have to be
+ * redrawn because the TV emulation smears the change into them.
+ */
+unsigned DocRenderer::GetTVMargin(unsigned nZoom) const
+{
+    unsigned xFactor = nZoom;
+
+    if (m_pDoc)
+        xFactor *= m_pDoc->GetBitmap()->GetPixelXFactor();
+
+    return (m_tvFilter.GetMargin(nZoom) + xFactor - 1) / xFactor;
+}
+
+
+/*****************************************************************************/
+/**
+ * Draw the area x1/y1..x2/y2 of the bitmap at scale 1:1 and 2:1.
+ *
+ * Only the given area is rendered, row by row, into an RGB buffer which is
+ * blitted at once. GetRowRGB delivers the colors of a whole row at once.
+ * When the TV is emulated, the filter is started GetTVMargin() pixels left
+ * of the area, so the pixels in the area get (almost) the same values as if
+ * the whole line had been filtered. The margin itself is not drawn.
+ *
+ * Nothing depends on the size of the whole bitmap, so large canvases only
+ * cost what is visible or changed.
  *
  * The caller must make sure that:
  * x1 <= x2, y1 <= y2, 0 <= x < w, 0 <= y <= h
@@ -133,71 +285,70 @@ void DocRenderer::DrawScaleSmall(wxDC* pDC, unsigned nZoom, bool bEmulateTV,
         unsigned x1, unsigned y1, unsigned x2, unsigned y2)
 {
     const BitmapBase* pB = m_pDoc->GetBitmap();
-    MC_RGB   col;
-    int      fixr, fixg, fixb, tmpr, tmpg, tmpb;
-    const int aFilters[] = {0, 2, 1};
-    int      filter;
-    unsigned        x, y, w, yStop, xFactor, yFactor;
-    unsigned char*  pPixels;
+    unsigned        x, y, i, xStart, xFactor, yFactor, nMargin;
     unsigned char*  p;
-    unsigned        nPitch;
+    const unsigned char* pRGB;
+    unsigned        w, h, nPitch;
+    wxRect          rect;
 
-    filter  = aFilters[nZoom];
     xFactor = pB->GetPixelXFactor() * nZoom;
     yFactor = pB->GetPixelYFactor() * nZoom;
 
-    if (!m_image.IsOk() ||
-        m_image.GetWidth() != pB->GetWidth() * xFactor ||
-        m_image.GetHeight() != pB->GetHeight() * yFactor)
+    xStart = x1;
+    if (bEmulateTV)
     {
-        m_image.Create(pB->GetWidth() * xFactor,
-                       pB->GetHeight() * yFactor, false);
-        // in this case we have to render the whole image
-        x1 = 0;
-        y1 = 0;
-        x2 = pB->GetWidth() - 1;
-        y2 = pB->GetHeight() - 1;
+        nMargin = GetTVMargin(nZoom);
+        xStart  = x1 > nMargin ? x1 - nMargin : 0;
     }
 
-    pPixels = m_image.GetData();
-    nPitch  = m_image.GetWidth() * 3;
-    w       = xFactor * pB->GetWidth();
+    // the area to be rendered in screen pixels, including the margin
+    w      = (x2 + 1 - xStart) * xFactor;
+    h      = (y2 + 1 - y1) * yFactor;
+    nPitch = w * 3;
+
+    if (m_aSmallBuffer.size() < nPitch * h)
+        m_aSmallBuffer.resize(nPitch * h);
 
-    // We draw all full lines of the area so the blur has the right effect
-    yStop = (y2 + 1) * yFactor;
-    for (y = y1 * yFactor; y < yStop; ++y) // todo: bug?
+    for (y = y1; y <= y2; ++y)
     {
-        fixr = fixg = fixb = 64 << FIXP_SHIFT;
-        p = pPixels + y * nPitch;
+        pRGB = GetRowRGB(pB, xStart, y, x2 + 1 - xStart);
 
-        for (x = 0; x < w; ++x)
+        p = &m_aSmallBuffer[(y - y1) * yFactor * nPitch];
+        for (x = xStart; x <= x2; ++x, pRGB += 3)
         {
-            if (x % xFactor == 0)
-            {
-                col = pB->GetColor(x / xFactor, y / nZoom)->GetRGB();
-                tmpr = (col & 0xff) << FIXP_SHIFT;
-                tmpg = ((col >> 8) & 0xff) << FIXP_SHIFT;
-                tmpb = ((col >> 16) & 0xff) << FIXP_SHIFT;
-            }
-            if (bEmulateTV)
+            for (i = 0; i < xFactor; ++i)
             {
-                PAINT_FILTER(fixr, tmpr, filter);
-                PAINT_FILTER(fixg, tmpg, filter);
-                PAINT_FILTER(fixb, tmpb, filter);
-                *p++ = fixb >> FIXP_SHIFT;
-                *p++ = fixg >> FIXP_SHIFT;
-                *p++ = fixr >> FIXP_SHIFT;
+                *p++ = pRGB[0];
+                *p++ = pRGB[1];
+                *p++ = pRGB[2];
             }
-            else
-            {
-                *p++ = tmpb >> FIXP_SHIFT;
-                *p++ = tmpg >> FIXP_SHIFT;
-                *p++ = tmpr >> FIXP_SHIFT;
-            }
-        } /* x */
-    } /* y */
+        }
+
+        p = &m_aSmallBuffer[(y - y1) * yFactor * nPitch];
+        if (bEmulateTV)
+            m_tvFilter.FilterLine(p, w, nZoom);
+
+        // the other lines of this bitmap row look the same
+        for (i = 1; i < yFactor; ++i)
+        {
+            memcpy(p + i * nPitch, p, nPitch);
+            if (bEmulateTV && m_tvFilter.HasScanlines() && (i & 1))
+                m_tvFilter.DarkenLine(p + i * nPitch, w);
+        }
+    }
 
-    pDC->DrawBitmap(m_image, 0, 0, false);
+    wxImage image(w, h, &m_aSmallBuffer[0], true);
+
+    // only copy the area itself to the screen, not the margin
+    rect.x      = (x1 - xStart) * xFactor;
+    rect.y      = 0;
+    rect.width  = (x2 + 1 - x1) * xFactor;
+    rect.height = h;
+    if (rect.x == 0)
+        pDC->DrawBitmap(wxBitmap(image), x1 * xFactor, y1 * yFactor, false);
+    else
+        pDC->DrawBitmap(wxBitmap(image.GetSubImage(rect)),
+                        x1 * xFactor, y1 * yFactor, false);
 }
 
 
@@ -205,6 +356,11 @@ void DocRenderer::DrawScaleSmall(wxDC* pDC, unsigned nZoom, bool bEmulateTV,
 /**
  * Draw the scaled bitmap at scale 4:1 and higher.
  *
+ * The area is rendered into an RGB buffer which is blitted at once. Each
+ * bitmap pixel becomes a block of the pixel's color with one line of grid
+ * color at its top and left edge. Then a cross in contrast color is drawn
+ * at each cell corner.
+ *
  * The caller must make sure that:
  * x1 <= x2, y1 <= y2, 0 <= x < w, 0 <= y <= h
  *
@@ -214,67 +370,202 @@ void DocRenderer::DrawScaleBig(wxDC* pDC, unsigned nZoom,
         unsigned x1, unsigned y1, unsigned x2, unsigned y2)
 {
     const BitmapBase* pB = m_pDoc->GetBitmap();
-    wxBrush        brush(*wxBLACK);
-    wxPen          pen(*wxBLACK);
     MC_RGB         rgb;
-    wxRect         rect;
-    unsigned       x, y, i, xFactor;
+    unsigned       x, y, i, xFactor, yFactor;
+    unsigned       xOrig, yOrig, w, h, nPitch;
+    unsigned       xCorner, yCorner, xCellSize, yCellSize, nArm;
+    int            a, b, aStart, aEnd;
+    unsigned char* p;
+    unsigned char* pLine;
+    const unsigned char* pRGB;
 
     xFactor = pB->GetPixelXFactor() * nZoom;
+    yFactor = pB->GetPixelYFactor() * nZoom;
 
-    pen.SetColour(MC_GRID_COL_R, MC_GRID_COL_G, MC_GRID_COL_B);
+    // the area to be drawn in screen coordinates
+    xOrig  = x1 * xFactor;
+    yOrig  = y1 * yFactor;
+    w      = (x2 + 1 - x1) * xFactor;
+    h      = (y2 + 1 - y1) * yFactor;
+    nPitch = w * 3;
 
-    // Draw blocks for pixels
-    pDC->SetPen(*wxTRANSPARENT_PEN);
-    rect.height = nZoom - 1;
-    rect.width  = xFactor - 1;
+    if (m_aBigBuffer.size() < nPitch * h)
+        m_aBigBuffer.resize(nPitch * h);
+
+    // Draw blocks for pixels, including the fine grid
     for (y = y1; y <= y2; ++y)
     {
-        rect.y = nZoom * y + 1;
-        for (x = x1; x <= x2; ++x)
+        // the first line of each pixel row is grid
+        p = &m_aBigBuffer[(y - y1) * yFactor * nPitch];
+        for (x = 0; x < w; ++x)
         {
-            rect.x = xFactor * x + 1;
+            *p++ = MC_GRID_COL_R;
+            *p++ = MC_GRID_COL_G;
+            *p++ = MC_GRID_COL_B;
+        }
+
+        // the next one has a grid pixel left of each bitmap pixel
+        pLine = p;
+        pRGB = GetRowRGB(pB, x1, y, x2 + 1 - x1);
+        for (x = x1; x <= x2; ++x, pRGB += 3)
+        {
+            *p++ = MC_GRID_COL_R;
+            *p++ = MC_GRID_COL_G;
+            *p++ = MC_GRID_COL_B;
 
-            rgb = pB->GetColor(x, y)->GetRGB();
-            brush.SetColour(MC_RGB_R(rgb), MC_RGB_G(rgb), MC_RGB_B(rgb));
-            pDC->SetBrush(brush);
-            pDC->DrawRectangle(rect);
+            for (i = 1; i < xFactor; ++i)
+            {
+                *p++ = pRGB[0];
+                *p++ = pRGB[1];
+                *p++ = pRGB[2];
+            }
         }
-    }
 
-    // Draw the fine grid
-    pDC->SetPen(pen);
-    for (x = x1; x <= x2; ++x)
-    {
-        i = xFactor * x;
-        pDC->DrawLine(i, nZoom * y1, i, nZoom * (y2 + 1));
+        // and the others look the same
+        for (i = 2; i < yFactor; ++i)
+            memcpy(pLine + (i - 1) * nPitch, pLine, nPitch);
     }
-    for (y = y1; y <= y2; ++y)
+
+    // Draw a cross at each cell corner which touches this area
+    xCellSize = pB->GetCellWidth() * xFactor;
+    yCellSize = pB->GetCellHeight() * yFactor;
+    nArm      = nZoom / 2;
+
+    for (yCorner = yOrig - yOrig % yCellSize;
+         yCorner < yOrig + h + nArm &&
+         yCorner < pB->GetHeight() * yFactor;
+         yCorner += yCellSize)
     {
-        i = nZoom * y;
-        pDC->DrawLine(xFactor * x1, i, xFactor * (x2 + 1), i);
+        for (xCorner = xOrig - xOrig % xCellSize;
+             xCorner < xOrig + w + nArm &&
+             xCorner < pB->GetWidth() * xFactor;
+             xCorner += xCellSize)
+        {
+            rgb = pB->GetColor(xCorner / xFactor,
+                               yCorner / yFactor)->GetContrastRGB();
+
+            // horizontal line
+            b = yCorner - yOrig;
+            if (b >= 0 && b < (int) h)
+            {
+                aStart = wxMax((int) xCorner - (int) nArm, (int) xOrig) -
+                         xOrig;
+                aEnd   = wxMin(xCorner + nArm, xOrig + w) - xOrig;
+                p = &m_aBigBuffer[b * nPitch + aStart * 3];
+                for (a = aStart; a < aEnd; ++a)
+                {
+                    *p++ = MC_RGB_R(rgb);
+                    *p++ = MC_RGB_G(rgb);
+                    *p++ = MC_RGB_B(rgb);
+                }
+            }
+
+            // vertical line
+            a = xCorner - xOrig;
+            if (a >= 0 && a < (int) w)
+            {
+                aStart = wxMax((int) yCorner - (int) nArm, (int) yOrig) -
+                         yOrig;
+                aEnd   = wxMin(yCorner + nArm, yOrig + h) - yOrig;
+                for (b = aStart; b < aEnd; ++b)
+                {
+                    p = &m_aBigBuffer[b * nPitch + a * 3];
+                    p[0] = MC_RGB_R(rgb);
+                    p[1] = MC_RGB_G(rgb);
+                    p[2] = MC_RGB_B(rgb);
+                }
+            }
+        }
     }
 
-    // Draw the cell grid, we extend the area to the next border at the
-    // upper left corner
-    x1 -= x1 % pB->GetCellWidth();
-    x1 *= xFactor;
-    y1 -= y1 % pB->GetCellHeight();
-    y1 *= nZoom;
+    wxImage image(w, h, &m_aBigBuffer[0], true);
+    pDC->DrawBitmap(wxBitmap(image), xOrig, yOrig, false);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the RGB values of w pixels starting at x/y, 3 bytes per bitmap
+ * pixel. The pointer is valid until the next call.
+ *
+ * The bitmap delivers the color numbers of a whole row at once, they are
+ * converted to RGB with a palette table. Interlaced bitmaps deliver a row
+ * for each frame, the pair of colors is converted with a table of mixed
+ * colors. A dirty area is the same in both frames, so they are always
+ * redrawn together. Pixels in the bug area, which a real C64 doesn't show
+ * properly, are drawn darker. The shape previewed by a tool is drawn over
+ * the bitmap in its pure color.
+ *
+ * The caller must make sure that the whole row is inside of the bitmap.
+ */
+const unsigned char* DocRenderer::GetRowRGB(const BitmapBase* pB,
+        unsigned x, unsigned y, unsigned w)
+{
+    const unsigned char* pRGB;
+    unsigned char*       p;
+    const wxPoint*       pPreview;
+    unsigned             i, nBug, nPreview;
+
+    if (m_aRowBuffer.size() < w)
+        m_aRowBuffer.resize(w);
+    if (m_aRowRGB.size() < w * 3)
+        m_aRowRGB.resize(w * 3);
+
+    nBug = pB->GetBugAreaWidth();
+    p    = &m_aRowRGB[0];
 
-    x2 *= xFactor;
-    y2 *= nZoom;
-    for (y = y1; y <= y2; y += 8 * nZoom)
+    if (pB->GetNFrames() > 1)
     {
-        for (x = x1; x < x2; x += 8 * nZoom)
+        if (m_aFrameBuffer.size() < w)
+            m_aFrameBuffer.resize(w);
+
+        pB->GetFrameColorRow(0, x, y, w, &m_aRowBuffer[0]);
+        pB->GetFrameColorRow(1, x, y, w, &m_aFrameBuffer[0]);
+        for (i = 0; i < w; ++i)
+        {
+            pRGB = m_aBlendRGB[m_aRowBuffer[i]][m_aFrameBuffer[i]];
+            if (x + i < nBug)
+            {
+                *p++ = pRGB[0] / 2;
+                *p++ = pRGB[1] / 2;
+                *p++ = pRGB[2] / 2;
+            }
+            else
+            {
+                *p++ = pRGB[0];
+                *p++ = pRGB[1];
+                *p++ = pRGB[2];
+            }
+        }
+    }
+    else
+    {
+        pB->GetColorRow(x, y, w, &m_aRowBuffer[0]);
+        for (i = 0; i < w; ++i)
         {
-            rgb = pB->GetColor(
-                x / xFactor, y / nZoom)->GetContrastRGB();
-            pen.SetColour(MC_RGB_R(rgb), MC_RGB_G(rgb), MC_RGB_B(rgb));
-            pDC->SetPen(pen);
+            if (x + i < nBug)
+                pRGB = m_aBugRGB[m_aRowBuffer[i]];
+            else
+                pRGB = m_aPaletteRGB[m_aRowBuffer[i]];
+            *p++ = pRGB[0];
+            *p++ = pRGB[1];
+            *p++ = pRGB[2];
+        }
+    }
 
-            pDC->DrawLine(x - nZoom / 2, y, x + nZoom / 2, y);
-            pDC->DrawLine(x, y - nZoom / 2, x, y + nZoom / 2);
+    // draw the preview of a tool over it
+    pPreview = m_pDoc->GetPreviewRow(y, &nPreview);
+    pRGB     = m_aPaletteRGB[m_pDoc->GetPreviewColor() & 0x0f];
+    for (i = 0; i < nPreview; ++i)
+    {
+        if (pPreview[i].x >= (int) x && pPreview[i].x < (int) (x + w))
+        {
+            p = &m_aRowRGB[(pPreview[i].x - x) * 3];
+            p[0] = pRGB[0];
+            p[1] = pRGB[1];
+            p[2] = pRGB[2];
         }
     }
+
+    return &m_aRowRGB[0];
 }
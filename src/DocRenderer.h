@@ -26,10 +26,18 @@
 #ifndef DOCRENDERER_H_
 #define DOCRENDERER_H_
 
+#include <vector>
 #include <wx/dc.h>
 #include <wx/image.h>
 
 #include "DocBase.h"
+#include "TVFilter.h"
+
+/// Maximal number of areas a renderer collects until it redraws them
+#define DOCRENDERER_MAX_DIRTY_RECTS 8
+
+/// Time in ms from the first change until the areas are redrawn, one frame
+#define DOCRENDERER_REDRAW_INTERVAL 16
 
 /*****************************************************************************/
 /**
@@ -68,22 +76,62 @@ public:
 
     DocBase* GetDoc();
 
+    MCTVFilterKernel GetTVKernel() const;
+
 protected:
 
     void DrawMousePos(wxDC* pDC, int x, int y, unsigned nZoom);
 
+    void AddDirtyRect(int x1, int y1, int x2, int y2);
+    void TakeDirtyRects(std::vector<wxRect>* paRects);
+
+    unsigned GetTVMargin(unsigned nZoom) const;
+
     void DrawScaleSmall(wxDC* pDC, unsigned nZoom, bool bEmulateTV,
             unsigned x1, unsigned y1, unsigned x2, unsigned y2);
 
     void DrawScaleBig(wxDC* pDC, unsigned nZoom,
             unsigned x1, unsigned y1, unsigned x2, unsigned y2);
 
+    const unsigned char* GetRowRGB(const BitmapBase* pB,
+            unsigned x, unsigned y, unsigned w);
+
     // Pointer to Document to be rendered or NULL
     DocBase*    m_pDoc;
 
+    /// Used for TV emulation at zoom levels 1:1 and 2:1
+    TVFilter    m_tvFilter;
+
 private:
-    /// This image is used as cache at zoom levels 1:1 and 2:1
-    wxImage     m_image;
+    void MergeDirtyRect(wxRect rect);
+    static unsigned long GetWaste(const wxRect& a, const wxRect& b);
+
+    /// Areas to be redrawn in bitmap space, merged to a few boxes
+    std::vector<wxRect> m_aDirtyRects;
+
+    /// R, G, B for each C64 color number, in the order used by wxImage
+    unsigned char m_aPaletteRGB[16][3];
+
+    /// The same, but darker for pixels in the bug area of FLI modes
+    unsigned char m_aBugRGB[16][3];
+
+    /// Mixed R, G, B for each pair of colors in interlaced frames
+    unsigned char m_aBlendRGB[16][16][3];
+
+    /// C64 color numbers of one bitmap row, filled by GetColorRow
+    std::vector<unsigned char> m_aRowBuffer;
+
+    /// The same for the second frame of interlaced bitmaps
+    std::vector<unsigned char> m_aFrameBuffer;
+
+    /// RGB data of one bitmap row, one entry per bitmap pixel
+    std::vector<unsigned char> m_aRowRGB;
+
+    /// RGB data of the area drawn at zoom levels 1:1 and 2:1
+    std::vector<unsigned char> m_aSmallBuffer;
+
+    /// RGB data of the area drawn at zoom levels 4:1 and higher
+    std::vector<unsigned char> m_aBigBuffer;
 };
 
 
@@ -96,4 +144,14 @@ inline DocBase* DocRenderer::GetDoc()
     return m_pDoc;
 }
 
+
+/*****************************************************************************/
+/**
+ * Return the kernel used for TV emulation.
+ */
+inline MCTVFilterKernel DocRenderer::GetTVKernel() const
+{
+    return m_tvFilter.GetKernel();
+}
+
 #endif /*DOCRENDERER_H_*/
@@ -0,0 +1,575 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include "FLIBitmap.h"
+
+
+const C64Color FLIBitmap::black;
+
+
+/*****************************************************************************/
+FLIBitmap::FLIBitmap(void)
+{
+    memset(m_aBitmapRAM, 0, sizeof(m_aBitmapRAM));
+    memset(m_aScreenRAM, 0, sizeof(m_aScreenRAM));
+    memset(m_aColorRAM, 0, sizeof(m_aColorRAM));
+    memset(m_aBackground, MC_BLACK, sizeof(m_aBackground));
+}
+
+
+/*****************************************************************************/
+FLIBitmap::~FLIBitmap(void)
+{
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to a copy of this bitmap created with "new".
+ */
+BitmapBase* FLIBitmap::Copy() const
+{
+    return new FLIBitmap(*this);
+}
+
+
+/******************************************************************************/
+/**
+ * Return the width of this image.
+ */
+int FLIBitmap::GetWidth() const
+{
+    return FLI_X;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the height of this image.
+ */
+int FLIBitmap::GetHeight() const
+{
+    return FLI_Y;
+}
+
+
+/*****************************************************************************/
+/**
+ * Each pixel row of a character has its own colors, so a cell is 4x1.
+ */
+int FLIBitmap::GetCellWidth() const
+{
+    return FLIBLOCK_WIDTH;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the height of a cell, which is one pixel row.
+ */
+int FLIBitmap::GetCellHeight() const
+{
+    return FLIBLOCK_HEIGHT;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the pixel factor in X-direction. 2 for MC.
+ */
+int FLIBitmap::GetPixelXFactor() const
+{
+    return 2;
+}
+
+
+/******************************************************************************/
+/**
+ * The first three character columns are covered by the FLI bug.
+ */
+int FLIBitmap::GetBugAreaWidth() const
+{
+    return FLIBITMAP_BUG_WIDTH;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of color indexes in this mode.
+ */
+int FLIBitmap::GetNIndexes() const
+{
+    return 4;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of an index in the cell which contains the given
+ * coordinates. If the coordinates are out of range, return black.
+ */
+const C64Color* FLIBitmap::GetColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+    {
+        if (index < 4)
+            return C64Color::GetPaletteColor(
+                    GetIndexedColorNumber(x, y, index));
+        else
+            return NULL;
+    }
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of pixels of an index in the cell which contains the
+ * given coordinates. If the coordinates are out of range, return 0.
+ */
+int FLIBitmap::CountColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return CountIndex(x, y, index);
+    else
+        return 0;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of a pixel. If the coordinates are out of range, return
+ * black.
+ */
+const C64Color* FLIBitmap::GetColor(int x, int y) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return C64Color::GetPaletteColor(
+                GetIndexedColorNumber(x, y, GetIndex(x, y)));
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ */
+void FLIBitmap::GetColorRow(int x, int y, int w, unsigned char* pDest) const
+{
+    unsigned             c, xPixel, val;
+    const unsigned char* pRow;
+    const unsigned char* pScreen;
+    unsigned char        aColors[4];
+
+    c       = (y / 8) * FLIBITMAP_XCHARS + x / FLIBLOCK_WIDTH;
+    pRow    = m_aBitmapRAM + c * FLIBITMAP_BYTES_PER_CHAR + y % 8;
+    pScreen = m_aScreenRAM[y % 8];
+    xPixel  = x % FLIBLOCK_WIDTH;
+
+    aColors[0] = m_aBackground[y];
+    while (w > 0)
+    {
+        aColors[1] = pScreen[c] >> 4;
+        aColors[2] = pScreen[c] & 0x0f;
+        aColors[3] = m_aColorRAM[c];
+
+        val = *pRow;
+        for (; xPixel < FLIBLOCK_WIDTH && w > 0; ++xPixel, --w)
+            *pDest++ = aColors[(val >> (2 * (FLIBLOCK_WIDTH - 1 - xPixel))) &
+                               0x03];
+
+        xPixel = 0;
+        ++c;
+        pRow += FLIBITMAP_BYTES_PER_CHAR;
+    }
+}
+
+
+/*****************************************************************************
+ * Set the pixel x/y to the color col. This works like MCBlock::SetPixel,
+ * but for the 4x1 cell which contains the pixel.
+ *
+ * Index 0 is the background of this line, it is used if it has the right
+ * color. Index 1 and 2 belong to this cell only. Index 3 is the color RAM,
+ * which is shared by the 8 rows of the character. So it is only free if no
+ * pixel of the whole character uses it and its usage is counted for the
+ * whole character when the least used color is looked for.
+ */
+void FLIBitmap::SetPixel(int x, int y, const C64Color& col,
+                         MCDrawingMode mode)
+{
+    int           aUsage[4];
+    unsigned char c;
+    int           i;
+
+    if ((x < 0) || (y < 0) || (x >= GetWidth()) || (y >= GetHeight()))
+        return;
+
+    c = (unsigned char) col.GetColor();
+
+    // this may change the whole cell
+    Dirty(x & ~(FLIBLOCK_WIDTH - 1), y, FLIBLOCK_WIDTH, FLIBLOCK_HEIGHT);
+
+    // Set colors with fixed index first
+    i = (int)(mode - MCDrawingModeIndex0);
+    if (mode >= MCDrawingModeIndex0 && mode <= MCDrawingModeIndex3)
+    {
+        SetIndexedColor(x, y, i, c);
+        SetIndex(x, y, i);
+        return;
+    }
+
+    // use the background if possible
+    if (GetIndexedColorNumber(x, y, 0) == c)
+    {
+        SetIndex(x, y, 0);
+        return;
+    }
+
+    aUsage[1] = CountIndex(x, y, 1);
+    aUsage[2] = CountIndex(x, y, 2);
+    aUsage[3] = CountColorRAM(x, y);
+
+    // then all colors used
+    for (i = 1; i < 4; ++i)
+    {
+        if (aUsage[i] != 0 && GetIndexedColorNumber(x, y, i) == c)
+        {
+            SetIndex(x, y, i);
+            return;
+        }
+    }
+
+    // otherwise a free one
+    for (i = 1; i < 4; ++i)
+    {
+        if (aUsage[i] == 0)
+        {
+            SetIndex(x, y, i);
+            SetIndexedColor(x, y, i, c);
+            return;
+        }
+    }
+
+    // color clash, depends on the mode
+    if (mode == MCDrawingModeIgnore)
+        return;
+
+    if (mode == MCDrawingModeForce)
+    {
+        // replace the color of this pixel
+        i = GetIndex(x, y);
+        if (i != 0)
+        {
+            SetIndexedColor(x, y, i, c);
+            return;
+        }
+
+        // the background is fixed, use the least used color instead
+        mode = MCDrawingModeLeast;
+    }
+
+    if (mode == MCDrawingModeLeast)
+    {
+        i = 1;
+        if (aUsage[2] < aUsage[i])
+            i = 2;
+        if (aUsage[3] < aUsage[i])
+            i = 3;
+        SetIndex(x, y, i);
+        SetIndexedColor(x, y, i, c);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: One bitmap byte,
+ * one byte screen RAM and the color RAM of its character.
+ */
+unsigned FLIBitmap::GetCellDataSize() const
+{
+    return 3;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid.
+ */
+void FLIBitmap::GetCellData(int xCell, int yCell, unsigned char* pData) const
+{
+    unsigned c = (yCell / 8) * FLIBITMAP_XCHARS + xCell;
+
+    pData[0] = m_aBitmapRAM[c * FLIBITMAP_BYTES_PER_CHAR + yCell % 8];
+    pData[1] = m_aScreenRAM[yCell % 8][c];
+    pData[2] = m_aColorRAM[c];
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ *
+ * The color RAM belongs to the whole character, if it changes, all of its
+ * rows have to be redrawn.
+ */
+void FLIBitmap::SetCellData(int xCell, int yCell, const unsigned char* pData)
+{
+    unsigned c = (yCell / 8) * FLIBITMAP_XCHARS + xCell;
+
+    m_aBitmapRAM[c * FLIBITMAP_BYTES_PER_CHAR + yCell % 8] = pData[0];
+    m_aScreenRAM[yCell % 8][c] = pData[1];
+
+    if (m_aColorRAM[c] != (pData[2] & 0x0f))
+    {
+        m_aColorRAM[c] = pData[2] & 0x0f;
+        Dirty(xCell * FLIBLOCK_WIDTH, yCell & ~7, FLIBLOCK_WIDTH, 8);
+    }
+
+    Dirty(xCell * FLIBLOCK_WIDTH, yCell, FLIBLOCK_WIDTH, FLIBLOCK_HEIGHT);
+}
+
+
+/*****************************************************************************/
+/**
+ * The global data of an FLI bitmap are the background colors of all lines.
+ */
+unsigned FLIBitmap::GetGlobalDataSize() const
+{
+    return sizeof(m_aBackground);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the background colors of all lines to pData.
+ */
+void FLIBitmap::GetGlobalData(unsigned char* pData) const
+{
+    memcpy(pData, m_aBackground, sizeof(m_aBackground));
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background colors of all lines from pData.
+ */
+void FLIBitmap::SetGlobalData(const unsigned char* pData)
+{
+    unsigned y;
+
+    for (y = 0; y < FLI_Y; ++y)
+        SetBackground(y, pData[y]);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background color of line y.
+ */
+void FLIBitmap::SetBackground(unsigned y, unsigned char col)
+{
+    if (m_aBackground[y] != (col & 0x0f))
+    {
+        m_aBackground[y] = col & 0x0f;
+
+        // this may change the whole line
+        Dirty(0, y, FLI_X, 1);
+    }
+}
+
+
+/*****************************************************************************/
+unsigned char FLIBitmap::GetBackground(unsigned y) const
+{
+    return m_aBackground[y];
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy nRows bitmap bytes in VIC order into this image, starting at the
+ * first one. Usually nRows is 8000 to set the complete bitmap.
+ */
+void FLIBitmap::SetBitmapRows(const uint8_t* pSrc, size_t nRows)
+{
+    if (nRows > sizeof(m_aBitmapRAM))
+        nRows = sizeof(m_aBitmapRAM);
+
+    memcpy(m_aBitmapRAM, pSrc, nRows);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the first nRows bitmap bytes in VIC order to pDest.
+ */
+void FLIBitmap::GetBitmapRows(uint8_t* pDest, size_t nRows) const
+{
+    if (nRows > sizeof(m_aBitmapRAM))
+        nRows = sizeof(m_aBitmapRAM);
+
+    memcpy(pDest, m_aBitmapRAM, nRows);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy a complete screen RAM (1000 bytes) into this image. Bank n is used
+ * for pixel row n of each character.
+ */
+void FLIBitmap::SetScreenRAM(unsigned nBank, const unsigned char* pSrc)
+{
+    memcpy(m_aScreenRAM[nBank], pSrc, sizeof(m_aScreenRAM[nBank]));
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the screen RAM of bank nBank (1000 bytes) to pDest.
+ */
+void FLIBitmap::GetScreenRAM(unsigned nBank, unsigned char* pDest) const
+{
+    memcpy(pDest, m_aScreenRAM[nBank], sizeof(m_aScreenRAM[nBank]));
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy a complete color RAM (1000 bytes) into this image. The upper nibbles
+ * are not connected on a real C64, so we ignore them.
+ */
+void FLIBitmap::SetColorRAM(const unsigned char* pSrc)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(m_aColorRAM); ++i)
+        m_aColorRAM[i] = pSrc[i] & 0x0f;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the complete color RAM (1000 bytes) to pDest.
+ */
+void FLIBitmap::GetColorRAM(unsigned char* pDest) const
+{
+    memcpy(pDest, m_aColorRAM, sizeof(m_aColorRAM));
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color index (0..3) of the pixel x/y. The coordinates must be
+ * valid.
+ */
+void FLIBitmap::SetIndex(unsigned x, unsigned y, int index)
+{
+    unsigned char* pRow;
+    unsigned       shift;
+
+    pRow  = m_aBitmapRAM + ((y / 8) * FLIBITMAP_XCHARS + x / FLIBLOCK_WIDTH) *
+            FLIBITMAP_BYTES_PER_CHAR + y % 8;
+    shift = 2 * (FLIBLOCK_WIDTH - 1 - x % FLIBLOCK_WIDTH);
+    *pRow = (*pRow & ~(0x03 << shift)) | (index << shift);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color of an index in the cell which contains x/y. The background
+ * belongs to the whole line and the color RAM to the whole character, the
+ * area which may change is marked as dirty.
+ */
+void FLIBitmap::SetIndexedColor(unsigned x, unsigned y, int index,
+                                unsigned char col)
+{
+    unsigned char* pScreen;
+    unsigned       c = (y / 8) * FLIBITMAP_XCHARS + x / FLIBLOCK_WIDTH;
+
+    pScreen = &m_aScreenRAM[y % 8][c];
+    switch (index)
+    {
+    case 0:
+        SetBackground(y, col);
+        break;
+    case 1:
+        *pScreen = (*pScreen & 0x0f) | (col << 4);
+        break;
+    case 2:
+        *pScreen = (*pScreen & 0xf0) | col;
+        break;
+    case 3:
+        m_aColorRAM[c] = col;
+        Dirty(x & ~(FLIBLOCK_WIDTH - 1), y & ~7, FLIBLOCK_WIDTH, 8);
+        break;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of pixels in the 4x1 cell containing x/y which use the
+ * given index.
+ */
+int FLIBitmap::CountIndex(unsigned x, unsigned y, int index) const
+{
+    unsigned char val;
+    int           i, n;
+
+    val = m_aBitmapRAM[((y / 8) * FLIBITMAP_XCHARS + x / FLIBLOCK_WIDTH) *
+                       FLIBITMAP_BYTES_PER_CHAR + y % 8];
+    n = 0;
+    for (i = 0; i < FLIBLOCK_WIDTH; ++i)
+    {
+        if (((val >> (2 * i)) & 0x03) == index)
+            ++n;
+    }
+    return n;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of pixels in the character containing x/y which use
+ * the color RAM (index 3).
+ */
+int FLIBitmap::CountColorRAM(unsigned x, unsigned y) const
+{
+    unsigned yy;
+    int      n;
+
+    n = 0;
+    for (yy = y & ~7; yy < (y & ~7) + 8; ++yy)
+        n += CountIndex(x, yy, 3);
+    return n;
+}
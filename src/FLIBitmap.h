@@ -0,0 +1,175 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef FLIBITMAP_H
+#define FLIBITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "C64Color.h"
+#include "ToolBase.h"
+#include "BitmapBase.h"
+
+#define FLI_X 160
+#define FLI_Y 200
+
+/* An FLI cell is one row of a character */
+#define FLIBLOCK_WIDTH  4
+#define FLIBLOCK_HEIGHT 1
+
+#define FLIBITMAP_BYTES_PER_CHAR 8
+#define FLIBITMAP_XCHARS (FLI_X / 4)
+#define FLIBITMAP_YCHARS (FLI_Y / 8)
+#define FLIBITMAP_NCHARS (FLIBITMAP_XCHARS * FLIBITMAP_YCHARS)
+
+/* One screen RAM for each pixel row of a character */
+#define FLIBITMAP_NBANKS 8
+
+/* The VIC shows garbage in the first 3 character columns of each line */
+#define FLIBITMAP_BUG_WIDTH (3 * FLIBLOCK_WIDTH)
+
+/*****************************************************************************/
+/**
+ * A multicolor FLI bitmap. The VIC gets a new screen RAM for each pixel
+ * row, so each 4x1 cell has two colors of its own. The color RAM is shared
+ * by the 8 rows of a character and the background can be changed for each
+ * line.
+ *
+ * Like MCBitmap the data is stored exactly like the VIC sees it: 8000 bytes
+ * bitmap, 8 * 1000 bytes screen RAM, 1000 bytes color RAM and 200
+ * background colors. There are no usage counters, a cell has only 4 pixels
+ * in a single bitmap byte, so they are counted when needed.
+ */
+class FLIBitmap : public BitmapBase
+{
+public:
+    FLIBitmap(void);
+    ~FLIBitmap(void);
+    virtual BitmapBase* Copy() const;
+
+    virtual int GetWidth() const;
+    virtual int GetHeight() const;
+
+    virtual int GetCellWidth() const;
+    virtual int GetCellHeight() const;
+
+    virtual int GetPixelXFactor() const;
+
+    virtual int GetBugAreaWidth() const;
+
+    virtual int GetNIndexes() const;
+    virtual const C64Color* GetColorByIndex(int x, int y, int index) const;
+    virtual int CountColorByIndex(int x, int y, int index) const;
+
+    virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
+    virtual void SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode = MCDrawingModeIgnore);
+
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
+    virtual unsigned GetGlobalDataSize() const;
+    virtual void GetGlobalData(unsigned char* pData) const;
+    virtual void SetGlobalData(const unsigned char* pData);
+
+    void SetBackground(unsigned y, unsigned char col);
+    unsigned char GetBackground(unsigned y) const;
+
+    void SetBitmapRows(const uint8_t* pSrc, size_t nRows);
+    void GetBitmapRows(uint8_t* pDest, size_t nRows) const;
+    void SetScreenRAM(unsigned nBank, const unsigned char* pSrc);
+    void GetScreenRAM(unsigned nBank, unsigned char* pDest) const;
+    void SetColorRAM(const unsigned char* pSrc);
+    void GetColorRAM(unsigned char* pDest) const;
+
+    static const C64Color black;
+
+protected:
+    int GetIndex(unsigned x, unsigned y) const;
+    void SetIndex(unsigned x, unsigned y, int index);
+    int GetIndexedColorNumber(unsigned x, unsigned y, int index) const;
+    void SetIndexedColor(unsigned x, unsigned y, int index,
+                         unsigned char col);
+    int CountIndex(unsigned x, unsigned y, int index) const;
+    int CountColorRAM(unsigned x, unsigned y) const;
+
+    /// Bitmap RAM, 8 bytes per character, in VIC order
+    unsigned char m_aBitmapRAM[FLIBITMAP_NCHARS * FLIBITMAP_BYTES_PER_CHAR];
+
+    /// Screen RAM for each pixel row, upper nibble is index 1, lower is 2
+    unsigned char m_aScreenRAM[FLIBITMAP_NBANKS][FLIBITMAP_NCHARS];
+
+    /// Color RAM, only the lower nibble is used, it's index 3
+    unsigned char m_aColorRAM[FLIBITMAP_NCHARS];
+
+    /// Background color of each line, index 0
+    unsigned char m_aBackground[FLI_Y];
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the color index (0..3) of the pixel x/y. The coordinates must be
+ * valid.
+ */
+inline int FLIBitmap::GetIndex(unsigned x, unsigned y) const
+{
+    unsigned c = (y / 8) * FLIBITMAP_XCHARS + x / FLIBLOCK_WIDTH;
+
+    return (m_aBitmapRAM[c * FLIBITMAP_BYTES_PER_CHAR + y % 8] >>
+            (2 * (FLIBLOCK_WIDTH - 1 - x % FLIBLOCK_WIDTH))) & 0x03;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the C64 color number used for the given index in the cell which
+ * contains x/y. The coordinates must be valid.
+ */
+inline int FLIBitmap::GetIndexedColorNumber(unsigned x, unsigned y,
+                                            int index) const
+{
+    unsigned c = (y / 8) * FLIBITMAP_XCHARS + x / FLIBLOCK_WIDTH;
+
+    switch (index)
+    {
+    case 0:
+        return m_aBackground[y];
+    case 1:
+        return m_aScreenRAM[y % 8][c] >> 4;
+    case 2:
+        return m_aScreenRAM[y % 8][c] & 0x0f;
+    default:
+        return m_aColorRAM[c];
+    }
+}
+
+#endif // FLIBITMAP_H
@@ -0,0 +1,320 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+#include "MCApp.h"
+#include "FLIDoc.h"
+#include "DocRenderer.h"
+
+#define BML_START_ADDR      0x3b00
+#define FLIGRAPH_START_ADDR 0x3c00
+
+/* File structure of a Blackmail FLI image including start address */
+typedef struct bml_s
+{
+   uint8_t ptr[2];               /* start address */
+   uint8_t background[256];      /* $d021 for each line, 200 used */
+   uint8_t col_ram[1024];        /* low-nibble only, 1000 used */
+   uint8_t scr_ram[8][1024];     /* one for each pixel row, 1000 used */
+   uint8_t bitmap[8000];         /* 160 * 200 * 2 bit */
+} bml_t;
+
+/* File structure of an FLI Graph image including start address */
+typedef struct fligraph_s
+{
+   uint8_t ptr[2];               /* start address */
+   uint8_t col_ram[1024];        /* low-nibble only, 1000 used */
+   uint8_t scr_ram[8][1024];     /* one for each pixel row, 1000 used */
+   uint8_t bitmap[8000];         /* 160 * 200 * 2 bit */
+} fligraph_t;
+
+/******************************************************************************/
+/**
+ * This is a list of all Filters for this image format.
+ */
+static FormatInfo::Filter m_aFilters[] =
+{
+    { wxT("Blackmail FLI files"), wxT("*.bml") },
+    { wxT("FLI Graph files"), wxT("*.fli") },
+    { NULL, NULL }
+};
+
+/**
+ * File sizes and load addresses CheckFormat looks for, terminated by 0.
+ */
+static const unsigned m_aSizes[] =
+    { sizeof(bml_t), sizeof(fligraph_t), 0 };
+static const unsigned m_aLoadAddresses[] =
+    { BML_START_ADDR, FLIGRAPH_START_ADDR, 0 };
+
+/**
+ * Information about this image format.
+ */
+FormatInfo FLIDoc::m_formatInfo(
+    wxT("Multi Color FLI"),
+    wxT("bml"),
+    m_aFilters,
+    FLIDoc::Factory,
+    FLIDoc::CheckFormat,
+    m_aSizes,
+    m_aLoadAddresses);
+
+
+/******************************************************************************/
+/**
+ *
+ */
+FLIDoc::FLIDoc()
+    : m_bitmap()
+{
+    PrepareUndo();
+
+    // PrepareUndo sets m_bModified, reset it
+    m_bModified = false;
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class.
+ */
+DocBase* FLIDoc::Factory()
+{
+    return new FLIDoc;
+}
+
+
+/******************************************************************************/
+/**
+ * Check how good data matches our document format. Return a sum of
+ * MC_FORMAT_*_MATCH.
+ */
+int FLIDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                        const wxFileName& fileName)
+{
+    uint16_t addr;
+    int      match = 0;
+
+    if (fileName.GetExt().CmpNoCase(wxT("bml")) == 0 ||
+        fileName.GetExt().CmpNoCase(wxT("fli")) == 0)
+    {
+        match += MC_FORMAT_EXTENSION_MATCH;
+    }
+
+    if (len == sizeof(bml_t) || len == sizeof(fligraph_t))
+        match += MC_FORMAT_SIZE_MATCH;
+
+    if (len < 2)
+        return match;
+
+    addr = pBuff[0] + pBuff[1] * 256;
+    if (addr == BML_START_ADDR ||
+        addr == FLIGRAPH_START_ADDR)
+    {
+        match += MC_FORMAT_ADDR_MATCH;
+    }
+
+    return match;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our FormatInfo.
+ */
+const FormatInfo* FLIDoc::GetFormatInfo() const
+{
+    return &m_formatInfo;
+}
+
+
+/******************************************************************************/
+/**
+ * Copy the contents of the given bitmap to our one. The pointer must point to
+ * an object which has actually the same type as our bitmap.
+ */
+void FLIDoc::SetBitmap(const BitmapBase* pB)
+{
+    m_bitmap = *(FLIBitmap*) pB;
+}
+
+
+/******************************************************************************/
+/**
+ * Try to load the file from the given memory buffer. Return true for success.
+ */
+bool FLIDoc::Load(const uint8_t* pBuff, unsigned size)
+{
+    bool bLoaded = false;
+    bLoaded = LoadBML(pBuff, size);
+
+    if (!bLoaded)
+        bLoaded = LoadFLIGraph(pBuff, size);
+
+    return bLoaded;
+}
+
+
+/******************************************************************************
+ **
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success. The file name is for informational purposes only, e.g. to
+ * decide which sub-format to use.
+ */
+bool FLIDoc::Save(std::vector<uint8_t>* pOut, const wxFileName& fileName)
+{
+    if (fileName.GetExt().CmpNoCase(wxT("fli")) == 0)
+        return SaveFLIGraph(pOut);
+    else
+        return SaveBML(pOut);
+}
+
+
+/*****************************************************************************/
+/**
+ * Try to load a Blackmail FLI picture from the given buffer into this
+ * document.
+ * Return true if it worked and false otherwise.
+ *
+ * pBuff        Points to bytes from the file
+ * nSize        Size
+ * return       true if the file has been loaded
+ */
+bool FLIDoc::LoadBML(const uint8_t* pBuff, unsigned nSize)
+{
+    const bml_t* pImage;
+    unsigned     i;
+
+    if (nSize != sizeof(bml_t))
+        return false;
+
+    pImage = (const bml_t*) pBuff;
+
+    // ignore start addr, 2 bytes
+
+    m_bitmap.SetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
+    for (i = 0; i < FLIBITMAP_NBANKS; ++i)
+        m_bitmap.SetScreenRAM(i, pImage->scr_ram[i]);
+    m_bitmap.SetColorRAM(pImage->col_ram);
+    for (i = 0; i < FLI_Y; ++i)
+        m_bitmap.SetBackground(i, pImage->background[i]);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Try to load an FLI Graph picture from the given buffer into this
+ * document. This format has no background colors, they are black.
+ * Return true if it worked and false otherwise.
+ *
+ * pBuff        Points to bytes from the file
+ * nSize        Size
+ * return       true if the file has been loaded
+ */
+bool FLIDoc::LoadFLIGraph(const uint8_t* pBuff, unsigned nSize)
+{
+    const fligraph_t* pImage;
+    unsigned          i;
+
+    if (nSize != sizeof(fligraph_t))
+        return false;
+
+    pImage = (const fligraph_t*) pBuff;
+
+    // ignore start addr, 2 bytes
+
+    m_bitmap.SetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
+    for (i = 0; i < FLIBITMAP_NBANKS; ++i)
+        m_bitmap.SetScreenRAM(i, pImage->scr_ram[i]);
+    m_bitmap.SetColorRAM(pImage->col_ram);
+    for (i = 0; i < FLI_Y; ++i)
+        m_bitmap.SetBackground(i, MC_BLACK);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Save a Blackmail FLI file into the given buffer.
+ *
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
+ */
+bool FLIDoc::SaveBML(std::vector<uint8_t>* pOut)
+{
+    bml_t*   pImage;
+    unsigned i;
+
+    pOut->assign(sizeof(bml_t), 0);
+    pImage = (bml_t*) &(*pOut)[0];
+
+    // start addr
+    pImage->ptr[0] = BML_START_ADDR % 0x100;
+    pImage->ptr[1] = BML_START_ADDR / 0x100;
+
+    for (i = 0; i < FLI_Y; ++i)
+        pImage->background[i] = m_bitmap.GetBackground(i);
+    m_bitmap.GetColorRAM(pImage->col_ram);
+    for (i = 0; i < FLIBITMAP_NBANKS; ++i)
+        m_bitmap.GetScreenRAM(i, pImage->scr_ram[i]);
+    m_bitmap.GetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Save an FLI Graph file into the given buffer. The background colors are
+ * not saved in this format.
+ *
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
+ */
+bool FLIDoc::SaveFLIGraph(std::vector<uint8_t>* pOut)
+{
+    fligraph_t* pImage;
+    unsigned    i;
+
+    pOut->assign(sizeof(fligraph_t), 0);
+    pImage = (fligraph_t*) &(*pOut)[0];
+
+    // start addr
+    pImage->ptr[0] = FLIGRAPH_START_ADDR % 0x100;
+    pImage->ptr[1] = FLIGRAPH_START_ADDR / 0x100;
+
+    m_bitmap.GetColorRAM(pImage->col_ram);
+    for (i = 0; i < FLIBITMAP_NBANKS; ++i)
+        m_bitmap.GetScreenRAM(i, pImage->scr_ram[i]);
+    m_bitmap.GetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
+
+    return true;
+}
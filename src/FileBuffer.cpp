@@ -0,0 +1,125 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <wx/file.h>
+
+#include "FileBuffer.h"
+
+// FileBuffer.h decides whether we use mmap
+#ifdef MC_FILEBUFFER_MMAP
+#include <sys/mman.h>
+#endif
+
+
+/*****************************************************************************/
+/**
+ * Constructor.
+ */
+FileBuffer::FileBuffer() :
+    m_pData(NULL),
+    m_nSize(0),
+    m_bMapped(false),
+    m_aData()
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Destructor. Unmap or free the file contents.
+ */
+FileBuffer::~FileBuffer()
+{
+    Close();
+}
+
+
+/*****************************************************************************/
+/**
+ * Make the contents of the given file accessible. Return false if the file
+ * could not be opened or read.
+ */
+bool FileBuffer::Open(const wxString& stringFileName)
+{
+    wxFile       file;
+    wxFileOffset len;
+#ifdef MC_FILEBUFFER_MMAP
+    void*        p;
+#endif
+
+    Close();
+
+    if (!file.Open(stringFileName))
+        return false;
+
+    len = file.Length();
+    if (len < 0 || (wxFileOffset)(size_t) len != len)
+        return false;
+
+#ifdef MC_FILEBUFFER_MMAP
+    if (len > 0)
+    {
+        // the mapping stays valid when the file is closed
+        p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, file.fd(), 0);
+        if (p != MAP_FAILED)
+        {
+            m_pData   = (const uint8_t*) p;
+            m_nSize   = len;
+            m_bMapped = true;
+            return true;
+        }
+    }
+#endif
+
+    // no mapping possible, read it
+    m_aData.resize(len);
+    if (len > 0 && file.Read(&m_aData[0], len) != len)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = len ? &m_aData[0] : NULL;
+    m_nSize = len;
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Release the file contents.
+ */
+void FileBuffer::Close()
+{
+#ifdef MC_FILEBUFFER_MMAP
+    if (m_bMapped)
+        munmap((void*) m_pData, m_nSize);
+#endif
+
+    std::vector<uint8_t>().swap(m_aData);
+    m_pData   = NULL;
+    m_nSize   = 0;
+    m_bMapped = false;
+}
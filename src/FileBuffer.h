@@ -0,0 +1,98 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef FILEBUFFER_H
+#define FILEBUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <wx/string.h>
+
+#if defined(__UNIX__) || defined(__unix__) || defined(__APPLE__)
+#define MC_FILEBUFFER_MMAP
+#endif
+
+/*****************************************************************************/
+/**
+ * Read-only view of the contents of a file.
+ *
+ * Where possible the file is mapped into memory, so nothing is copied and
+ * large files only cost what is actually read from them. Otherwise, or if
+ * mapping fails, the file is read into a buffer owned by this object.
+ */
+class FileBuffer
+{
+public:
+    FileBuffer();
+    ~FileBuffer();
+
+    bool Open(const wxString& stringFileName);
+    void Close();
+
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+
+protected:
+    /// Start of the file contents, NULL if empty
+    const uint8_t*          m_pData;
+
+    /// Size of the file contents
+    size_t                  m_nSize;
+
+    /// true if m_pData points to a memory mapping
+    bool                    m_bMapped;
+
+    /// Contains the file if it could not be mapped
+    std::vector<uint8_t>    m_aData;
+
+private:
+    /// Copy construtor is private: This can't be copied
+    FileBuffer(const FileBuffer& r);
+    FileBuffer& operator=(const FileBuffer& r);
+};
+
+
+/*****************************************************************************/
+/**
+ * Return a pointer to the contents of the file. This is NULL if the file
+ * is empty or not open.
+ */
+inline const uint8_t* FileBuffer::GetData() const
+{
+    return m_pData;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the size of the file.
+ */
+inline size_t FileBuffer::GetSize() const
+{
+    return m_nSize;
+}
+
+#endif // FILEBUFFER_H
@@ -23,17 +23,31 @@
  * Thomas Giesel skoe@directbox.com
  */
 
+#include <algorithm>
+
 #include "FormatInfo.h"
 
 
 std::list<const FormatInfo*>* FormatInfo::m_pListFormatInfo;
+FormatInfo::ProbeIndex* FormatInfo::m_pProbeIndex;
 
+/*****************************************************************************/
+/**
+ * Constructor. Register this format.
+ *
+ * pSizes and pLoadAddresses are lists terminated by 0 which contain all file
+ * sizes and load addresses checkFormat gives points for. If they are NULL,
+ * checkFormat is called for each file.
+ */
 FormatInfo::FormatInfo(const wxChar* pStrName,
                        const wxChar* pStrDefaultExtension,
                        Filter* pFilters,
                        DocBase* (*docFactory)(),
-                       int (*checkFormat)(uint8_t* pBuff, unsigned len,
-                                          const wxFileName& fileName)) :
+                       int (*checkFormat)(const uint8_t* pBuff, unsigned len,
+                                          const wxFileName& fileName),
+                       const unsigned* pSizes,
+                       const unsigned* pLoadAddresses) :
+        m_nIndex(0),
         m_stringName(pStrName),
         m_stringDefaultExtension(pStrDefaultExtension),
         m_pFilters(pFilters),
@@ -45,7 +59,10 @@ FormatInfo::FormatInfo(const wxChar* pStrName,
         m_pListFormatInfo = new std::list<const FormatInfo*>;
     }
 
+    m_nIndex = m_pListFormatInfo->size();
     m_pListFormatInfo->push_back(this);
+
+    AddToProbeIndex(pSizes, pLoadAddresses);
 }
 
 
@@ -178,18 +195,50 @@ const std::list<const FormatInfo*>* FormatInfo::GetFormatList()
 /**
  * Find the format which matches the data best. Return the format or NULL if
  * none of them fits.
+ *
+ * Only the formats found in the probe index for the size, the load address
+ * or the extension of the file are checked. Like in the list of all
+ * formats, the first one wins if more of them get the same points.
  */
-const FormatInfo* FormatInfo::FindBestFormat(uint8_t* pBuff,
+const FormatInfo* FormatInfo::FindBestFormat(const uint8_t* pBuff,
                                              unsigned len,
                                              const wxFileName& fileName)
 {
     const FormatInfo*  pBestFormat;
     int          nMostPoints, nPoints;
-    std::list<const FormatInfo*>::const_iterator i;
+    FormatVector aCandidates;
+    FormatVector::const_iterator i;
+    std::map<unsigned, FormatVector>::const_iterator iNum;
+    std::map<wxString, FormatVector>::const_iterator iExt;
+
+    if (!m_pProbeIndex)
+        return NULL;
+
+    iNum = m_pProbeIndex->mapSize.find(len);
+    if (iNum != m_pProbeIndex->mapSize.end())
+        AddCandidates(&aCandidates, iNum->second);
+
+    if (len >= 2)
+    {
+        iNum = m_pProbeIndex->mapLoadAddress.find(pBuff[0] + pBuff[1] * 256);
+        if (iNum != m_pProbeIndex->mapLoadAddress.end())
+            AddCandidates(&aCandidates, iNum->second);
+    }
+
+    iExt = m_pProbeIndex->mapExtension.find(fileName.GetExt().Lower());
+    if (iExt != m_pProbeIndex->mapExtension.end())
+        AddCandidates(&aCandidates, iExt->second);
+
+    AddCandidates(&aCandidates, m_pProbeIndex->aUnindexed);
+
+    // check them in the order of registration, each one once
+    std::sort(aCandidates.begin(), aCandidates.end(), CompareIndex);
+    aCandidates.erase(std::unique(aCandidates.begin(), aCandidates.end()),
+                      aCandidates.end());
 
     pBestFormat = NULL;
     nMostPoints = 0;
-    for (i = m_pListFormatInfo->begin(); i != m_pListFormatInfo->end(); ++i)
+    for (i = aCandidates.begin(); i != aCandidates.end(); ++i)
     {
         nPoints = (*i)->CheckFormat(pBuff, len, fileName);
         if (nPoints > nMostPoints)
@@ -201,3 +250,77 @@ const FormatInfo* FormatInfo::FindBestFormat(uint8_t* pBuff,
 
     return pBestFormat;
 }
+
+
+/*****************************************************************************/
+/**
+ * Add this format to the probe index. The extensions are taken from the
+ * wildcards of the filters, e.g. "*.koa;*.kla". If no sizes or no load
+ * addresses are given, the format must be checked for every file.
+ *
+ * Only called from the constructor, i.e. during static initialization.
+ */
+void FormatInfo::AddToProbeIndex(const unsigned* pSizes,
+                                 const unsigned* pLoadAddresses)
+{
+    wxString stringWildcards;
+    wxString stringExt;
+    size_t   nPos;
+    int      i;
+
+    if (!m_pProbeIndex)
+        m_pProbeIndex = new ProbeIndex;
+
+    if (!pSizes || !pLoadAddresses)
+    {
+        m_pProbeIndex->aUnindexed.push_back(this);
+        return;
+    }
+
+    for (i = 0; pSizes[i] != 0; ++i)
+        m_pProbeIndex->mapSize[pSizes[i]].push_back(this);
+
+    for (i = 0; pLoadAddresses[i] != 0; ++i)
+        m_pProbeIndex->mapLoadAddress[pLoadAddresses[i]].push_back(this);
+
+    for (i = 0; m_pFilters[i].pStrWildcard != NULL; i++)
+    {
+        stringWildcards = m_pFilters[i].pStrWildcard;
+        while (!stringWildcards.empty())
+        {
+            nPos = stringWildcards.find(wxT(';'));
+            stringExt = stringWildcards.substr(0, nPos);
+            if (nPos == wxString::npos)
+                stringWildcards.clear();
+            else
+                stringWildcards.erase(0, nPos + 1);
+
+            if (stringExt.StartsWith(wxT("*.")))
+            {
+                stringExt.erase(0, 2);
+                m_pProbeIndex->mapExtension[stringExt.Lower()].push_back(this);
+            }
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Append the formats to the list of candidates.
+ */
+void FormatInfo::AddCandidates(FormatVector* pCandidates,
+                               const FormatVector& aFormats)
+{
+    pCandidates->insert(pCandidates->end(), aFormats.begin(), aFormats.end());
+}
+
+
+/*****************************************************************************/
+/**
+ * Return true if p1 has been registered before p2.
+ */
+bool FormatInfo::CompareIndex(const FormatInfo* p1, const FormatInfo* p2)
+{
+    return p1->m_nIndex < p2->m_nIndex;
+}
@@ -28,6 +28,8 @@
 
 #include <stdint.h>
 #include <list>
+#include <map>
+#include <vector>
 #include <wx/string.h>
 #include <wx/filename.h>
 
@@ -41,6 +43,12 @@
  * e.g.                            e.g.
  * Koala files / *.koa;*.kla       Multi Color Bitmap
  * Amica files / *.ami
+ *
+ * To find the format of a file quickly, formats can tell which file sizes
+ * and load addresses they use. Together with the extensions from their
+ * filters, these go into a probe index. For a file, only the formats found
+ * in the index for its size, load address or extension are checked, plus
+ * the formats which didn't give this information.
  */
 
 /**
@@ -68,7 +76,10 @@ public:
                const wxChar* pStrDefaultExtension,
                Filter* pFilters,
                DocBase* (*docFactory)(),
-               int (*checkFile)(uint8_t* pBuff, unsigned len, const wxFileName& fileName));
+               int (*checkFile)(const uint8_t* pBuff, unsigned len,
+                                 const wxFileName& fileName),
+               const unsigned* pSizes = NULL,
+               const unsigned* pLoadAddresses = NULL);
 
     const wxString& GetName() const;
     const wxString& GetDefaultExtension() const;
@@ -77,22 +88,47 @@ public:
 
     static wxString GetFullFilterString();
     static const std::list<const FormatInfo*>* GetFormatList();
-    static const FormatInfo* FindBestFormat(uint8_t* pBuff,
+    static const FormatInfo* FindBestFormat(const uint8_t* pBuff,
                                             unsigned len,
                                             const wxFileName& fileName);
 
     DocBase* Factory() const;
-    int CheckFormat(uint8_t* pBuff, unsigned len, const wxFileName& fileName) const;
+    int CheckFormat(const uint8_t* pBuff, unsigned len,
+                    const wxFileName& fileName) const;
 
 protected:
+    typedef std::vector<const FormatInfo*> FormatVector;
+
+    /// Maps file sizes, load addresses and extensions to formats
+    typedef struct ProbeIndex_s
+    {
+        std::map<unsigned, FormatVector> mapSize;
+        std::map<unsigned, FormatVector> mapLoadAddress;
+        std::map<wxString, FormatVector> mapExtension;
+
+        /// Formats which can't be found using the maps
+        FormatVector                     aUnindexed;
+    } ProbeIndex;
+
+    void AddToProbeIndex(const unsigned* pSizes,
+                         const unsigned* pLoadAddresses);
+    static void AddCandidates(FormatVector* pCandidates,
+                              const FormatVector& aFormats);
+    static bool CompareIndex(const FormatInfo* p1, const FormatInfo* p2);
+
+    /// Number of this format in the order of registration
+    unsigned m_nIndex;
+
     wxString m_stringName;
     wxString m_stringDefaultExtension;
     Filter* m_pFilters;
     DocBase* (*m_docFactory)();
-    int (*m_checkFormat)(uint8_t* pBuff, unsigned len, const wxFileName& fileName);
+    int (*m_checkFormat)(const uint8_t* pBuff, unsigned len,
+                         const wxFileName& fileName);
 
 private:
     static std::list<const FormatInfo*>* m_pListFormatInfo;
+    static ProbeIndex* m_pProbeIndex;
 
 };
 
@@ -112,7 +148,7 @@ inline DocBase* FormatInfo::Factory() const
  * Check how good data matches our document format. Return a sum of
  * MC_FORMAT_*_MATCH.
  */
-inline int FormatInfo::CheckFormat(uint8_t* pBuff, unsigned len,
+inline int FormatInfo::CheckFormat(const uint8_t* pBuff, unsigned len,
                                  const wxFileName& fileName) const
 {
     return m_checkFormat(pBuff, len, fileName);
@@ -140,6 +140,35 @@ const C64Color* HiResBitmap::GetColor(int x, int y) const
 }
 
 
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ */
+void HiResBitmap::GetColorRow(int x, int y, int w, unsigned char* pDest) const
+{
+    const HiResBlock* pBlock;
+    unsigned          xPixel, yPixel;
+    unsigned char     aColors[2];
+
+    pBlock = &m_aHiResBlock[y / HIRESBLOCK_HEIGHT][x / HIRESBLOCK_WIDTH];
+    xPixel = x % HIRESBLOCK_WIDTH;
+    yPixel = y % HIRESBLOCK_HEIGHT;
+
+    while (w > 0)
+    {
+        aColors[0] = pBlock->GetIndexedColor(0)->GetColor();
+        aColors[1] = pBlock->GetIndexedColor(1)->GetColor();
+
+        for (; xPixel < HIRESBLOCK_WIDTH && w > 0; ++xPixel, --w)
+            *pDest++ = aColors[pBlock->GetBitmapPixel(xPixel, yPixel)];
+
+        xPixel = 0;
+        ++pBlock;
+    }
+}
+
+
 /*****************************************************************************/
 void HiResBitmap::SetScreenRAM(unsigned offset, unsigned char val)
 {
@@ -179,6 +208,46 @@ unsigned char HiResBitmap::GetBitmapRAM(unsigned offset)
          offset % HIRESBITMAP_BYTES_PER_BLOCK);
 }
 
+/*****************************************************************************/
+/**
+ * Set nRows bitmap bytes in VIC order, starting at the first one. Each byte
+ * is one row of 8 pixels of a cell. Usually nRows is 8000 to set the
+ * complete bitmap.
+ */
+void HiResBitmap::SetBitmapRows(const uint8_t* pSrc, size_t nRows)
+{
+    HiResBlock* pBlock = m_aHiResBlock[0];
+    size_t      i;
+
+    if (nRows > HIRESBITMAP_XBLOCKS * HIRESBITMAP_YBLOCKS *
+                HIRESBITMAP_BYTES_PER_BLOCK)
+        nRows = HIRESBITMAP_XBLOCKS * HIRESBITMAP_YBLOCKS *
+                HIRESBITMAP_BYTES_PER_BLOCK;
+
+    for (i = 0; i < nRows; ++i)
+        pBlock[i / HIRESBITMAP_BYTES_PER_BLOCK].SetBitmapRAM(
+            i % HIRESBITMAP_BYTES_PER_BLOCK, pSrc[i]);
+}
+
+/*****************************************************************************/
+/**
+ * Copy the first nRows bitmap bytes in VIC order to pDest.
+ */
+void HiResBitmap::GetBitmapRows(uint8_t* pDest, size_t nRows) const
+{
+    const HiResBlock* pBlock = m_aHiResBlock[0];
+    size_t            i;
+
+    if (nRows > HIRESBITMAP_XBLOCKS * HIRESBITMAP_YBLOCKS *
+                HIRESBITMAP_BYTES_PER_BLOCK)
+        nRows = HIRESBITMAP_XBLOCKS * HIRESBITMAP_YBLOCKS *
+                HIRESBITMAP_BYTES_PER_BLOCK;
+
+    for (i = 0; i < nRows; ++i)
+        pDest[i] = pBlock[i / HIRESBITMAP_BYTES_PER_BLOCK].GetBitmapRAM(
+            i % HIRESBITMAP_BYTES_PER_BLOCK);
+}
+
 /*****************************************************************************/
 /**
  * Get a the block containing the given coordinates.
@@ -186,7 +255,7 @@ unsigned char HiResBitmap::GetBitmapRAM(unsigned offset)
  */
 const HiResBlock* HiResBitmap::GetHiResBlock(unsigned x, unsigned y) const
 {
-    if ((x < GetWidth()) && (y < GetHeight()))
+    if ((x < (unsigned) GetWidth()) && (y < (unsigned) GetHeight()))
     {
         return &(m_aHiResBlock[y / HIRESBLOCK_HEIGHT][x / HIRESBLOCK_WIDTH]);
     }
@@ -194,6 +263,51 @@ const HiResBlock* HiResBitmap::GetHiResBlock(unsigned x, unsigned y) const
         return NULL;
 }
 
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: 8 bytes bitmap and
+ * one byte screen RAM.
+ */
+unsigned HiResBitmap::GetCellDataSize() const
+{
+    return HIRESBITMAP_BYTES_PER_BLOCK + 1;
+}
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid.
+ */
+void HiResBitmap::GetCellData(int xCell, int yCell, unsigned char* pData) const
+{
+    unsigned y;
+
+    for (y = 0; y < HIRESBITMAP_BYTES_PER_BLOCK; ++y)
+        pData[y] = m_aHiResBlock[yCell][xCell].GetBitmapRAM(y);
+
+    pData[HIRESBITMAP_BYTES_PER_BLOCK] =
+        GetScreenRAM(yCell * HIRESBITMAP_XBLOCKS + xCell);
+}
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ */
+void HiResBitmap::SetCellData(int xCell, int yCell, const unsigned char* pData)
+{
+    unsigned y;
+
+    for (y = 0; y < HIRESBITMAP_BYTES_PER_BLOCK; ++y)
+        m_aHiResBlock[yCell][xCell].SetBitmapRAM(y, pData[y]);
+
+    SetScreenRAM(yCell * HIRESBITMAP_XBLOCKS + xCell,
+                 pData[HIRESBITMAP_BYTES_PER_BLOCK]);
+
+    Dirty(xCell * HIRESBLOCK_WIDTH, yCell * HIRESBLOCK_HEIGHT,
+          HIRESBLOCK_WIDTH, HIRESBLOCK_HEIGHT);
+}
+
 /*****************************************************************************
  * Setzt einen Pixel an x/y in der Farbe col. Gibt es schon alle Vordergrund-
  * farben, wird je nach "mode" verfahren. Siehe HiResBlock::SetPixel
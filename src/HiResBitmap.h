@@ -26,6 +26,9 @@
 #ifndef HIRESBITMAP_H
 #define HIRESBITMAP_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "HiResBlock.h"
 #include "ToolBase.h"
 #include "BitmapBase.h"
@@ -53,9 +56,17 @@ public:
     virtual int CountColorByIndex(int x, int y, int index) const;
 
     virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
     virtual void SetPixel(int x, int y, const C64Color& col,
                           MCDrawingMode mode = MCDrawingModeIgnore);
 
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
     void SetBackground(C64Color col);
     unsigned char GetBackground() const;
 
@@ -68,6 +79,9 @@ public:
     void SetBitmapRAM(unsigned offset, unsigned char val);
     unsigned char GetBitmapRAM(unsigned offset);
 
+    void SetBitmapRows(const uint8_t* pSrc, size_t nRows);
+    void GetBitmapRows(uint8_t* pDest, size_t nRows) const;
+
     const HiResBlock* GetHiResBlock(unsigned x, unsigned y) const;
 
     static const C64Color black;
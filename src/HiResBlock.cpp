@@ -27,11 +27,44 @@
 #include "HiResBlock.h"
 #include "HiResBitmap.h"
 
+
+/*
+ * Lookup tables to convert a bitmap byte to 8 pixel indexes and to count
+ * the pixels with index 1 in a byte. Bit 7 is the leftmost pixel.
+ */
+#define UNPACK1(v)   { ((v) >> 7) & 1, ((v) >> 6) & 1, ((v) >> 5) & 1, \
+                       ((v) >> 4) & 1, ((v) >> 3) & 1, ((v) >> 2) & 1, \
+                       ((v) >> 1) & 1, (v) & 1 }
+#define UNPACK4(v)   UNPACK1(v), UNPACK1(v + 1), UNPACK1(v + 2), UNPACK1(v + 3)
+#define UNPACK16(v)  UNPACK4(v), UNPACK4(v + 4), UNPACK4(v + 8), UNPACK4(v + 12)
+#define UNPACK64(v)  UNPACK16(v), UNPACK16(v + 16), UNPACK16(v + 32), \
+                     UNPACK16(v + 48)
+
+#define ONES1(v)     (((v) >> 7) & 1) + (((v) >> 6) & 1) + (((v) >> 5) & 1) + \
+                     (((v) >> 4) & 1) + (((v) >> 3) & 1) + (((v) >> 2) & 1) + \
+                     (((v) >> 1) & 1) + ((v) & 1)
+#define ONES4(v)     ONES1(v), ONES1(v + 1), ONES1(v + 2), ONES1(v + 3)
+#define ONES16(v)    ONES4(v), ONES4(v + 4), ONES4(v + 8), ONES4(v + 12)
+#define ONES64(v)    ONES16(v), ONES16(v + 16), ONES16(v + 32), ONES16(v + 48)
+
+static const unsigned char m_aUnpack[256][HIRESBLOCK_WIDTH] =
+{
+    UNPACK64(0), UNPACK64(64), UNPACK64(128), UNPACK64(192)
+};
+
+static const unsigned char m_aOnes[256] =
+{
+    ONES64(0), ONES64(64), ONES64(128), ONES64(192)
+};
+
+
 /*****************************************************************************/
 HiResBlock::HiResBlock() :
     m_pParent(NULL)
 {
     memset(m_aBitmap, 0, sizeof(m_aBitmap));
+    m_aCount[0] = HIRESBLOCK_WIDTH * HIRESBLOCK_HEIGHT;
+    m_aCount[1] = 0;
     m_c64Color[0].SetColor(MC_BLACK);
     m_c64Color[1].SetColor(MC_BLACK);
 }
@@ -56,13 +89,15 @@ const C64Color* HiResBlock::GetIndexedColor(int index) const
 
 
 /*****************************************************************************/
+/**
+ * Return the number of pixels in this block which use the given index.
+ */
 int HiResBlock::CountIndexedColor(int index) const
 {
-    int i, cnt = 0;
-
-    for (i = 0; i < HIRESBLOCK_WIDTH * HIRESBLOCK_HEIGHT; ++i)
-        if (m_aBitmap[0][i] == index) ++cnt;
-    return cnt;
+    if (index < 2)
+        return m_aCount[index];
+    else
+        return 0;
 }
 
 
@@ -72,37 +107,42 @@ void HiResBlock::SetBitmapPixel(unsigned x, unsigned y, int index)
     if ((x < HIRESBLOCK_WIDTH) && (y < HIRESBLOCK_HEIGHT) &&
         (index < 2))
     {
+        --m_aCount[m_aBitmap[y][x]];
+        ++m_aCount[index];
         m_aBitmap[y][x] = index;
     }
 }
 
 /*****************************************************************************/
+/**
+ * Set the row y of this block from a bitmap byte. Bit 7 is the leftmost
+ * pixel.
+ */
 void HiResBlock::SetBitmapRAM(unsigned y, unsigned char val)
 {
-    int x;
+    unsigned nOnes;
 
     if (y < HIRESBLOCK_HEIGHT)
     {
-        for (x = 0; x < HIRESBLOCK_WIDTH; ++x)
-        {
-            SetBitmapPixel(x, y,
-                ((val >> (HIRESBLOCK_WIDTH - x - 1)) & 1));
-        }
+        nOnes = m_aCount[1] - m_aOnes[GetBitmapRAM(y)] + m_aOnes[val];
+        m_aCount[0] = HIRESBLOCK_WIDTH * HIRESBLOCK_HEIGHT - nOnes;
+        m_aCount[1] = nOnes;
+
+        memcpy(m_aBitmap[y], m_aUnpack[val], HIRESBLOCK_WIDTH);
     }
 }
 
 /*****************************************************************************/
+/**
+ * Return the row y of this block as bitmap byte. Bit 7 is the leftmost
+ * pixel.
+ */
 unsigned char HiResBlock::GetBitmapRAM(unsigned y) const
 {
-    unsigned char v;
-    int x;
+    const unsigned char* p = m_aBitmap[y];
 
-    v = 0;
-    for (x = 0; x < HIRESBLOCK_WIDTH; ++x)
-    {
-        v |= m_aBitmap[y][x] << (HIRESBLOCK_WIDTH - x - 1);
-    }
-    return v;
+    return (p[0] << 7) | (p[1] << 6) | (p[2] << 5) | (p[3] << 4) |
+           (p[4] << 3) | (p[5] << 2) | (p[6] << 1) | p[7];
 }
 
 
@@ -127,7 +167,7 @@ void HiResBlock::SetPixel(unsigned x, unsigned y,
     if (mode >= MCDrawingModeIndex0 && mode <= MCDrawingModeIndex1)
     {
         SetIndexedColor(i, col);
-        m_aBitmap[y][x] = i;
+        SetBitmapPixel(x, y, i);
         return;
     }
     else if (mode >= MCDrawingModeIndex2 && mode <= MCDrawingModeIndex3)
@@ -138,7 +178,7 @@ void HiResBlock::SetPixel(unsigned x, unsigned y,
     {
         if ((CountIndexedColor(i) != 0) && (m_c64Color[i] == col))
         {
-            m_aBitmap[y][x] = i;
+            SetBitmapPixel(x, y, i);
             return;
         }
     }
@@ -147,7 +187,7 @@ void HiResBlock::SetPixel(unsigned x, unsigned y,
     {
         if (CountIndexedColor(i) == 0)
         {
-            m_aBitmap[y][x] = i;
+            SetBitmapPixel(x, y, i);
             m_c64Color[i] = col;
             return;
         }
@@ -167,7 +207,7 @@ void HiResBlock::SetPixel(unsigned x, unsigned y,
     case MCDrawingModeLeast:
         /* COLMODE_LEAST -> Am wenigsten benutzte Vordergrundfarbe nehmen */
         i = CountIndexedColor(0) < CountIndexedColor(1) ? 0 : 1;
-        m_aBitmap[y][x] = i;
+        SetBitmapPixel(x, y, i);
         m_c64Color[i] = col;
 
     default:
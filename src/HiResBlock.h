@@ -46,6 +46,7 @@ public:
     int CountIndexedColor(int index) const;
 
     void SetBitmapPixel(unsigned x, unsigned y, int index);
+    int GetBitmapPixel(unsigned x, unsigned y) const;
     void SetBitmapRAM(unsigned y, unsigned char val);
     unsigned char GetBitmapRAM(unsigned y) const;
 
@@ -56,6 +57,10 @@ public:
 protected:
     C64Color m_c64Color[2];
     unsigned char m_aBitmap[HIRESBLOCK_HEIGHT][HIRESBLOCK_WIDTH];
+
+    /// Number of pixels using each of the 2 color indexes
+    unsigned char m_aCount[2];
+
     HiResBitmap* m_pParent;
 };
 
@@ -69,6 +74,15 @@ inline const C64Color* HiResBlock::GetPixel(unsigned x, unsigned y) const
     return &(m_c64Color[m_aBitmap[y][x]]);
 }
 
+/*****************************************************************************/
+/**
+ * Return the color index (0..1) of the pixel x/y in this block.
+ */
+inline int HiResBlock::GetBitmapPixel(unsigned x, unsigned y) const
+{
+    return m_aBitmap[y][x];
+}
+
 /*****************************************************************************/
 /**
  * Set the owner of this block.
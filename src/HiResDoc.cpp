@@ -31,6 +31,8 @@
 #include "MCApp.h"
 #include "HiResDoc.h"
 #include "DocRenderer.h"
+#include "Cruncher.h"
+#include "ImageImporter.h"
 
 #define ISH_START_ADDR 0x4000
 #define ISH_PADDING    192
@@ -61,9 +63,17 @@ static FormatInfo::Filter m_aFilters[] =
 {
     { wxT("Interpaint Hires files"), wxT("*.iph;*.ip64h") },
     { wxT("Image System Hires files"), wxT("*.ish") },
+    { wxT("Self-decrunching Hires files"), wxT("*.prg") },
     { NULL, NULL }
 };
 
+/**
+ * File sizes and load addresses CheckFormat looks for, terminated by 0.
+ */
+static const unsigned m_aSizes[] = { sizeof(ish_t), sizeof(iph_t), 0 };
+static const unsigned m_aLoadAddresses[] =
+    { ISH_START_ADDR, IPH_START_ADDR, 0 };
+
 /**
  * Information about this image format.
  */
@@ -72,7 +82,9 @@ FormatInfo HiResDoc::m_formatInfo(
     wxT("iph"),
     m_aFilters,
     HiResDoc::Factory,
-    HiResDoc::CheckFormat);
+    HiResDoc::CheckFormat,
+    m_aSizes,
+    m_aLoadAddresses);
 
 
 /******************************************************************************/
@@ -81,9 +93,7 @@ FormatInfo HiResDoc::m_formatInfo(
  */
 HiResDoc::HiResDoc()
     : m_bitmap()
-    , m_bitmapBackup()
-    , m_listUndo()
-    , m_nRedoPos(0)
+    , m_bImageSystem(false)
 {
     PrepareUndo();
 
@@ -106,7 +116,8 @@ DocBase* HiResDoc::Factory()
 /**
  *
  */
-int HiResDoc::CheckFormat(uint8_t* pBuff, unsigned len, const wxFileName& fileName)
+int HiResDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                          const wxFileName& fileName)
 {
     uint16_t addr;
     int      match = 0;
@@ -121,6 +132,9 @@ int HiResDoc::CheckFormat(uint8_t* pBuff, unsigned len, const wxFileName& fileNa
     if (len == sizeof(ish_t) || len == sizeof(iph_t))
         match += MC_FORMAT_SIZE_MATCH;
 
+    if (len < 2)
+        return match;
+
     addr = pBuff[0] + pBuff[1] * 256;
     if (addr == ISH_START_ADDR ||
         addr == IPH_START_ADDR)
@@ -157,7 +171,7 @@ void HiResDoc::SetBitmap(const BitmapBase* pB)
 /**
  * Try to load the file from the given memory buffer. Return true for success.
  */
-bool HiResDoc::Load(uint8_t* pBuff, unsigned size)
+bool HiResDoc::Load(const uint8_t* pBuff, unsigned size)
 {
     bool bLoaded = false;
     bLoaded = LoadISH(pBuff, size);
@@ -171,23 +185,77 @@ bool HiResDoc::Load(uint8_t* pBuff, unsigned size)
 
 /******************************************************************************
  **
- * Save the file to the memory buffer. Return the number of bytes used.
- * The file name is for informational purposes only, e.g. to decide
- * which sub-format to use.
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success. The file name is for informational purposes only, e.g. to
+ * decide which sub-format to use.
  */
-unsigned HiResDoc::Save(uint8_t* pBuff, const wxFileName& fileName)
+bool HiResDoc::Save(std::vector<uint8_t>* pOut, const wxFileName& fileName)
 {
-    unsigned len = 0;
+    std::vector<uint8_t> aPlain;
+    bool                 bImageSystem = IsImageSystemName(fileName);
 
-    if (fileName.GetExt().CmpNoCase(wxT("ish")) == 0)
-        len = SaveISH(pBuff);
+    if (fileName.GetExt().CmpNoCase(wxT("prg")) == 0)
+    {
+        if (bImageSystem)
+            return SaveISH(&aPlain) && Cruncher::CrunchPRG(aPlain, pOut);
+        else
+            return SaveIPH(&aPlain) && Cruncher::CrunchPRG(aPlain, pOut);
+    }
+    else if (bImageSystem)
+        return SaveISH(pOut);
     else
-        len = SaveIPH(pBuff);
+        return SaveIPH(pOut);
+}
 
-    return len;
+
+/******************************************************************************/
+/**
+ * Remember whether the file just written was an Image System file.
+ */
+void HiResDoc::OnSaved(const wxFileName& fileName)
+{
+    m_bImageSystem = IsImageSystemName(fileName);
 }
 
 
+/******************************************************************************/
+/**
+ * Return true if a file with the given name is saved as Image System
+ * picture. A self-decrunching PRG contains the format given before ".prg",
+ * e.g. "pic.ish.prg". Otherwise it contains the format of the last file
+ * loaded or saved.
+ */
+bool HiResDoc::IsImageSystemName(const wxFileName& fileName) const
+{
+    wxString stringInner;
+
+    if (fileName.GetExt().CmpNoCase(wxT("ish")) == 0)
+        return true;
+    else if (fileName.GetExt().CmpNoCase(wxT("prg")) == 0)
+    {
+        stringInner = wxFileName(fileName.GetName()).GetExt();
+        if (stringInner.CmpNoCase(wxT("ish")) == 0)
+            return true;
+        else if (stringInner.CmpNoCase(wxT("iph")) == 0)
+            return false;
+        else
+            return m_bImageSystem;
+    }
+    else
+        return false;
+}
+
+
+/******************************************************************************/
+/**
+ * Convert an image into our bitmap.
+ */
+bool HiResDoc::ImportImage(ImageImporter* pImporter)
+{
+    pImporter->ImportHiRes(&m_bitmap);
+    return true;
+}
+
 
 /*****************************************************************************/
 /**
@@ -199,24 +267,24 @@ unsigned HiResDoc::Save(uint8_t* pBuff, const wxFileName& fileName)
  * nSize        Size
  * return       true if the file has been loaded
  */
-bool HiResDoc::LoadISH(unsigned char* pBuff, unsigned nSize)
+bool HiResDoc::LoadISH(const uint8_t* pBuff, unsigned nSize)
 {
-    ish_t*  pImage;
+    const ish_t* pImage;
     int     i;
 
     if (nSize != sizeof(ish_t))
         return false;
 
-    pImage = (ish_t*) pBuff;
+    pImage = (const ish_t*) pBuff;
 
     // ignore start addr, 2 bytes
 
-    for (i = 0; i < 8000; ++i)
-        m_bitmap.SetBitmapRAM(i, pImage->bitmap[i]);
+    m_bitmap.SetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
 
     for (i = 0; i < 1000; ++i)
         m_bitmap.SetScreenRAM(i, pImage->scr_ram[i]);
 
+    m_bImageSystem = true;
     return true;
 }
 
@@ -231,24 +299,24 @@ bool HiResDoc::LoadISH(unsigned char* pBuff, unsigned nSize)
  * nSize        Size
  * return       true if the file has been loaded
  */
-bool HiResDoc::LoadIPH(unsigned char* pBuff, unsigned nSize)
+bool HiResDoc::LoadIPH(const uint8_t* pBuff, unsigned nSize)
 {
-    iph_t*  pImage;
+    const iph_t* pImage;
     int     i;
 
     if (nSize != sizeof(iph_t))
         return false;
 
-    pImage = (iph_t*) pBuff;
+    pImage = (const iph_t*) pBuff;
 
     // ignore start addr, 2 bytes
 
-    for (i = 0; i < 8000; ++i)
-        m_bitmap.SetBitmapRAM(i, pImage->bitmap[i]);
+    m_bitmap.SetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
 
     for (i = 0; i < 1000; ++i)
         m_bitmap.SetScreenRAM(i, pImage->scr_ram[i]);
 
+    m_bImageSystem = false;
     return true;
 }
 
@@ -257,30 +325,31 @@ bool HiResDoc::LoadIPH(unsigned char* pBuff, unsigned nSize)
 /**
  * Save a Image System Hires file into the given buffer.
  *
- * Return the number of bytes used in this buffer. The image includes the first
- * two bytes which form the load address of an PRG file.
- * If there's something wrong, return 0
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
  */
-int HiResDoc::SaveISH(unsigned char* pBuff)
+bool HiResDoc::SaveISH(std::vector<uint8_t>* pOut)
 {
-    unsigned char* p = pBuff;
-    int i;
+    ish_t* pImage;
+    int    i;
+
+    pOut->resize(sizeof(ish_t));
+    pImage = (ish_t*) &(*pOut)[0];
 
     // start addr
-    *p++ = ISH_START_ADDR % 0x100;
-    *p++ = ISH_START_ADDR / 0x100;
+    pImage->ptr[0] = ISH_START_ADDR % 0x100;
+    pImage->ptr[1] = ISH_START_ADDR / 0x100;
 
-    for (i = 0; i < 8000; i++)
-        *p++ = m_bitmap.GetBitmapRAM(i);
+    m_bitmap.GetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
 
     for (i = 0; i < ISH_PADDING; i++)
-        *p++ = 0;
+        pImage->padding[i] = 0;
 
     // screen
     for (i = 0; i < 1000; i++)
-        *p++ = m_bitmap.GetScreenRAM(i);
+        pImage->scr_ram[i] = m_bitmap.GetScreenRAM(i);
 
-    return p - pBuff;
+    return true;
 }
 
 
@@ -288,25 +357,26 @@ int HiResDoc::SaveISH(unsigned char* pBuff)
 /**
  * Save a Interpaint Hires file into the given buffer.
  *
- * Return the number of bytes used in this buffer. The image includes the first
- * two bytes which form the load address of an PRG file.
- * If there's something wrong, return 0
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
  */
-int HiResDoc::SaveIPH(unsigned char* pBuff)
+bool HiResDoc::SaveIPH(std::vector<uint8_t>* pOut)
 {
-    unsigned char* p = pBuff;
-    int i;
+    iph_t* pImage;
+    int    i;
+
+    pOut->resize(sizeof(iph_t));
+    pImage = (iph_t*) &(*pOut)[0];
 
     // start addr
-    *p++ = IPH_START_ADDR % 0x100;
-    *p++ = IPH_START_ADDR / 0x100;
+    pImage->ptr[0] = IPH_START_ADDR % 0x100;
+    pImage->ptr[1] = IPH_START_ADDR / 0x100;
 
-    for (i = 0; i < 8000; i++)
-        *p++ = m_bitmap.GetBitmapRAM(i);
+    m_bitmap.GetBitmapRows(pImage->bitmap, sizeof(pImage->bitmap));
 
     // screen
     for (i = 0; i < 1000; i++)
-        *p++ = m_bitmap.GetScreenRAM(i);
+        pImage->scr_ram[i] = m_bitmap.GetScreenRAM(i);
 
-    return p - pBuff;
+    return true;
 }
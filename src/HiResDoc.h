@@ -15,35 +15,35 @@ class HiResDoc : public DocBase
 public:
     HiResDoc();
     static DocBase* Factory();
-    static int CheckFormat(uint8_t* pBuff, unsigned len, const wxFileName& fileName);
+    static int CheckFormat(const uint8_t* pBuff, unsigned len,
+                           const wxFileName& fileName);
 
     virtual const FormatInfo* GetFormatInfo() const;
 
     const BitmapBase* GetBitmap() const;
     virtual BitmapBase* GetBitmap();
     virtual void SetBitmap(const BitmapBase*);
-    virtual void BackupBitmap();
-    virtual void RestoreBitmap();
-
-    std::vector<HiResBitmap> m_listUndo;
-    unsigned       m_nRedoPos;
 
 protected:
-    virtual bool Load(uint8_t* pBuff, unsigned size);
-    virtual unsigned Save(uint8_t* pBuff, const wxFileName& fileName);
+    virtual bool Load(const uint8_t* pBuff, unsigned size);
+    virtual bool Save(std::vector<uint8_t>* pOut, const wxFileName& fileName);
+    virtual void OnSaved(const wxFileName& fileName);
+    virtual bool ImportImage(ImageImporter* pImporter);
 
-    bool LoadISH(unsigned char* pBuff, unsigned nSize);
-    bool LoadIPH(unsigned char* pBuff, unsigned nSize);
-    int SaveISH(unsigned char* pBuff);
-    int SaveIPH(unsigned char* pBuff);
+    bool IsImageSystemName(const wxFileName& fileName) const;
+    bool LoadISH(const uint8_t* pBuff, unsigned nSize);
+    bool LoadIPH(const uint8_t* pBuff, unsigned nSize);
+    bool SaveISH(std::vector<uint8_t>* pOut);
+    bool SaveIPH(std::vector<uint8_t>* pOut);
 
     static FormatInfo m_formatInfo;
 
     /// The bitmap under work
     HiResBitmap  m_bitmap;
 
-    /// Backup which holds the original state when a tool is in use
-    HiResBitmap  m_bitmapBackup;
+    /// true if the last file loaded or saved was an Image System file,
+    /// self-decrunching PRGs contain this format then
+    bool         m_bImageSystem;
 };
 
 
@@ -67,24 +67,4 @@ inline BitmapBase* HiResDoc::GetBitmap()
 }
 
 
-/******************************************************************************/
-/**
- * Create a temporary backup of the current document bitmap state.
- */
-inline void HiResDoc::BackupBitmap()
-{
-    m_bitmapBackup = m_bitmap;
-}
-
-
-/******************************************************************************/
-/**
- * Restore the current bitmap from the temporary backup.
- */
-inline void HiResDoc::RestoreBitmap()
-{
-    m_bitmap = m_bitmapBackup;
-}
-
-
 #endif // HIRESDOC_H
@@ -0,0 +1,674 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "C64Color.h"
+#include "MCBitmap.h"
+#include "HiResBitmap.h"
+#include "CharBitmap.h"
+#include "ImageImporter.h"
+#include "BackgroundSearch.h"
+
+/* All cells are 8 pixels high */
+#define IMPORTER_CELL_HEIGHT 8
+
+/* Maximal number of pixels in a cell */
+#define IMPORTER_MAX_CELL_PIXELS (8 * IMPORTER_CELL_HEIGHT)
+
+/* Maximal number of colors in a cell */
+#define IMPORTER_MAX_COLORS 4
+
+/* Number of background colors for which the colors of the cells are searched */
+#define IMPORTER_BACKGROUND_CANDIDATES 4
+
+/* How much ordered dithering may change each color channel */
+#define IMPORTER_ORDERED_AMPLITUDE 2
+
+/* 4x4 Bayer matrix for ordered dithering, values 0..15 */
+static const int m_aBayer[4][4] =
+{
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 }
+};
+
+
+/*****************************************************************************/
+/**
+ * Constructor. The image must stay valid as long as this object is used.
+ */
+ImageImporter::ImageImporter(const wxImage& image, MCDitherMode dither) :
+    m_image(image),
+    m_dither(dither),
+    m_nWidth(0),
+    m_nHeight(0),
+    m_nCellWidth(0),
+    m_nXCells(0),
+    m_nYCells(0),
+    m_nColors(0),
+    m_bBackground(false),
+    m_nBackgrounds(0),
+    m_aBackgrounds(),
+    m_aRGB(),
+    m_aDistance(),
+    m_aCellError(),
+    m_aCellColors(),
+    m_nBackground(0),
+    m_aIndexes()
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Convert the image into a multicolor bitmap: The background color is
+ * shared by all cells, each 4x8 cell has three colors of its own.
+ */
+void ImageImporter::ImportMC(MCBitmap* pBitmap)
+{
+    const uint8_t* pColors;
+    const uint8_t* pIndexes;
+    unsigned char  aData[MCBITMAP_BYTES_PER_BLOCK + 2];
+    unsigned       xCell, yCell, y, x;
+
+    Prepare(MC_X, MC_Y, MCBLOCK_WIDTH, 4, true);
+    SearchAllCells();
+    ChooseBackground();
+    Dither();
+
+    pBitmap->SetBackground(C64Color(m_aBackgrounds[m_nBackground]));
+
+    for (yCell = 0; yCell < m_nYCells; ++yCell)
+    {
+        for (xCell = 0; xCell < m_nXCells; ++xCell)
+        {
+            pColors = GetCellColors(yCell * m_nXCells + xCell);
+
+            for (y = 0; y < MCBITMAP_BYTES_PER_BLOCK; ++y)
+            {
+                pIndexes = &m_aIndexes[(yCell * IMPORTER_CELL_HEIGHT + y) *
+                                       m_nWidth + xCell * m_nCellWidth];
+                aData[y] = 0;
+                for (x = 0; x < m_nCellWidth; ++x)
+                    aData[y] = (aData[y] << 2) | pIndexes[x];
+            }
+
+            // index 1 is the upper nibble of the screen RAM
+            aData[MCBITMAP_BYTES_PER_BLOCK]     = (pColors[1] << 4) | pColors[2];
+            aData[MCBITMAP_BYTES_PER_BLOCK + 1] = pColors[3];
+
+            pBitmap->SetCellData(xCell, yCell, aData);
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Convert the image into a hires bitmap: Each 8x8 cell has two colors.
+ */
+void ImageImporter::ImportHiRes(HiResBitmap* pBitmap)
+{
+    const uint8_t* pColors;
+    const uint8_t* pIndexes;
+    unsigned char  aData[HIRESBITMAP_BYTES_PER_BLOCK + 1];
+    unsigned       xCell, yCell, y, x;
+
+    Prepare(HIRES_X, HIRES_Y, HIRESBLOCK_WIDTH, 2, false);
+    SearchAllCells();
+    ChooseBackground();
+    Dither();
+
+    for (yCell = 0; yCell < m_nYCells; ++yCell)
+    {
+        for (xCell = 0; xCell < m_nXCells; ++xCell)
+        {
+            pColors = GetCellColors(yCell * m_nXCells + xCell);
+
+            for (y = 0; y < HIRESBITMAP_BYTES_PER_BLOCK; ++y)
+            {
+                pIndexes = &m_aIndexes[(yCell * IMPORTER_CELL_HEIGHT + y) *
+                                       m_nWidth + xCell * m_nCellWidth];
+                aData[y] = 0;
+                for (x = 0; x < m_nCellWidth; ++x)
+                    aData[y] = (aData[y] << 1) | pIndexes[x];
+            }
+
+            // index 1 (bit set) is the upper nibble of the screen RAM
+            aData[HIRESBITMAP_BYTES_PER_BLOCK] = (pColors[1] << 4) | pColors[0];
+
+            pBitmap->SetCellData(xCell, yCell, aData);
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Convert the image into a hires character screen: The background color is
+ * shared by all cells, each 8x8 cell has one color of its own. The cells
+ * are not merged here, so the screen may need more than 256 characters.
+ */
+void ImageImporter::ImportChars(CharBitmap* pBitmap)
+{
+    const uint8_t* pColors;
+    const uint8_t* pIndexes;
+    unsigned char  aData[CHARBITMAP_BYTES_PER_CHAR + 1];
+    unsigned       xCell, yCell, y, x;
+
+    Prepare(CHAR_X, CHAR_Y, CHAR_X / CHARBITMAP_XCELLS, 2, true);
+    SearchAllCells();
+    ChooseBackground();
+    Dither();
+
+    pBitmap->SetBackground(m_aBackgrounds[m_nBackground]);
+
+    for (yCell = 0; yCell < m_nYCells; ++yCell)
+    {
+        for (xCell = 0; xCell < m_nXCells; ++xCell)
+        {
+            pColors = GetCellColors(yCell * m_nXCells + xCell);
+
+            for (y = 0; y < CHARBITMAP_BYTES_PER_CHAR; ++y)
+            {
+                pIndexes = &m_aIndexes[(yCell * IMPORTER_CELL_HEIGHT + y) *
+                                       m_nWidth + xCell * m_nCellWidth];
+                aData[y] = 0;
+                for (x = 0; x < m_nCellWidth; ++x)
+                    aData[y] = (aData[y] << 1) | pIndexes[x];
+            }
+
+            // index 1 (bit set) is the color RAM
+            aData[CHARBITMAP_BYTES_PER_CHAR] = pColors[1];
+
+            pBitmap->SetCellData(xCell, yCell, aData);
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Scale the image to nWidth * nHeight pixels and calculate the distance of
+ * each pixel to each C64 color.
+ *
+ * Each cell has nCellWidth * 8 pixels and nColors colors. If bBackground is
+ * true, the first one of them is the background color shared by all cells.
+ */
+void ImageImporter::Prepare(unsigned nWidth, unsigned nHeight,
+                            unsigned nCellWidth, unsigned nColors,
+                            bool bBackground)
+{
+    wxImage  imageScaled;
+    Yuv      aPalette[16];
+    Yuv      yuv;
+    MC_RGB   rgb;
+    unsigned i, nPixels;
+    int      c;
+
+    m_nWidth       = nWidth;
+    m_nHeight      = nHeight;
+    m_nCellWidth   = nCellWidth;
+    m_nXCells      = nWidth / nCellWidth;
+    m_nYCells      = nHeight / IMPORTER_CELL_HEIGHT;
+    m_nColors      = nColors;
+    m_bBackground  = bBackground;
+    m_nBackground  = 0;
+
+    nPixels = nWidth * nHeight;
+
+    imageScaled = m_image.Scale(nWidth, nHeight, wxIMAGE_QUALITY_HIGH);
+    m_aRGB.assign(imageScaled.GetData(), imageScaled.GetData() + 3 * nPixels);
+
+    for (c = 0; c < 16; ++c)
+    {
+        rgb = C64Color::GetPaletteColor(c)->GetRGB();
+        aPalette[c] = ToYuv(MC_RGB_R(rgb), MC_RGB_G(rgb), MC_RGB_B(rgb));
+    }
+
+    m_aDistance.resize(16 * nPixels);
+    for (i = 0; i < nPixels; ++i)
+    {
+        yuv = ToYuv(m_aRGB[3 * i], m_aRGB[3 * i + 1], m_aRGB[3 * i + 2]);
+        for (c = 0; c < 16; ++c)
+            m_aDistance[16 * i + c] = Distance(yuv, aPalette[c]);
+    }
+
+    if (!bBackground)
+        m_aBackgrounds.assign(1, 0);
+    else if (nColors == IMPORTER_MAX_COLORS)
+        RankBackgrounds();
+    else
+    {
+        // the ranking is made for multicolor cells, with less colors per
+        // cell the search is cheap enough to try all backgrounds
+        m_aBackgrounds.resize(16);
+        for (c = 0; c < 16; ++c)
+            m_aBackgrounds[c] = c;
+    }
+    m_nBackgrounds = m_aBackgrounds.size();
+
+    m_aCellError.resize(m_nXCells * m_nYCells * m_nBackgrounds);
+    m_aCellColors.resize(m_nXCells * m_nYCells * m_nBackgrounds * nColors);
+    m_aIndexes.resize(nPixels);
+}
+
+
+/*****************************************************************************/
+/**
+ * Find the background colors which are worth to be tried. Each pixel is
+ * counted as the C64 color nearest to it, the backgrounds are ranked by
+ * the clash errors these cells would have.
+ */
+void ImageImporter::RankBackgrounds()
+{
+    BackgroundSearch search;
+    unsigned         aHistogram[16];
+    const int*       pDistance;
+    unsigned         nCell, x, y, c, nNearest;
+
+    for (nCell = 0; nCell < m_nXCells * m_nYCells; ++nCell)
+    {
+        memset(aHistogram, 0, sizeof(aHistogram));
+        for (y = 0; y < IMPORTER_CELL_HEIGHT; ++y)
+        {
+            for (x = 0; x < m_nCellWidth; ++x)
+            {
+                pDistance = &m_aDistance[16 *
+                    (((nCell / m_nXCells) * IMPORTER_CELL_HEIGHT + y) *
+                     m_nWidth + (nCell % m_nXCells) * m_nCellWidth + x)];
+                nNearest = 0;
+                for (c = 1; c < 16; ++c)
+                {
+                    if (pDistance[c] < pDistance[nNearest])
+                        nNearest = c;
+                }
+                ++aHistogram[nNearest];
+            }
+        }
+        search.AddCell(aHistogram);
+    }
+
+    search.Search();
+
+    m_aBackgrounds.resize(IMPORTER_BACKGROUND_CANDIDATES);
+    for (c = 0; c < IMPORTER_BACKGROUND_CANDIDATES; ++c)
+        m_aBackgrounds[c] = search.GetBackground(c);
+}
+
+
+/*****************************************************************************/
+/**
+ * Find the best colors for the cells nStart to nEnd - 1, for each
+ * background color to be tried.
+ *
+ * All combinations of the colors which are not the background are tried.
+ * Each pixel takes the color with the smallest distance, the error of the
+ * cell is the sum of these distances. The distances of the cell are copied
+ * to one row per color first, so the loops over the pixels of a cell run
+ * over consecutive memory and can be vectorized by the compiler.
+ */
+void ImageImporter::SearchCells(unsigned nStart, unsigned nEnd)
+{
+    int        aDistance[16][IMPORTER_MAX_CELL_PIXELS];
+    int        aMin[IMPORTER_MAX_CELL_PIXELS];
+    const int* pDistance;
+    unsigned   aCombination[IMPORTER_MAX_COLORS];
+    unsigned   nCell, nPixels, nFree, nFirst, nBg, nSlot, i, p, x, y;
+    unsigned   nError;
+    uint8_t*   pColors;
+
+    nPixels = m_nCellWidth * IMPORTER_CELL_HEIGHT;
+    // the background color is not chosen per cell
+    nFirst = m_bBackground ? 1 : 0;
+    nFree  = m_nColors - nFirst;
+
+    for (nCell = nStart; nCell < nEnd; ++nCell)
+    {
+        p = 0;
+        for (y = 0; y < IMPORTER_CELL_HEIGHT; ++y)
+        {
+            for (x = 0; x < m_nCellWidth; ++x)
+            {
+                pDistance = &m_aDistance[16 *
+                    (((nCell / m_nXCells) * IMPORTER_CELL_HEIGHT + y) *
+                     m_nWidth + (nCell % m_nXCells) * m_nCellWidth + x)];
+                for (i = 0; i < 16; ++i)
+                    aDistance[i][p] = pDistance[i];
+                ++p;
+            }
+        }
+
+        for (nBg = 0; nBg < m_nBackgrounds; ++nBg)
+            m_aCellError[nCell * m_nBackgrounds + nBg] = UINT_MAX;
+
+        for (i = 0; i < nFree; ++i)
+            aCombination[i] = i;
+
+        for (;;)
+        {
+            memcpy(aMin, aDistance[aCombination[0]], nPixels * sizeof(int));
+            for (i = 1; i < nFree; ++i)
+            {
+                pDistance = aDistance[aCombination[i]];
+                for (p = 0; p < nPixels; ++p)
+                    aMin[p] = pDistance[p] < aMin[p] ? pDistance[p] : aMin[p];
+            }
+
+            for (nBg = 0; nBg < m_nBackgrounds; ++nBg)
+            {
+                nError = 0;
+                if (nFirst)
+                {
+                    pDistance = aDistance[m_aBackgrounds[nBg]];
+                    for (p = 0; p < nPixels; ++p)
+                        nError += pDistance[p] < aMin[p] ?
+                                  pDistance[p] : aMin[p];
+                }
+                else
+                {
+                    for (p = 0; p < nPixels; ++p)
+                        nError += aMin[p];
+                }
+
+                nSlot = nCell * m_nBackgrounds + nBg;
+                if (nError < m_aCellError[nSlot])
+                {
+                    m_aCellError[nSlot] = nError;
+                    pColors = &m_aCellColors[nSlot * m_nColors];
+                    pColors[0] = m_aBackgrounds[nBg];
+                    for (i = 0; i < nFree; ++i)
+                        pColors[nFirst + i] = aCombination[i];
+                }
+            }
+
+            // next combination of nFree out of 16 colors
+            i = nFree;
+            while (i > 0 && aCombination[i - 1] == 16 - nFree + i - 1)
+                --i;
+            if (i == 0)
+                break;
+            ++aCombination[i - 1];
+            for (; i < nFree; ++i)
+                aCombination[i] = aCombination[i - 1] + 1;
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Find the best colors for all cells. The rows of cells are distributed to
+ * several threads.
+ */
+void ImageImporter::SearchAllCells()
+{
+    std::vector<Worker*> apWorkers;
+    Worker*              pWorker;
+    unsigned             nThreads, nRows, nStart, nEnd, nCells;
+    int                  nCPUs;
+    size_t               i;
+
+    nCPUs = wxThread::GetCPUCount();
+    nThreads = nCPUs > 0 ? nCPUs : 1;
+    if (nThreads > m_nYCells)
+        nThreads = m_nYCells;
+
+    nRows  = (m_nYCells + nThreads - 1) / nThreads;
+    nCells = m_nXCells * m_nYCells;
+
+    // the first rows are searched by this thread
+    for (nStart = nRows * m_nXCells; nStart < nCells;
+         nStart += nRows * m_nXCells)
+    {
+        nEnd = nStart + nRows * m_nXCells;
+        if (nEnd > nCells)
+            nEnd = nCells;
+
+        pWorker = new Worker(this, nStart, nEnd);
+        if (pWorker->Create() != wxTHREAD_NO_ERROR ||
+            pWorker->Run() != wxTHREAD_NO_ERROR)
+        {
+            // do it ourselves
+            delete pWorker;
+            SearchCells(nStart, nEnd);
+            continue;
+        }
+        apWorkers.push_back(pWorker);
+    }
+
+    SearchCells(0, nRows * m_nXCells < nCells ? nRows * m_nXCells : nCells);
+
+    for (i = 0; i < apWorkers.size(); ++i)
+    {
+        apWorkers[i]->Wait();
+        delete apWorkers[i];
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Choose the background color which gives the smallest error in total.
+ */
+void ImageImporter::ChooseBackground()
+{
+    uint64_t           aTotal[16];
+    unsigned           nCell, nBg;
+
+    for (nBg = 0; nBg < m_nBackgrounds; ++nBg)
+        aTotal[nBg] = 0;
+
+    for (nCell = 0; nCell < m_nXCells * m_nYCells; ++nCell)
+    {
+        for (nBg = 0; nBg < m_nBackgrounds; ++nBg)
+            aTotal[nBg] += m_aCellError[nCell * m_nBackgrounds + nBg];
+    }
+
+    m_nBackground = 0;
+    for (nBg = 1; nBg < m_nBackgrounds; ++nBg)
+    {
+        if (aTotal[nBg] < aTotal[m_nBackground])
+            m_nBackground = nBg;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Give each pixel one of the colors of its cell. Depending on the dither
+ * mode, a threshold pattern is added to the pixels first or the error of
+ * each pixel is distributed to its neighbours (Floyd-Steinberg).
+ */
+void ImageImporter::Dither()
+{
+    std::vector<int> aError;
+    const uint8_t*   pColors;
+    const uint8_t*   pRGB;
+    int*             pError;
+    int              aColor[3], aDiff[3];
+    MC_RGB           rgb;
+    unsigned         x, y, nCell, nIndex, c;
+    int              nOffset;
+
+    if (m_dither == MCDitherFloydSteinberg)
+        aError.assign(3 * m_nWidth * (m_nHeight + 1) + 3, 0);
+
+    for (y = 0; y < m_nHeight; ++y)
+    {
+        for (x = 0; x < m_nWidth; ++x)
+        {
+            pRGB  = &m_aRGB[3 * (y * m_nWidth + x)];
+            nCell = (y / IMPORTER_CELL_HEIGHT) * m_nXCells + x / m_nCellWidth;
+
+            nOffset = 0;
+            if (m_dither == MCDitherOrdered)
+                nOffset = (2 * m_aBayer[y & 3][x & 3] - 15) *
+                          IMPORTER_ORDERED_AMPLITUDE;
+
+            for (c = 0; c < 3; ++c)
+            {
+                aColor[c] = pRGB[c] + nOffset;
+                if (m_dither == MCDitherFloydSteinberg)
+                    aColor[c] += aError[3 * (y * m_nWidth + x) + c] / 16;
+
+                if (aColor[c] < 0)
+                    aColor[c] = 0;
+                else if (aColor[c] > 255)
+                    aColor[c] = 255;
+            }
+
+            nIndex = NearestIndex(nCell, aColor[0], aColor[1], aColor[2]);
+            m_aIndexes[y * m_nWidth + x] = nIndex;
+
+            if (m_dither != MCDitherFloydSteinberg)
+                continue;
+
+            pColors = GetCellColors(nCell);
+            rgb = C64Color::GetPaletteColor(pColors[nIndex])->GetRGB();
+            aDiff[0] = aColor[0] - (int) MC_RGB_R(rgb);
+            aDiff[1] = aColor[1] - (int) MC_RGB_G(rgb);
+            aDiff[2] = aColor[2] - (int) MC_RGB_B(rgb);
+
+            // 7/16 right, 3/16 below left, 5/16 below, 1/16 below right
+            pError = &aError[3 * (y * m_nWidth + x)];
+            for (c = 0; c < 3; ++c)
+            {
+                if (x + 1 < m_nWidth)
+                    pError[3 + c] += 7 * aDiff[c];
+                if (x > 0)
+                    pError[3 * m_nWidth - 3 + c] += 3 * aDiff[c];
+                pError[3 * m_nWidth + c] += 5 * aDiff[c];
+                if (x + 1 < m_nWidth)
+                    pError[3 * m_nWidth + 3 + c] += aDiff[c];
+            }
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the index of the color of the cell which is nearest to r/g/b.
+ */
+unsigned ImageImporter::NearestIndex(unsigned nCell, int r, int g, int b) const
+{
+    const uint8_t* pColors;
+    Yuv            yuv, yuvColor;
+    MC_RGB         rgb;
+    unsigned       i, nBest;
+    int            nDist, nBestDist;
+
+    pColors = GetCellColors(nCell);
+    yuv     = ToYuv(r, g, b);
+
+    nBest     = 0;
+    nBestDist = INT_MAX;
+    for (i = 0; i < m_nColors; ++i)
+    {
+        rgb = C64Color::GetPaletteColor(pColors[i])->GetRGB();
+        yuvColor = ToYuv(MC_RGB_R(rgb), MC_RGB_G(rgb), MC_RGB_B(rgb));
+        nDist = Distance(yuv, yuvColor);
+        if (nDist < nBestDist)
+        {
+            nBestDist = nDist;
+            nBest     = i;
+        }
+    }
+
+    return nBest;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the colors chosen for a cell with the background chosen.
+ */
+const uint8_t* ImageImporter::GetCellColors(unsigned nCell) const
+{
+    return &m_aCellColors[(nCell * m_nBackgrounds + m_nBackground) *
+                          m_nColors];
+}
+
+
+/*****************************************************************************/
+/**
+ * Convert an RGB color to YUV.
+ */
+ImageImporter::Yuv ImageImporter::ToYuv(int r, int g, int b)
+{
+    Yuv yuv;
+
+    yuv.y = (299 * r + 587 * g + 114 * b) / 1000;
+    yuv.u = b - yuv.y;
+    yuv.v = r - yuv.y;
+
+    return yuv;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the squared distance between two colors. The eye is more
+ * sensitive to brightness, so Y counts three times as much as U and V.
+ */
+int ImageImporter::Distance(const Yuv& yuv1, const Yuv& yuv2)
+{
+    int dy, du, dv;
+
+    dy = yuv1.y - yuv2.y;
+    du = yuv1.u - yuv2.u;
+    dv = yuv1.v - yuv2.v;
+
+    return 3 * dy * dy + du * du + dv * dv;
+}
+
+
+/*****************************************************************************/
+/**
+ * Constructor. The worker searches the cells nStart to nEnd - 1.
+ */
+ImageImporter::Worker::Worker(ImageImporter* pImporter, unsigned nStart,
+                              unsigned nEnd) :
+    wxThread(wxTHREAD_JOINABLE),
+    m_pImporter(pImporter),
+    m_nStart(nStart),
+    m_nEnd(nEnd)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Thread entry: Search the colors of our cells.
+ */
+wxThread::ExitCode ImageImporter::Worker::Entry()
+{
+    m_pImporter->SearchCells(m_nStart, m_nEnd);
+    return 0;
+}
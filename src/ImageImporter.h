@@ -0,0 +1,155 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef IMAGEIMPORTER_H
+#define IMAGEIMPORTER_H
+
+#include <stdint.h>
+#include <vector>
+#include <wx/image.h>
+#include <wx/thread.h>
+
+#include "DitherMode.h"
+
+class MCBitmap;
+class HiResBitmap;
+class CharBitmap;
+
+/*****************************************************************************/
+/**
+ * Converts a true color image into a C64 bitmap.
+ *
+ * The image is scaled to the size of the bitmap. Then the colors of each
+ * cell are chosen which give the smallest error compared to the original.
+ * For multicolor bitmaps the background colors are ranked by a
+ * BackgroundSearch over the nearest C64 colors of the pixels first. This is
+ * done for the most promising backgrounds only, the one with the smallest
+ * total error wins. Character screens have only one color per cell, all
+ * backgrounds are tried for them.
+ * The cells are independent from each other, so they are distributed to
+ * several threads. At last each pixel gets one of the colors of its cell,
+ * optionally with dithering.
+ *
+ * The error is measured in a YUV color space, brightness differences count
+ * more than color differences.
+ */
+class ImageImporter
+{
+public:
+    ImageImporter(const wxImage& image, MCDitherMode dither);
+
+    void ImportMC(MCBitmap* pBitmap);
+    void ImportHiRes(HiResBitmap* pBitmap);
+    void ImportChars(CharBitmap* pBitmap);
+
+    /// A color in YUV space
+    typedef struct Yuv_s
+    {
+        int y;
+        int u;
+        int v;
+    } Yuv;
+
+    static Yuv ToYuv(int r, int g, int b);
+    static int Distance(const Yuv& yuv1, const Yuv& yuv2);
+
+protected:
+    class Worker : public wxThread
+    {
+    public:
+        Worker(ImageImporter* pImporter, unsigned nStart, unsigned nEnd);
+
+    protected:
+        virtual ExitCode Entry();
+
+        ImageImporter* m_pImporter;
+        unsigned       m_nStart;
+        unsigned       m_nEnd;
+    };
+
+    void Prepare(unsigned nWidth, unsigned nHeight, unsigned nCellWidth,
+                 unsigned nColors, bool bBackground);
+    void SearchCells(unsigned nStart, unsigned nEnd);
+    void SearchAllCells();
+    void ChooseBackground();
+    void Dither();
+    unsigned NearestIndex(unsigned nCell, int r, int g, int b) const;
+    const uint8_t* GetCellColors(unsigned nCell) const;
+    void RankBackgrounds();
+
+    /// The image to be converted
+    const wxImage&          m_image;
+
+    /// The dithering to be used
+    MCDitherMode            m_dither;
+
+    /// Size of the bitmap in (wide) pixels
+    unsigned                m_nWidth;
+    unsigned                m_nHeight;
+
+    /// Width of a cell in pixels, the height is always 8
+    unsigned                m_nCellWidth;
+
+    /// Number of cells in each direction
+    unsigned                m_nXCells;
+    unsigned                m_nYCells;
+
+    /// Number of colors in a cell, including the background color
+    unsigned                m_nColors;
+
+    /// true if the first color of each cell is a shared background color
+    bool                    m_bBackground;
+
+    /// Number of backgrounds to try, 1 if there's no background color
+    unsigned                m_nBackgrounds;
+
+    /// The background colors to try, the most promising ones
+    std::vector<uint8_t>    m_aBackgrounds;
+
+    /// The scaled image, 3 bytes RGB per pixel
+    std::vector<uint8_t>    m_aRGB;
+
+    /// For each pixel the distance to each of the 16 C64 colors
+    std::vector<int>        m_aDistance;
+
+    /// For each cell and background the smallest error found
+    std::vector<unsigned>   m_aCellError;
+
+    /// For each cell and background the colors with the smallest error
+    std::vector<uint8_t>    m_aCellColors;
+
+    /// Index of the background chosen in m_aBackgrounds
+    unsigned                m_nBackground;
+
+    /// For each pixel the index of its color in the colors of its cell
+    std::vector<uint8_t>    m_aIndexes;
+
+private:
+    /// Copy construtor is private: This can't be copied
+    ImageImporter(const ImageImporter& r);
+    ImageImporter& operator=(const ImageImporter& r);
+};
+
+#endif // IMAGEIMPORTER_H
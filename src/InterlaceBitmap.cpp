@@ -0,0 +1,666 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include "InterlaceBitmap.h"
+
+
+const C64Color InterlaceBitmap::black;
+
+
+/*****************************************************************************/
+InterlaceBitmap::InterlaceBitmap(bool bSeparateScreens) :
+    m_nBackground(MC_BLACK),
+    m_nEditFrame(-1),
+    m_bSeparateScreens(bSeparateScreens)
+{
+    memset(m_aBitmapRAM, 0, sizeof(m_aBitmapRAM));
+    memset(m_aScreenRAM, 0, sizeof(m_aScreenRAM));
+    memset(m_aColorRAM, 0, sizeof(m_aColorRAM));
+}
+
+
+/*****************************************************************************/
+InterlaceBitmap::~InterlaceBitmap(void)
+{
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to a copy of this bitmap created with "new".
+ */
+BitmapBase* InterlaceBitmap::Copy() const
+{
+    return new InterlaceBitmap(*this);
+}
+
+
+/******************************************************************************/
+/**
+ * Return the width of this image.
+ */
+int InterlaceBitmap::GetWidth() const
+{
+    return MC_X;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the height of this image.
+ */
+int InterlaceBitmap::GetHeight() const
+{
+    return MC_Y;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the width of an attribute cell.
+ */
+int InterlaceBitmap::GetCellWidth() const
+{
+    return MCBLOCK_WIDTH;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the height of an attribute cell.
+ */
+int InterlaceBitmap::GetCellHeight() const
+{
+    return MCBLOCK_HEIGHT;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the pixel factor in X-direction. 2 for MC.
+ */
+int InterlaceBitmap::GetPixelXFactor() const
+{
+    return 2;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of frames, which are shown alternately.
+ */
+int InterlaceBitmap::GetNFrames() const
+{
+    return INTERLACEBITMAP_NFRAMES;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the frame which is changed by SetPixel or -1 for both.
+ */
+int InterlaceBitmap::GetEditFrame() const
+{
+    return m_nEditFrame;
+}
+
+
+/******************************************************************************/
+/**
+ * Select the frame to be changed by SetPixel, -1 for both. Invalid numbers
+ * select both frames.
+ */
+void InterlaceBitmap::SetEditFrame(int nFrame)
+{
+    if (nFrame >= 0 && nFrame < INTERLACEBITMAP_NFRAMES)
+        m_nEditFrame = nFrame;
+    else
+        m_nEditFrame = -1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of color indexes in this mode.
+ */
+int InterlaceBitmap::GetNIndexes() const
+{
+    return 4;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of an index in the cell which contains the given
+ * coordinates, in the frame being edited or in the first one. If the
+ * coordinates are out of range, return black.
+ */
+const C64Color* InterlaceBitmap::GetColorByIndex(int x, int y,
+                                                 int index) const
+{
+    int nFrame = m_nEditFrame < 0 ? 0 : m_nEditFrame;
+
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+    {
+        if (index < 4)
+            return C64Color::GetPaletteColor(
+                    GetIndexedColorNumber(nFrame, x, y, index));
+        else
+            return NULL;
+    }
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of pixels of an index in the cell which contains the
+ * given coordinates. Indexes shared by both frames are counted in both of
+ * them, the others in the frame being edited or in the first one. If the
+ * coordinates are out of range, return 0.
+ */
+int InterlaceBitmap::CountColorByIndex(int x, int y, int index) const
+{
+    int nFrame = m_nEditFrame < 0 ? 0 : m_nEditFrame;
+
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return CountIndex(nFrame, x, y, index);
+    else
+        return 0;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of a pixel in the frame being edited or in the first
+ * one. If the coordinates are out of range, return black.
+ */
+const C64Color* InterlaceBitmap::GetColor(int x, int y) const
+{
+    int nFrame = m_nEditFrame < 0 ? 0 : m_nEditFrame;
+
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return C64Color::GetPaletteColor(
+                GetIndexedColorNumber(nFrame, x, y, GetIndex(nFrame, x, y)));
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y in the frame
+ * being edited or in the first one to pDest. The caller must make sure
+ * that the whole row is inside of the bitmap.
+ */
+void InterlaceBitmap::GetColorRow(int x, int y, int w,
+                                  unsigned char* pDest) const
+{
+    GetFrameColorRow(m_nEditFrame < 0 ? 0 : m_nEditFrame, x, y, w, pDest);
+}
+
+
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y in frame nFrame
+ * to pDest. The caller must make sure that the whole row is inside of the
+ * bitmap.
+ */
+void InterlaceBitmap::GetFrameColorRow(int nFrame, int x, int y, int w,
+                                       unsigned char* pDest) const
+{
+    unsigned             c, xPixel, val;
+    const unsigned char* pRow;
+    unsigned char        aColors[4];
+
+    c      = (y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH;
+    pRow   = m_aBitmapRAM[nFrame] + c * MCBITMAP_BYTES_PER_BLOCK +
+             y % MCBLOCK_HEIGHT;
+    xPixel = x % MCBLOCK_WIDTH;
+
+    aColors[0] = m_nBackground;
+    while (w > 0)
+    {
+        aColors[1] = m_aScreenRAM[nFrame][c] >> 4;
+        aColors[2] = m_aScreenRAM[nFrame][c] & 0x0f;
+        aColors[3] = m_aColorRAM[c];
+
+        val = *pRow;
+        for (; xPixel < MCBLOCK_WIDTH && w > 0; ++xPixel, --w)
+            *pDest++ = aColors[(val >> (2 * (MCBLOCK_WIDTH - 1 - xPixel))) &
+                               0x03];
+
+        xPixel = 0;
+        ++c;
+        pRow += MCBITMAP_BYTES_PER_BLOCK;
+    }
+}
+
+
+/*****************************************************************************
+ * Set the pixel x/y to the color col in the frame being edited or in both
+ * frames. A color shared by both frames can only be replaced if no pixel
+ * in any of them uses it.
+ */
+void InterlaceBitmap::SetPixel(int x, int y, const C64Color& col,
+                               MCDrawingMode mode)
+{
+    unsigned char c;
+    int           nFrame;
+
+    if ((x < 0) || (y < 0) || (x >= GetWidth()) || (y >= GetHeight()))
+        return;
+
+    c = (unsigned char) col.GetColor();
+
+    // this may change the whole cell, in both frames
+    Dirty(x & ~(MCBLOCK_WIDTH - 1), y & ~(MCBLOCK_HEIGHT - 1),
+          MCBLOCK_WIDTH, MCBLOCK_HEIGHT);
+
+    if (m_nEditFrame >= 0)
+        SetFramePixel(m_nEditFrame, x, y, c, mode);
+    else
+    {
+        for (nFrame = 0; nFrame < INTERLACEBITMAP_NFRAMES; ++nFrame)
+            SetFramePixel(nFrame, x, y, c, mode);
+    }
+}
+
+
+/*****************************************************************************
+ * Set the pixel x/y of frame nFrame to the color number c. This works like
+ * MCBlock::SetPixel, but the usage of each shared index is counted in both
+ * frames. The coordinates must be valid.
+ */
+void InterlaceBitmap::SetFramePixel(int nFrame, int x, int y,
+                                    unsigned char c, MCDrawingMode mode)
+{
+    int aUsage[4];
+    int i;
+
+    // Set colors with fixed index first
+    i = (int)(mode - MCDrawingModeIndex0);
+    if (mode >= MCDrawingModeIndex0 && mode <= MCDrawingModeIndex3)
+    {
+        SetIndexedColor(nFrame, x, y, i, c);
+        SetIndex(nFrame, x, y, i);
+        return;
+    }
+
+    // use the background if possible
+    if (m_nBackground == c)
+    {
+        SetIndex(nFrame, x, y, 0);
+        return;
+    }
+
+    for (i = 1; i < 4; ++i)
+        aUsage[i] = CountIndex(nFrame, x, y, i);
+
+    // then all colors used
+    for (i = 1; i < 4; ++i)
+    {
+        if (aUsage[i] != 0 && GetIndexedColorNumber(nFrame, x, y, i) == c)
+        {
+            SetIndex(nFrame, x, y, i);
+            return;
+        }
+    }
+
+    // otherwise a free one
+    for (i = 1; i < 4; ++i)
+    {
+        if (aUsage[i] == 0)
+        {
+            SetIndex(nFrame, x, y, i);
+            SetIndexedColor(nFrame, x, y, i, c);
+            return;
+        }
+    }
+
+    // color clash, depends on the mode
+    if (mode == MCDrawingModeIgnore)
+        return;
+
+    if (mode == MCDrawingModeForce)
+    {
+        // replace the color of this pixel
+        i = GetIndex(nFrame, x, y);
+        if (i != 0)
+        {
+            SetIndexedColor(nFrame, x, y, i, c);
+            return;
+        }
+
+        // the background is fixed, use the least used color instead
+        mode = MCDrawingModeLeast;
+    }
+
+    if (mode == MCDrawingModeLeast)
+    {
+        i = 1;
+        if (aUsage[2] < aUsage[i])
+            i = 2;
+        if (aUsage[3] < aUsage[i])
+            i = 3;
+        SetIndex(nFrame, x, y, i);
+        SetIndexedColor(nFrame, x, y, i, c);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: The bitmap bytes and
+ * the screen RAM byte of each frame and one byte color RAM.
+ */
+unsigned InterlaceBitmap::GetCellDataSize() const
+{
+    return INTERLACEBITMAP_NFRAMES * (MCBITMAP_BYTES_PER_BLOCK + 1) + 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid.
+ */
+void InterlaceBitmap::GetCellData(int xCell, int yCell,
+                                  unsigned char* pData) const
+{
+    unsigned c = yCell * MCBITMAP_XBLOCKS + xCell;
+    int      nFrame;
+
+    for (nFrame = 0; nFrame < INTERLACEBITMAP_NFRAMES; ++nFrame)
+    {
+        memcpy(pData, m_aBitmapRAM[nFrame] + c * MCBITMAP_BYTES_PER_BLOCK,
+               MCBITMAP_BYTES_PER_BLOCK);
+        pData += MCBITMAP_BYTES_PER_BLOCK;
+        *pData++ = m_aScreenRAM[nFrame][c];
+    }
+    pData[0] = m_aColorRAM[c];
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ */
+void InterlaceBitmap::SetCellData(int xCell, int yCell,
+                                  const unsigned char* pData)
+{
+    unsigned c = yCell * MCBITMAP_XBLOCKS + xCell;
+    int      nFrame;
+
+    for (nFrame = 0; nFrame < INTERLACEBITMAP_NFRAMES; ++nFrame)
+    {
+        memcpy(m_aBitmapRAM[nFrame] + c * MCBITMAP_BYTES_PER_BLOCK, pData,
+               MCBITMAP_BYTES_PER_BLOCK);
+        pData += MCBITMAP_BYTES_PER_BLOCK;
+        m_aScreenRAM[nFrame][c] = *pData++;
+    }
+    m_aColorRAM[c] = pData[0] & 0x0f;
+
+    Dirty(xCell * MCBLOCK_WIDTH, yCell * MCBLOCK_HEIGHT,
+          MCBLOCK_WIDTH, MCBLOCK_HEIGHT);
+}
+
+
+/*****************************************************************************/
+/**
+ * The global data of an interlaced bitmap is the background color.
+ */
+unsigned InterlaceBitmap::GetGlobalDataSize() const
+{
+    return 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Store the background color in pData[0].
+ */
+void InterlaceBitmap::GetGlobalData(unsigned char* pData) const
+{
+    pData[0] = m_nBackground;
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background color from pData[0].
+ */
+void InterlaceBitmap::SetGlobalData(const unsigned char* pData)
+{
+    SetBackground(pData[0]);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return true if each frame has its own screen RAM.
+ */
+bool InterlaceBitmap::HasSeparateScreens() const
+{
+    return m_bSeparateScreens;
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background color of both frames.
+ */
+void InterlaceBitmap::SetBackground(unsigned char col)
+{
+    if (m_nBackground != (col & 0x0f))
+    {
+        m_nBackground = col & 0x0f;
+
+        // this may change the whole bitmap
+        Dirty(0, 0, MC_X, MC_Y);
+    }
+}
+
+
+/*****************************************************************************/
+unsigned char InterlaceBitmap::GetBackground() const
+{
+    return m_nBackground;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy nRows bitmap bytes in VIC order into frame nFrame, starting at the
+ * first one. Usually nRows is 8000 to set the complete bitmap.
+ */
+void InterlaceBitmap::SetBitmapRows(int nFrame, const uint8_t* pSrc,
+                                    size_t nRows)
+{
+    if (nRows > sizeof(m_aBitmapRAM[nFrame]))
+        nRows = sizeof(m_aBitmapRAM[nFrame]);
+
+    memcpy(m_aBitmapRAM[nFrame], pSrc, nRows);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the first nRows bitmap bytes of frame nFrame in VIC order to pDest.
+ */
+void InterlaceBitmap::GetBitmapRows(int nFrame, uint8_t* pDest,
+                                    size_t nRows) const
+{
+    if (nRows > sizeof(m_aBitmapRAM[nFrame]))
+        nRows = sizeof(m_aBitmapRAM[nFrame]);
+
+    memcpy(pDest, m_aBitmapRAM[nFrame], nRows);
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy a complete screen RAM (1000 bytes) into frame nFrame of this image.
+ * If nFrame is -1 or the screen RAM is shared, both frames get it.
+ */
+void InterlaceBitmap::SetScreenRAM(int nFrame, const unsigned char* pSrc)
+{
+    int n;
+
+    for (n = 0; n < INTERLACEBITMAP_NFRAMES; ++n)
+    {
+        if (n == nFrame || nFrame < 0 || !m_bSeparateScreens)
+            memcpy(m_aScreenRAM[n], pSrc, sizeof(m_aScreenRAM[n]));
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the complete screen RAM (1000 bytes) of frame nFrame to pDest.
+ */
+void InterlaceBitmap::GetScreenRAM(int nFrame, unsigned char* pDest) const
+{
+    memcpy(pDest, m_aScreenRAM[nFrame], sizeof(m_aScreenRAM[nFrame]));
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy a complete color RAM (1000 bytes) into this image. The upper nibbles
+ * are not connected on a real C64, so we ignore them.
+ */
+void InterlaceBitmap::SetColorRAM(const unsigned char* pSrc)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(m_aColorRAM); ++i)
+        m_aColorRAM[i] = pSrc[i] & 0x0f;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the complete color RAM (1000 bytes) to pDest.
+ */
+void InterlaceBitmap::GetColorRAM(unsigned char* pDest) const
+{
+    memcpy(pDest, m_aColorRAM, sizeof(m_aColorRAM));
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color index (0..3) of the pixel x/y in frame nFrame. The
+ * coordinates must be valid.
+ */
+void InterlaceBitmap::SetIndex(int nFrame, unsigned x, unsigned y, int index)
+{
+    unsigned char* pRow;
+    unsigned       shift;
+
+    pRow  = m_aBitmapRAM[nFrame] +
+            ((y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH) *
+            MCBITMAP_BYTES_PER_BLOCK + y % MCBLOCK_HEIGHT;
+    shift = 2 * (MCBLOCK_WIDTH - 1 - x % MCBLOCK_WIDTH);
+    *pRow = (*pRow & ~(0x03 << shift)) | (index << shift);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color of an index in the cell which contains x/y. This changes
+ * both frames, except for the screen RAM colors if each frame has its own
+ * screen RAM; then only frame nFrame is changed. The background belongs to
+ * the whole bitmap.
+ */
+void InterlaceBitmap::SetIndexedColor(int nFrame, unsigned x, unsigned y,
+                                      int index, unsigned char col)
+{
+    unsigned c = (y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH;
+    int      n;
+
+    switch (index)
+    {
+    case 0:
+        SetBackground(col);
+        break;
+    case 1:
+    case 2:
+        for (n = 0; n < INTERLACEBITMAP_NFRAMES; ++n)
+        {
+            if (n != nFrame && m_bSeparateScreens)
+                continue;
+
+            if (index == 1)
+                m_aScreenRAM[n][c] = (m_aScreenRAM[n][c] & 0x0f) | (col << 4);
+            else
+                m_aScreenRAM[n][c] = (m_aScreenRAM[n][c] & 0xf0) | col;
+        }
+        break;
+    case 3:
+        m_aColorRAM[c] = col;
+        break;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of pixels in the cell containing x/y which use the
+ * given index. Indexes shared by both frames are counted in both of them,
+ * the others in frame nFrame only.
+ */
+int InterlaceBitmap::CountIndex(int nFrame, unsigned x, unsigned y,
+                                int index) const
+{
+    const unsigned char* pRow;
+    unsigned char        val;
+    int                  nF, i, j, n;
+
+    n = 0;
+    for (nF = 0; nF < INTERLACEBITMAP_NFRAMES; ++nF)
+    {
+        if (nF != nFrame && IsFrameIndex(index))
+            continue;
+
+        pRow = m_aBitmapRAM[nF] +
+               ((y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH) *
+               MCBITMAP_BYTES_PER_BLOCK;
+        for (i = 0; i < MCBITMAP_BYTES_PER_BLOCK; ++i)
+        {
+            val = pRow[i];
+            for (j = 0; j < MCBLOCK_WIDTH; ++j)
+            {
+                if (((val >> (2 * j)) & 0x03) == index)
+                    ++n;
+            }
+        }
+    }
+    return n;
+}
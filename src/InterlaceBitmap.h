@@ -0,0 +1,201 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef INTERLACEBITMAP_H
+#define INTERLACEBITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "C64Color.h"
+#include "ToolBase.h"
+#include "BitmapBase.h"
+#include "MCBitmap.h"
+#include "MCBlock.h"
+
+/* Two multicolor bitmaps are shown alternately */
+#define INTERLACEBITMAP_NFRAMES 2
+
+/*****************************************************************************/
+/**
+ * An interlaced multicolor bitmap. Two bitmaps are shown in alternating VIC
+ * frames, so the eye sees the mix of the colors of both frames. Every pixel
+ * can use a different color index in each frame.
+ *
+ * Color RAM and background are always shared, there is only one of them
+ * in the C64. The screen RAM is either shared too, like in Drazlace, so
+ * each 4x8 cell has the same four colors in both frames. Or each frame has
+ * its own screen RAM, like in True Paint, then indexes 1 and 2 have
+ * different colors in each frame. In the shared layout both screen RAMs
+ * are kept equal.
+ *
+ * The data is stored like the VIC sees it. There are no usage counters,
+ * the pixels of a cell are counted in both bitmaps when needed.
+ *
+ * SetPixel changes the frame selected with SetEditFrame or both of them,
+ * GetColor and GetColorRow return the colors of this frame or of the first
+ * one.
+ */
+class InterlaceBitmap : public BitmapBase
+{
+public:
+    InterlaceBitmap(bool bSeparateScreens = false);
+    ~InterlaceBitmap(void);
+    virtual BitmapBase* Copy() const;
+
+    virtual int GetWidth() const;
+    virtual int GetHeight() const;
+
+    virtual int GetCellWidth() const;
+    virtual int GetCellHeight() const;
+
+    virtual int GetPixelXFactor() const;
+
+    virtual int GetNFrames() const;
+    virtual int GetEditFrame() const;
+    virtual void SetEditFrame(int nFrame);
+
+    virtual int GetNIndexes() const;
+    virtual const C64Color* GetColorByIndex(int x, int y, int index) const;
+    virtual int CountColorByIndex(int x, int y, int index) const;
+
+    virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
+    virtual void GetFrameColorRow(int nFrame, int x, int y, int w,
+                                  unsigned char* pDest) const;
+    virtual void SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode = MCDrawingModeIgnore);
+
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
+    virtual unsigned GetGlobalDataSize() const;
+    virtual void GetGlobalData(unsigned char* pData) const;
+    virtual void SetGlobalData(const unsigned char* pData);
+
+    bool HasSeparateScreens() const;
+
+    void SetBackground(unsigned char col);
+    unsigned char GetBackground() const;
+
+    void SetBitmapRows(int nFrame, const uint8_t* pSrc, size_t nRows);
+    void GetBitmapRows(int nFrame, uint8_t* pDest, size_t nRows) const;
+    void SetScreenRAM(int nFrame, const unsigned char* pSrc);
+    void GetScreenRAM(int nFrame, unsigned char* pDest) const;
+    void SetColorRAM(const unsigned char* pSrc);
+    void GetColorRAM(unsigned char* pDest) const;
+
+    static const C64Color black;
+
+protected:
+    void SetFramePixel(int nFrame, int x, int y, unsigned char c,
+                       MCDrawingMode mode);
+
+    int GetIndex(int nFrame, unsigned x, unsigned y) const;
+    void SetIndex(int nFrame, unsigned x, unsigned y, int index);
+    int GetIndexedColorNumber(int nFrame, unsigned x, unsigned y,
+                              int index) const;
+    void SetIndexedColor(int nFrame, unsigned x, unsigned y, int index,
+                         unsigned char col);
+    int CountIndex(int nFrame, unsigned x, unsigned y, int index) const;
+    bool IsFrameIndex(int index) const;
+
+    /// Bitmap RAM of each frame, 8 bytes per cell, in VIC order
+    unsigned char m_aBitmapRAM[INTERLACEBITMAP_NFRAMES]
+                              [MCBITMAP_NBLOCKS * MCBITMAP_BYTES_PER_BLOCK];
+
+    /// Screen RAM of each frame, upper nibble is index 1, lower is 2
+    unsigned char m_aScreenRAM[INTERLACEBITMAP_NFRAMES][MCBITMAP_NBLOCKS];
+
+    /// Color RAM of both frames, only the lower nibble is used, index 3
+    unsigned char m_aColorRAM[MCBITMAP_NBLOCKS];
+
+    /// Background color of both frames, index 0
+    unsigned char m_nBackground;
+
+    /// Frame changed by SetPixel, -1 for both
+    int m_nEditFrame;
+
+    /// true if each frame has its own screen RAM
+    bool m_bSeparateScreens;
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the color index (0..3) of the pixel x/y in frame nFrame. The
+ * coordinates must be valid.
+ */
+inline int InterlaceBitmap::GetIndex(int nFrame, unsigned x,
+                                     unsigned y) const
+{
+    unsigned c = (y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH;
+
+    return (m_aBitmapRAM[nFrame][c * MCBITMAP_BYTES_PER_BLOCK +
+                                 y % MCBLOCK_HEIGHT] >>
+            (2 * (MCBLOCK_WIDTH - 1 - x % MCBLOCK_WIDTH))) & 0x03;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the C64 color number used for the given index in frame nFrame in
+ * the cell which contains x/y. The coordinates must be valid.
+ */
+inline int InterlaceBitmap::GetIndexedColorNumber(int nFrame,
+                                                  unsigned x, unsigned y,
+                                                  int index) const
+{
+    unsigned c = (y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH;
+
+    switch (index)
+    {
+    case 0:
+        return m_nBackground;
+    case 1:
+        return m_aScreenRAM[nFrame][c] >> 4;
+    case 2:
+        return m_aScreenRAM[nFrame][c] & 0x0f;
+    default:
+        return m_aColorRAM[c];
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return true if the color of this index may be different in each frame,
+ * i.e. if it comes from the screen RAM and this is not shared.
+ */
+inline bool InterlaceBitmap::IsFrameIndex(int index) const
+{
+    return m_bSeparateScreens && (index == 1 || index == 2);
+}
+
+#endif // INTERLACEBITMAP_H
@@ -0,0 +1,392 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+#include "MCApp.h"
+#include "InterlaceDoc.h"
+#include "DocRenderer.h"
+
+#define DRAZLACE_START_ADDR  0x5800
+#define TRUEPAINT_START_ADDR 0x9c00
+
+/* File structure of a Drazlace image including start address */
+typedef struct drazlace_s
+{
+   uint8_t ptr[2];               /* start address */
+   uint8_t col_ram[1024];        /* $5800: low-nibble only, 1000 used */
+   uint8_t scr_ram[1024];        /* $5c00: 1000 used */
+   uint8_t bitmap1[8000];        /* $6000: first frame */
+   uint8_t background;           /* $7f40: $d021 */
+   uint8_t unused1;
+   uint8_t shift;                /* $7f42: shift of the second frame */
+   uint8_t unused2[189];
+   uint8_t bitmap2[8000];        /* $8000: second frame */
+} drazlace_t;
+
+/* File structure of a True Paint image including start address */
+typedef struct truepaint_s
+{
+   uint8_t ptr[2];               /* start address */
+   uint8_t scr_ram1[1000];       /* $9c00: screen RAM of the first frame */
+   uint8_t background;           /* $9fe8: $d021 */
+   uint8_t unused1[23];
+   uint8_t bitmap1[8000];        /* $a000: first frame */
+   uint8_t unused2[192];
+   uint8_t scr_ram2[1000];       /* $c000: screen RAM of the second frame */
+   uint8_t unused3[24];
+   uint8_t bitmap2[8000];        /* $c400: second frame */
+   uint8_t unused4[192];
+   uint8_t col_ram[1000];        /* $e400: low-nibble only */
+} truepaint_t;
+
+/******************************************************************************/
+/**
+ * This is a list of all Filters for this image format. Pictures with a
+ * shared screen RAM can be saved in both formats.
+ */
+static FormatInfo::Filter m_aFilters[] =
+{
+    { wxT("Drazlace files"), wxT("*.drl") },
+    { wxT("True Paint files"), wxT("*.mci") },
+    { NULL, NULL }
+};
+
+static FormatInfo::Filter m_aFiltersSeparate[] =
+{
+    { wxT("True Paint files"), wxT("*.mci") },
+    { NULL, NULL }
+};
+
+/**
+ * File sizes and load addresses CheckFormat looks for, terminated by 0.
+ */
+static const unsigned m_aSizes[] =
+    { sizeof(drazlace_t), 0 };
+static const unsigned m_aLoadAddresses[] =
+    { DRAZLACE_START_ADDR, 0 };
+
+static const unsigned m_aSizesSeparate[] =
+    { sizeof(truepaint_t), 0 };
+static const unsigned m_aLoadAddressesSeparate[] =
+    { TRUEPAINT_START_ADDR, 0 };
+
+/**
+ * Information about this image format, with a shared screen RAM like
+ * Drazlace or with one screen RAM per frame like True Paint.
+ */
+FormatInfo InterlaceDoc::m_formatInfo(
+    wxT("Multi Color Interlace"),
+    wxT("drl"),
+    m_aFilters,
+    InterlaceDoc::Factory,
+    InterlaceDoc::CheckFormat,
+    m_aSizes,
+    m_aLoadAddresses);
+
+FormatInfo InterlaceDoc::m_formatInfoSeparate(
+    wxT("Multi Color Interlace (True Paint)"),
+    wxT("mci"),
+    m_aFiltersSeparate,
+    InterlaceDoc::FactorySeparate,
+    InterlaceDoc::CheckFormatSeparate,
+    m_aSizesSeparate,
+    m_aLoadAddressesSeparate);
+
+
+/******************************************************************************/
+/**
+ *
+ */
+InterlaceDoc::InterlaceDoc(bool bSeparateScreens)
+    : m_bitmap(bSeparateScreens)
+    , m_nShift(0)
+{
+    PrepareUndo();
+
+    // PrepareUndo sets m_bModified, reset it
+    m_bModified = false;
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class with a shared screen RAM.
+ */
+DocBase* InterlaceDoc::Factory()
+{
+    return new InterlaceDoc(false);
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class with one screen RAM per frame.
+ */
+DocBase* InterlaceDoc::FactorySeparate()
+{
+    return new InterlaceDoc(true);
+}
+
+
+/******************************************************************************/
+/**
+ * Check how good data matches our document format. Return a sum of
+ * MC_FORMAT_*_MATCH.
+ */
+int InterlaceDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                              const wxFileName& fileName)
+{
+    uint16_t addr;
+    int      match = 0;
+
+    if (fileName.GetExt().CmpNoCase(wxT("drl")) == 0)
+        match += MC_FORMAT_EXTENSION_MATCH;
+
+    if (len == sizeof(drazlace_t))
+        match += MC_FORMAT_SIZE_MATCH;
+
+    if (len < 2)
+        return match;
+
+    addr = pBuff[0] + pBuff[1] * 256;
+    if (addr == DRAZLACE_START_ADDR)
+        match += MC_FORMAT_ADDR_MATCH;
+
+    return match;
+}
+
+
+/******************************************************************************/
+/**
+ * Check how good data matches a True Paint file. Return a sum of
+ * MC_FORMAT_*_MATCH.
+ */
+int InterlaceDoc::CheckFormatSeparate(const uint8_t* pBuff, unsigned len,
+                                      const wxFileName& fileName)
+{
+    uint16_t addr;
+    int      match = 0;
+
+    if (fileName.GetExt().CmpNoCase(wxT("mci")) == 0)
+        match += MC_FORMAT_EXTENSION_MATCH;
+
+    if (len == sizeof(truepaint_t))
+        match += MC_FORMAT_SIZE_MATCH;
+
+    if (len < 2)
+        return match;
+
+    addr = pBuff[0] + pBuff[1] * 256;
+    if (addr == TRUEPAINT_START_ADDR)
+        match += MC_FORMAT_ADDR_MATCH;
+
+    return match;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our FormatInfo, it depends on the screen RAM layout.
+ */
+const FormatInfo* InterlaceDoc::GetFormatInfo() const
+{
+    return m_bitmap.HasSeparateScreens() ? &m_formatInfoSeparate :
+                                           &m_formatInfo;
+}
+
+
+/******************************************************************************/
+/**
+ * Copy the contents of the given bitmap to our one. The pointer must point to
+ * an object which has actually the same type as our bitmap.
+ */
+void InterlaceDoc::SetBitmap(const BitmapBase* pB)
+{
+    m_bitmap = *(InterlaceBitmap*) pB;
+}
+
+
+/******************************************************************************/
+/**
+ * Try to load the file from the given memory buffer. Return true for success.
+ */
+bool InterlaceDoc::Load(const uint8_t* pBuff, unsigned size)
+{
+    if (m_bitmap.HasSeparateScreens())
+        return LoadTruePaint(pBuff, size);
+    else
+        return LoadDrazlace(pBuff, size);
+}
+
+
+/******************************************************************************
+ **
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success. The file name is for informational purposes only, e.g. to
+ * decide which sub-format to use.
+ */
+bool InterlaceDoc::Save(std::vector<uint8_t>* pOut,
+                        const wxFileName& fileName)
+{
+    if (m_bitmap.HasSeparateScreens() &&
+        fileName.GetExt().CmpNoCase(wxT("drl")) == 0)
+    {
+        ShowMessage(fileName.GetFullPath(),
+            wxT("Drazlace files have one screen RAM for both frames, save "
+                "this picture as True Paint file."),
+            wxT("Save Error"));
+        return false;
+    }
+
+    if (m_bitmap.HasSeparateScreens() ||
+        fileName.GetExt().CmpNoCase(wxT("mci")) == 0)
+        return SaveTruePaint(pOut);
+    else
+        return SaveDrazlace(pOut);
+}
+
+
+/*****************************************************************************/
+/**
+ * Try to load a Drazlace picture from the given buffer into this document.
+ * Return true if it worked and false otherwise.
+ *
+ * pBuff        Points to bytes from the file
+ * nSize        Size
+ * return       true if the file has been loaded
+ */
+bool InterlaceDoc::LoadDrazlace(const uint8_t* pBuff, unsigned nSize)
+{
+    const drazlace_t* pImage;
+
+    if (nSize != sizeof(drazlace_t))
+        return false;
+
+    pImage = (const drazlace_t*) pBuff;
+
+    // ignore start addr, 2 bytes
+
+    m_bitmap.SetBitmapRows(0, pImage->bitmap1, sizeof(pImage->bitmap1));
+    m_bitmap.SetBitmapRows(1, pImage->bitmap2, sizeof(pImage->bitmap2));
+    m_bitmap.SetScreenRAM(-1, pImage->scr_ram);
+    m_bitmap.SetColorRAM(pImage->col_ram);
+    m_bitmap.SetBackground(pImage->background);
+    m_nShift = pImage->shift;
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Save a Drazlace file into the given buffer.
+ *
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
+ */
+bool InterlaceDoc::SaveDrazlace(std::vector<uint8_t>* pOut)
+{
+    drazlace_t* pImage;
+
+    pOut->assign(sizeof(drazlace_t), 0);
+    pImage = (drazlace_t*) &(*pOut)[0];
+
+    // start addr
+    pImage->ptr[0] = DRAZLACE_START_ADDR % 0x100;
+    pImage->ptr[1] = DRAZLACE_START_ADDR / 0x100;
+
+    m_bitmap.GetColorRAM(pImage->col_ram);
+    m_bitmap.GetScreenRAM(0, pImage->scr_ram);
+    m_bitmap.GetBitmapRows(0, pImage->bitmap1, sizeof(pImage->bitmap1));
+    pImage->background = m_bitmap.GetBackground();
+    pImage->shift = m_nShift;
+    m_bitmap.GetBitmapRows(1, pImage->bitmap2, sizeof(pImage->bitmap2));
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Try to load a True Paint picture from the given buffer into this
+ * document. Each frame has its own screen RAM.
+ * Return true if it worked and false otherwise.
+ *
+ * pBuff        Points to bytes from the file
+ * nSize        Size
+ * return       true if the file has been loaded
+ */
+bool InterlaceDoc::LoadTruePaint(const uint8_t* pBuff, unsigned nSize)
+{
+    const truepaint_t* pImage;
+
+    if (nSize != sizeof(truepaint_t))
+        return false;
+
+    pImage = (const truepaint_t*) pBuff;
+
+    // ignore start addr, 2 bytes
+
+    m_bitmap.SetBitmapRows(0, pImage->bitmap1, sizeof(pImage->bitmap1));
+    m_bitmap.SetBitmapRows(1, pImage->bitmap2, sizeof(pImage->bitmap2));
+    m_bitmap.SetScreenRAM(0, pImage->scr_ram1);
+    m_bitmap.SetScreenRAM(1, pImage->scr_ram2);
+    m_bitmap.SetColorRAM(pImage->col_ram);
+    m_bitmap.SetBackground(pImage->background);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Save a True Paint file into the given buffer.
+ *
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
+ */
+bool InterlaceDoc::SaveTruePaint(std::vector<uint8_t>* pOut)
+{
+    truepaint_t* pImage;
+
+    pOut->assign(sizeof(truepaint_t), 0);
+    pImage = (truepaint_t*) &(*pOut)[0];
+
+    // start addr
+    pImage->ptr[0] = TRUEPAINT_START_ADDR % 0x100;
+    pImage->ptr[1] = TRUEPAINT_START_ADDR / 0x100;
+
+    m_bitmap.GetScreenRAM(0, pImage->scr_ram1);
+    pImage->background = m_bitmap.GetBackground();
+    m_bitmap.GetBitmapRows(0, pImage->bitmap1, sizeof(pImage->bitmap1));
+    m_bitmap.GetScreenRAM(1, pImage->scr_ram2);
+    m_bitmap.GetBitmapRows(1, pImage->bitmap2, sizeof(pImage->bitmap2));
+    m_bitmap.GetColorRAM(pImage->col_ram);
+
+    return true;
+}
@@ -0,0 +1,95 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef INTERLACEDOC_H
+#define INTERLACEDOC_H
+
+#include <list>
+#include <vector>
+
+#include "InterlaceBitmap.h"
+#include "DocBase.h"
+#include "FormatInfo.h"
+
+class DocRenderer;
+
+class InterlaceDoc : public DocBase
+{
+public:
+    InterlaceDoc(bool bSeparateScreens);
+    static DocBase* Factory();
+    static DocBase* FactorySeparate();
+    static int CheckFormat(const uint8_t* pBuff, unsigned len,
+                           const wxFileName& fileName);
+    static int CheckFormatSeparate(const uint8_t* pBuff, unsigned len,
+                                   const wxFileName& fileName);
+
+    virtual const FormatInfo* GetFormatInfo() const;
+
+    const BitmapBase* GetBitmap() const;
+    virtual BitmapBase* GetBitmap();
+    virtual void SetBitmap(const BitmapBase*);
+
+protected:
+    virtual bool Load(const uint8_t* pBuff, unsigned size);
+    virtual bool Save(std::vector<uint8_t>* pOut, const wxFileName& fileName);
+
+    bool LoadDrazlace(const uint8_t* pBuff, unsigned nSize);
+    bool SaveDrazlace(std::vector<uint8_t>* pOut);
+    bool LoadTruePaint(const uint8_t* pBuff, unsigned nSize);
+    bool SaveTruePaint(std::vector<uint8_t>* pOut);
+
+    static FormatInfo m_formatInfo;
+    static FormatInfo m_formatInfoSeparate;
+
+    /// The bitmap under work
+    InterlaceBitmap  m_bitmap;
+
+    /// Drazlace shift flag for the second frame, kept for saving only
+    uint8_t          m_nShift;
+};
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our bitmap (const).
+ */
+inline const BitmapBase* InterlaceDoc::GetBitmap() const
+{
+    return &m_bitmap;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our bitmap.
+ */
+inline BitmapBase* InterlaceDoc::GetBitmap()
+{
+    return &m_bitmap;
+}
+
+
+#endif // INTERLACEDOC_H
@@ -38,6 +38,8 @@
 #include "MCMainFrame.h"
 #include "MCDoc.h"
 #include "ToolPanel.h"
+#include "MCBatchApp.h"
+#include "Bench.h"
 
 #include "ToolDots.h"
 #include "ToolFreehand.h"
@@ -49,6 +51,25 @@
 
 static const wxCmdLineEntryDesc cmdLineDesc[] =
 {
+    {
+        wxCMD_LINE_SWITCH, wxT("c"), wxT("convert"),
+        wxT("convert the image files given without GUI, the last one is the "
+            "target; a '*' in it is replaced by each source name"),
+        wxCMD_LINE_VAL_NONE, 0
+    },
+    {
+        wxCMD_LINE_OPTION, wxT("j"), wxT("jobs"),
+        wxT("number of files to be converted in parallel, "
+            "default: one per CPU"),
+        wxCMD_LINE_VAL_NUMBER, 0
+    },
+#ifdef MC_BENCH
+    {
+        wxCMD_LINE_SWITCH, NULL, wxT("bench"),
+        wxT("run the benchmarks and print the results"),
+        wxCMD_LINE_VAL_NONE, 0
+    },
+#endif
     {
         wxCMD_LINE_PARAM,  NULL, NULL, wxT("image file"),
         wxCMD_LINE_VAL_STRING,
@@ -57,13 +78,33 @@ static const wxCmdLineEntryDesc cmdLineDesc[] =
     { wxCMD_LINE_NONE }
 };
 
-IMPLEMENT_APP(MCApp);
+IMPLEMENT_APP_NO_MAIN(MCApp);
+
+/*****************************************************************************/
+/*
+ * Start the GUI or, if the command line asks for a batch conversion, the
+ * console application MCBatchApp. In this case the GUI toolkit is not
+ * initialised, so files can be converted without a display.
+ */
+int main(int argc, char** argv)
+{
+    if (MCBatchApp::IsBatchCommandLine(argc, argv))
+        wxApp::SetInstance(new MCBatchApp);
+
+#ifdef __WXMSW__
+    // this one also remembers our instance handle for the GUI
+    return wxEntry(::GetModuleHandle(NULL));
+#else
+    return wxEntry(argc, argv);
+#endif
+}
 
 /*****************************************************************************/
 MCApp::MCApp()
     : m_pMainFrame(NULL)
     , m_idDrawingTool(0)
     , m_listTools()
+    , m_bHeadless(false)
 {
 #ifdef __WXMAC__
     ProcessSerialNumber psn;
@@ -87,6 +128,15 @@ bool MCApp::OnInit()
     if (cmdLineParser.Parse() != 0)
         return false;
 
+#ifdef MC_BENCH
+    if (cmdLineParser.Found(wxT("bench")))
+    {
+        m_bHeadless = true;
+        DocBase::SetHeadless(true);
+        return true;
+    }
+#endif
+
     wxInitAllImageHandlers();
 
     m_pMainFrame = new MCMainFrame(m_pMainFrame, wxT("MultiColor"));
@@ -105,6 +155,32 @@ bool MCApp::OnInit()
     return true;
 }
 
+/*****************************************************************************/
+/*
+ * Run the main loop or, in batch mode, run the benchmarks and quit.
+ *
+ * Return the exit code of the application.
+ */
+int MCApp::OnRun()
+{
+#ifdef MC_BENCH
+    if (IsHeadless())
+        return Bench::Run();
+#endif
+
+    return wxApp::OnRun();
+}
+
+/*****************************************************************************/
+/*
+ * Return the description of our command line. It is shared with
+ * MCBatchApp, so both accept the same options.
+ */
+const wxCmdLineEntryDesc* MCApp::GetCmdLineDesc()
+{
+    return cmdLineDesc;
+}
+
 /*****************************************************************************/
 /*
  * Allocate all drawing tools.
@@ -224,5 +300,6 @@ void MCApp::SetActiveDoc(DocBase* pDoc)
  */
 void MCApp::SetDocName(const DocBase* pDoc, const wxString name)
 {
-    m_pMainFrame->SetDocName(pDoc, name);
+    if (m_pMainFrame)
+        m_pMainFrame->SetDocName(pDoc, name);
 }
@@ -32,13 +32,11 @@
 #include "MCMainFrame.h"
 #include "ToolPanel.h"
 
-#define MC_MAX_FILE_BUFF_SIZE 0x10000
-
-
 class PalettePanel;
 class ToolBase;
 class DocBase;
 class MCChildFrame;
+struct wxCmdLineEntryDesc;
 
 class MCApp : public wxApp
 {
@@ -46,6 +44,9 @@ public:
     MCApp();
     virtual ~MCApp();
     virtual bool OnInit();
+    virtual int OnRun();
+
+    static const wxCmdLineEntryDesc* GetCmdLineDesc();
 
     static wxImage GetImage(const wxString& dir, const wxString& name);
     static wxBitmap GetBitmap(const wxString& dir, const wxString& name);
@@ -59,6 +60,7 @@ public:
 
     MCMainFrame* GetMainFrame();
     PalettePanel* GetPalettePanel();
+    bool IsHeadless() const;
 
 protected:
     MCMainFrame*    m_pMainFrame;
@@ -66,6 +68,9 @@ protected:
     int             m_idDrawingTool;
     std::list<ToolBase*> m_listTools;
 
+    /// true if we run without GUI, i.e. the benchmarks
+    bool            m_bHeadless;
+
 private:
     void AllocateTools();
     void FreeTools();
@@ -91,6 +96,12 @@ inline MCMainFrame* MCApp::GetMainFrame()
     return m_pMainFrame;
 }
 
+/*****************************************************************************/
+inline bool MCApp::IsHeadless() const
+{
+    return m_bHeadless;
+}
+
 
 /*****************************************************************************/
 enum MultiColorId
@@ -101,10 +112,20 @@ enum MultiColorId
     MC_ID_ZOOM_8,
     MC_ID_ZOOM_16,
     MC_ID_TV_MODE,
+    MC_ID_TV_KERNEL_EWMA,
+    MC_ID_TV_KERNEL_PAL,
+    MC_ID_TV_KERNEL_SCANLINES,
 
     MC_ID_TILE,
     MC_ID_CASCADE,
     MC_ID_NEW_VIEW,
+    MC_ID_IMPORT,
+    MC_ID_REOPTIMISE,
+    MC_ID_SPRITE_COUNT,
+    MC_ID_REDUCE_CHARS,
+    MC_ID_FRAME_ALL,
+    MC_ID_FRAME_1,
+    MC_ID_FRAME_2,
 
     MC_ID_TOOL_DOTS,
     MC_ID_TOOL_FREEHAND,
@@ -0,0 +1,112 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <wx/cmdline.h>
+
+#include "MCApp.h"
+#include "MCBatchApp.h"
+#include "DocBase.h"
+
+/*****************************************************************************/
+/**
+ * Constructor.
+ */
+MCBatchApp::MCBatchApp() :
+    m_converter(),
+    m_nThreads(0)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Prepare the conversion of the files given on the command line. The
+ * command line is parsed with the same description as in the GUI, so
+ * --help lists all options. Errors are reported on stderr.
+ */
+bool MCBatchApp::OnInit()
+{
+    wxArrayString arrayIn;
+    long          nThreads = 0;
+    size_t        i;
+
+    wxCmdLineParser parser(MCApp::GetCmdLineDesc(), argc, argv);
+
+    if (parser.Parse() != 0)
+        return false;
+
+    DocBase::SetHeadless(true);
+
+    if (parser.GetParamCount() < 2)
+    {
+        wxFprintf(stderr, wxT("--convert needs a source and a target\n"));
+        return false;
+    }
+
+    if (parser.Found(wxT("jobs"), &nThreads) && nThreads < 1)
+    {
+        wxFprintf(stderr, wxT("--jobs must be at least 1\n"));
+        return false;
+    }
+    m_nThreads = nThreads;
+
+    for (i = 0; i + 1 < parser.GetParamCount(); ++i)
+        arrayIn.Add(parser.GetParam(i));
+
+    return m_converter.AddJobs(arrayIn,
+            parser.GetParam(parser.GetParamCount() - 1));
+}
+
+
+/*****************************************************************************/
+/**
+ * Convert the files and quit. Return 0 if all files have been converted,
+ * 1 otherwise.
+ */
+int MCBatchApp::OnRun()
+{
+    return m_converter.Run(m_nThreads);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return true if the command line asks for a batch conversion. This is
+ * checked before wx is initialised, so it only looks for the switch
+ * itself and leaves the parsing to OnInit.
+ */
+bool MCBatchApp::IsBatchCommandLine(int argc, char** argv)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--convert") == 0)
+            return true;
+    }
+
+    return false;
+}
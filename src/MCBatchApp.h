@@ -0,0 +1,56 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef MCBATCHAPP_H
+#define MCBATCHAPP_H
+
+#include <wx/app.h>
+
+#include "BatchConverter.h"
+
+/*****************************************************************************/
+/**
+ * The application object used for --convert. It is a console application,
+ * so the GUI toolkit is not initialised and no display is needed. main()
+ * creates it instead of MCApp if IsBatchCommandLine() says so.
+ */
+class MCBatchApp : public wxAppConsole
+{
+public:
+    MCBatchApp();
+    virtual bool OnInit();
+    virtual int OnRun();
+
+    static bool IsBatchCommandLine(int argc, char** argv);
+
+protected:
+    /// Converts the files given on the command line
+    BatchConverter  m_converter;
+
+    /// Number of threads to be used, 0 = one per CPU
+    unsigned        m_nThreads;
+};
+
+#endif // MCBATCHAPP_H
@@ -33,11 +33,17 @@ const C64Color MCBitmap::black;
 
 
 /*****************************************************************************/
-MCBitmap::MCBitmap(void)
+MCBitmap::MCBitmap(void) :
+    m_nBackground(MC_BLACK)
 {
-    int x;
-    for (x = 0; x < MCBITMAP_XBLOCKS * MCBITMAP_YBLOCKS; ++x)
-        m_aMCBlock[0][x].SetParent(this);
+    unsigned cell;
+
+    memset(m_aBitmapRAM, 0, sizeof(m_aBitmapRAM));
+    memset(m_aScreenRAM, 0, sizeof(m_aScreenRAM));
+    memset(m_aColorRAM, 0, sizeof(m_aColorRAM));
+
+    for (cell = 0; cell < MCBITMAP_NBLOCKS; ++cell)
+        CountUsage(cell);
 }
 
 /*****************************************************************************/
@@ -116,11 +122,7 @@ int MCBitmap::GetNIndexes() const
 const C64Color* MCBitmap::GetColorByIndex(int x, int y, int index) const
 {
     if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
-    {
-        x /= MCBLOCK_WIDTH;
-        y /= MCBLOCK_HEIGHT;
-        return m_aMCBlock[y][x].GetIndexedColor(index);
-    }
+        return GetMCBlock(x, y).GetIndexedColor(index);
     else
         return &black;
 }
@@ -134,11 +136,7 @@ const C64Color* MCBitmap::GetColorByIndex(int x, int y, int index) const
 int MCBitmap::CountColorByIndex(int x, int y, int index) const
 {
     if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
-    {
-        y /= MCBLOCK_HEIGHT;
-        x /= MCBLOCK_WIDTH;
-        return m_aMCBlock[y][x].CountIndexedColor(index);
-    }
+        return GetMCBlock(x, y).CountIndexedColor(index);
     else
         return 0;
 }
@@ -152,21 +150,51 @@ int MCBitmap::CountColorByIndex(int x, int y, int index) const
 const C64Color* MCBitmap::GetColor(int x, int y) const
 {
     if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
-    {
-        return m_aMCBlock[y / MCBLOCK_HEIGHT][x / MCBLOCK_WIDTH].
-                GetPixel(x % MCBLOCK_WIDTH, y % MCBLOCK_HEIGHT);
-    }
+        return C64Color::GetPaletteColor(GetColorNumber(x, y));
     else
         return &black;
 }
 
 
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ */
+void MCBitmap::GetColorRow(int x, int y, int w, unsigned char* pDest) const
+{
+    unsigned             cell, xPixel, val;
+    const unsigned char* pRow;
+    unsigned char        aColors[4];
+
+    cell   = (y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH;
+    pRow   = m_aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK +
+             y % MCBLOCK_HEIGHT;
+    xPixel = x % MCBLOCK_WIDTH;
+
+    aColors[0] = m_nBackground;
+    while (w > 0)
+    {
+        aColors[1] = m_aScreenRAM[cell] >> 4;
+        aColors[2] = m_aScreenRAM[cell] & 0x0f;
+        aColors[3] = m_aColorRAM[cell];
+
+        val = *pRow;
+        for (; xPixel < MCBLOCK_WIDTH && w > 0; ++xPixel, --w)
+            *pDest++ = aColors[(val >> (2 * (MCBLOCK_WIDTH - 1 - xPixel))) &
+                               0x03];
+
+        xPixel = 0;
+        ++cell;
+        pRow += MCBITMAP_BYTES_PER_BLOCK;
+    }
+}
+
+
 /*****************************************************************************/
 void MCBitmap::SetBackground(C64Color col)
 {
-    int x;
-    for (x = 0; x < MCBITMAP_XBLOCKS * MCBITMAP_YBLOCKS; ++x)
-        m_aMCBlock[0][x].SetIndexedColor(0, col);
+    m_nBackground = (unsigned char) col.GetColor();
 
     // this may change the whole bitmap
     Dirty(0, 0, MC_X, MC_Y);
@@ -175,78 +203,220 @@ void MCBitmap::SetBackground(C64Color col)
 /*****************************************************************************/
 unsigned char MCBitmap::GetBackground() const
 {
-    return (unsigned char) m_aMCBlock[0][0].GetIndexedColor(0)->GetColor();
+    return m_nBackground;
 }
 
 /*****************************************************************************/
 void MCBitmap::SetScreenRAM(unsigned offset, unsigned char val)
 {
-    C64Color col;
-
-    col.SetColor((val >> 4) & 0x0f);
-    m_aMCBlock[0][offset].SetIndexedColor(1, col);
-
-    col.SetColor(val & 0x0f);
-    m_aMCBlock[0][offset].SetIndexedColor(2, col);
+    m_aScreenRAM[offset] = val;
 }
 
 /*****************************************************************************/
 unsigned char MCBitmap::GetScreenRAM(unsigned offset) const
 {
-    unsigned char v;
-
-    v  = m_aMCBlock[0][offset].GetIndexedColor(1)->GetColor() << 4;
-    v |= m_aMCBlock[0][offset].GetIndexedColor(2)->GetColor();
-    return v;
+    return m_aScreenRAM[offset];
 }
 
 /*****************************************************************************/
 void MCBitmap::SetColorRAM(unsigned offset, unsigned char val)
 {
-    C64Color col;
-
-    col.SetColor(val & 0x0f);
-    m_aMCBlock[0][offset].SetIndexedColor(3, col);
+    m_aColorRAM[offset] = val & 0x0f;
 }
 
 /*****************************************************************************/
 unsigned char MCBitmap::GetColorRAM(unsigned offset) const
 {
-    unsigned char v;
-
-    v = m_aMCBlock[0][offset].GetIndexedColor(3)->GetColor();
-    return v;
+    return m_aColorRAM[offset];
 }
 
 /*****************************************************************************/
 void MCBitmap::SetBitmapRAM(unsigned offset, unsigned char val)
 {
-    m_aMCBlock[0][offset / MCBITMAP_BYTES_PER_BLOCK].SetBitmapRAM(
-        offset % MCBITMAP_BYTES_PER_BLOCK, val);
+    unsigned cell = offset / MCBITMAP_BYTES_PER_BLOCK;
+
+    MCBlock::CountBitmapByte(m_aUsage[cell], m_aBitmapRAM[offset], -1);
+    MCBlock::CountBitmapByte(m_aUsage[cell], val, 1);
+    m_aBitmapRAM[offset] = val;
 }
 
 /*****************************************************************************/
-unsigned char MCBitmap::GetBitmapRAM(unsigned offset)
+unsigned char MCBitmap::GetBitmapRAM(unsigned offset) const
 {
     //ASSERT (offset < MCBITMAP_XBLOCKS * MCBITMAP_YBLOCKS * MCBITMAP_BYTES_PER_BLOCK);
 
-    return m_aMCBlock[0][offset / MCBITMAP_BYTES_PER_BLOCK].GetBitmapRAM(
-         offset % MCBITMAP_BYTES_PER_BLOCK);
+    return m_aBitmapRAM[offset];
 }
 
 /*****************************************************************************/
-/*
- * Get a const reference to the block containing the given coordinates.
- * Return NULL if the coordinates are out of range
+/**
+ * Copy nRows bitmap bytes in VIC order into this image, starting at the
+ * first one. Each byte is one row of 4 pixels of a cell. Usually nRows is
+ * 8000 to set the complete bitmap.
  */
-const MCBlock* MCBitmap::GetMCBlock(unsigned x, unsigned y) const
+void MCBitmap::SetBitmapRows(const uint8_t* pSrc, size_t nRows)
 {
-    if ((x < GetWidth()) && (y < GetHeight()))
-    {
-        return &(m_aMCBlock[y / MCBLOCK_HEIGHT][x / MCBLOCK_WIDTH]);
-    }
-    else
-        return NULL;
+    unsigned cell;
+
+    if (nRows > sizeof(m_aBitmapRAM))
+        nRows = sizeof(m_aBitmapRAM);
+
+    memcpy(m_aBitmapRAM, pSrc, nRows);
+
+    for (cell = 0; cell * MCBITMAP_BYTES_PER_BLOCK < nRows; ++cell)
+        CountUsage(cell);
+}
+
+/*****************************************************************************/
+/**
+ * Copy the first nRows bitmap bytes in VIC order to pDest.
+ */
+void MCBitmap::GetBitmapRows(uint8_t* pDest, size_t nRows) const
+{
+    if (nRows > sizeof(m_aBitmapRAM))
+        nRows = sizeof(m_aBitmapRAM);
+
+    memcpy(pDest, m_aBitmapRAM, nRows);
+}
+
+/*****************************************************************************/
+/**
+ * Copy a complete screen RAM (1000 bytes) into this image.
+ */
+void MCBitmap::SetScreenRAM(const unsigned char* pSrc)
+{
+    memcpy(m_aScreenRAM, pSrc, sizeof(m_aScreenRAM));
+}
+
+/*****************************************************************************/
+/**
+ * Copy the complete screen RAM (1000 bytes) to pDest.
+ */
+void MCBitmap::GetScreenRAM(unsigned char* pDest) const
+{
+    memcpy(pDest, m_aScreenRAM, sizeof(m_aScreenRAM));
+}
+
+/*****************************************************************************/
+/**
+ * Copy a complete color RAM (1000 bytes) into this image. The upper nibbles
+ * are not connected on a real C64, so we ignore them.
+ */
+void MCBitmap::SetColorRAM(const unsigned char* pSrc)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(m_aColorRAM); ++i)
+        m_aColorRAM[i] = pSrc[i] & 0x0f;
+}
+
+/*****************************************************************************/
+/**
+ * Copy the complete color RAM (1000 bytes) to pDest.
+ */
+void MCBitmap::GetColorRAM(unsigned char* pDest) const
+{
+    memcpy(pDest, m_aColorRAM, sizeof(m_aColorRAM));
+}
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: 8 bytes bitmap,
+ * one byte screen RAM and one byte color RAM.
+ */
+unsigned MCBitmap::GetCellDataSize() const
+{
+    return MCBITMAP_BYTES_PER_BLOCK + 2;
+}
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid.
+ */
+void MCBitmap::GetCellData(int xCell, int yCell, unsigned char* pData) const
+{
+    unsigned cell = yCell * MCBITMAP_XBLOCKS + xCell;
+
+    memcpy(pData, m_aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK,
+           MCBITMAP_BYTES_PER_BLOCK);
+    pData[MCBITMAP_BYTES_PER_BLOCK]     = m_aScreenRAM[cell];
+    pData[MCBITMAP_BYTES_PER_BLOCK + 1] = m_aColorRAM[cell];
+}
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ */
+void MCBitmap::SetCellData(int xCell, int yCell, const unsigned char* pData)
+{
+    unsigned cell = yCell * MCBITMAP_XBLOCKS + xCell;
+
+    memcpy(m_aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK, pData,
+           MCBITMAP_BYTES_PER_BLOCK);
+    m_aScreenRAM[cell] = pData[MCBITMAP_BYTES_PER_BLOCK];
+    m_aColorRAM[cell]  = pData[MCBITMAP_BYTES_PER_BLOCK + 1] & 0x0f;
+    CountUsage(cell);
+
+    Dirty(xCell * MCBLOCK_WIDTH, yCell * MCBLOCK_HEIGHT,
+          MCBLOCK_WIDTH, MCBLOCK_HEIGHT);
+}
+
+/*****************************************************************************/
+/**
+ * The only global data of a multicolor bitmap is the background color.
+ */
+unsigned MCBitmap::GetGlobalDataSize() const
+{
+    return 1;
+}
+
+/*****************************************************************************/
+/**
+ * Store the background color in pData[0].
+ */
+void MCBitmap::GetGlobalData(unsigned char* pData) const
+{
+    pData[0] = m_nBackground;
+}
+
+/*****************************************************************************/
+/**
+ * Set the background color from pData[0].
+ */
+void MCBitmap::SetGlobalData(const unsigned char* pData)
+{
+    if (pData[0] != m_nBackground)
+        SetBackground(C64Color(pData[0] & 0x0f));
+}
+
+/*****************************************************************************/
+/**
+ * Fill aHistogram with the number of pixels of each of the 16 colors in the
+ * given cell. This is taken from the usage counters, so it is cheap.
+ */
+void MCBitmap::GetCellHistogram(unsigned cell, unsigned* aHistogram) const
+{
+    memset(aHistogram, 0, 16 * sizeof(unsigned));
+    aHistogram[m_nBackground]             += m_aUsage[cell][0];
+    aHistogram[m_aScreenRAM[cell] >> 4]   += m_aUsage[cell][1];
+    aHistogram[m_aScreenRAM[cell] & 0x0f] += m_aUsage[cell][2];
+    aHistogram[m_aColorRAM[cell]]         += m_aUsage[cell][3];
+}
+
+/*****************************************************************************/
+/**
+ * Count the pixels of each color index in the given cell from scratch.
+ */
+void MCBitmap::CountUsage(unsigned cell)
+{
+    unsigned y;
+
+    memset(m_aUsage[cell], 0, sizeof(m_aUsage[cell]));
+    for (y = 0; y < MCBITMAP_BYTES_PER_BLOCK; ++y)
+        MCBlock::CountBitmapByte(m_aUsage[cell],
+            m_aBitmapRAM[cell * MCBITMAP_BYTES_PER_BLOCK + y], 1);
 }
 
 /*****************************************************************************
@@ -256,13 +426,10 @@ const MCBlock* MCBitmap::GetMCBlock(unsigned x, unsigned y) const
 void MCBitmap::SetPixel(int x, int y,
                         const C64Color& col, MCDrawingMode mode)
 {
-    MCBlock* pBlock;
-
     if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
     {
-        pBlock = &(m_aMCBlock[y / MCBLOCK_HEIGHT][x / MCBLOCK_WIDTH]);
-        pBlock->SetPixel(x % MCBLOCK_WIDTH, y % MCBLOCK_HEIGHT,
-                         col, mode);
+        GetMCBlock(x, y).SetPixel(x % MCBLOCK_WIDTH, y % MCBLOCK_HEIGHT,
+                                  col, mode);
 
         // this may change the whole block
         Dirty(x & ~(MCBLOCK_WIDTH - 1), y & ~(MCBLOCK_HEIGHT - 1),
@@ -26,6 +26,9 @@
 #ifndef MCBITMAP_H
 #define MCBITMAP_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "MCBlock.h"
 #include "ToolBase.h"
 #include "BitmapBase.h"
@@ -37,7 +40,15 @@
 
 #define MCBITMAP_XBLOCKS (MC_X / 4)
 #define MCBITMAP_YBLOCKS (MC_Y / 8)
-
+#define MCBITMAP_NBLOCKS (MCBITMAP_XBLOCKS * MCBITMAP_YBLOCKS)
+
+/*****************************************************************************/
+/**
+ * A multicolor bitmap. The data is stored exactly like the VIC sees it:
+ * 8000 bytes bitmap, 1000 bytes screen RAM, 1000 bytes color RAM and the
+ * background color. So the whole image fits into about 10 kBytes and can be
+ * copied, loaded and saved with plain memcpy operations.
+ */
 class MCBitmap : public BitmapBase
 {
 public:
@@ -57,9 +68,21 @@ public:
     virtual int CountColorByIndex(int x, int y, int index) const;
 
     virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
     virtual void SetPixel(int x, int y, const C64Color& col,
                           MCDrawingMode mode = MCDrawingModeIgnore);
 
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
+    virtual unsigned GetGlobalDataSize() const;
+    virtual void GetGlobalData(unsigned char* pData) const;
+    virtual void SetGlobalData(const unsigned char* pData);
+
     void SetBackground(C64Color col);
     unsigned char GetBackground() const;
 
@@ -70,14 +93,123 @@ public:
     unsigned char GetColorRAM(unsigned offset) const;
 
     void SetBitmapRAM(unsigned offset, unsigned char val);
-    unsigned char GetBitmapRAM(unsigned offset);
+    unsigned char GetBitmapRAM(unsigned offset) const;
+
+    void SetBitmapRows(const uint8_t* pSrc, size_t nRows);
+    void GetBitmapRows(uint8_t* pDest, size_t nRows) const;
+    void SetScreenRAM(const unsigned char* pSrc);
+    void GetScreenRAM(unsigned char* pDest) const;
+    void SetColorRAM(const unsigned char* pSrc);
+    void GetColorRAM(unsigned char* pDest) const;
 
-    const MCBlock* GetMCBlock(unsigned x, unsigned y) const;
+    const unsigned char* GetBitmapRAMData() const;
+    const unsigned char* GetScreenRAMData() const;
+    const unsigned char* GetColorRAMData() const;
+    void GetCellHistogram(unsigned cell, unsigned* aHistogram) const;
+
+    MCBlock GetMCBlock(unsigned x, unsigned y);
+    const MCBlock GetMCBlock(unsigned x, unsigned y) const;
 
     static const C64Color black;
 
 protected:
-    MCBlock m_aMCBlock[MCBITMAP_YBLOCKS][MCBITMAP_XBLOCKS];
+    int GetColorNumber(unsigned x, unsigned y) const;
+    void CountUsage(unsigned cell);
+
+    /// Bitmap RAM, 8 bytes per cell, in VIC order
+    unsigned char m_aBitmapRAM[MCBITMAP_NBLOCKS * MCBITMAP_BYTES_PER_BLOCK];
+
+    /// Screen RAM, upper nibble is index 1, lower nibble is index 2
+    unsigned char m_aScreenRAM[MCBITMAP_NBLOCKS];
+
+    /// Color RAM, only the lower nibble is used, it's index 3
+    unsigned char m_aColorRAM[MCBITMAP_NBLOCKS];
+
+    /// Background color, index 0 of all cells
+    unsigned char m_nBackground;
+
+    /// Number of pixels using each color index, for each cell
+    unsigned char m_aUsage[MCBITMAP_NBLOCKS][4];
 };
 
+
+/*****************************************************************************/
+/**
+ * Return the C64 color number of the pixel x/y. The coordinates must be
+ * valid.
+ */
+inline int MCBitmap::GetColorNumber(unsigned x, unsigned y) const
+{
+    unsigned cell  = (y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH;
+    unsigned index = (m_aBitmapRAM[cell * MCBITMAP_BYTES_PER_BLOCK +
+                                   y % MCBLOCK_HEIGHT] >>
+                      (2 * (MCBLOCK_WIDTH - 1 - x % MCBLOCK_WIDTH))) & 0x03;
+
+    switch (index)
+    {
+    case 0:
+        return m_nBackground;
+    case 1:
+        return m_aScreenRAM[cell] >> 4;
+    case 2:
+        return m_aScreenRAM[cell] & 0x0f;
+    default:
+        return m_aColorRAM[cell];
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Get a view on the block containing the given coordinates. The coordinates
+ * must be valid.
+ */
+inline MCBlock MCBitmap::GetMCBlock(unsigned x, unsigned y)
+{
+    unsigned cell = (y / MCBLOCK_HEIGHT) * MCBITMAP_XBLOCKS + x / MCBLOCK_WIDTH;
+
+    return MCBlock(this, m_aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK,
+                   m_aScreenRAM + cell, m_aColorRAM + cell, &m_nBackground,
+                   m_aUsage[cell]);
+}
+
+
+/*****************************************************************************/
+/**
+ * Get a read-only view on the block containing the given coordinates. The
+ * coordinates must be valid.
+ */
+inline const MCBlock MCBitmap::GetMCBlock(unsigned x, unsigned y) const
+{
+    return const_cast<MCBitmap*>(this)->GetMCBlock(x, y);
+}
+
+/*****************************************************************************/
+/**
+ * Return a pointer to the bitmap RAM (8000 bytes) for direct reading, e.g.
+ * by encoders which don't want to copy it.
+ */
+inline const unsigned char* MCBitmap::GetBitmapRAMData() const
+{
+    return m_aBitmapRAM;
+}
+
+/*****************************************************************************/
+/**
+ * Return a pointer to the screen RAM (1000 bytes) for direct reading.
+ */
+inline const unsigned char* MCBitmap::GetScreenRAMData() const
+{
+    return m_aScreenRAM;
+}
+
+/*****************************************************************************/
+/**
+ * Return a pointer to the color RAM (1000 bytes) for direct reading.
+ */
+inline const unsigned char* MCBitmap::GetColorRAMData() const
+{
+    return m_aColorRAM;
+}
+
 #endif
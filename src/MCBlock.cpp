@@ -27,23 +27,31 @@
 #include "MCBlock.h"
 #include "MCBitmap.h"
 
-/*****************************************************************************/
-MCBlock::MCBlock() :
-    m_pParent(NULL)
-{
-    memset(m_aBitmap, 0, sizeof(m_aBitmap));
-    m_c64Color[0].SetColor(MC_BLACK);
-    m_c64Color[1].SetColor(MC_BLACK);
-    m_c64Color[2].SetColor(MC_BLACK);
-    m_c64Color[3].SetColor(MC_BLACK);
-}
-
 
 /*****************************************************************************/
+/**
+ * Set the color for the given index. Index 0 is the background color, which
+ * is shared by all blocks of the bitmap.
+ */
 void MCBlock::SetIndexedColor(int index, C64Color col)
 {
-    if (index < 4)
-        m_c64Color[index] = col;
+    unsigned char c = (unsigned char) col.GetColor();
+
+    switch (index)
+    {
+    case 0:
+        *m_pBackground = c;
+        break;
+    case 1:
+        *m_pScreen = (*m_pScreen & 0x0f) | (c << 4);
+        break;
+    case 2:
+        *m_pScreen = (*m_pScreen & 0xf0) | c;
+        break;
+    case 3:
+        *m_pColor = c;
+        break;
+    }
 }
 
 
@@ -51,62 +59,57 @@ void MCBlock::SetIndexedColor(int index, C64Color col)
 const C64Color* MCBlock::GetIndexedColor(int index) const
 {
     if (index < 4)
-        return &m_c64Color[index];
+        return C64Color::GetPaletteColor(GetIndexedColorNumber(index));
     else
         return NULL;
 }
 
 
 /*****************************************************************************/
+/**
+ * Return the number of pixels in this block which use the given index.
+ */
 int MCBlock::CountIndexedColor(int index) const
 {
-    int i, cnt = 0;
-
-    for (i = 0; i < MCBLOCK_WIDTH * MCBLOCK_HEIGHT; ++i)
-        if (m_aBitmap[0][i] == index) ++cnt;
-    return cnt;
+    if (index < 4)
+        return m_pUsage[index];
+    else
+        return 0;
 }
 
 
 /*****************************************************************************/
 void MCBlock::SetBitmapPixel(unsigned x, unsigned y, int index)
 {
+    unsigned shift;
+
     if ((x < MCBLOCK_WIDTH) && (y < MCBLOCK_HEIGHT) &&
         (index < 4))
     {
-        m_aBitmap[y][x] = index;
+        shift = 2 * (MCBLOCK_WIDTH - 1 - x);
+        --m_pUsage[GetBitmapPixel(x, y)];
+        ++m_pUsage[index];
+        m_pBitmap[y] = (m_pBitmap[y] & ~(0x03 << shift)) | (index << shift);
     }
 }
 
 /*****************************************************************************/
 void MCBlock::SetBitmapRAM(unsigned y, unsigned char val)
 {
-    int x;
-
     if (y < MCBLOCK_HEIGHT)
     {
-        for (x = 0; x < MCBLOCK_WIDTH; ++x)
-        {
-            SetBitmapPixel(x, y,
-                ((val >> (2 * (MCBLOCK_WIDTH - x - 1))) & 0x03));
-        }
+        CountBitmapByte(m_pUsage, m_pBitmap[y], -1);
+        CountBitmapByte(m_pUsage, val, 1);
+        m_pBitmap[y] = val;
     }
 }
 
 /*****************************************************************************/
 unsigned char MCBlock::GetBitmapRAM(unsigned y) const
 {
-    unsigned char v;
-    int x;
-
     //ASSERT (y < MCBLOCK_HEIGHT);
 
-    v = 0;
-    for (x = 0; x < MCBLOCK_WIDTH; ++x)
-    {
-        v |= m_aBitmap[y][x] << 2 * (MCBLOCK_WIDTH - x - 1);
-    }
-    return v;
+    return m_pBitmap[y];
 }
 
 
@@ -135,23 +138,24 @@ void MCBlock::SetPixel(unsigned x, unsigned y,
         else
             SetIndexedColor(i, col);
 
-        m_aBitmap[y][x] = i;
+        SetBitmapPixel(x, y, i);
         return;
     }
 
     /* Die vorhandenen Farben durchgehen und nachsehen, ob geeignet */
     /* HG-Farbe immer verwenden, wenn moeglich */
-    if (m_c64Color[0] == col)
+    if (GetIndexedColorNumber(0) == col.GetColor())
     {
-        m_aBitmap[y][x] = 0;
+        SetBitmapPixel(x, y, 0);
         return;
     }
     /* Dann alle benutzte Farben durchgehen */
     for (i = 1; i < 4; ++i)
     {
-        if ((CountIndexedColor(i) != 0) && (m_c64Color[i] == col))
+        if ((CountIndexedColor(i) != 0) &&
+            (GetIndexedColorNumber(i) == col.GetColor()))
         {
-            m_aBitmap[y][x] = i;
+            SetBitmapPixel(x, y, i);
             return;
         }
     }
@@ -160,8 +164,8 @@ void MCBlock::SetPixel(unsigned x, unsigned y,
     {
         if (CountIndexedColor(i) == 0)
         {
-            m_aBitmap[y][x] = i;
-            m_c64Color[i] = col;
+            SetBitmapPixel(x, y, i);
+            SetIndexedColor(i, col);
             return;
         }
     }
@@ -172,9 +176,9 @@ void MCBlock::SetPixel(unsigned x, unsigned y,
     if (mode == MCDrawingModeForce)
     {
         /* Diese Farbe ersetzen */
-        i = m_aBitmap[y][x];
+        i = GetBitmapPixel(x, y);
         if (i != 0)
-            m_c64Color[i] = col;
+            SetIndexedColor(i, col);
         else
         {
             // Sonderfall: Die Hintergrundfarbe ist fest, hier muessen wir auf
@@ -191,8 +195,8 @@ void MCBlock::SetPixel(unsigned x, unsigned y,
             i = 2;
         if (CountIndexedColor(3) < CountIndexedColor(1))
             i = 3;
-        m_aBitmap[y][x] = i;
-        m_c64Color[i] = col;
+        SetBitmapPixel(x, y, i);
+        SetIndexedColor(i, col);
     }
     return;
 }
@@ -35,19 +35,33 @@
 
 class MCBitmap;
 
-
+/*****************************************************************************/
+/**
+ * An MCBlock is a light-weight view on one 4x8 cell of an MCBitmap. It does
+ * not own any data but works on the VIC memory layout of its parent: 8
+ * bitmap bytes, one screen RAM byte, one color RAM byte and the background
+ * color shared by all cells.
+ *
+ * Color index 0 is the background, 1 and 2 are the upper and lower nibble
+ * of screen RAM and 3 is color RAM.
+ *
+ * The parent also keeps the number of pixels using each color index per
+ * cell. They are updated by all functions which write the bitmap, so
+ * CountIndexedColor is just a lookup.
+ */
 class MCBlock
 {
 public:
-    MCBlock();
-
-    void SetParent(MCBitmap* pParent);
+    MCBlock(MCBitmap* pParent, unsigned char* pBitmap,
+            unsigned char* pScreen, unsigned char* pColor,
+            unsigned char* pBackground, unsigned char* pUsage);
 
     void SetIndexedColor(int index, C64Color col);
     const C64Color* GetIndexedColor(int index) const;
     int CountIndexedColor(int index) const;
 
     void SetBitmapPixel(unsigned x, unsigned y, int index);
+    int GetBitmapPixel(unsigned x, unsigned y) const;
 
     void SetBitmapRAM(unsigned y, unsigned char val);
     unsigned char GetBitmapRAM(unsigned y) const;
@@ -57,29 +71,95 @@ public:
 
     const C64Color* GetPixel(unsigned x, unsigned y) const;
 
+    static void CountBitmapByte(unsigned char* pUsage, unsigned char val,
+                                int n);
+
 protected:
-    C64Color m_c64Color[4];
-    unsigned char m_aBitmap[MCBLOCK_HEIGHT][MCBLOCK_WIDTH];
-    MCBitmap* m_pParent;
+    int GetIndexedColorNumber(int index) const;
+
+    MCBitmap*      m_pParent;
+    unsigned char* m_pBitmap;
+    unsigned char* m_pScreen;
+    unsigned char* m_pColor;
+    unsigned char* m_pBackground;
+
+    /// Number of pixels using each of the 4 color indexes
+    unsigned char* m_pUsage;
 };
 
+
 /*****************************************************************************/
 /**
- * Return the color of the given position. The caller must make sure that
- * the coordinates are valid.
+ * Create a block which works on the bitmap, screen and color RAM bytes of
+ * one cell of pParent. The block does not own this memory.
  */
-inline const C64Color* MCBlock::GetPixel(unsigned x, unsigned y) const
+inline MCBlock::MCBlock(MCBitmap* pParent, unsigned char* pBitmap,
+                        unsigned char* pScreen, unsigned char* pColor,
+                        unsigned char* pBackground, unsigned char* pUsage) :
+    m_pParent(pParent),
+    m_pBitmap(pBitmap),
+    m_pScreen(pScreen),
+    m_pColor(pColor),
+    m_pBackground(pBackground),
+    m_pUsage(pUsage)
 {
-    return &(m_c64Color[m_aBitmap[y][x]]);
 }
 
+
 /*****************************************************************************/
 /**
- * Set the owner of this block.
+ * Return the color index (0..3) of the pixel x/y in this block.
  */
-inline void MCBlock::SetParent(MCBitmap* pParent)
+inline int MCBlock::GetBitmapPixel(unsigned x, unsigned y) const
+{
+    return (m_pBitmap[y] >> (2 * (MCBLOCK_WIDTH - 1 - x))) & 0x03;
+}
+
+
+/*****************************************************************************/
+/**
+ * Add n to the usage counters in pUsage for each of the 4 pixels in the
+ * bitmap byte val. Use n = -1 to remove a byte.
+ */
+inline void MCBlock::CountBitmapByte(unsigned char* pUsage, unsigned char val,
+                                     int n)
+{
+    pUsage[val & 0x03]        += n;
+    pUsage[(val >> 2) & 0x03] += n;
+    pUsage[(val >> 4) & 0x03] += n;
+    pUsage[val >> 6]          += n;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the C64 color number (0..15) used for the given color index.
+ */
+inline int MCBlock::GetIndexedColorNumber(int index) const
+{
+    switch (index)
+    {
+    case 0:
+        return *m_pBackground;
+    case 1:
+        return *m_pScreen >> 4;
+    case 2:
+        return *m_pScreen & 0x0f;
+    default:
+        return *m_pColor & 0x0f;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the color of the given position. The caller must make sure that
+ * the coordinates are valid.
+ */
+inline const C64Color* MCBlock::GetPixel(unsigned x, unsigned y) const
 {
-    m_pParent = pParent;
+    return C64Color::GetPaletteColor(
+            GetIndexedColorNumber(GetBitmapPixel(x, y)));
 }
 
 #endif
@@ -59,11 +59,13 @@ MCBlockPanel::~MCBlockPanel()
 /*****************************************************************************/
 /**
  * This is called when the document contents has changed, the parameters
- * report the area to be updated. Coordinates are in bitmap space.
+ * report the area to be updated. Coordinates are in bitmap space. The block
+ * is refreshed by the timer, like when the mouse has been moved.
  */
 void MCBlockPanel::RedrawDoc(int x1, int y1, int x2, int y2)
 {
-    Refresh(false);
+    if (!m_timerRefresh.IsRunning())
+        m_timerRefresh.Start(MCBLOCKPANEL_UPDATE_INTERVAL, wxTIMER_ONE_SHOT);
 }
 
 
@@ -54,6 +54,7 @@ MCCanvas::MCCanvas(wxWindow* pParent, int nStyle) :
     m_pointNextMousePos(-1, -1),
     m_timerScrolling(this, MCCANVAS_SCROLL_TIMER_ID),
     m_timerRefresh(this, MCCANVAS_REFRESH_TIMER_ID),
+    m_timerRedraw(this, MCCANVAS_REDRAW_TIMER_ID),
     m_bDragScrollActive(false),
     m_pointDragScrollStart(0, 0),
     m_xDragScrollStart(0),
@@ -95,32 +96,52 @@ MCCanvas::MCCanvas(wxWindow* pParent, int nStyle) :
  * It may by possible that x1 == x2 or y1 == y2 and it may be larger than
  * the actual image.
  *
- * We must force a redraw immediately, otherwise it may take a while
- * until we get to the event loop again
- *
+ * The area is only collected here. All areas changed during one frame are
+ * redrawn together when the redraw timer expires, so we don't paint for each
+ * mouse event or pixel drawn.
  */
 void MCCanvas::RedrawDoc(int x1, int y1, int x2, int y2)
 {
+    if (m_pDoc)
+    {
+        AddDirtyRect(x1, y1, x2, y2);
+        if (!m_timerRedraw.IsRunning())
+            m_timerRedraw.Start(DOCRENDERER_REDRAW_INTERVAL, wxTIMER_ONE_SHOT);
+    }
+    else
+        Refresh(false);
+}
+
+
+/*****************************************************************************/
+/**
+ * Invalidate the areas collected by RedrawDoc, they will be painted when
+ * we get to the event loop again.
+ */
+void MCCanvas::RefreshDirtyRects()
+{
+    std::vector<wxRect> aRects;
+    std::vector<wxRect>::const_iterator i;
     wxRect      rect;
     BitmapBase* pB;
 
-    if (m_pDoc)
+    if (!m_pDoc)
+        return;
+
+    pB = m_pDoc->GetBitmap();
+    TakeDirtyRects(&aRects);
+    for (i = aRects.begin(); i != aRects.end(); ++i)
     {
         // Calculate the rectangle to be redrawn in screen coordinates
-        ToCanvasCoord(&rect.x, &rect.y, x1, y1);
-        pB = m_pDoc->GetBitmap();
+        ToCanvasCoord(&rect.x, &rect.y, i->x, i->y);
 
-        // x2 = x1 is a rect with width = 1, that's why + 1
-        // 2 extra pixels to b e refreshed in x direction because of TV emulation
-        rect.SetWidth ((x2 - x1 + 3) * pB->GetPixelXFactor() * m_nZoom);
-        rect.SetHeight((y2 - y1 + 1) * pB->GetPixelYFactor() * m_nZoom);
+        // the TV emulation smears the change into the pixels to the right
+        rect.SetWidth ((i->width + (m_bEmulateTV ? GetTVMargin(m_nZoom) : 0)) *
+                       pB->GetPixelXFactor() * m_nZoom);
+        rect.SetHeight(i->height * pB->GetPixelYFactor() * m_nZoom);
 
         RefreshRect(rect, false);
     }
-    else
-        Refresh(false);
-
-    Update();
 }
 
 /*****************************************************************************/
@@ -151,15 +172,20 @@ void MCCanvas::SetDoc(DocBase* pDoc)
 
     if (pDoc)
     {
-        // set min size incl. borders
+        // set min size incl. borders, large canvases are scrolled instead
         pB = pDoc->GetBitmap();
         wxSize size(GetWindowBorderSize());
-        size.IncBy(pB->GetPixelXFactor() * pB->GetWidth(),
-                   pB->GetPixelYFactor() * pB->GetHeight());
+        size.IncBy(wxMin(pB->GetPixelXFactor() * pB->GetWidth(),
+                         MCCANVAS_MAX_MIN_WIDTH),
+                   wxMin(pB->GetPixelYFactor() * pB->GetHeight(),
+                         MCCANVAS_MAX_MIN_HEIGHT));
         SetMinSize(size);
     }
 
     DocRenderer::SetDoc(pDoc);
+
+    // update the virtual size and the scroll rate for this bitmap
+    SetZoom(m_nZoom);
 }
 
 
@@ -491,7 +517,7 @@ void MCCanvas::StartTool(int x, int y, bool bSecondary)
 
 /*****************************************************************************/
 /**
- * Enable/Disable TV emulation and delete the cache.
+ * Enable/Disable TV emulation and redraw everything.
  */
 void MCCanvas::SetEmulateTV(bool bTV)
 {
@@ -502,7 +528,19 @@ void MCCanvas::SetEmulateTV(bool bTV)
 
 /*****************************************************************************/
 /**
- * Set zoom factor and delete the cache.
+ * Set the filter kernel used for TV emulation.
+ */
+void MCCanvas::SetTVKernel(MCTVFilterKernel kernel)
+{
+    m_tvFilter.SetKernel(kernel);
+    if (m_bEmulateTV)
+        Refresh(false);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set zoom factor and redraw everything.
  */
 void MCCanvas::SetZoom(unsigned nZoom)
 {
@@ -853,4 +891,8 @@ void MCCanvas::OnTimer(wxTimerEvent& event)
         DrawMousePos(&dc, m_pointNextMousePos.x, m_pointNextMousePos.y, m_nZoom);
         m_pointLastMousePos = m_pointNextMousePos;
     }
+    else if (event.GetId() == MCCANVAS_REDRAW_TIMER_ID)
+    {
+        RefreshDirtyRects();
+    }
 }
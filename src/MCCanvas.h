@@ -38,6 +38,7 @@
 
 #define MCCANVAS_SCROLL_TIMER_ID  1
 #define MCCANVAS_REFRESH_TIMER_ID 2
+#define MCCANVAS_REDRAW_TIMER_ID  3
 
 // If we are closer as that many (screen) pixels to the border, we scroll
 #define MCCANVAS_SCROLL_THRESHOLD 48
@@ -48,6 +49,10 @@
 // Scroll interval [ms]
 #define MCCANVAS_SCROLL_INTERVAL 150
 
+// The minimal size of the canvas doesn't grow beyond one C64 screen
+#define MCCANVAS_MAX_MIN_WIDTH  320
+#define MCCANVAS_MAX_MIN_HEIGHT 200
+
 
 class ToolBase;
 class DocBase;
@@ -70,6 +75,7 @@ public:
 
     void SetEmulateTV(bool bTV);
     bool GetEmulateTV();
+    void SetTVKernel(MCTVFilterKernel kernel);
     void SetZoom(unsigned nZoom);
     unsigned GetZoom();
 
@@ -94,6 +100,7 @@ protected:
     void StartTool(int x, int y, bool bSecondary);
     void UpdateCursorPosition(int x, int y, bool bCanvasCoordinates);
     void EndTool(int x, int y);
+    void RefreshDirtyRects();
 
     void OnButtonDown(wxMouseEvent& event);
     void OnMouseMove(wxMouseEvent& event);
@@ -128,6 +135,9 @@ protected:
 
     wxTimer     m_timerRefresh;
 
+    // Runs from the first change of the document until it is redrawn
+    wxTimer     m_timerRedraw;
+
     //// Drag Scrolling
     // true if we are dragging the image for scrolling
     bool        m_bDragScrollActive;
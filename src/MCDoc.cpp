@@ -23,6 +23,7 @@
  * Thomas Giesel skoe@directbox.com
  */
 
+#include <string.h>
 #include <ios>
 #include <iostream>
 #include <wx/wx.h>
@@ -31,6 +32,9 @@
 #include "MCApp.h"
 #include "MCDoc.h"
 #include "DocRenderer.h"
+#include "Cruncher.h"
+#include "BackgroundSearch.h"
+#include "ImageImporter.h"
 
 #define AMICA_SIG_BYTE 0xc2
 
@@ -55,9 +59,17 @@ static FormatInfo::Filter m_aFilters[] =
 {
     { wxT("Koala files"), wxT("*.koa;*.kla") },
     { wxT("Amica files"), wxT("*.ami") },
+    { wxT("Self-decrunching Koala files"), wxT("*.prg") },
     { NULL, NULL }
 };
 
+/**
+ * File sizes and load addresses CheckFormat looks for, terminated by 0.
+ */
+static const unsigned m_aSizes[] = { sizeof(koala_t), 0 };
+static const unsigned m_aLoadAddresses[] =
+    { KOALA_START_ADDR, AMICA_START_ADDR, 0 };
+
 /**
  * Information about this image format.
  */
@@ -66,7 +78,9 @@ FormatInfo MCDoc::m_formatInfo(
     wxT("koa"),
     m_aFilters,
     MCDoc::Factory,
-    MCDoc::CheckFormat);
+    MCDoc::CheckFormat,
+    m_aSizes,
+    m_aLoadAddresses);
 
 
 /******************************************************************************/
@@ -75,7 +89,6 @@ FormatInfo MCDoc::m_formatInfo(
  */
 MCDoc::MCDoc()
     : m_bitmap()
-    , m_bitmapBackup()
 {
     PrepareUndo();
 
@@ -84,7 +97,10 @@ MCDoc::MCDoc()
 
     if (sizeof(koala_t) != 10003)
     {
-        wxMessageBox(wxT("Warning: Koala structure has wrong size. This is not good at all."));
+        ShowMessage(m_fileName.GetFullPath(),
+                    wxT("Warning: Koala structure has wrong size. "
+                        "This is not good at all."),
+                    wxT("Warning"), wxOK | wxICON_WARNING);
     }
 }
 
@@ -104,7 +120,8 @@ DocBase* MCDoc::Factory()
  * Check how good data matches our document format. Return a sum of
  * MC_FORMAT_*_MATCH.
  */
-int MCDoc::CheckFormat(uint8_t* pBuff, unsigned len, const wxFileName& fileName)
+int MCDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                       const wxFileName& fileName)
 {
     uint16_t addr;
     int      match = 0;
@@ -119,6 +136,9 @@ int MCDoc::CheckFormat(uint8_t* pBuff, unsigned len, const wxFileName& fileName)
     if (len == sizeof(koala_t))
         match += MC_FORMAT_SIZE_MATCH;
 
+    if (len < 2)
+        return match;
+
     addr = pBuff[0] + pBuff[1] * 256;
     if (addr == KOALA_START_ADDR ||
         addr == AMICA_START_ADDR)
@@ -155,7 +175,7 @@ void MCDoc::SetBitmap(const BitmapBase* pB)
 /**
  * Try to load the file from the given memory buffer. Return true for success.
  */
-bool MCDoc::Load(uint8_t* pBuff, unsigned size)
+bool MCDoc::Load(const uint8_t* pBuff, unsigned size)
 {
     bool bLoaded = false;
 
@@ -170,20 +190,67 @@ bool MCDoc::Load(uint8_t* pBuff, unsigned size)
 
 /******************************************************************************
  **
- * Save the file to the memory buffer. Return the number of bytes used.
- * The file name is for informational purposes only, e.g. to decide
- * which sub-format to use.
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success. The file name is for informational purposes only, e.g. to
+ * decide which sub-format to use.
  */
-unsigned MCDoc::Save(uint8_t* pBuff, const wxFileName& fileName)
+bool MCDoc::Save(std::vector<uint8_t>* pOut, const wxFileName& fileName)
 {
-    unsigned len = 0;
+    std::vector<uint8_t> aPlain;
 
     if (fileName.GetExt().CmpNoCase(wxT("ami")) == 0)
-        len = SaveAmica(pBuff);
+        return SaveAmica(pOut);
+    else if (fileName.GetExt().CmpNoCase(wxT("prg")) == 0)
+        return SaveKoala(&aPlain) && Cruncher::CrunchPRG(aPlain, pOut);
     else
-        len = SaveKoala(pBuff);
+        return SaveKoala(pOut);
+}
+
+
+/******************************************************************************/
+/**
+ * Convert an image into our bitmap.
+ */
+bool MCDoc::ImportImage(ImageImporter* pImporter)
+{
+    pImporter->ImportMC(&m_bitmap);
+    return true;
+}
+
+
+/******************************************************************************/
+/**
+ * Multicolor bitmaps can get a better background color.
+ */
+bool MCDoc::CanReoptimise() const
+{
+    return true;
+}
+
+
+/******************************************************************************/
+/**
+ * Search the background color which leaves the most color slots free in the
+ * cells and give it to the bitmap. The current background never clashes,
+ * so the pixels keep their colors. Nothing is changed if the current
+ * background is as good as the best one.
+ */
+bool MCDoc::ReoptimiseBitmap()
+{
+    BackgroundSearch search;
+    unsigned         nBest, nCurrent;
+
+    search.AddBitmap(m_bitmap);
+    search.Search();
+
+    nBest    = search.GetBackground();
+    nCurrent = m_bitmap.GetBackground();
+    if (search.GetError(nBest) == search.GetError(nCurrent) &&
+        search.GetSlots(nBest) >= search.GetSlots(nCurrent))
+        return false;
 
-    return len;
+    search.Apply(&m_bitmap);
+    return true;
 }
 
 
@@ -197,29 +264,21 @@ unsigned MCDoc::Save(uint8_t* pBuff, const wxFileName& fileName)
  * nSize        Size
  * return       true if the file has been loaded
  */
-bool MCDoc::LoadKoala(unsigned char* pBuff, unsigned nSize)
+bool MCDoc::LoadKoala(const uint8_t* pBuff, unsigned nSize)
 {
-    koala_t* pKoala;
-    int      i;
+    const koala_t* pKoala;
 
     if (nSize != sizeof(koala_t))
         return false;
 
-    pKoala = (koala_t*) pBuff;
+    pKoala = (const koala_t*) pBuff;
 
     // ignore start addr, 2 bytes
 
-    // bitmap
-    for (i = 0; i < 8000; ++i)
-        m_bitmap.SetBitmapRAM(i, pKoala->bitmap[i]);
-    // screen
-    for (i = 0; i < 1000; ++i)
-        m_bitmap.SetScreenRAM(i, pKoala->scr_ram[i]);
-    // color
-    for (i = 0; i < 1000; ++i)
-        m_bitmap.SetColorRAM(i, pKoala->col_ram[i]);
-    // background
-    m_bitmap.SetBackground(C64Color(pKoala->background));
+    m_bitmap.SetBitmapRows(pKoala->bitmap, sizeof(pKoala->bitmap));
+    m_bitmap.SetScreenRAM(pKoala->scr_ram);
+    m_bitmap.SetColorRAM(pKoala->col_ram);
+    m_bitmap.SetBackground(C64Color(pKoala->background & 0x0f));
 
     return true;
 }
@@ -233,7 +292,7 @@ bool MCDoc::LoadKoala(unsigned char* pBuff, unsigned nSize)
  * nSize        Size
  * return       true if the file has been loaded
  */
-bool MCDoc::LoadAmica(unsigned char* pBuff, unsigned nSize)
+bool MCDoc::LoadAmica(const uint8_t* pBuff, unsigned nSize)
 {
     koala_t        koala;
     unsigned       nRead, nCount, i;
@@ -299,16 +358,15 @@ bool MCDoc::LoadAmica(unsigned char* pBuff, unsigned nSize)
 
     if (p < pEnd)
     {
-        wxMessageBox(wxT("Warning: File too short or damaged"));
+        ShowMessage(m_fileName.GetFullPath(),
+            wxT("Warning: File too short or damaged"), wxT("Load Warning"),
+            wxOK | wxICON_WARNING);
     }
 
-    for (i = 0; i < 8000; ++i)
-        m_bitmap.SetBitmapRAM(i, koala.bitmap[i]);
-    for (i = 0; i < 1000; ++i)
-        m_bitmap.SetScreenRAM(i, koala.scr_ram[i]);
-    for (i = 0; i < 1000; ++i)
-        m_bitmap.SetColorRAM(i, koala.col_ram[i]);
-    m_bitmap.SetBackground(C64Color(koala.background));
+    m_bitmap.SetBitmapRows(koala.bitmap, sizeof(koala.bitmap));
+    m_bitmap.SetScreenRAM(koala.scr_ram);
+    m_bitmap.SetColorRAM(koala.col_ram);
+    m_bitmap.SetBackground(C64Color(koala.background & 0x0f));
 
     return true;
 }
@@ -316,127 +374,160 @@ bool MCDoc::LoadAmica(unsigned char* pBuff, unsigned nSize)
 /******************************************************************************
  * Save a koala file image into the given buffer.
  *
- * Return the number of bytes used in this buffer. The image includes the first
- * two bytes which form the load address of an PRG file.
- * If there's something wrong, return 0
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
  */
-int MCDoc::SaveKoala(unsigned char* pBuff)
+bool MCDoc::SaveKoala(std::vector<uint8_t>* pOut)
 {
-    unsigned char* p = pBuff;
-    int i;
-
-    // start addr
-    *p++ = KOALA_START_ADDR % 0x100;
-    *p++ = KOALA_START_ADDR / 0x100;
-
-    // bitmap
-    for (i = 0; i < 8000; i++)
-        *p++ = m_bitmap.GetBitmapRAM(i);
+    koala_t* pKoala;
 
-    // screen
-    for (i = 0; i < 1000; i++)
-        *p++ = m_bitmap.GetScreenRAM(i);
+    pOut->resize(sizeof(koala_t));
+    pKoala = (koala_t*) &(*pOut)[0];
 
-    // color
-    for (i = 0; i < 1000; i++)
-        *p++ = m_bitmap.GetColorRAM(i);
+    // start addr
+    pKoala->ptr[0] = KOALA_START_ADDR % 0x100;
+    pKoala->ptr[1] = KOALA_START_ADDR / 0x100;
 
-    // background
-    *p++ = m_bitmap.GetBackground();
+    m_bitmap.GetBitmapRows(pKoala->bitmap, sizeof(pKoala->bitmap));
+    m_bitmap.GetScreenRAM(pKoala->scr_ram);
+    m_bitmap.GetColorRAM(pKoala->col_ram);
+    pKoala->background = m_bitmap.GetBackground();
 
-    return p - pBuff;
+    return true;
 }
 
-/******************************************************************************
+/******************************************************************************/
+/**
  * Save a Amica file image into the given buffer.
  *
- * Return the number of bytes used in this buffer. The image includes the first
- * two bytes which form the load address of an PRG file.
- * If there's something wrong, return 0
+ * The image includes the first two bytes which form the load address of a
+ * PRG file. Return false if there's something wrong.
+ *
+ * The data is encoded directly from the bitmap in the order of a Koala file.
+ * Runs may continue from one memory area into the next one.
  */
-int MCDoc::SaveAmica(unsigned char* pBuff)
+bool MCDoc::SaveAmica(std::vector<uint8_t>* pOut)
 {
-    unsigned       nPos;
-    unsigned       nVal, nCount, nNext;
-    unsigned char* p;
-    unsigned char* pSource;
-
-    // make it easy for me and create a koala buffer first
-    pSource = new unsigned char[MC_MAX_FILE_BUFF_SIZE];
-    if (SaveKoala(pSource) != sizeof(koala_t))
-    {
-        delete[] pSource;
-        return 0;
-    }
+    const uint8_t* aAreas[4];
+    unsigned       aAreaSizes[4];
+    const uint8_t* p;
+    const uint8_t* pEnd;
+    uint8_t        nBackground;
+    unsigned       nArea, nRun, nCount;
+    uint8_t        nVal;
+
+    nBackground = m_bitmap.GetBackground();
+
+    aAreas[0]     = m_bitmap.GetBitmapRAMData();
+    aAreaSizes[0] = sizeof(((koala_t*) 0)->bitmap);
+    aAreas[1]     = m_bitmap.GetScreenRAMData();
+    aAreaSizes[1] = sizeof(((koala_t*) 0)->scr_ram);
+    aAreas[2]     = m_bitmap.GetColorRAMData();
+    aAreaSizes[2] = sizeof(((koala_t*) 0)->col_ram);
+    aAreas[3]     = &nBackground;
+    aAreaSizes[3] = 1;
 
     // save start address
-    p = pBuff;
-    *p++ = AMICA_START_ADDR % 0x100;
-    *p++ = AMICA_START_ADDR / 0x100;
-
-    // start reading behind the loading address of the koala buffer
-    nPos = 2;
+    pOut->clear();
+    pOut->push_back(AMICA_START_ADDR % 0x100);
+    pOut->push_back(AMICA_START_ADDR / 0x100);
 
-    // get the first byte
-    nVal = pSource[nPos++];
-    nCount = 1;
-    do
+    nVal   = 0;
+    nCount = 0;
+    for (nArea = 0; nArea < 4; ++nArea)
     {
-        nNext = pSource[nPos++];
+        p    = aAreas[nArea];
+        pEnd = p + aAreaSizes[nArea];
 
-        // is there a reason to write now?
-        if ((nVal != nNext) || (nCount == 255))
-        {
-            // write compressed data if we have enough
-            // or if we have the signal byte
-            p = SaveAmicaFlush(p, nCount, nVal);
-            nVal = nNext;
-            nCount = 1;
-        }
-        else
+        while (p < pEnd)
         {
-            ++nCount;
+            // a different value ends the current run
+            if (nCount && *p != nVal)
+            {
+                SaveAmicaFlush(pOut, nCount, nVal);
+                nCount = 0;
+            }
+
+            nVal    = *p;
+            nRun    = AmicaRunLength(p, pEnd - p);
+            nCount += nRun;
+            p      += nRun;
         }
     }
-    while (nPos < (sizeof(koala_t)));
 
-    // save remaining bytes, if there are any
     if (nCount)
-        p = SaveAmicaFlush(p, nCount, nVal);
+        SaveAmicaFlush(pOut, nCount, nVal);
 
     // end mark
-    *p++ = AMICA_SIG_BYTE;
-    *p++ = 0;
+    pOut->push_back(AMICA_SIG_BYTE);
+    pOut->push_back(0);
 
-    delete[] pSource;
-    return p - pBuff;
+    return true;
 }
 
 
-/******************************************************************************
- * Flush collected bytes to an RLE Amica sequence.
+/******************************************************************************/
+/**
+ * Return the number of bytes at pData which are equal to the first one,
+ * but not more than nMax. nMax must be at least 1.
  *
- * Return the advanced target buffer pointer.
+ * Four bytes are compared at once, as long as they are available.
  */
-unsigned char* MCDoc::SaveAmicaFlush(
-        unsigned char* pBuff, unsigned char nCount, unsigned char nVal)
+unsigned MCDoc::AmicaRunLength(const uint8_t* pData, unsigned nMax)
 {
-    unsigned i;
+    uint32_t nPattern, nWord;
+    unsigned n;
 
-    if ((nCount > 3) || (nVal == AMICA_SIG_BYTE))
-    {
-        // write: SIG count val
-        *pBuff++ = AMICA_SIG_BYTE;
-        *pBuff++ = nCount;
-        *pBuff++ = nVal;
-    }
-    else
+    nPattern = pData[0] * 0x01010101u;
+    n = 1;
+
+    while (n + sizeof(nWord) <= nMax)
     {
-        // write literal data
-        for (i = 0; i < nCount; ++i)
-            *pBuff++ = nVal;
+        memcpy(&nWord, pData + n, sizeof(nWord));
+        if (nWord != nPattern)
+            break;
+        n += sizeof(nWord);
     }
 
-    return pBuff;
+    while (n < nMax && pData[n] == pData[0])
+        ++n;
+
+    return n;
 }
 
+
+/******************************************************************************/
+/**
+ * Append a run of nCount bytes with the value nVal to the buffer, using as
+ * few bytes as possible.
+ *
+ * A packed sequence "SIG count val" holds up to 255 bytes in 3 bytes. Full
+ * sequences are written for as long as possible. The rest is written
+ * literally if this isn't longer, i.e. up to 3 bytes. The signal byte
+ * itself can only be written packed.
+ */
+void MCDoc::SaveAmicaFlush(std::vector<uint8_t>* pOut,
+                           unsigned nCount, uint8_t nVal)
+{
+    unsigned nChunk;
+
+    while (nCount)
+    {
+        nChunk = nCount > 255 ? 255 : nCount;
+
+        if ((nChunk > 3) || (nVal == AMICA_SIG_BYTE))
+        {
+            // write: SIG count val
+            pOut->push_back(AMICA_SIG_BYTE);
+            pOut->push_back(nChunk);
+            pOut->push_back(nVal);
+        }
+        else
+        {
+            // write literal data
+            pOut->insert(pOut->end(), nChunk, nVal);
+        }
+
+        nCount -= nChunk;
+    }
+}
@@ -39,34 +39,38 @@ class MCDoc : public DocBase
 public:
     MCDoc();
     static DocBase* Factory();
-    static int CheckFormat(uint8_t* pBuff, unsigned len, const wxFileName& fileName);
+    static int CheckFormat(const uint8_t* pBuff, unsigned len,
+                           const wxFileName& fileName);
 
     virtual const FormatInfo* GetFormatInfo() const;
 
     const BitmapBase* GetBitmap() const;
     virtual BitmapBase* GetBitmap();
     virtual void SetBitmap(const BitmapBase*);
-    virtual void BackupBitmap();
-    virtual void RestoreBitmap();
+
+    virtual bool CanReoptimise() const;
+
+    MCBitmap* GetMCBitmap();
+
+    bool LoadKoala(const uint8_t* pBuff, unsigned nSize);
+    bool LoadAmica(const uint8_t* pBuff, unsigned nSize);
+    bool SaveKoala(std::vector<uint8_t>* pOut);
+    bool SaveAmica(std::vector<uint8_t>* pOut);
 
 protected:
-    virtual bool Load(uint8_t* pBuff, unsigned size);
-    virtual unsigned Save(uint8_t* pBuff, const wxFileName& fileName);
+    virtual bool Load(const uint8_t* pBuff, unsigned size);
+    virtual bool Save(std::vector<uint8_t>* pOut, const wxFileName& fileName);
+    virtual bool ImportImage(ImageImporter* pImporter);
+    virtual bool ReoptimiseBitmap();
 
     static FormatInfo m_formatInfo;
 
     /// The bitmap under work
     MCBitmap  m_bitmap;
 
-    /// Backup which holds the original state when a tool is in use
-    MCBitmap  m_bitmapBackup;
-
-    bool LoadKoala(unsigned char* pBuff, unsigned nSize);
-    bool LoadAmica(unsigned char* pBuff, unsigned nSize);
-    int SaveKoala(unsigned char* pBuff);
-    int SaveAmica(unsigned char* pBuff);
-    unsigned char* SaveAmicaFlush(
-            unsigned char* pBuff, unsigned char nCount, unsigned char nVal);
+    static unsigned AmicaRunLength(const uint8_t* pData, unsigned nMax);
+    static void SaveAmicaFlush(std::vector<uint8_t>* pOut,
+                               unsigned nCount, uint8_t nVal);
 };
 
 
@@ -92,21 +96,12 @@ inline BitmapBase* MCDoc::GetBitmap()
 
 /******************************************************************************/
 /**
- * Create a temporary backup of the current document bitmap state.
- */
-inline void MCDoc::BackupBitmap()
-{
-    m_bitmapBackup = m_bitmap;
-}
-
-
-/******************************************************************************/
-/**
- * Restore the current bitmap from the temporary backup.
+ * Return a pointer to our bitmap as MCBitmap, this gives access to the VIC
+ * memory layout.
  */
-inline void MCDoc::RestoreBitmap()
+inline MCBitmap* MCDoc::GetMCBitmap()
 {
-    m_bitmap = m_bitmapBackup;
+    return &m_bitmap;
 }
 
 #endif /* MCDOC_H */
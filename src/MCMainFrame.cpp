@@ -29,10 +29,16 @@
 #include <wx/msgdlg.h>
 #include <wx/image.h>
 #include <wx/filedlg.h>
+#include <wx/choicdlg.h>
+#include <wx/numdlg.h>
+#include <wx/utils.h>
 
 #include "FormatInfo.h"
 #include "MCApp.h"
 #include "DocBase.h"
+#include "BitmapBase.h"
+#include "CharBitmap.h"
+#include "SpriteBitmap.h"
 #include "MCMainFrame.h"
 #include "MCCanvas.h"
 #include "PalettePanel.h"
@@ -51,7 +57,8 @@
 MCMainFrame::MCMainFrame(wxFrame* parent, const wxString& title) :
     wxFrame(parent, wxID_ANY, title, wxDefaultPosition, wxSize(800, 600)),
     m_pToolPanel(NULL),
-    m_pNotebook(NULL)
+    m_pNotebook(NULL),
+    m_stringDocStatus()
 {
     m_pToolPanel = new ToolPanel(this);
     m_pNotebook = new wxNotebook(this, wxID_ANY);
@@ -65,6 +72,7 @@ MCMainFrame::MCMainFrame(wxFrame* parent, const wxString& title) :
 
     Connect(wxEVT_COMMAND_NOTEBOOK_PAGE_CHANGED, wxCommandEventHandler(MCMainFrame::OnPageChanged));
     Connect(wxEVT_SET_FOCUS, wxFocusEventHandler(MCMainFrame::OnFocus));
+    Connect(wxEVT_IDLE, wxIdleEventHandler(MCMainFrame::OnIdle));
 
     Connect(wxID_NEW, wxEVT_COMMAND_MENU_SELECTED,
             wxCommandEventHandler(MCMainFrame::OnNew));
@@ -72,6 +80,9 @@ MCMainFrame::MCMainFrame(wxFrame* parent, const wxString& title) :
     Connect(wxID_OPEN, wxEVT_COMMAND_MENU_SELECTED,
             wxCommandEventHandler(MCMainFrame::OnOpen));
 
+    Connect(MC_ID_IMPORT, wxEVT_COMMAND_MENU_SELECTED,
+            wxCommandEventHandler(MCMainFrame::OnImport));
+
     Connect(wxID_SAVE, wxEVT_UPDATE_UI,
             wxUpdateUIEventHandler(MCMainFrame::OnUpdateSave));
     Connect(wxID_SAVE, wxEVT_COMMAND_MENU_SELECTED,
@@ -100,6 +111,26 @@ MCMainFrame::MCMainFrame(wxFrame* parent, const wxString& title) :
     Connect(wxID_REDO, wxEVT_COMMAND_MENU_SELECTED,
             wxCommandEventHandler(MCMainFrame::OnRedo));
 
+    Connect(MC_ID_REOPTIMISE, wxEVT_UPDATE_UI,
+            wxUpdateUIEventHandler(MCMainFrame::OnUpdateReoptimise));
+    Connect(MC_ID_REOPTIMISE, wxEVT_COMMAND_MENU_SELECTED,
+            wxCommandEventHandler(MCMainFrame::OnReoptimise));
+
+    Connect(MC_ID_SPRITE_COUNT, wxEVT_UPDATE_UI,
+            wxUpdateUIEventHandler(MCMainFrame::OnUpdateSpriteCount));
+    Connect(MC_ID_SPRITE_COUNT, wxEVT_COMMAND_MENU_SELECTED,
+            wxCommandEventHandler(MCMainFrame::OnSpriteCount));
+
+    Connect(MC_ID_REDUCE_CHARS, wxEVT_UPDATE_UI,
+            wxUpdateUIEventHandler(MCMainFrame::OnUpdateReduceChars));
+    Connect(MC_ID_REDUCE_CHARS, wxEVT_COMMAND_MENU_SELECTED,
+            wxCommandEventHandler(MCMainFrame::OnReduceChars));
+
+    Connect(MC_ID_FRAME_ALL, MC_ID_FRAME_2, wxEVT_UPDATE_UI,
+            wxUpdateUIEventHandler(MCMainFrame::OnUpdateFrame));
+    Connect(MC_ID_FRAME_ALL, MC_ID_FRAME_2, wxEVT_COMMAND_MENU_SELECTED,
+            wxCommandEventHandler(MCMainFrame::OnFrame));
+
     Connect(MC_ID_ZOOM_1, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnZoom));
     Connect(MC_ID_ZOOM_2, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnZoom));
     Connect(MC_ID_ZOOM_4, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnZoom));
@@ -108,6 +139,9 @@ MCMainFrame::MCMainFrame(wxFrame* parent, const wxString& title) :
     Connect(wxID_ZOOM_IN, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnZoom));
     Connect(wxID_ZOOM_OUT, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnZoom));
     Connect(MC_ID_TV_MODE, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnTVMode));
+    Connect(MC_ID_TV_KERNEL_EWMA, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnTVKernel));
+    Connect(MC_ID_TV_KERNEL_PAL, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnTVKernel));
+    Connect(MC_ID_TV_KERNEL_SCANLINES, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnTVKernel));
 
     Connect(wxID_UNDO, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnUndo));
     Connect(wxID_REDO, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MCMainFrame::OnRedo));
@@ -120,6 +154,9 @@ MCMainFrame::MCMainFrame(wxFrame* parent, const wxString& title) :
     Connect(wxID_ZOOM_IN, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateZoomIn));
     Connect(wxID_ZOOM_OUT, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateZoomOut));
     Connect(MC_ID_TV_MODE, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateTVMode));
+    Connect(MC_ID_TV_KERNEL_EWMA, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateTVKernel));
+    Connect(MC_ID_TV_KERNEL_PAL, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateTVKernel));
+    Connect(MC_ID_TV_KERNEL_SCANLINES, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateTVKernel));
 
     Connect(wxID_UNDO, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateUndo));
     Connect(wxID_REDO, wxEVT_UPDATE_UI, wxUpdateUIEventHandler(MCMainFrame::OnUpdateRedo));
@@ -234,6 +271,9 @@ void MCMainFrame::InitMenuBar()
     pItem->SetBitmap(MCApp::GetBitmap(wxT("16x16"), wxT("fileopen.png")));
     pFileMenu->Append(pItem);
 
+    pFileMenu->Append(MC_ID_IMPORT, _T("&Import Image..."),
+                      _T("Convert a true color image into a new document"));
+
     pItem = new wxMenuItem(pFileMenu, wxID_CLOSE);
     pItem->SetBitmap(MCApp::GetBitmap(wxT("16x16"), wxT("fileclose.png")));
     pFileMenu->Append(pItem);
@@ -256,6 +296,20 @@ void MCMainFrame::InitMenuBar()
 
     pEditMenu->Append(wxID_UNDO, _T("&Undo\tCtrl+Z"));
     pEditMenu->Append(wxID_REDO, _T("&Redo\tShift+Ctrl+Z"));
+    pEditMenu->AppendSeparator();
+    pEditMenu->Append(MC_ID_REOPTIMISE, _T("Re-&optimise Picture"),
+                      _T("Choose the background color which leaves the most colors free"));
+    pEditMenu->Append(MC_ID_SPRITE_COUNT, _T("Number of &Sprites..."),
+                      _T("Sprite sheets: Add sprites or remove them from the end"));
+    pEditMenu->Append(MC_ID_REDUCE_CHARS, _T("Reduce &Characters..."),
+                      _T("Merge the most similar characters until the character set fits"));
+    pEditMenu->AppendSeparator();
+    pEditMenu->AppendRadioItem(MC_ID_FRAME_ALL, _T("Draw into &both Frames"),
+                      _T("Interlaced pictures: Change both frames"));
+    pEditMenu->AppendRadioItem(MC_ID_FRAME_1, _T("Draw into Frame &1"),
+                      _T("Interlaced pictures: Change the first frame only"));
+    pEditMenu->AppendRadioItem(MC_ID_FRAME_2, _T("Draw into Frame &2"),
+                      _T("Interlaced pictures: Change the second frame only"));
 
     wxMenu* pToolsMenu = new wxMenu;
     pToolsMenu->AppendRadioItem(MC_ID_TOOL_COLOR_PICKER, _T("Color &picker\tF1"));
@@ -276,6 +330,9 @@ void MCMainFrame::InitMenuBar()
     pViewMenu->Append(wxID_ZOOM_OUT, _T("Zoom &out"));
     pViewMenu->AppendSeparator();
     pViewMenu->Append(MC_ID_TV_MODE, _T("&TV Mode"), _T("Blur the image a little bit"), wxITEM_CHECK);
+    pViewMenu->AppendRadioItem(MC_ID_TV_KERNEL_EWMA, _T("Simple &blur"), _T("TV mode: Blur the image horizontally"));
+    pViewMenu->AppendRadioItem(MC_ID_TV_KERNEL_PAL, _T("&PAL"), _T("TV mode: Blur colors more than brightness"));
+    pViewMenu->AppendRadioItem(MC_ID_TV_KERNEL_SCANLINES, _T("Simple blur with &scanlines"), _T("TV mode: Blur the image and darken every second line"));
 
     wxMenu *pHelpMenu = new wxMenu;
     pHelpMenu->Append(wxID_ABOUT, _T("&About"));
@@ -293,16 +350,21 @@ void MCMainFrame::InitMenuBar()
 
 /*****************************************************************************/
 /*
- * Show the current mouse position in the status bar
+ * Show the current mouse position in the status bar, together with the
+ * status text of the active document, if any.
  */
 void MCMainFrame::ShowMousePos(int x, int y)
 {
+    DocBase* pDoc = GetActiveDoc();
+
 #ifdef N2C
     int bcpos(320*(y/8)+(x/4)*8); int bpos=bcpos+(y&7); int cpos=(40*(y/8)+(x/4));
     wxString strPosition(wxString::Format(wxT("%d:%d\t$%04x\t$%04x\t$%04x"), x, y, cpos,bcpos,bpos));
 #else
     wxString strPosition(wxString::Format(wxT("%d:%d"), x, y));
 #endif
+    if (pDoc && !pDoc->GetStatusText().IsEmpty())
+        strPosition += wxT("  ") + pDoc->GetStatusText();
     SetStatusText(strPosition, 1);
 }
 
@@ -442,6 +504,58 @@ void MCMainFrame::OnOpen(wxCommandEvent &event)
 }
 
 
+/*****************************************************************************/
+/**
+ * Import an image of any format wxImage can read into a new document.
+ * The user chooses the format of the document and the dithering.
+ */
+void MCMainFrame::OnImport(wxCommandEvent &event)
+{
+    DocBase* pDoc;
+    MCCanvas* pCanvas;
+    wxString stringFilter;
+    wxArrayString arrayDither;
+    int nDither;
+
+    stringFilter = wxT("Image files ");
+    stringFilter.append(wxImage::GetImageExtWildcard());
+    stringFilter.append(wxT("|All files (*)|*"));
+
+    wxFileDialog fileDialog(
+            this, wxT("Import Image"), wxT(""), wxT(""), stringFilter,
+            wxFD_OPEN | wxFD_CHANGE_DIR | wxFD_FILE_MUST_EXIST);
+
+    if (fileDialog.ShowModal() != wxID_OK)
+        return;
+
+    NewFileDialog formatDialog(this, wxT("Import into"));
+    formatDialog.ShowModal();
+    if (!formatDialog.GetSelectedFormatInfo())
+        return;
+
+    // same order as MCDitherMode
+    arrayDither.Add(wxT("No dithering"));
+    arrayDither.Add(wxT("Ordered dithering"));
+    arrayDither.Add(wxT("Floyd-Steinberg dithering"));
+    nDither = wxGetSingleChoiceIndex(wxT("How should colors be mixed?"),
+                                     wxT("Import Image"), arrayDither, this);
+    if (nDither < 0)
+        return;
+
+    wxBusyCursor busyCursor;
+    pDoc = DocBase::Import(fileDialog.GetPath(),
+                           formatDialog.GetSelectedFormatInfo(),
+                           (MCDitherMode) nDither);
+    if (pDoc)
+    {
+        pCanvas = new MCCanvas(m_pNotebook, 0);
+        pCanvas->SetDoc(pDoc);
+        m_pNotebook->AddPage(pCanvas, pDoc->GetFileName().GetFullName(), true);
+        pCanvas->Show();
+    }
+}
+
+
 /*****************************************************************************/
 /*
  * "Save" and "Save as" can only be used if there is a document.
@@ -644,6 +758,152 @@ void MCMainFrame::OnRedo(wxCommandEvent &event)
 }
 
 
+/*****************************************************************************/
+/*
+ * Update Re-optimise menu entry.
+ */
+void MCMainFrame::OnUpdateReoptimise(wxUpdateUIEvent& event)
+{
+    DocBase* pDoc = GetActiveDoc();
+    event.Enable(pDoc && pDoc->CanReoptimise());
+}
+
+
+/*****************************************************************************/
+/*
+ * Choose the colors of the active document again.
+ */
+void MCMainFrame::OnReoptimise(wxCommandEvent &event)
+{
+    DocBase* pDoc = GetActiveDoc();
+
+    if (pDoc)
+    {
+        wxBusyCursor busyCursor;
+        pDoc->Reoptimise();
+    }
+}
+
+
+/*****************************************************************************/
+/*
+ * Update the sprite count menu entry, it is only used for sprite sheets.
+ */
+void MCMainFrame::OnUpdateSpriteCount(wxUpdateUIEvent& event)
+{
+    DocBase* pDoc = GetActiveDoc();
+    event.Enable(pDoc && pDoc->GetNSprites() > 0);
+}
+
+
+/*****************************************************************************/
+/*
+ * Update Reduce Characters menu entry.
+ */
+void MCMainFrame::OnUpdateReduceChars(wxUpdateUIEvent& event)
+{
+    DocBase* pDoc = GetActiveDoc();
+    event.Enable(pDoc && pDoc->CanReduceChars());
+}
+
+
+/*****************************************************************************/
+/*
+ * Ask for the number of sprites of the active sprite sheet and change it.
+ * The sheet gets a new size, so all canvases showing it are updated.
+ */
+void MCMainFrame::OnSpriteCount(wxCommandEvent &event)
+{
+    DocBase*  pDoc = GetActiveDoc();
+    MCCanvas* pCanvas;
+    size_t    n;
+    long      nSprites;
+
+    if (!pDoc || pDoc->GetNSprites() == 0)
+        return;
+
+    nSprites = wxGetNumberFromUser(
+            wxT("Sprites are added or removed at the end of the sheet.\n"
+                "This cannot be undone."),
+            wxT("Number of sprites:"), wxT("Number of Sprites"),
+            pDoc->GetNSprites(), 1, SPRITEBITMAP_MAX_SPRITES, this);
+    if (nSprites <= 0)
+        return;
+
+    pDoc->SetNSprites(nSprites);
+
+    for (n = 0; n < m_pNotebook->GetPageCount(); ++n)
+    {
+        pCanvas = (MCCanvas*) m_pNotebook->GetPage(n);
+        if (pCanvas->GetDoc() == pDoc)
+        {
+            // update min size and virtual size to the new bitmap size
+            pCanvas->SetDoc(pDoc);
+            pCanvas->SetZoom(pCanvas->GetZoom());
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/*
+ * Ask for the number of characters and merge the characters of the active
+ * document until it fits.
+ */
+void MCMainFrame::OnReduceChars(wxCommandEvent &event)
+{
+    DocBase* pDoc = GetActiveDoc();
+    long     nChars;
+
+    if (!pDoc)
+        return;
+
+    nChars = wxGetNumberFromUser(
+        wxT("The most similar characters will be merged."),
+        wxT("Number of characters:"), wxT("Reduce Characters"),
+        CHARBITMAP_MAX_CHARS, 1, CHARBITMAP_NCELLS, this);
+
+    if (nChars > 0)
+    {
+        wxBusyCursor busyCursor;
+        pDoc->ReduceChars(nChars);
+    }
+}
+
+
+/*****************************************************************************/
+/*
+ * Update the frame selection menu entries, they are only used for
+ * interlaced pictures.
+ */
+void MCMainFrame::OnUpdateFrame(wxUpdateUIEvent& event)
+{
+    DocBase* pDoc = GetActiveDoc();
+
+    if (pDoc && pDoc->GetBitmap()->GetNFrames() > 1)
+    {
+        event.Enable(true);
+        event.Check(pDoc->GetBitmap()->GetEditFrame() ==
+                    event.GetId() - MC_ID_FRAME_1);
+    }
+    else
+        event.Enable(false);
+}
+
+
+/*****************************************************************************/
+/*
+ * Select the frame(s) of an interlaced picture to be changed by the tools.
+ */
+void MCMainFrame::OnFrame(wxCommandEvent &event)
+{
+    DocBase* pDoc = GetActiveDoc();
+
+    if (pDoc)
+        pDoc->GetBitmap()->SetEditFrame(event.GetId() - MC_ID_FRAME_1);
+}
+
+
 /*****************************************************************************/
 /*
  * Get a pointer to the active document or NULL.
@@ -689,6 +949,27 @@ void MCMainFrame::OnSize(wxSizeEvent& event)
 }
 
 
+/*****************************************************************************/
+/*
+ * Show the status text of the active document again when it has changed.
+ * This is checked when the application is idle, so the status bar is also
+ * up to date after undo, redo or keyboard edits, e.g. the number of
+ * characters of a character mode document.
+ */
+void MCMainFrame::OnIdle(wxIdleEvent& event)
+{
+    DocBase* pDoc = GetActiveDoc();
+
+    if (pDoc && pDoc->GetStatusText() != m_stringDocStatus)
+    {
+        m_stringDocStatus = pDoc->GetStatusText();
+        ShowMousePos(pDoc->GetMousePos().x, pDoc->GetMousePos().y);
+    }
+
+    event.Skip();
+}
+
+
 /*****************************************************************************/
 void MCMainFrame::OnAbout(wxCommandEvent &event)
 {
@@ -784,6 +1065,31 @@ void MCMainFrame::OnTVMode(wxCommandEvent& event)
 }
 
 
+/*****************************************************************************/
+void MCMainFrame::OnTVKernel(wxCommandEvent& event)
+{
+    MCCanvas* pCanvas = GetActiveCanvas();
+
+    if (!pCanvas)
+        return;
+
+    switch (event.GetId())
+    {
+    case MC_ID_TV_KERNEL_PAL:
+        pCanvas->SetTVKernel(MCTVFilterPAL);
+        break;
+
+    case MC_ID_TV_KERNEL_SCANLINES:
+        pCanvas->SetTVKernel(MCTVFilterScanlines);
+        break;
+
+    default:
+        pCanvas->SetTVKernel(MCTVFilterEWMA);
+        break;
+    }
+}
+
+
 /*****************************************************************************/
 void MCMainFrame::OnUpdateZoomIn(wxUpdateUIEvent& event)
 {
@@ -875,6 +1181,43 @@ void MCMainFrame::OnUpdateTVMode(wxUpdateUIEvent& event)
 }
 
 
+/*****************************************************************************/
+/*
+ * Update the state of the TV kernel menu items.
+ */
+void MCMainFrame::OnUpdateTVKernel(wxUpdateUIEvent& event)
+{
+    MCCanvas* pCanvas = GetActiveCanvas();
+
+    if (pCanvas)
+    {
+        event.Enable(true);
+        switch (pCanvas->GetTVKernel())
+        {
+        case MCTVFilterEWMA:
+            event.Check(event.GetId() == MC_ID_TV_KERNEL_EWMA);
+            break;
+
+        case MCTVFilterPAL:
+            event.Check(event.GetId() == MC_ID_TV_KERNEL_PAL);
+            break;
+
+        case MCTVFilterScanlines:
+            event.Check(event.GetId() == MC_ID_TV_KERNEL_SCANLINES);
+            break;
+        }
+    }
+    else
+    {
+        event.Enable(false);
+    }
+
+#ifdef MC_TOOLS_ALWAYS_ENABLED
+    event.Enable(true);
+#endif
+}
+
+
 /*****************************************************************************/
 void MCMainFrame::OnKeyDown(wxKeyEvent& event)
 {
@@ -61,6 +61,7 @@ protected:
     void OnNew(wxCommandEvent &event);
 
     void OnOpen(wxCommandEvent &event);
+    void OnImport(wxCommandEvent &event);
 
     void OnUpdateSave(wxUpdateUIEvent& event);
     void OnSave(wxCommandEvent& event);
@@ -76,6 +77,15 @@ protected:
     void OnUpdateRedo(wxUpdateUIEvent& event);
     void OnRedo(wxCommandEvent& event);
 
+    void OnUpdateReoptimise(wxUpdateUIEvent& event);
+    void OnReoptimise(wxCommandEvent& event);
+    void OnUpdateSpriteCount(wxUpdateUIEvent& event);
+    void OnSpriteCount(wxCommandEvent& event);
+    void OnUpdateReduceChars(wxUpdateUIEvent& event);
+    void OnReduceChars(wxCommandEvent& event);
+    void OnUpdateFrame(wxUpdateUIEvent& event);
+    void OnFrame(wxCommandEvent& event);
+
     void OnAbout(wxCommandEvent& event);
     void OnSize(wxSizeEvent& event);
 
@@ -84,16 +94,20 @@ protected:
 
     void OnZoom(wxCommandEvent& event);
     void OnTVMode(wxCommandEvent& event);
+    void OnTVKernel(wxCommandEvent& event);
 
     void OnUpdateZoomIn(wxUpdateUIEvent& event);
     void OnUpdateZoomOut(wxUpdateUIEvent& event);
     void OnUpdateZoom(wxUpdateUIEvent& event);
     void OnUpdateTVMode(wxUpdateUIEvent& event);
+    void OnUpdateTVKernel(wxUpdateUIEvent& event);
 
     void OnKeyDown(wxKeyEvent& event);
+    void OnIdle(wxIdleEvent& event);
 
     ToolPanel*      m_pToolPanel;
     wxNotebook*     m_pNotebook;
+    wxString        m_stringDocStatus;
 };
 
 /*****************************************************************************/
@@ -49,9 +49,11 @@
 
 /*****************************************************************************/
 /**
+ * Constructor. The title can be changed for other uses than "New file",
+ * e.g. for choosing the format of an imported image.
  */
-NewFileDialog::NewFileDialog(wxWindow* parent) :
-    wxDialog(parent, wxID_ANY, wxT("New file"), wxDefaultPosition, wxDefaultSize),
+NewFileDialog::NewFileDialog(wxWindow* parent, const wxString& stringTitle) :
+    wxDialog(parent, wxID_ANY, stringTitle, wxDefaultPosition, wxDefaultSize),
     m_pSelectedFormatInfo(NULL)
 {
     wxStaticText*   pText;
@@ -34,7 +34,8 @@ class FormatInfo;
 class NewFileDialog : public wxDialog
 {
 public:
-    NewFileDialog(wxWindow* parent);
+    NewFileDialog(wxWindow* parent,
+                  const wxString& stringTitle = wxT("New file"));
     virtual ~NewFileDialog();
 
     void OnButton(wxCommandEvent& event);
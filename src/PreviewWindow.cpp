@@ -46,6 +46,7 @@ PreviewWindow::PreviewWindow(wxWindow* pParent, int nStyle) :
     m_pointLastMousePos(-1, -1),
     m_pointNextMousePos(-1, -1),
     m_timerRefresh(this, PREVIEWWINDOW_REFRESH_TIMER_ID),
+    m_timerRedraw(this, PREVIEWWINDOW_REDRAW_TIMER_ID),
     m_bColorPickerActive(false)
 {
     Connect(wxEVT_LEFT_DOWN, wxMouseEventHandler(PreviewWindow::OnButtonDown));
@@ -69,32 +70,51 @@ PreviewWindow::PreviewWindow(wxWindow* pParent, int nStyle) :
  * It may by possible that x1 == x2 or y1 == y2 and it may be larger than
  * the actual image.
  *
- * We must force a redraw immediately, otherwise it may take a while
- * until we get to the event loop again
- *
+ * The area is only collected here, it is redrawn with all other areas
+ * changed during the same frame when the redraw timer expires.
  */
 void PreviewWindow::RedrawDoc(int x1, int y1, int x2, int y2)
 {
+    if (m_pDoc)
+    {
+        AddDirtyRect(x1, y1, x2, y2);
+        if (!m_timerRedraw.IsRunning())
+            m_timerRedraw.Start(DOCRENDERER_REDRAW_INTERVAL, wxTIMER_ONE_SHOT);
+    }
+    else
+        Refresh(false);
+}
+
+
+/*****************************************************************************/
+/**
+ * Invalidate the areas collected by RedrawDoc, they will be painted when
+ * we get to the event loop again.
+ */
+void PreviewWindow::RefreshDirtyRects()
+{
+    std::vector<wxRect> aRects;
+    std::vector<wxRect>::const_iterator i;
     wxRect      rect;
     BitmapBase* pB;
 
-    if (m_pDoc)
+    if (!m_pDoc)
+        return;
+
+    pB = m_pDoc->GetBitmap();
+    TakeDirtyRects(&aRects);
+    for (i = aRects.begin(); i != aRects.end(); ++i)
     {
         // Calculate the rectangle to be redrawn in screen coordinates
-        ToCanvasCoord(&rect.x, &rect.y, x1, y1);
-        pB = m_pDoc->GetBitmap();
+        ToCanvasCoord(&rect.x, &rect.y, i->x, i->y);
 
-        // x2 = x1 is a rect with width = 1, that's why + 1
-        // 2 extra pixels to b e refreshed in x direction because of TV emulation
-        rect.SetWidth ((x2 - x1 + 3) * pB->GetPixelXFactor());
-        rect.SetHeight((y2 - y1 + 1) * pB->GetPixelYFactor());
+        // the TV emulation smears the change into the pixels to the right
+        rect.SetWidth ((i->width + (m_bEmulateTV ? GetTVMargin(1) : 0)) *
+                       pB->GetPixelXFactor());
+        rect.SetHeight(i->height * pB->GetPixelYFactor());
 
         RefreshRect(rect, false);
     }
-    else
-        Refresh(false);
-
-    Update();
 }
 
 /*****************************************************************************/
@@ -302,4 +322,8 @@ void PreviewWindow::OnTimer(wxTimerEvent& event)
         DrawMousePos(&dc, m_pointNextMousePos.x, m_pointNextMousePos.y, 1);
         m_pointLastMousePos = m_pointNextMousePos;
     }
+    else if (event.GetId() == PREVIEWWINDOW_REDRAW_TIMER_ID)
+    {
+        RefreshDirtyRects();
+    }
 }
@@ -38,6 +38,7 @@
 
 #define PREVIEWWINDOW_SCROLL_TIMER_ID  1
 #define PREVIEWWINDOW_REFRESH_TIMER_ID 2
+#define PREVIEWWINDOW_REDRAW_TIMER_ID  3
 
 class ToolBase;
 class DocBase;
@@ -67,6 +68,7 @@ protected:
     void ToCanvasCoord(int* px, int* py, int x, int y);
     void UpdateCursorPosition(int x, int y, bool bCanvasCoordinates);
     void UpdateCursorType();
+    void RefreshDirtyRects();
 
     void OnButtonDown(wxMouseEvent& event);
     void OnMouseMove(wxMouseEvent& event);
@@ -86,6 +88,9 @@ protected:
 
     wxTimer     m_timerRefresh;
 
+    // Runs from the first change of the document until it is redrawn
+    wxTimer     m_timerRedraw;
+
     // This is true if the Color Picker is activated temporarily (using Shift)
     bool        m_bColorPickerActive;
 };
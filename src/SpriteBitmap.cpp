@@ -0,0 +1,636 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include "SpriteBitmap.h"
+
+
+const C64Color SpriteBitmap::black;
+
+
+/*****************************************************************************/
+/**
+ * Create a sheet with nSprites empty sprites (at least one) in white.
+ */
+SpriteBitmap::SpriteBitmap(bool bMultiColor, unsigned nSprites) :
+    m_bMultiColor(bMultiColor),
+    m_nSprites(nSprites ? nSprites : 1),
+    m_aSprites(m_nSprites * SPRITE_BYTES, 0)
+{
+    unsigned i;
+
+    for (i = 0; i < m_nSprites; ++i)
+        m_aSprites[i * SPRITE_BYTES + SPRITE_DATA_BYTES] =
+            MC_WHITE | (bMultiColor ? SPRITE_MC_FLAG : 0);
+
+    m_aSharedColors[0] = MC_BLACK;
+    m_aSharedColors[1] = MC_DGRAY;
+    m_aSharedColors[2] = MC_LGRAY;
+}
+
+
+/*****************************************************************************/
+SpriteBitmap::~SpriteBitmap(void)
+{
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to a copy of this bitmap created with "new".
+ */
+BitmapBase* SpriteBitmap::Copy() const
+{
+    return new SpriteBitmap(*this);
+}
+
+
+/******************************************************************************/
+/**
+ * The sheet is SPRITEBITMAP_COLUMNS sprites wide.
+ */
+int SpriteBitmap::GetWidth() const
+{
+    return SPRITEBITMAP_COLUMNS * GetSpriteWidth();
+}
+
+
+/******************************************************************************/
+/**
+ * The height depends on the number of sprite rows, the last one may be
+ * incomplete.
+ */
+int SpriteBitmap::GetHeight() const
+{
+    return (m_nSprites + SPRITEBITMAP_COLUMNS - 1) / SPRITEBITMAP_COLUMNS *
+           SPRITE_HEIGHT;
+}
+
+
+/*****************************************************************************/
+/**
+ * Each sprite is a cell, as it has a color of its own.
+ */
+int SpriteBitmap::GetCellWidth() const
+{
+    return GetSpriteWidth();
+}
+
+
+/*****************************************************************************/
+/**
+ * A cell is one sprite, 21 rows high.
+ */
+int SpriteBitmap::GetCellHeight() const
+{
+    return SPRITE_HEIGHT;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the pixel factor in X-direction. 2 for multicolor sprites.
+ */
+int SpriteBitmap::GetPixelXFactor() const
+{
+    return m_bMultiColor ? 2 : 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Multicolor sprites have the background, two shared colors and a color of
+ * their own, hires sprites only the background and their own color.
+ */
+int SpriteBitmap::GetNIndexes() const
+{
+    return m_bMultiColor ? 4 : 2;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of an index in the sprite which contains the given
+ * coordinates. If the coordinates are out of range, return black.
+ */
+const C64Color* SpriteBitmap::GetColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+    {
+        if (index < GetNIndexes())
+            return C64Color::GetPaletteColor(
+                    GetIndexedColorNumber(x, y, index));
+        else
+            return NULL;
+    }
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of pixels of an index in the sprite which contains the
+ * given coordinates. If the coordinates are out of range, return 0.
+ */
+int SpriteBitmap::CountColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return CountIndex(x, y, index);
+    else
+        return 0;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of a pixel. If the coordinates are out of range, return
+ * black.
+ */
+const C64Color* SpriteBitmap::GetColor(int x, int y) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return C64Color::GetPaletteColor(
+                GetIndexedColorNumber(x, y, GetIndex(x, y)));
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ *
+ * The three bytes of a sprite row are read at once, empty places in the
+ * last row of the sheet show the background.
+ */
+void SpriteBitmap::GetColorRow(int x, int y, int w,
+                               unsigned char* pDest) const
+{
+    const uint8_t* pRow;
+    unsigned       n, xPixel, nWidth, bits;
+    unsigned char  aColors[4];
+
+    nWidth = GetSpriteWidth();
+    n      = (y / SPRITE_HEIGHT) * SPRITEBITMAP_COLUMNS + x / nWidth;
+    xPixel = x % nWidth;
+
+    while (w > 0)
+    {
+        if (n < m_nSprites)
+        {
+            GetIndexColors(n, aColors);
+            pRow = &m_aSprites[n * SPRITE_BYTES +
+                               (y % SPRITE_HEIGHT) * SPRITE_ROW_BYTES];
+            bits = (pRow[0] << 16) | (pRow[1] << 8) | pRow[2];
+        }
+        else
+        {
+            GetIndexColors(-1, aColors);
+            bits = 0;
+        }
+
+        if (m_bMultiColor)
+        {
+            for (; xPixel < nWidth && w > 0; ++xPixel, --w)
+                *pDest++ = aColors[(bits >> (22 - 2 * xPixel)) & 0x03];
+        }
+        else
+        {
+            for (; xPixel < nWidth && w > 0; ++xPixel, --w)
+                *pDest++ = aColors[(bits >> (23 - xPixel)) & 0x01];
+        }
+
+        xPixel = 0;
+        ++n;
+    }
+}
+
+
+/*****************************************************************************
+ * Set the pixel x/y to the color col.
+ *
+ * The shared colors can be used by each sprite at any time. Otherwise the
+ * sprite color is used, if it has the right color or if no pixel uses it.
+ * In case of a color clash, all drawing modes but MCDrawingModeIgnore
+ * change the sprite color, the shared colors are only changed with the
+ * fixed index modes.
+ */
+void SpriteBitmap::SetPixel(int x, int y, const C64Color& col,
+                            MCDrawingMode mode)
+{
+    unsigned char c;
+    int           i, nOwn;
+
+    if ((x < 0) || (y < 0) || (x >= GetWidth()) || (y >= GetHeight()) ||
+        GetSpriteNumber(x, y) < 0)
+        return;
+
+    c    = (unsigned char) col.GetColor();
+    nOwn = m_bMultiColor ? 2 : 1;
+
+    Dirty(x, y);
+
+    // Set colors with fixed index first
+    i = (int)(mode - MCDrawingModeIndex0);
+    if (mode >= MCDrawingModeIndex0 && mode <= MCDrawingModeIndex3)
+    {
+        if (i < GetNIndexes())
+        {
+            SetIndexedColor(x, y, i, c);
+            SetIndex(x, y, i);
+        }
+        return;
+    }
+
+    // use a shared color if possible
+    for (i = 0; i < GetNIndexes(); ++i)
+    {
+        if (i != nOwn && GetIndexedColorNumber(x, y, i) == c)
+        {
+            SetIndex(x, y, i);
+            return;
+        }
+    }
+
+    // then the sprite color if it fits or if it is free
+    if (GetIndexedColorNumber(x, y, nOwn) == c ||
+        CountIndex(x, y, nOwn) == 0)
+    {
+        SetIndex(x, y, nOwn);
+        SetIndexedColor(x, y, nOwn, c);
+        return;
+    }
+
+    // color clash, depends on the mode
+    if (mode == MCDrawingModeIgnore)
+        return;
+
+    SetIndex(x, y, nOwn);
+    SetIndexedColor(x, y, nOwn, c);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: The 64 byte record
+ * of the sprite.
+ */
+unsigned SpriteBitmap::GetCellDataSize() const
+{
+    return SPRITE_BYTES;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid, empty places in the last row give zeros.
+ */
+void SpriteBitmap::GetCellData(int xCell, int yCell,
+                               unsigned char* pData) const
+{
+    unsigned n = yCell * SPRITEBITMAP_COLUMNS + xCell;
+
+    if (n < m_nSprites)
+        memcpy(pData, &m_aSprites[n * SPRITE_BYTES], SPRITE_BYTES);
+    else
+        memset(pData, 0, SPRITE_BYTES);
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ */
+void SpriteBitmap::SetCellData(int xCell, int yCell,
+                               const unsigned char* pData)
+{
+    unsigned n = yCell * SPRITEBITMAP_COLUMNS + xCell;
+
+    if (n >= m_nSprites)
+        return;
+
+    memcpy(&m_aSprites[n * SPRITE_BYTES], pData, SPRITE_BYTES);
+    Dirty(xCell * GetSpriteWidth(), yCell * SPRITE_HEIGHT,
+          GetSpriteWidth(), SPRITE_HEIGHT);
+}
+
+
+/*****************************************************************************/
+/**
+ * The global data of a sprite sheet are the three shared colors.
+ */
+unsigned SpriteBitmap::GetGlobalDataSize() const
+{
+    return sizeof(m_aSharedColors);
+}
+
+
+/*****************************************************************************/
+/**
+ * Store the background and the two multicolors in pData[0..2].
+ */
+void SpriteBitmap::GetGlobalData(unsigned char* pData) const
+{
+    memcpy(pData, m_aSharedColors, sizeof(m_aSharedColors));
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background and the two multicolors from pData[0..2].
+ */
+void SpriteBitmap::SetGlobalData(const unsigned char* pData)
+{
+    SetBackground(pData[0]);
+    SetMultiColor(0, pData[1]);
+    SetMultiColor(1, pData[2]);
+}
+
+
+/*****************************************************************************/
+/**
+ * Replace all sprites by nSprites records of 64 bytes from pSrc, at least
+ * one. The records are copied as they are, the sprite type of the sheet
+ * is taken from the multicolor flag of the first one.
+ */
+void SpriteBitmap::SetSprites(const uint8_t* pSrc, unsigned nSprites)
+{
+    if (nSprites == 0)
+        return;
+
+    m_nSprites = nSprites;
+    m_aSprites.assign(pSrc, pSrc + nSprites * SPRITE_BYTES);
+    m_bMultiColor = (m_aSprites[SPRITE_DATA_BYTES] & SPRITE_MC_FLAG) != 0;
+
+    // the dirty and changed cells are numbered for the old size
+    ResetDirty();
+    ResetChanged();
+    Dirty(0, 0, GetWidth(), GetHeight());
+}
+
+
+/*****************************************************************************/
+/**
+ * Change the number of sprites on this sheet, at least one. Sprites are
+ * removed from the end or added there. New sprites are empty and have the
+ * type of the sheet.
+ */
+void SpriteBitmap::SetNSprites(unsigned nSprites)
+{
+    unsigned i;
+
+    if (nSprites == 0 || nSprites == m_nSprites)
+        return;
+
+    m_aSprites.resize(nSprites * SPRITE_BYTES, 0);
+    for (i = m_nSprites; i < nSprites; ++i)
+        m_aSprites[i * SPRITE_BYTES + SPRITE_DATA_BYTES] =
+            MC_WHITE | (m_bMultiColor ? SPRITE_MC_FLAG : 0);
+    m_nSprites = nSprites;
+
+    // the dirty and changed cells are numbered for the old size
+    ResetDirty();
+    ResetChanged();
+    Dirty(0, 0, GetWidth(), GetHeight());
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background color of all sprites.
+ */
+void SpriteBitmap::SetBackground(unsigned char col)
+{
+    SetMultiColor(-1, col);
+}
+
+
+/*****************************************************************************/
+unsigned char SpriteBitmap::GetBackground() const
+{
+    return m_aSharedColors[0];
+}
+
+
+/*****************************************************************************/
+/**
+ * Set sprite multicolor 0 ($d025) or 1 ($d026). -1 is the background.
+ */
+void SpriteBitmap::SetMultiColor(int n, unsigned char col)
+{
+    if (m_aSharedColors[n + 1] != (col & 0x0f))
+    {
+        m_aSharedColors[n + 1] = col & 0x0f;
+
+        // this may change the whole sheet
+        Dirty(0, 0, GetWidth(), GetHeight());
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return sprite multicolor 0 ($d025) or 1 ($d026). -1 is the background.
+ */
+unsigned char SpriteBitmap::GetMultiColor(int n) const
+{
+    return m_aSharedColors[n + 1];
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the color index of the pixel x/y. The coordinates must be valid,
+ * empty places in the last row are background.
+ */
+int SpriteBitmap::GetIndex(unsigned x, unsigned y) const
+{
+    const uint8_t* pRow;
+    int            n = GetSpriteNumber(x, y);
+
+    if (n < 0)
+        return 0;
+
+    pRow = &m_aSprites[n * SPRITE_BYTES +
+                       (y % SPRITE_HEIGHT) * SPRITE_ROW_BYTES];
+    x %= GetSpriteWidth();
+    if (m_bMultiColor)
+        return (pRow[x / 4] >> (2 * (3 - x % 4))) & 0x03;
+    else
+        return (pRow[x / 8] >> (7 - x % 8)) & 0x01;
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color index of the pixel x/y. The coordinates must be valid.
+ */
+void SpriteBitmap::SetIndex(unsigned x, unsigned y, int index)
+{
+    uint8_t* pRow;
+    unsigned shift;
+    int      n = GetSpriteNumber(x, y);
+
+    if (n < 0)
+        return;
+
+    pRow = &m_aSprites[n * SPRITE_BYTES +
+                       (y % SPRITE_HEIGHT) * SPRITE_ROW_BYTES];
+    x %= GetSpriteWidth();
+    if (m_bMultiColor)
+    {
+        shift = 2 * (3 - x % 4);
+        pRow[x / 4] = (pRow[x / 4] & ~(0x03 << shift)) | (index << shift);
+    }
+    else
+    {
+        shift = 7 - x % 8;
+        pRow[x / 8] = (pRow[x / 8] & ~(0x01 << shift)) | (index << shift);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the C64 color number used for the given index in the sprite which
+ * contains x/y. The coordinates must be valid.
+ */
+int SpriteBitmap::GetIndexedColorNumber(unsigned x, unsigned y,
+                                        int index) const
+{
+    unsigned char aColors[4];
+
+    GetIndexColors(GetSpriteNumber(x, y), aColors);
+    return aColors[index];
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the color of an index in the sprite which contains x/y. Only the
+ * sprite color belongs to this sprite, the other ones change all sprites.
+ */
+void SpriteBitmap::SetIndexedColor(unsigned x, unsigned y, int index,
+                                   unsigned char col)
+{
+    uint8_t* pColor;
+    int      n = GetSpriteNumber(x, y);
+
+    if (index == 0)
+        SetBackground(col);
+    else if (!m_bMultiColor || index == 2)
+    {
+        if (n < 0)
+            return;
+
+        pColor = &m_aSprites[n * SPRITE_BYTES + SPRITE_DATA_BYTES];
+        if ((*pColor & SPRITE_COLOR_MASK) != (col & SPRITE_COLOR_MASK))
+        {
+            *pColor = (*pColor & ~SPRITE_COLOR_MASK) |
+                      (col & SPRITE_COLOR_MASK);
+            Dirty(x - x % GetSpriteWidth(), y - y % SPRITE_HEIGHT,
+                  GetSpriteWidth(), SPRITE_HEIGHT);
+        }
+    }
+    else
+        SetMultiColor(index == 1 ? 0 : 1, col);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of pixels in the sprite containing x/y which use the
+ * given index.
+ */
+int SpriteBitmap::CountIndex(unsigned x, unsigned y, int index) const
+{
+    const uint8_t* p;
+    unsigned char  val;
+    int            i, j, n, nSprite;
+
+    nSprite = GetSpriteNumber(x, y);
+    if (nSprite < 0)
+        return 0;
+
+    p = &m_aSprites[nSprite * SPRITE_BYTES];
+    n = 0;
+    for (i = 0; i < SPRITE_DATA_BYTES; ++i)
+    {
+        val = p[i];
+        if (m_bMultiColor)
+        {
+            for (j = 0; j < 4; ++j)
+            {
+                if (((val >> (2 * j)) & 0x03) == index)
+                    ++n;
+            }
+        }
+        else
+        {
+            for (j = 0; j < 8; ++j)
+            {
+                if (((val >> j) & 0x01) == index)
+                    ++n;
+            }
+        }
+    }
+    return n;
+}
+
+
+/*****************************************************************************/
+/**
+ * Write the color numbers of all indexes of sprite nSprite to pColors,
+ * which must have space for 4 of them. For -1, i.e. no sprite, all of them
+ * are the background.
+ */
+void SpriteBitmap::GetIndexColors(int nSprite, unsigned char* pColors) const
+{
+    unsigned char own;
+
+    if (nSprite < 0)
+        own = m_aSharedColors[0];
+    else
+        own = m_aSprites[nSprite * SPRITE_BYTES + SPRITE_DATA_BYTES] &
+              SPRITE_COLOR_MASK;
+
+    pColors[0] = m_aSharedColors[0];
+    if (m_bMultiColor)
+    {
+        pColors[1] = m_aSharedColors[1];
+        pColors[2] = own;
+        pColors[3] = m_aSharedColors[2];
+    }
+    else
+    {
+        pColors[1] = own;
+        pColors[2] = own;
+        pColors[3] = own;
+    }
+}
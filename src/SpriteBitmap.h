@@ -0,0 +1,202 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef SPRITEBITMAP_H
+#define SPRITEBITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "C64Color.h"
+#include "ToolBase.h"
+#include "BitmapBase.h"
+
+/* Each sprite is stored in a record of 64 bytes, the last one has its color */
+#define SPRITE_BYTES      64
+#define SPRITE_DATA_BYTES 63
+#define SPRITE_ROW_BYTES  3
+#define SPRITE_HEIGHT     21
+
+/* Byte 63: sprite color in the lower nibble and the multicolor flag */
+#define SPRITE_COLOR_MASK 0x0f
+#define SPRITE_MC_FLAG    0x80
+
+/* Width in pixels for hires and multicolor sprites */
+#define SPRITE_HIRES_WIDTH 24
+#define SPRITE_MC_WIDTH    12
+
+/* Sprites per row of a sheet and number of sprites of a new sheet */
+#define SPRITEBITMAP_COLUMNS         8
+#define SPRITEBITMAP_DEFAULT_SPRITES 64
+
+/* Number of sprites which fit into one VIC bank of 16 KB */
+#define SPRITEBITMAP_MAX_SPRITES     256
+
+/*****************************************************************************/
+/**
+ * A sheet of sprites, either all hires or all multicolor. The sprites are
+ * kept in one buffer of 64 byte records, exactly like they are stored in
+ * C64 memory, so files are loaded and saved with a single copy. On the
+ * sheet they are arranged in rows of SPRITEBITMAP_COLUMNS, each sprite is
+ * a cell.
+ *
+ * A sprite has one color of its own, which is stored in its last byte.
+ * The background and the two sprite multicolors ($d025/$d026) are shared
+ * by all sprites.
+ *
+ * Multicolor: index 0 is the background, 1 is multicolor 0, 2 is the
+ * sprite color and 3 is multicolor 1, like the bit pairs.
+ * Hires: index 0 is the background, 1 is the sprite color.
+ */
+class SpriteBitmap : public BitmapBase
+{
+public:
+    SpriteBitmap(bool bMultiColor = true,
+                 unsigned nSprites = SPRITEBITMAP_DEFAULT_SPRITES);
+    ~SpriteBitmap(void);
+    virtual BitmapBase* Copy() const;
+
+    virtual int GetWidth() const;
+    virtual int GetHeight() const;
+
+    virtual int GetCellWidth() const;
+    virtual int GetCellHeight() const;
+
+    virtual int GetPixelXFactor() const;
+
+    virtual int GetNIndexes() const;
+    virtual const C64Color* GetColorByIndex(int x, int y, int index) const;
+    virtual int CountColorByIndex(int x, int y, int index) const;
+
+    virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
+    virtual void SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode = MCDrawingModeIgnore);
+
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
+    virtual unsigned GetGlobalDataSize() const;
+    virtual void GetGlobalData(unsigned char* pData) const;
+    virtual void SetGlobalData(const unsigned char* pData);
+
+    bool IsMultiColor() const;
+    unsigned GetNSprites() const;
+    void SetNSprites(unsigned nSprites);
+
+    void SetSprites(const uint8_t* pSrc, unsigned nSprites);
+    const uint8_t* GetSprites() const;
+
+    void SetBackground(unsigned char col);
+    unsigned char GetBackground() const;
+    void SetMultiColor(int n, unsigned char col);
+    unsigned char GetMultiColor(int n) const;
+
+    static const C64Color black;
+
+protected:
+    int GetSpriteWidth() const;
+    int GetSpriteNumber(unsigned x, unsigned y) const;
+    int GetIndex(unsigned x, unsigned y) const;
+    void SetIndex(unsigned x, unsigned y, int index);
+    int GetIndexedColorNumber(unsigned x, unsigned y, int index) const;
+    void SetIndexedColor(unsigned x, unsigned y, int index,
+                         unsigned char col);
+    int CountIndex(unsigned x, unsigned y, int index) const;
+    void GetIndexColors(int nSprite, unsigned char* pColors) const;
+
+    /// true for multicolor sprites
+    bool                 m_bMultiColor;
+
+    /// Number of sprites on this sheet
+    unsigned             m_nSprites;
+
+    /// 64 bytes for each sprite, in C64 memory layout
+    std::vector<uint8_t> m_aSprites;
+
+    /// Background, multicolor 0 ($d025) and multicolor 1 ($d026)
+    unsigned char        m_aSharedColors[3];
+};
+
+
+/*****************************************************************************/
+/**
+ * Return true if this is a sheet of multicolor sprites.
+ */
+inline bool SpriteBitmap::IsMultiColor() const
+{
+    return m_bMultiColor;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of sprites on this sheet.
+ */
+inline unsigned SpriteBitmap::GetNSprites() const
+{
+    return m_nSprites;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return a pointer to the sprite data, GetNSprites() records of 64 bytes.
+ */
+inline const uint8_t* SpriteBitmap::GetSprites() const
+{
+    return m_aSprites.empty() ? NULL : &m_aSprites[0];
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the width of a sprite in pixels of this bitmap.
+ */
+inline int SpriteBitmap::GetSpriteWidth() const
+{
+    return m_bMultiColor ? SPRITE_MC_WIDTH : SPRITE_HIRES_WIDTH;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of the sprite which contains x/y or -1 if this place
+ * of the last row is empty. The coordinates must be valid.
+ */
+inline int SpriteBitmap::GetSpriteNumber(unsigned x, unsigned y) const
+{
+    unsigned n = (y / SPRITE_HEIGHT) * SPRITEBITMAP_COLUMNS +
+                 x / GetSpriteWidth();
+
+    return n < m_nSprites ? (int) n : -1;
+}
+
+#endif // SPRITEBITMAP_H
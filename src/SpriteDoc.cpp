@@ -0,0 +1,223 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+#include "MCApp.h"
+#include "SpriteDoc.h"
+#include "DocRenderer.h"
+
+/******************************************************************************/
+/**
+ * This is a list of all Filters for this image format. Both sprite types
+ * use the same files, the flag in each sprite tells which one it is.
+ */
+static FormatInfo::Filter m_aFilters[] =
+{
+    { wxT("Multicolor sprite files"), wxT("*.spr") },
+    { NULL, NULL }
+};
+
+static FormatInfo::Filter m_aFiltersHiRes[] =
+{
+    { wxT("HiRes sprite files"), wxT("*.spr") },
+    { NULL, NULL }
+};
+
+/**
+ * Information about this image format. The sizes of sprite files vary, so
+ * they are checked for all files.
+ *
+ * The multicolor format is registered first, it wins if a file matches
+ * both. Load finds out the actual type.
+ */
+FormatInfo SpriteDoc::m_formatInfo(
+    wxT("Multi Color Sprites"),
+    wxT("spr"),
+    m_aFilters,
+    SpriteDoc::Factory,
+    SpriteDoc::CheckFormat);
+
+FormatInfo SpriteDoc::m_formatInfoHiRes(
+    wxT("HiRes Sprites"),
+    wxT("spr"),
+    m_aFiltersHiRes,
+    SpriteDoc::FactoryHiRes,
+    SpriteDoc::CheckFormat);
+
+
+/******************************************************************************/
+/**
+ *
+ */
+SpriteDoc::SpriteDoc(bool bMultiColor)
+    : m_bitmap(bMultiColor)
+    , m_nLoadAddress(0)
+{
+    PrepareUndo();
+
+    // PrepareUndo sets m_bModified, reset it
+    m_bModified = false;
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class with multicolor sprites.
+ */
+DocBase* SpriteDoc::Factory()
+{
+    return new SpriteDoc(true);
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class with hires sprites.
+ */
+DocBase* SpriteDoc::FactoryHiRes()
+{
+    return new SpriteDoc(false);
+}
+
+
+/******************************************************************************/
+/**
+ * Check how good data matches our document format. Return a sum of
+ * MC_FORMAT_*_MATCH.
+ *
+ * A file consists of 64 byte records, maybe with a load address. Many
+ * files have such a size, so it only counts together with the extension.
+ */
+int SpriteDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                           const wxFileName& fileName)
+{
+    if (fileName.GetExt().CmpNoCase(wxT("spr")) != 0)
+        return 0;
+
+    if (len >= SPRITE_BYTES &&
+        (len % SPRITE_BYTES == 0 || len % SPRITE_BYTES == 2))
+        return MC_FORMAT_EXTENSION_MATCH + MC_FORMAT_SIZE_MATCH;
+
+    return MC_FORMAT_EXTENSION_MATCH;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our FormatInfo, it depends on the sprite type.
+ */
+const FormatInfo* SpriteDoc::GetFormatInfo() const
+{
+    return m_bitmap.IsMultiColor() ? &m_formatInfo : &m_formatInfoHiRes;
+}
+
+
+/******************************************************************************/
+/**
+ * Copy the contents of the given bitmap to our one. The pointer must point to
+ * an object which has actually the same type as our bitmap.
+ */
+void SpriteDoc::SetBitmap(const BitmapBase* pB)
+{
+    m_bitmap = *(SpriteBitmap*) pB;
+}
+
+
+/******************************************************************************/
+/**
+ * Try to load the file from the given memory buffer. Return true for success.
+ *
+ * If the size is a multiple of 64 plus 2, the file starts with a load
+ * address, which is written again when the file is saved.
+ */
+bool SpriteDoc::Load(const uint8_t* pBuff, unsigned size)
+{
+    if (size >= SPRITE_BYTES + 2 && size % SPRITE_BYTES == 2)
+    {
+        m_nLoadAddress = pBuff[0] + pBuff[1] * 256;
+        pBuff += 2;
+        size  -= 2;
+    }
+    else if (size >= SPRITE_BYTES && size % SPRITE_BYTES == 0)
+        m_nLoadAddress = 0;
+    else
+        return false;
+
+    m_bitmap.SetSprites(pBuff, size / SPRITE_BYTES);
+
+    return true;
+}
+
+
+/******************************************************************************
+ **
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success. The file name is for informational purposes only, e.g. to
+ * decide which sub-format to use.
+ *
+ * A .prg file always gets a load address, the one of the file loaded or
+ * SPRITEDOC_DEFAULT_LOAD_ADDRESS. Other files keep the layout of the file
+ * loaded.
+ */
+bool SpriteDoc::Save(std::vector<uint8_t>* pOut, const wxFileName& fileName)
+{
+    const uint8_t* pSprites = m_bitmap.GetSprites();
+    unsigned       nSize = m_bitmap.GetNSprites() * SPRITE_BYTES;
+    uint16_t       nLoadAddress = m_nLoadAddress;
+
+    if (!nLoadAddress && fileName.GetExt().CmpNoCase(wxT("prg")) == 0)
+        nLoadAddress = SPRITEDOC_DEFAULT_LOAD_ADDRESS;
+
+    if (nLoadAddress)
+    {
+        pOut->resize(2);
+        (*pOut)[0] = nLoadAddress % 0x100;
+        (*pOut)[1] = nLoadAddress / 0x100;
+        pOut->insert(pOut->end(), pSprites, pSprites + nSize);
+    }
+    else
+        pOut->assign(pSprites, pSprites + nSize);
+
+    return true;
+}
+
+
+/******************************************************************************/
+/**
+ * Change the number of sprites on our sheet. Return true if it has been
+ * changed.
+ */
+bool SpriteDoc::SetNSpritesBitmap(unsigned nSprites)
+{
+    if (nSprites == 0 || nSprites > SPRITEBITMAP_MAX_SPRITES ||
+        nSprites == m_bitmap.GetNSprites())
+        return false;
+
+    m_bitmap.SetNSprites(nSprites);
+    return true;
+}
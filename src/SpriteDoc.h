@@ -0,0 +1,104 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef SPRITEDOC_H
+#define SPRITEDOC_H
+
+#include <list>
+#include <vector>
+
+#include "SpriteBitmap.h"
+#include "DocBase.h"
+#include "FormatInfo.h"
+
+/* Load address written to .prg files if the file loaded had none */
+#define SPRITEDOC_DEFAULT_LOAD_ADDRESS 0x2000
+
+class DocRenderer;
+
+class SpriteDoc : public DocBase
+{
+public:
+    SpriteDoc(bool bMultiColor);
+    static DocBase* Factory();
+    static DocBase* FactoryHiRes();
+    static int CheckFormat(const uint8_t* pBuff, unsigned len,
+                           const wxFileName& fileName);
+
+    virtual const FormatInfo* GetFormatInfo() const;
+
+    const BitmapBase* GetBitmap() const;
+    virtual BitmapBase* GetBitmap();
+    virtual void SetBitmap(const BitmapBase*);
+
+    virtual unsigned GetNSprites() const;
+
+protected:
+    virtual bool Load(const uint8_t* pBuff, unsigned size);
+    virtual bool Save(std::vector<uint8_t>* pOut, const wxFileName& fileName);
+    virtual bool SetNSpritesBitmap(unsigned nSprites);
+
+    static FormatInfo m_formatInfo;
+    static FormatInfo m_formatInfoHiRes;
+
+    /// The bitmap under work
+    SpriteBitmap  m_bitmap;
+
+    /// Load address of the file or 0 if it had none, see Save
+    uint16_t      m_nLoadAddress;
+};
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our bitmap (const).
+ */
+inline const BitmapBase* SpriteDoc::GetBitmap() const
+{
+    return &m_bitmap;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our bitmap.
+ */
+inline BitmapBase* SpriteDoc::GetBitmap()
+{
+    return &m_bitmap;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of sprites on our sheet.
+ */
+inline unsigned SpriteDoc::GetNSprites() const
+{
+    return m_bitmap.GetNSprites();
+}
+
+
+#endif // SPRITEDOC_H
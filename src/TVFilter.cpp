@@ -0,0 +1,262 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include "TVFilter.h"
+
+#ifdef MC_TVFILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#define FIXP_SHIFT 16
+
+/* Ein EWMA-Filter.
+ * CONST ist der Exponent fuer die Filterkonstante 1 - 1/(2^CONST)
+ */
+#define PAINT_FILTER(F,X,CONST) ( (F)+=(X)-(F) - (((X)-(F))>>(CONST)) )
+
+/* Weights of R, G and B for the luma, sum is 256 */
+#define LUMA_R  77
+#define LUMA_G 150
+#define LUMA_B  29
+
+
+/*****************************************************************************/
+/**
+ * Constructor.
+ */
+TVFilter::TVFilter() :
+    m_kernel(MCTVFilterEWMA)
+{
+}
+
+
+/*****************************************************************************/
+/**
+ * Select the kernel to be used from now.
+ */
+void TVFilter::SetKernel(MCTVFilterKernel kernel)
+{
+    m_kernel = kernel;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the filter exponent for the given zoom level. The filter constant
+ * is 1 - 1/(2^shift), so a larger shift follows the input faster and blurs
+ * less. At zoom 2:1 a pixel needs more pixels at its right to fade.
+ */
+int TVFilter::GetShift(unsigned nZoom)
+{
+    return nZoom >= 2 ? 1 : 2;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of (screen) pixels right of a change which may be
+ * affected by it. Each pixel reduces the influence of a change to
+ * 1/(2^shift), after this distance it is below the fixed point precision.
+ *
+ * The PAL kernel doesn't need more: Its chroma filter uses the same shift
+ * as the other kernels, its luma filter follows the input faster.
+ */
+unsigned TVFilter::GetMargin(unsigned nZoom) const
+{
+    int shift = GetShift(nZoom);
+
+    return (FIXP_SHIFT + 8 + shift - 1) / shift;
+}
+
+
+/*****************************************************************************/
+/**
+ * Filter nPixels RGB pixels at pRGB in place. The filter always starts with
+ * a dark gray, as the border left of the line.
+ */
+void TVFilter::FilterLine(unsigned char* pRGB, unsigned nPixels,
+                          unsigned nZoom) const
+{
+    if (m_kernel == MCTVFilterPAL)
+        FilterLinePAL(pRGB, nPixels, GetShift(nZoom) + 1, GetShift(nZoom));
+    else
+        FilterLineEWMA(pRGB, nPixels, GetShift(nZoom));
+}
+
+
+/*****************************************************************************/
+/**
+ * Filter each of R, G and B with an EWMA filter.
+ *
+ * The SSE2 version keeps R, G and B in three lanes of one register, so the
+ * filter for all channels is calculated at once.
+ */
+void TVFilter::FilterLineEWMA(unsigned char* pRGB, unsigned nPixels,
+                              int shift) const
+{
+#ifdef MC_TVFILTER_SSE2
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    __m128i       f, x, d;
+    unsigned      v;
+
+    f = _mm_set1_epi32(64 << FIXP_SHIFT);
+    while (nPixels--)
+    {
+        x = _mm_cvtsi32_si128(pRGB[0] | (pRGB[1] << 8) | (pRGB[2] << 16));
+        x = _mm_unpacklo_epi8(x, zero);
+        x = _mm_unpacklo_epi16(x, zero);
+        x = _mm_slli_epi32(x, FIXP_SHIFT);
+
+        d = _mm_sub_epi32(x, f);
+        f = _mm_add_epi32(f, _mm_sub_epi32(d, _mm_sra_epi32(d, count)));
+
+        x = _mm_srli_epi32(f, FIXP_SHIFT);
+        x = _mm_packs_epi32(x, x);
+        x = _mm_packus_epi16(x, x);
+        v = _mm_cvtsi128_si32(x);
+
+        *pRGB++ = v;
+        *pRGB++ = v >> 8;
+        *pRGB++ = v >> 16;
+    }
+#else
+    int fixr, fixg, fixb;
+
+    fixr = fixg = fixb = 64 << FIXP_SHIFT;
+    while (nPixels--)
+    {
+        PAINT_FILTER(fixr, pRGB[0] << FIXP_SHIFT, shift);
+        PAINT_FILTER(fixg, pRGB[1] << FIXP_SHIFT, shift);
+        PAINT_FILTER(fixb, pRGB[2] << FIXP_SHIFT, shift);
+        *pRGB++ = fixr >> FIXP_SHIFT;
+        *pRGB++ = fixg >> FIXP_SHIFT;
+        *pRGB++ = fixb >> FIXP_SHIFT;
+    }
+#endif
+}
+
+
+/*****************************************************************************/
+/**
+ * Filter luma with the constant shiftLuma and chroma with the (smaller)
+ * constant shiftChroma, so chroma is blurred more than luma.
+ *
+ * Both filters are linear, so we can run a fast and a slow EWMA on RGB and
+ * take the slow result with the luma of the fast one:
+ *
+ *   out = slow + (luma(fast) - luma(slow))
+ *
+ * Adding the same value to R, G and B only changes the luma.
+ */
+void TVFilter::FilterLinePAL(unsigned char* pRGB, unsigned nPixels,
+                             int shiftLuma, int shiftChroma) const
+{
+    int      aFast[4], aSlow[4];    // 8.8 fixed point
+    int      i, diff, val;
+#ifdef MC_TVFILTER_SSE2
+    const __m128i zero        = _mm_setzero_si128();
+    const __m128i countLuma   = _mm_cvtsi32_si128(shiftLuma);
+    const __m128i countChroma = _mm_cvtsi32_si128(shiftChroma);
+    __m128i       fast, slow, x, d;
+
+    fast = slow = _mm_set1_epi32(64 << FIXP_SHIFT);
+#else
+    int      aFixFast[3], aFixSlow[3];
+
+    for (i = 0; i < 3; ++i)
+        aFixFast[i] = aFixSlow[i] = 64 << FIXP_SHIFT;
+#endif
+
+    while (nPixels--)
+    {
+#ifdef MC_TVFILTER_SSE2
+        x = _mm_cvtsi32_si128(pRGB[0] | (pRGB[1] << 8) | (pRGB[2] << 16));
+        x = _mm_unpacklo_epi8(x, zero);
+        x = _mm_unpacklo_epi16(x, zero);
+        x = _mm_slli_epi32(x, FIXP_SHIFT);
+
+        d    = _mm_sub_epi32(x, fast);
+        fast = _mm_add_epi32(fast,
+                             _mm_sub_epi32(d, _mm_sra_epi32(d, countLuma)));
+        d    = _mm_sub_epi32(x, slow);
+        slow = _mm_add_epi32(slow,
+                             _mm_sub_epi32(d, _mm_sra_epi32(d, countChroma)));
+
+        _mm_storeu_si128((__m128i*) aFast,
+                         _mm_srai_epi32(fast, FIXP_SHIFT - 8));
+        _mm_storeu_si128((__m128i*) aSlow,
+                         _mm_srai_epi32(slow, FIXP_SHIFT - 8));
+#else
+        for (i = 0; i < 3; ++i)
+        {
+            PAINT_FILTER(aFixFast[i], pRGB[i] << FIXP_SHIFT, shiftLuma);
+            PAINT_FILTER(aFixSlow[i], pRGB[i] << FIXP_SHIFT, shiftChroma);
+            aFast[i] = aFixFast[i] >> (FIXP_SHIFT - 8);
+            aSlow[i] = aFixSlow[i] >> (FIXP_SHIFT - 8);
+        }
+#endif
+        diff = (LUMA_R * (aFast[0] - aSlow[0]) +
+                LUMA_G * (aFast[1] - aSlow[1]) +
+                LUMA_B * (aFast[2] - aSlow[2])) >> 8;
+
+        for (i = 0; i < 3; ++i)
+        {
+            val = (aSlow[i] + diff + 0x80) >> 8;
+            if (val < 0)
+                val = 0;
+            else if (val > 0xff)
+                val = 0xff;
+            *pRGB++ = val;
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Darken nPixels RGB pixels at pRGB to 3/4 of their brightness. This is
+ * used for the dark gap between two scanlines.
+ */
+void TVFilter::DarkenLine(unsigned char* pRGB, unsigned nPixels) const
+{
+    unsigned nBytes = nPixels * 3;
+#ifdef MC_TVFILTER_SSE2
+    const __m128i mask = _mm_set1_epi8(0x3f);
+    __m128i       v, q;
+
+    for (; nBytes >= 16; nBytes -= 16, pRGB += 16)
+    {
+        v = _mm_loadu_si128((const __m128i*) pRGB);
+        q = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+        _mm_storeu_si128((__m128i*) pRGB, _mm_sub_epi8(v, q));
+    }
+#endif
+    while (nBytes--)
+    {
+        *pRGB -= *pRGB >> 2;
+        ++pRGB;
+    }
+}
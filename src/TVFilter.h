@@ -0,0 +1,106 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef TVFILTER_H
+#define TVFILTER_H
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MC_TVFILTER_SSE2
+#endif
+
+typedef enum TVFilterKernel_e
+{
+    MCTVFilterEWMA,
+    MCTVFilterPAL,
+    MCTVFilterScanlines
+}
+MCTVFilterKernel;
+
+/*****************************************************************************/
+/**
+ * Emulates the blur of a TV on RGB scanlines, as they are stored in a
+ * wxImage.
+ *
+ * All kernels work from the left to the right, so a change of a pixel
+ * affects some pixels at its right side. GetMargin tells how many, so
+ * callers can recompute only the affected part of a line: they start the
+ * filter this number of pixels left of the changed area and update this
+ * number of pixels at its right.
+ *
+ * MCTVFilterEWMA:      A simple exponentially weighted moving average on
+ *                      each of R, G and B.
+ * MCTVFilterPAL:       Chroma is filtered like above, luma follows the
+ *                      input faster, so colors are smeared over a longer
+ *                      distance than brightness, as a PAL TV does it.
+ * MCTVFilterScanlines: Like EWMA, but every second line is darkened when
+ *                      the image is zoomed vertically.
+ */
+class TVFilter
+{
+public:
+    TVFilter();
+
+    void SetKernel(MCTVFilterKernel kernel);
+    MCTVFilterKernel GetKernel() const;
+
+    unsigned GetMargin(unsigned nZoom) const;
+    bool HasScanlines() const;
+
+    void FilterLine(unsigned char* pRGB, unsigned nPixels,
+                    unsigned nZoom) const;
+    void DarkenLine(unsigned char* pRGB, unsigned nPixels) const;
+
+protected:
+    static int GetShift(unsigned nZoom);
+
+    void FilterLineEWMA(unsigned char* pRGB, unsigned nPixels,
+                        int shift) const;
+    void FilterLinePAL(unsigned char* pRGB, unsigned nPixels,
+                       int shiftLuma, int shiftChroma) const;
+
+    MCTVFilterKernel m_kernel;
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the kernel currently used.
+ */
+inline MCTVFilterKernel TVFilter::GetKernel() const
+{
+    return m_kernel;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return true if the current kernel wants every second line to be darkened.
+ */
+inline bool TVFilter::HasScanlines() const
+{
+    return m_kernel == MCTVFilterScanlines;
+}
+
+#endif // TVFILTER_H
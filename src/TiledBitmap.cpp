@@ -0,0 +1,675 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <map>
+
+#include "TiledBitmap.h"
+#include "ToolBase.h"
+
+
+const C64Color TiledBitmap::black;
+
+const TiledBitmap::Tile TiledBitmap::m_tileEmpty =
+    TiledBitmap::InitEmptyTile();
+
+
+/*****************************************************************************/
+/**
+ * Create an empty canvas of the given size in cells.
+ */
+TiledBitmap::TiledBitmap(unsigned nXCells, unsigned nYCells) :
+    m_nXCells(0),
+    m_nYCells(0),
+    m_nXTiles(0),
+    m_nBackground(MC_BLACK)
+{
+    SetSize(nXCells, nYCells);
+    ResetDirty();
+    ResetChanged();
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy constructor. The copy shares all tiles with the original.
+ */
+TiledBitmap::TiledBitmap(const TiledBitmap& r) :
+    BitmapBase(r),
+    m_aTiles(r.m_aTiles),
+    m_nXCells(r.m_nXCells),
+    m_nYCells(r.m_nYCells),
+    m_nXTiles(r.m_nXTiles),
+    m_nBackground(r.m_nBackground)
+{
+    unsigned i;
+
+    for (i = 0; i < m_aTiles.size(); ++i)
+    {
+        if (m_aTiles[i])
+            ++m_aTiles[i]->nRefs;
+    }
+}
+
+
+/*****************************************************************************/
+TiledBitmap::~TiledBitmap(void)
+{
+    ReleaseTiles();
+}
+
+
+/*****************************************************************************/
+/**
+ * Make this bitmap a copy of r, which shares all tiles with it.
+ */
+TiledBitmap& TiledBitmap::operator=(const TiledBitmap& r)
+{
+    unsigned i;
+
+    if (this == &r)
+        return *this;
+
+    // count the new references first, r may share tiles with us
+    for (i = 0; i < r.m_aTiles.size(); ++i)
+    {
+        if (r.m_aTiles[i])
+            ++r.m_aTiles[i]->nRefs;
+    }
+    ReleaseTiles();
+
+    BitmapBase::operator=(r);
+    m_aTiles      = r.m_aTiles;
+    m_nXCells     = r.m_nXCells;
+    m_nYCells     = r.m_nYCells;
+    m_nXTiles     = r.m_nXTiles;
+    m_nBackground = r.m_nBackground;
+
+    return *this;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to a copy of this bitmap created with "new". The tiles
+ * are shared with the copy until one of them is written to.
+ */
+BitmapBase* TiledBitmap::Copy() const
+{
+    return new TiledBitmap(*this);
+}
+
+
+/******************************************************************************/
+/**
+ * Return the width of the canvas in pixels, it depends on its size.
+ */
+int TiledBitmap::GetWidth() const
+{
+    return m_nXCells * MCBLOCK_WIDTH;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the height of the canvas in pixels, it depends on its size.
+ */
+int TiledBitmap::GetHeight() const
+{
+    return m_nYCells * MCBLOCK_HEIGHT;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the width of a cell in pixels, as for a multicolor bitmap.
+ */
+int TiledBitmap::GetCellWidth() const
+{
+    return MCBLOCK_WIDTH;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the pixel factor in X-direction. 2 for MC.
+ */
+int TiledBitmap::GetPixelXFactor() const
+{
+    return 2;
+}
+
+
+/*****************************************************************************/
+/**
+ * Each cell has the background and three colors of its own.
+ */
+int TiledBitmap::GetNIndexes() const
+{
+    return 4;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of an index in the cell which contains the given
+ * coordinates. If the coordinates are out of range, return black.
+ */
+const C64Color* TiledBitmap::GetColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return GetMCBlock(x, y).GetIndexedColor(index);
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the number of pixels of an index in the cell which contains the
+ * given coordinates. If the coordinates are out of range, return 0.
+ */
+int TiledBitmap::CountColorByIndex(int x, int y, int index) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return GetMCBlock(x, y).CountIndexedColor(index);
+    else
+        return 0;
+}
+
+
+/******************************************************************************/
+/**
+ * Return the color of a pixel. If the coordinates are out of range, return
+ * black.
+ */
+const C64Color* TiledBitmap::GetColor(int x, int y) const
+{
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+        return C64Color::GetPaletteColor(GetColorNumber(x, y));
+    else
+        return &black;
+}
+
+
+/******************************************************************************/
+/**
+ * Write the C64 color numbers of w pixels starting at x/y to pDest. The
+ * caller must make sure that the whole row is inside of the bitmap.
+ *
+ * The tile is looked up once per cell, so this costs about the same as
+ * MCBitmap::GetColorRow.
+ */
+void TiledBitmap::GetColorRow(int x, int y, int w, unsigned char* pDest) const
+{
+    const Tile*   pTile;
+    unsigned      xCell, yCell, cell, xPixel, val;
+    unsigned char aColors[4];
+
+    xCell  = x / MCBLOCK_WIDTH;
+    yCell  = y / MCBLOCK_HEIGHT;
+    xPixel = x % MCBLOCK_WIDTH;
+
+    aColors[0] = m_nBackground;
+    while (w > 0)
+    {
+        pTile = GetTile(xCell, yCell);
+        cell  = GetCellInTile(xCell, yCell);
+
+        aColors[1] = pTile->aScreenRAM[cell] >> 4;
+        aColors[2] = pTile->aScreenRAM[cell] & 0x0f;
+        aColors[3] = pTile->aColorRAM[cell];
+
+        val = pTile->aBitmapRAM[cell * MCBITMAP_BYTES_PER_BLOCK +
+                                y % MCBLOCK_HEIGHT];
+        for (; xPixel < MCBLOCK_WIDTH && w > 0; ++xPixel, --w)
+            *pDest++ = aColors[(val >> (2 * (MCBLOCK_WIDTH - 1 - xPixel))) &
+                               0x03];
+
+        xPixel = 0;
+        ++xCell;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Set a pixel like MCBitmap::SetPixel does.
+ *
+ * Drawing with the background color into a tile which has not been
+ * allocated yet doesn't change anything, so the tile is left alone.
+ */
+void TiledBitmap::SetPixel(int x, int y,
+                           const C64Color& col, MCDrawingMode mode)
+{
+    unsigned xCell, yCell;
+
+    if ((x >= 0) && (y >= 0) && (x < GetWidth()) && (y < GetHeight()))
+    {
+        xCell = x / MCBLOCK_WIDTH;
+        yCell = y / MCBLOCK_HEIGHT;
+
+        if (mode == MCDrawingModeIndex0)
+            SetBackground((unsigned char) col.GetColor());
+        else if (mode < MCDrawingModeIndex0 &&
+                 col.GetColor() == m_nBackground &&
+                 GetTile(xCell, yCell) == &m_tileEmpty)
+            return;
+
+        GetMCBlock(x, y).SetPixel(x % MCBLOCK_WIDTH, y % MCBLOCK_HEIGHT,
+                                  col, mode);
+
+        // this may change the whole block
+        Dirty(xCell * MCBLOCK_WIDTH, yCell * MCBLOCK_HEIGHT,
+              MCBLOCK_WIDTH, MCBLOCK_HEIGHT);
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of bytes needed to store one cell: 8 bytes bitmap,
+ * one byte screen RAM and one byte color RAM, like in an MCBitmap.
+ */
+unsigned TiledBitmap::GetCellDataSize() const
+{
+    return MCBITMAP_BYTES_PER_BLOCK + 2;
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy the data of the cell xCell/yCell to pData. The cell coordinates must
+ * be valid.
+ */
+void TiledBitmap::GetCellData(int xCell, int yCell,
+                              unsigned char* pData) const
+{
+    const Tile* pTile = GetTile(xCell, yCell);
+    unsigned    cell  = GetCellInTile(xCell, yCell);
+
+    memcpy(pData, pTile->aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK,
+           MCBITMAP_BYTES_PER_BLOCK);
+    pData[MCBITMAP_BYTES_PER_BLOCK]     = pTile->aScreenRAM[cell];
+    pData[MCBITMAP_BYTES_PER_BLOCK + 1] = pTile->aColorRAM[cell];
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the data of the cell xCell/yCell from pData, which has been filled
+ * by GetCellData before. The cell coordinates must be valid.
+ *
+ * An empty cell doesn't need a tile to be allocated.
+ */
+void TiledBitmap::SetCellData(int xCell, int yCell,
+                              const unsigned char* pData)
+{
+    static const unsigned char aEmpty[MCBITMAP_BYTES_PER_BLOCK + 2] = { 0 };
+    Tile*    pTile;
+    unsigned cell = GetCellInTile(xCell, yCell);
+
+    if (GetTile(xCell, yCell) != &m_tileEmpty ||
+        memcmp(pData, aEmpty, sizeof(aEmpty)) != 0)
+    {
+        pTile = GetWritableTile(xCell, yCell);
+        memcpy(pTile->aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK, pData,
+               MCBITMAP_BYTES_PER_BLOCK);
+        pTile->aScreenRAM[cell] = pData[MCBITMAP_BYTES_PER_BLOCK];
+        pTile->aColorRAM[cell]  = pData[MCBITMAP_BYTES_PER_BLOCK + 1] & 0x0f;
+        CountUsage(pTile, cell);
+    }
+
+    Dirty(xCell * MCBLOCK_WIDTH, yCell * MCBLOCK_HEIGHT,
+          MCBLOCK_WIDTH, MCBLOCK_HEIGHT);
+}
+
+
+/*****************************************************************************/
+/**
+ * The only global data of a multicolor canvas is the background color.
+ */
+unsigned TiledBitmap::GetGlobalDataSize() const
+{
+    return 1;
+}
+
+
+/*****************************************************************************/
+/**
+ * Store the background color in pData[0].
+ */
+void TiledBitmap::GetGlobalData(unsigned char* pData) const
+{
+    pData[0] = m_nBackground;
+}
+
+
+/*****************************************************************************/
+/**
+ * Set the background color from pData[0].
+ */
+void TiledBitmap::SetGlobalData(const unsigned char* pData)
+{
+    if (pData[0] != m_nBackground)
+        SetBackground(pData[0] & 0x0f);
+}
+
+
+/*****************************************************************************/
+/**
+ * Change the size of the canvas. The size is limited to
+ * TILEDBITMAP_MAX_XCELLS x TILEDBITMAP_MAX_YCELLS cells. All cells are
+ * cleared, no tile is allocated.
+ */
+void TiledBitmap::SetSize(unsigned nXCells, unsigned nYCells)
+{
+    unsigned nYTiles;
+
+    if (nXCells < 1)
+        nXCells = 1;
+    else if (nXCells > TILEDBITMAP_MAX_XCELLS)
+        nXCells = TILEDBITMAP_MAX_XCELLS;
+
+    if (nYCells < 1)
+        nYCells = 1;
+    else if (nYCells > TILEDBITMAP_MAX_YCELLS)
+        nYCells = TILEDBITMAP_MAX_YCELLS;
+
+    ReleaseTiles();
+
+    m_nXCells = nXCells;
+    m_nYCells = nYCells;
+    m_nXTiles = (nXCells + TILEDBITMAP_TILE_CELLS - 1) >>
+                TILEDBITMAP_TILE_SHIFT;
+    nYTiles   = (nYCells + TILEDBITMAP_TILE_CELLS - 1) >>
+                TILEDBITMAP_TILE_SHIFT;
+    m_aTiles.assign(m_nXTiles * nYTiles, NULL);
+
+    // the dirty and changed cells are numbered for the old size
+    ResetDirty();
+    ResetChanged();
+    Dirty(0, 0, GetWidth(), GetHeight());
+}
+
+
+/*****************************************************************************/
+void TiledBitmap::SetBackground(unsigned char col)
+{
+    m_nBackground = col & 0x0f;
+
+    // this may change the whole bitmap
+    Dirty(0, 0, GetWidth(), GetHeight());
+}
+
+
+/*****************************************************************************/
+unsigned char TiledBitmap::GetBackground() const
+{
+    return m_nBackground;
+}
+
+
+/*****************************************************************************/
+/**
+ * Set all cells of the canvas. The cells are given in rows from the top left
+ * to the bottom right. pBitmap contains 8 bytes per cell, pScreen and
+ * pColor one byte per cell, like MCBitmap stores them for a single screen.
+ *
+ * Only tiles which contain cells which are not empty are allocated, then
+ * identical tiles are shared.
+ */
+void TiledBitmap::SetCells(const uint8_t* pBitmap, const uint8_t* pScreen,
+                           const uint8_t* pColor)
+{
+    Tile*    pTile;
+    unsigned xCell, yCell, cell, i, y;
+    bool     bEmpty;
+
+    ReleaseTiles();
+
+    for (yCell = 0; yCell < m_nYCells; ++yCell)
+    {
+        for (xCell = 0; xCell < m_nXCells; ++xCell)
+        {
+            i = yCell * m_nXCells + xCell;
+
+            bEmpty = pScreen[i] == 0 && (pColor[i] & 0x0f) == 0;
+            for (y = 0; y < MCBITMAP_BYTES_PER_BLOCK && bEmpty; ++y)
+                bEmpty = pBitmap[i * MCBITMAP_BYTES_PER_BLOCK + y] == 0;
+            if (bEmpty)
+                continue;
+
+            pTile = GetWritableTile(xCell, yCell);
+            cell  = GetCellInTile(xCell, yCell);
+            memcpy(pTile->aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK,
+                   pBitmap + i * MCBITMAP_BYTES_PER_BLOCK,
+                   MCBITMAP_BYTES_PER_BLOCK);
+            pTile->aScreenRAM[cell] = pScreen[i];
+            pTile->aColorRAM[cell]  = pColor[i] & 0x0f;
+            CountUsage(pTile, cell);
+        }
+    }
+
+    ShareTiles();
+    Dirty(0, 0, GetWidth(), GetHeight());
+}
+
+
+/*****************************************************************************/
+/**
+ * Copy all cells of the canvas in the order used by SetCells.
+ */
+void TiledBitmap::GetCells(uint8_t* pBitmap, uint8_t* pScreen,
+                           uint8_t* pColor) const
+{
+    const Tile* pTile;
+    unsigned    xCell, yCell, cell, i;
+
+    for (yCell = 0; yCell < m_nYCells; ++yCell)
+    {
+        for (xCell = 0; xCell < m_nXCells; ++xCell)
+        {
+            i     = yCell * m_nXCells + xCell;
+            pTile = GetTile(xCell, yCell);
+            cell  = GetCellInTile(xCell, yCell);
+
+            memcpy(pBitmap + i * MCBITMAP_BYTES_PER_BLOCK,
+                   pTile->aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK,
+                   MCBITMAP_BYTES_PER_BLOCK);
+            pScreen[i] = pTile->aScreenRAM[cell];
+            pColor[i]  = pTile->aColorRAM[cell];
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Let identical tiles share their memory and free tiles which are empty.
+ * This doesn't change the contents of the canvas. Tiles are compared by a
+ * hash first, so this takes linear time.
+ */
+void TiledBitmap::ShareTiles()
+{
+    std::multimap<uint32_t, Tile*> mapTiles;
+    std::multimap<uint32_t, Tile*>::iterator it, itEnd;
+    Tile*    pTile;
+    Tile*    pSame;
+    uint32_t hash;
+    unsigned i;
+
+    for (i = 0; i < m_aTiles.size(); ++i)
+    {
+        pTile = m_aTiles[i];
+        if (!pTile)
+            continue;
+
+        pSame = NULL;
+        if (!IsSameTile(pTile, &m_tileEmpty))
+        {
+            hash  = HashTile(pTile);
+            itEnd = mapTiles.upper_bound(hash);
+            for (it = mapTiles.lower_bound(hash); it != itEnd; ++it)
+            {
+                if (it->second == pTile || IsSameTile(it->second, pTile))
+                {
+                    pSame = it->second;
+                    break;
+                }
+            }
+
+            if (!pSame)
+            {
+                mapTiles.insert(std::make_pair(hash, pTile));
+                continue;
+            }
+            ++pSame->nRefs;
+        }
+
+        if (--pTile->nRefs == 0)
+            delete pTile;
+        m_aTiles[i] = pSame;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the tile which contains the given cell for writing. If it has not
+ * been allocated yet, an empty one is created. If it is shared with other
+ * bitmaps, we get our own copy. The cell coordinates must be valid.
+ */
+TiledBitmap::Tile* TiledBitmap::GetWritableTile(unsigned xCell,
+                                                unsigned yCell)
+{
+    Tile** ppTile;
+    Tile*  pTile;
+
+    ppTile = &m_aTiles[(yCell >> TILEDBITMAP_TILE_SHIFT) * m_nXTiles +
+                       (xCell >> TILEDBITMAP_TILE_SHIFT)];
+    pTile  = *ppTile;
+
+    if (!pTile)
+        pTile = new Tile(m_tileEmpty);
+    else if (pTile->nRefs > 1)
+    {
+        --pTile->nRefs;
+        pTile = new Tile(*pTile);
+    }
+    else
+        return pTile;
+
+    pTile->nRefs = 1;
+    *ppTile = pTile;
+    return pTile;
+}
+
+
+/*****************************************************************************/
+/**
+ * Drop our references to all tiles, the canvas is empty afterwards.
+ */
+void TiledBitmap::ReleaseTiles()
+{
+    unsigned i;
+
+    for (i = 0; i < m_aTiles.size(); ++i)
+    {
+        if (m_aTiles[i] && --m_aTiles[i]->nRefs == 0)
+            delete m_aTiles[i];
+        m_aTiles[i] = NULL;
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Count the pixels of each color index in the given cell of a tile from
+ * scratch.
+ */
+void TiledBitmap::CountUsage(Tile* pTile, unsigned cell)
+{
+    unsigned y;
+
+    memset(pTile->aUsage[cell], 0, sizeof(pTile->aUsage[cell]));
+    for (y = 0; y < MCBITMAP_BYTES_PER_BLOCK; ++y)
+        MCBlock::CountBitmapByte(pTile->aUsage[cell],
+            pTile->aBitmapRAM[cell * MCBITMAP_BYTES_PER_BLOCK + y], 1);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return true if both tiles have the same contents. The usage counters
+ * follow from the bitmap, so they are not compared.
+ */
+bool TiledBitmap::IsSameTile(const Tile* pTile1, const Tile* pTile2)
+{
+    return memcmp(pTile1->aBitmapRAM, pTile2->aBitmapRAM,
+                  sizeof(pTile1->aBitmapRAM)) == 0 &&
+           memcmp(pTile1->aScreenRAM, pTile2->aScreenRAM,
+                  sizeof(pTile1->aScreenRAM)) == 0 &&
+           memcmp(pTile1->aColorRAM, pTile2->aColorRAM,
+                  sizeof(pTile1->aColorRAM)) == 0;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return a hash (FNV-1a) of the contents of a tile.
+ */
+uint32_t TiledBitmap::HashTile(const Tile* pTile)
+{
+    uint32_t hash = 2166136261u;
+    unsigned i;
+
+    for (i = 0; i < sizeof(pTile->aBitmapRAM); ++i)
+        hash = (hash ^ pTile->aBitmapRAM[i]) * 16777619u;
+    for (i = 0; i < TILEDBITMAP_TILE_NCELLS; ++i)
+    {
+        hash = (hash ^ pTile->aScreenRAM[i]) * 16777619u;
+        hash = (hash ^ pTile->aColorRAM[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the contents of a tile which has not been drawn into: All pixels
+ * use index 0, the background.
+ */
+TiledBitmap::Tile TiledBitmap::InitEmptyTile()
+{
+    Tile     tile;
+    unsigned cell;
+
+    memset(&tile, 0, sizeof(tile));
+    for (cell = 0; cell < TILEDBITMAP_TILE_NCELLS; ++cell)
+        tile.aUsage[cell][0] = MCBLOCK_WIDTH * MCBLOCK_HEIGHT;
+
+    return tile;
+}
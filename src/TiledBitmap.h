@@ -0,0 +1,291 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef TILEDBITMAP_H
+#define TILEDBITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "C64Color.h"
+#include "ToolBase.h"
+#include "BitmapBase.h"
+#include "MCBitmap.h"
+#include "MCBlock.h"
+
+/* A tile has (1 << TILEDBITMAP_TILE_SHIFT) cells in each direction */
+#define TILEDBITMAP_TILE_SHIFT  3
+#define TILEDBITMAP_TILE_CELLS  (1 << TILEDBITMAP_TILE_SHIFT)
+#define TILEDBITMAP_TILE_NCELLS (TILEDBITMAP_TILE_CELLS * TILEDBITMAP_TILE_CELLS)
+
+/* Size of a new canvas in cells: 40 screens for a horizontal scroller */
+#define TILEDBITMAP_DEFAULT_XCELLS (40 * MCBITMAP_XBLOCKS)
+#define TILEDBITMAP_DEFAULT_YCELLS MCBITMAP_YBLOCKS
+
+/* Largest canvas in cells */
+#define TILEDBITMAP_MAX_XCELLS 4096
+#define TILEDBITMAP_MAX_YCELLS 1024
+
+/*****************************************************************************/
+/**
+ * A multicolor bitmap of almost any size, e.g. for scrollers and game maps.
+ * Each 4x8 cell has its own screen RAM and color RAM byte, the background
+ * color is shared by the whole canvas, just like in an MCBitmap.
+ *
+ * The cells are stored in tiles of TILEDBITMAP_TILE_CELLS x
+ * TILEDBITMAP_TILE_CELLS cells. A tile which has never been drawn into is
+ * not allocated, it reads like a tile with all pixels in the background
+ * color. Tiles are reference counted and shared between copies of a bitmap,
+ * so copies made for the undo buffer or as backup during a tool operation
+ * only cost a pointer per tile. A tile is copied when a shared one is
+ * written to. ShareTiles also lets identical tiles share their memory, e.g.
+ * after loading a map which repeats the same graphics.
+ *
+ * A pixel is found with two lookups, tile and cell, so GetColor and SetPixel
+ * don't depend on the size of the canvas.
+ *
+ * The reference counters are not protected by a lock, so bitmaps which
+ * share tiles must be used by one thread only.
+ */
+class TiledBitmap : public BitmapBase
+{
+public:
+    TiledBitmap(unsigned nXCells = TILEDBITMAP_DEFAULT_XCELLS,
+                unsigned nYCells = TILEDBITMAP_DEFAULT_YCELLS);
+    TiledBitmap(const TiledBitmap& r);
+    ~TiledBitmap(void);
+    TiledBitmap& operator=(const TiledBitmap& r);
+    virtual BitmapBase* Copy() const;
+
+    virtual int GetWidth() const;
+    virtual int GetHeight() const;
+
+    virtual int GetCellWidth() const;
+
+    virtual int GetPixelXFactor() const;
+
+    virtual int GetNIndexes() const;
+    virtual const C64Color* GetColorByIndex(int x, int y, int index) const;
+    virtual int CountColorByIndex(int x, int y, int index) const;
+
+    virtual const C64Color* GetColor(int x, int y) const;
+    virtual void GetColorRow(int x, int y, int w,
+                             unsigned char* pDest) const;
+    virtual void SetPixel(int x, int y, const C64Color& col,
+                          MCDrawingMode mode = MCDrawingModeIgnore);
+
+    virtual unsigned GetCellDataSize() const;
+    virtual void GetCellData(int xCell, int yCell,
+                             unsigned char* pData) const;
+    virtual void SetCellData(int xCell, int yCell,
+                             const unsigned char* pData);
+
+    virtual unsigned GetGlobalDataSize() const;
+    virtual void GetGlobalData(unsigned char* pData) const;
+    virtual void SetGlobalData(const unsigned char* pData);
+
+    void SetSize(unsigned nXCells, unsigned nYCells);
+    unsigned GetXCells() const;
+    unsigned GetYCells() const;
+
+    void SetBackground(unsigned char col);
+    unsigned char GetBackground() const;
+
+    void SetCells(const uint8_t* pBitmap, const uint8_t* pScreen,
+                  const uint8_t* pColor);
+    void GetCells(uint8_t* pBitmap, uint8_t* pScreen,
+                  uint8_t* pColor) const;
+
+    void ShareTiles();
+
+    static const C64Color black;
+
+protected:
+    /// The cells of one tile in VIC memory layout, plus usage counters
+    typedef struct Tile_s
+    {
+        /// Number of bitmaps which use this tile
+        unsigned      nRefs;
+
+        /// Bitmap RAM, 8 bytes per cell, cells in rows
+        unsigned char aBitmapRAM[TILEDBITMAP_TILE_NCELLS *
+                                 MCBITMAP_BYTES_PER_BLOCK];
+
+        /// Screen RAM, upper nibble is index 1, lower nibble is index 2
+        unsigned char aScreenRAM[TILEDBITMAP_TILE_NCELLS];
+
+        /// Color RAM, only the lower nibble is used, it's index 3
+        unsigned char aColorRAM[TILEDBITMAP_TILE_NCELLS];
+
+        /// Number of pixels using each color index, for each cell
+        unsigned char aUsage[TILEDBITMAP_TILE_NCELLS][4];
+    } Tile;
+
+    const Tile* GetTile(unsigned xCell, unsigned yCell) const;
+    Tile* GetWritableTile(unsigned xCell, unsigned yCell);
+    static unsigned GetCellInTile(unsigned xCell, unsigned yCell);
+
+    MCBlock GetMCBlock(unsigned x, unsigned y);
+    const MCBlock GetMCBlock(unsigned x, unsigned y) const;
+    int GetColorNumber(unsigned x, unsigned y) const;
+
+    void ReleaseTiles();
+    static void CountUsage(Tile* pTile, unsigned cell);
+    static bool IsSameTile(const Tile* pTile1, const Tile* pTile2);
+    static uint32_t HashTile(const Tile* pTile);
+    static Tile InitEmptyTile();
+
+    /// Tiles in rows, NULL for tiles which look like m_tileEmpty
+    std::vector<Tile*> m_aTiles;
+
+    /// Size of the canvas in cells
+    unsigned           m_nXCells;
+    unsigned           m_nYCells;
+
+    /// Number of tiles in each row
+    unsigned           m_nXTiles;
+
+    /// Background color, index 0 of all cells
+    unsigned char      m_nBackground;
+
+    /// Contents of tiles which are not allocated
+    static const Tile  m_tileEmpty;
+};
+
+
+/*****************************************************************************/
+/**
+ * Return the tile which contains the given cell for reading. The cell
+ * coordinates must be valid.
+ */
+inline const TiledBitmap::Tile* TiledBitmap::GetTile(unsigned xCell,
+                                                     unsigned yCell) const
+{
+    const Tile* pTile;
+
+    pTile = m_aTiles[(yCell >> TILEDBITMAP_TILE_SHIFT) * m_nXTiles +
+                     (xCell >> TILEDBITMAP_TILE_SHIFT)];
+    return pTile ? pTile : &m_tileEmpty;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the number of the given cell inside of its tile.
+ */
+inline unsigned TiledBitmap::GetCellInTile(unsigned xCell, unsigned yCell)
+{
+    return (yCell & (TILEDBITMAP_TILE_CELLS - 1)) * TILEDBITMAP_TILE_CELLS +
+           (xCell & (TILEDBITMAP_TILE_CELLS - 1));
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the C64 color number of the pixel x/y. The coordinates must be
+ * valid.
+ */
+inline int TiledBitmap::GetColorNumber(unsigned x, unsigned y) const
+{
+    const Tile* pTile = GetTile(x / MCBLOCK_WIDTH, y / MCBLOCK_HEIGHT);
+    unsigned    cell  = GetCellInTile(x / MCBLOCK_WIDTH, y / MCBLOCK_HEIGHT);
+    unsigned    index = (pTile->aBitmapRAM[cell * MCBITMAP_BYTES_PER_BLOCK +
+                                           y % MCBLOCK_HEIGHT] >>
+                         (2 * (MCBLOCK_WIDTH - 1 - x % MCBLOCK_WIDTH))) & 0x03;
+
+    switch (index)
+    {
+    case 0:
+        return m_nBackground;
+    case 1:
+        return pTile->aScreenRAM[cell] >> 4;
+    case 2:
+        return pTile->aScreenRAM[cell] & 0x0f;
+    default:
+        return pTile->aColorRAM[cell];
+    }
+}
+
+
+/*****************************************************************************/
+/**
+ * Get a view on the block containing the given coordinates. The tile which
+ * contains it is made writable. The coordinates must be valid.
+ *
+ * The block has no parent, so it would change the background color without
+ * marking the whole canvas dirty. SetPixel takes care of this.
+ */
+inline MCBlock TiledBitmap::GetMCBlock(unsigned x, unsigned y)
+{
+    Tile*    pTile = GetWritableTile(x / MCBLOCK_WIDTH, y / MCBLOCK_HEIGHT);
+    unsigned cell  = GetCellInTile(x / MCBLOCK_WIDTH, y / MCBLOCK_HEIGHT);
+
+    return MCBlock(NULL,
+                   pTile->aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK,
+                   pTile->aScreenRAM + cell, pTile->aColorRAM + cell,
+                   &m_nBackground, pTile->aUsage[cell]);
+}
+
+
+/*****************************************************************************/
+/**
+ * Get a read-only view on the block containing the given coordinates. The
+ * coordinates must be valid.
+ */
+inline const MCBlock TiledBitmap::GetMCBlock(unsigned x, unsigned y) const
+{
+    Tile*    pTile = const_cast<Tile*>(GetTile(x / MCBLOCK_WIDTH,
+                                               y / MCBLOCK_HEIGHT));
+    unsigned cell  = GetCellInTile(x / MCBLOCK_WIDTH, y / MCBLOCK_HEIGHT);
+
+    return MCBlock(NULL,
+                   pTile->aBitmapRAM + cell * MCBITMAP_BYTES_PER_BLOCK,
+                   pTile->aScreenRAM + cell, pTile->aColorRAM + cell,
+                   const_cast<unsigned char*>(&m_nBackground),
+                   pTile->aUsage[cell]);
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the width of the canvas in cells.
+ */
+inline unsigned TiledBitmap::GetXCells() const
+{
+    return m_nXCells;
+}
+
+
+/*****************************************************************************/
+/**
+ * Return the height of the canvas in cells.
+ */
+inline unsigned TiledBitmap::GetYCells() const
+{
+    return m_nYCells;
+}
+
+#endif // TILEDBITMAP_H
@@ -0,0 +1,248 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+#include "MCApp.h"
+#include "TiledDoc.h"
+#include "DocRenderer.h"
+
+#define MCMAP_MAGIC "MCMP"
+
+/*
+ * File structure of a multicolor map. A map may be larger than 64 kBytes,
+ * so it has no start address. The header is followed by the bitmap (8 bytes
+ * per cell), the screen RAM and the color RAM (1 byte per cell each). The
+ * cells are stored in rows from the top left to the bottom right.
+ */
+typedef struct mcmap_header_s
+{
+   uint8_t magic[4];             /* MCMAP_MAGIC */
+   uint8_t xcells[2];            /* width in cells, low byte first */
+   uint8_t ycells[2];            /* height in cells, low byte first */
+   uint8_t background;           /* $d021 */
+} mcmap_header_t;
+
+/******************************************************************************/
+/**
+ * This is a list of all Filters for this image format.
+ */
+static FormatInfo::Filter m_aFilters[] =
+{
+    { wxT("Multi Color maps"), wxT("*.mcm") },
+    { NULL, NULL }
+};
+
+/**
+ * Information about this image format. The size of a map depends on its
+ * contents, so it can't be found by size or load address.
+ */
+FormatInfo TiledDoc::m_formatInfo(
+    wxT("Multi Color Canvas"),
+    wxT("mcm"),
+    m_aFilters,
+    TiledDoc::Factory,
+    TiledDoc::CheckFormat);
+
+
+/******************************************************************************/
+/**
+ *
+ */
+TiledDoc::TiledDoc()
+    : m_bitmap()
+{
+    PrepareUndo();
+
+    // PrepareUndo sets m_bModified, reset it
+    m_bModified = false;
+}
+
+
+/******************************************************************************/
+/**
+ * Create an object of this class.
+ */
+DocBase* TiledDoc::Factory()
+{
+    return new TiledDoc;
+}
+
+
+/******************************************************************************/
+/**
+ * Check how good data matches our document format. Return a sum of
+ * MC_FORMAT_*_MATCH.
+ */
+int TiledDoc::CheckFormat(const uint8_t* pBuff, unsigned len,
+                          const wxFileName& fileName)
+{
+    const mcmap_header_t* pHeader;
+    unsigned nCells;
+    int      match = 0;
+
+    if (fileName.GetExt().CmpNoCase(wxT("mcm")) == 0)
+        match += MC_FORMAT_EXTENSION_MATCH;
+
+    if (len < sizeof(mcmap_header_t))
+        return match;
+
+    pHeader = (const mcmap_header_t*) pBuff;
+    if (memcmp(pHeader->magic, MCMAP_MAGIC, sizeof(pHeader->magic)) != 0)
+        return match;
+    match += MC_FORMAT_MAGIC_MATCH;
+
+    nCells = (pHeader->xcells[0] + pHeader->xcells[1] * 256) *
+             (pHeader->ycells[0] + pHeader->ycells[1] * 256);
+    if (len == sizeof(mcmap_header_t) +
+               nCells * (MCBITMAP_BYTES_PER_BLOCK + 2))
+        match += MC_FORMAT_SIZE_MATCH;
+
+    return match;
+}
+
+
+/******************************************************************************/
+/**
+ * Return a pointer to our FormatInfo.
+ */
+const FormatInfo* TiledDoc::GetFormatInfo() const
+{
+    return &m_formatInfo;
+}
+
+
+/******************************************************************************/
+/**
+ * Copy the contents of the given bitmap to our one. The pointer must point to
+ * an object which has actually the same type as our bitmap.
+ */
+void TiledDoc::SetBitmap(const BitmapBase* pB)
+{
+    m_bitmap = *(TiledBitmap*) pB;
+}
+
+
+/******************************************************************************/
+/**
+ * Try to load the file from the given memory buffer. Return true for success.
+ */
+bool TiledDoc::Load(const uint8_t* pBuff, unsigned size)
+{
+    return LoadMap(pBuff, size);
+}
+
+
+/******************************************************************************
+ **
+ * Save the file to the buffer given, which is resized as needed. Return true
+ * for success. The file name is for informational purposes only, e.g. to
+ * decide which sub-format to use.
+ */
+bool TiledDoc::Save(std::vector<uint8_t>* pOut,
+                    const wxFileName& fileName)
+{
+    return SaveMap(pOut);
+}
+
+
+/*****************************************************************************/
+/**
+ * Try to load a multicolor map from the given buffer into this document.
+ * Return true if it worked and false otherwise.
+ *
+ * pBuff        Points to bytes from the file
+ * nSize        Size
+ * return       true if the file has been loaded
+ */
+bool TiledDoc::LoadMap(const uint8_t* pBuff, unsigned nSize)
+{
+    const mcmap_header_t* pHeader;
+    const uint8_t* pCells;
+    unsigned nXCells, nYCells, nCells;
+
+    if (nSize < sizeof(mcmap_header_t))
+        return false;
+
+    pHeader = (const mcmap_header_t*) pBuff;
+    if (memcmp(pHeader->magic, MCMAP_MAGIC, sizeof(pHeader->magic)) != 0)
+        return false;
+
+    nXCells = pHeader->xcells[0] + pHeader->xcells[1] * 256;
+    nYCells = pHeader->ycells[0] + pHeader->ycells[1] * 256;
+    if (nXCells < 1 || nXCells > TILEDBITMAP_MAX_XCELLS ||
+        nYCells < 1 || nYCells > TILEDBITMAP_MAX_YCELLS)
+        return false;
+
+    nCells = nXCells * nYCells;
+    if (nSize != sizeof(mcmap_header_t) +
+                 nCells * (MCBITMAP_BYTES_PER_BLOCK + 2))
+        return false;
+
+    pCells = pBuff + sizeof(mcmap_header_t);
+
+    m_bitmap.SetSize(nXCells, nYCells);
+    m_bitmap.SetCells(pCells,
+                      pCells + nCells * MCBITMAP_BYTES_PER_BLOCK,
+                      pCells + nCells * (MCBITMAP_BYTES_PER_BLOCK + 1));
+    m_bitmap.SetBackground(pHeader->background);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/**
+ * Save a multicolor map into the given buffer. Return false if there's
+ * something wrong.
+ */
+bool TiledDoc::SaveMap(std::vector<uint8_t>* pOut)
+{
+    mcmap_header_t* pHeader;
+    uint8_t*        pCells;
+    unsigned        nCells;
+
+    nCells = m_bitmap.GetXCells() * m_bitmap.GetYCells();
+
+    pOut->assign(sizeof(mcmap_header_t) +
+                 nCells * (MCBITMAP_BYTES_PER_BLOCK + 2), 0);
+    pHeader = (mcmap_header_t*) &(*pOut)[0];
+    pCells  = &(*pOut)[sizeof(mcmap_header_t)];
+
+    memcpy(pHeader->magic, MCMAP_MAGIC, sizeof(pHeader->magic));
+    pHeader->xcells[0]  = m_bitmap.GetXCells() % 0x100;
+    pHeader->xcells[1]  = m_bitmap.GetXCells() / 0x100;
+    pHeader->ycells[0]  = m_bitmap.GetYCells() % 0x100;
+    pHeader->ycells[1]  = m_bitmap.GetYCells() / 0x100;
+    pHeader->background = m_bitmap.GetBackground();
+
+    m_bitmap.GetCells(pCells,
+                      pCells + nCells * MCBITMAP_BYTES_PER_BLOCK,
+                      pCells + nCells * (MCBITMAP_BYTES_PER_BLOCK + 1));
+
+    return true;
+}
@@ -160,24 +160,42 @@ void ToolCloneBrush::CloneLine(int x1, int y1, int x2, int y2)
 /*
  * Clone from source to destination.
  *
+ * The offset between them is kept in screen pixels, so documents with
+ * different pixel sizes, e.g. hires sprites and a multicolor bitmap, are
+ * cloned without distortion.
+ *
  * X and y are bitmap coordinates.
  */
 void ToolCloneBrush::ClonePixel(int x, int y)
 {
-    C64Color col;
+    C64Color    col;
+    BitmapBase* pSource;
+    BitmapBase* pDest;
+    int         xSource, ySource;
 
     if (!m_pDocSource)
         return;
 
+    pSource = m_pDocSource->GetBitmap();
+    pDest   = m_pDoc->GetBitmap();
+
     // Is the document different from the last destination?
     if (m_pDoc != m_pDocDest)
     {
         // Then we clone to a new one
         m_pDocDest = m_pDoc;
-        m_dx = x - m_xSource;
-        m_dy = y - m_ySource;
+        m_dx = x * pDest->GetPixelXFactor() -
+               m_xSource * pSource->GetPixelXFactor();
+        m_dy = y * pDest->GetPixelYFactor() -
+               m_ySource * pSource->GetPixelYFactor();
     }
 
-    col = *m_pDocSource->GetBitmap()->GetColor(x - m_dx, y - m_dy);
-    m_pDocDest->GetBitmap()->SetPixel(x, y, col, m_drawingMode);
+    // screen coordinates in the source, negative ones are outside
+    xSource = x * pDest->GetPixelXFactor() - m_dx;
+    ySource = y * pDest->GetPixelYFactor() - m_dy;
+    xSource = xSource >= 0 ? xSource / pSource->GetPixelXFactor() : -1;
+    ySource = ySource >= 0 ? ySource / pSource->GetPixelYFactor() : -1;
+
+    col = *pSource->GetColor(xSource, ySource);
+    pDest->SetPixel(x, y, col, m_drawingMode);
 }
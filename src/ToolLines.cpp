@@ -23,9 +23,11 @@
  * Thomas Giesel skoe@directbox.com
  */
 
+#include <vector>
 #include <wx/gdicmn.h>
 
 #include "ToolLines.h"
+#include "BitmapBase.h"
 #include "MCDoc.h"
 #include "MCApp.h"
 
@@ -50,7 +52,7 @@ int ToolLines::GetToolId()
 /*
  * Start the tool at the given coordinates (i.e. Mouse button down).
  *
- * Fill the area around the given point.
+ * Show the start point as preview.
  * X and y are bitmap coordinates.
  * bSecondaryFunction is true if the tool was invoked with a
  * secondary (i.e. right) mouse button.
@@ -58,56 +60,37 @@ int ToolLines::GetToolId()
 void ToolLines::Start(int x, int y, bool bSecondaryFunction)
 {
     ToolBase::Start(x, y, bSecondaryFunction);
-
-    // initialise the "previous" preview line end coordinates
-    m_xOld = x;
-    m_yOld = y;
+    Move(x, y);
 }
 
 /*****************************************************************************/
 /**
  * Mouse has been moved while the button was kept pressed.
  *
- * Restory the documents bitmap from a saved one and draw a preview of the
- * line.
+ * Show a preview of the line. The preview is drawn by the renderers over
+ * the bitmap, the bitmap is not changed until the tool is finished.
  *
  * X and y are bitmap coordinates.
  */
 void ToolLines::Move(int x, int y)
 {
-    int x1, y1, x2, y2;
-
-    m_pDoc->RestoreBitmap();
-    m_pDoc->GetBitmap()->Line(m_xStart, m_yStart, x, y, m_nColorSelected,
-            m_drawingMode);
+    std::vector<wxPoint> aPoints;
 
-    // redraw an area that includes the previous line preview and this line
-    x1 = x2 = m_xStart;
-    y1 = y2 = m_yStart;
-    if (x < x1) x1 = x;
-    if (x > x2) x2 = x;
-    if (y < y1) y1 = y;
-    if (y > y2) y2 = y;
-    if (m_xOld < x1) x1 = m_xOld;
-    if (m_xOld > x2) x2 = m_xOld;
-    if (m_yOld < y1) y1 = m_yOld;
-    if (m_yOld > y2) y2 = m_yOld;
-
-    m_pDoc->Refresh(x1, y1, x2, y2); // ???
-
-    m_xOld = x;
-    m_yOld = y;
+    BitmapBase::GetLinePoints(m_xStart, m_yStart, x, y, &aPoints);
+    m_pDoc->SetPreview(aPoints, m_nColorSelected);
 }
 
 /*****************************************************************************/
 /*
  * Finish the tool at the given coordinates (i.e. Mouse button up)
  *
- * Draw the line.
+ * Draw the line and remove the preview.
  * X and y are bitmap coordinates.
  */
 void ToolLines::End(int x, int y)
 {
-    Move(x, y);
+    m_pDoc->GetBitmap()->Line(m_xStart, m_yStart, x, y, m_nColorSelected,
+            m_drawingMode);
+    m_pDoc->ClearPreview();
     m_pDoc->PrepareUndo();
 }
@@ -0,0 +1,242 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#include <string.h>
+
+#include "UndoBuffer.h"
+#include "BitmapBase.h"
+
+
+/******************************************************************************/
+/**
+ * Constructor.
+ */
+UndoBuffer::UndoBuffer() :
+    m_aSteps(MC_UNDO_LEN),
+    m_nFirst(0),
+    m_nCount(0),
+    m_nPos(0),
+    m_pSnapshot(NULL)
+{
+}
+
+
+/******************************************************************************/
+/**
+ * Destructor.
+ */
+UndoBuffer::~UndoBuffer()
+{
+    delete m_pSnapshot;
+}
+
+
+/******************************************************************************/
+/**
+ * Forget all steps and the snapshot. The next call to Commit will take a
+ * new snapshot.
+ */
+void UndoBuffer::Clear()
+{
+    unsigned i;
+
+    for (i = 0; i < MC_UNDO_LEN; ++i)
+        Step().swap(m_aSteps[i]);
+
+    m_nFirst = 0;
+    m_nCount = 0;
+    m_nPos   = 0;
+
+    delete m_pSnapshot;
+    m_pSnapshot = NULL;
+}
+
+
+/******************************************************************************/
+/**
+ * Record the changes done to pBitmap since the last call as a new step.
+ * Steps which could have been redone are discarded. If the buffer is full,
+ * the oldest step is discarded.
+ *
+ * The first call after Clear() only takes the snapshot.
+ *
+ * Return true if a step has been recorded, false if nothing has changed.
+ */
+bool UndoBuffer::Commit(BitmapBase* pBitmap)
+{
+    Step     step;
+    Step     before, after;
+    unsigned nGlobalSize, nCellSize, nXCells;
+    unsigned cell, pos, i;
+    int      nCell, xCell, yCell;
+    bool     bChanged;
+
+    if (!m_pSnapshot)
+    {
+        m_pSnapshot = pBitmap->Copy();
+        pBitmap->ResetChanged();
+        return false;
+    }
+
+    nGlobalSize = pBitmap->GetGlobalDataSize();
+    nCellSize   = pBitmap->GetCellDataSize();
+    nXCells     = pBitmap->GetWidth() / pBitmap->GetCellWidth();
+    bChanged    = false;
+
+    step.resize(2 * nGlobalSize);
+    if (nGlobalSize)
+    {
+        m_pSnapshot->GetGlobalData(&step[0]);
+        pBitmap->GetGlobalData(&step[nGlobalSize]);
+        if (memcmp(&step[0], &step[nGlobalSize], nGlobalSize))
+        {
+            m_pSnapshot->SetGlobalData(&step[nGlobalSize]);
+            bChanged = true;
+        }
+    }
+
+    // compare all changed cells with the snapshot
+    before.resize(nCellSize);
+    after.resize(nCellSize);
+    for (nCell = pBitmap->GetNextChangedCell(0); nCell >= 0;
+         nCell = pBitmap->GetNextChangedCell(nCell + 1))
+    {
+        cell  = nCell;
+        xCell = cell % nXCells;
+        yCell = cell / nXCells;
+
+        m_pSnapshot->GetCellData(xCell, yCell, &before[0]);
+        pBitmap->GetCellData(xCell, yCell, &after[0]);
+        if (before == after)
+            continue;
+
+        for (i = 0; i < 4; ++i)
+            step.push_back((unsigned char) (cell >> (8 * i)));
+        step.insert(step.end(), before.begin(), before.end());
+        step.insert(step.end(), after.begin(), after.end());
+        bChanged = true;
+    }
+    pBitmap->ResetChanged();
+
+    // Update the snapshot only now: Cells may share data, e.g. the color
+    // RAM of FLI, so updating one cell would change the "before" of others
+    for (pos = 2 * nGlobalSize; pos < step.size(); pos += 4 + 2 * nCellSize)
+    {
+        cell = step[pos] | (step[pos + 1] << 8) |
+               (step[pos + 2] << 16) | (step[pos + 3] << 24);
+        m_pSnapshot->SetCellData(cell % nXCells, cell / nXCells,
+                                 &step[pos + 4 + nCellSize]);
+    }
+
+    if (!bChanged)
+        return false;
+
+    // if we are not at the end of the undo list, discard the rest
+    while (m_nCount > m_nPos)
+        Step().swap(GetStep(--m_nCount));
+
+    // if the buffer is full, discard the oldest step
+    if (m_nCount == MC_UNDO_LEN)
+    {
+        Step().swap(GetStep(0));
+        m_nFirst = (m_nFirst + 1) % MC_UNDO_LEN;
+        --m_nCount;
+        --m_nPos;
+    }
+
+    GetStep(m_nCount).swap(step);
+    m_nPos = ++m_nCount;
+
+    return true;
+}
+
+
+/******************************************************************************/
+/**
+ * Undo the last step, if possible.
+ */
+void UndoBuffer::Undo(BitmapBase* pBitmap)
+{
+    if (CanUndo())
+    {
+        --m_nPos;
+        ApplyStep(pBitmap, m_nPos, true);
+    }
+}
+
+
+/******************************************************************************/
+/**
+ * Redo the next step, if possible.
+ */
+void UndoBuffer::Redo(BitmapBase* pBitmap)
+{
+    if (CanRedo())
+    {
+        ApplyStep(pBitmap, m_nPos, false);
+        ++m_nPos;
+    }
+}
+
+
+/******************************************************************************/
+/**
+ * Write the data of the given step to pBitmap and to the snapshot. If bUndo
+ * is true, the state before the step is restored, otherwise the state after
+ * it.
+ */
+void UndoBuffer::ApplyStep(BitmapBase* pBitmap, unsigned nStep, bool bUndo)
+{
+    const Step& step = GetStep(nStep);
+    unsigned    nGlobalSize, nCellSize, nXCells;
+    unsigned    pos, cell;
+    const unsigned char* pData;
+
+    nGlobalSize = pBitmap->GetGlobalDataSize();
+    nCellSize   = pBitmap->GetCellDataSize();
+    nXCells     = pBitmap->GetWidth() / pBitmap->GetCellWidth();
+
+    if (nGlobalSize)
+    {
+        pData = &step[bUndo ? 0 : nGlobalSize];
+        pBitmap->SetGlobalData(pData);
+        m_pSnapshot->SetGlobalData(pData);
+    }
+
+    pos = 2 * nGlobalSize;
+    while (pos < step.size())
+    {
+        cell = step[pos] | (step[pos + 1] << 8) |
+               (step[pos + 2] << 16) | (step[pos + 3] << 24);
+        pData = &step[pos + 4 + (bUndo ? 0 : nCellSize)];
+
+        pBitmap->SetCellData(cell % nXCells, cell / nXCells, pData);
+        m_pSnapshot->SetCellData(cell % nXCells, cell / nXCells, pData);
+
+        pos += 4 + 2 * nCellSize;
+    }
+
+    pBitmap->ResetChanged();
+}
@@ -0,0 +1,122 @@
+/*
+ * MultiColor - An image manipulation tool for Commodore 8-bit computers'
+ *              graphic formats
+ *
+ * (c) 2003-2010 Thomas Giesel
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Thomas Giesel skoe@directbox.com
+ */
+
+#ifndef UNDOBUFFER_H
+#define UNDOBUFFER_H
+
+#include <vector>
+
+#define MC_UNDO_LEN 100
+
+class BitmapBase;
+
+/*****************************************************************************/
+/**
+ * The undo history of a document. Each step only contains the cells which
+ * have been changed, i.e. their contents before and after the change. The
+ * steps are kept in a ring buffer, so the oldest one is discarded when it
+ * is full.
+ *
+ * The data of a step looks like this:
+ *
+ *   global data before, global data after,
+ *   n * (cell number (4 bytes), cell data before, cell data after)
+ *
+ * To find out which cells have been changed we keep a snapshot of the
+ * bitmap as it was after the last step and compare it with the current
+ * bitmap, but only the cells BitmapBase::GetNextChangedCell() reports as
+ * touched since the last step.
+ */
+class UndoBuffer
+{
+public:
+    UndoBuffer();
+    ~UndoBuffer();
+
+    void Clear();
+    bool Commit(BitmapBase* pBitmap);
+    void Undo(BitmapBase* pBitmap);
+    void Redo(BitmapBase* pBitmap);
+    bool CanUndo() const;
+    bool CanRedo() const;
+
+protected:
+    typedef std::vector<unsigned char> Step;
+
+    Step& GetStep(unsigned nStep);
+    void ApplyStep(BitmapBase* pBitmap, unsigned nStep, bool bUndo);
+
+    /// Ring buffer with MC_UNDO_LEN steps
+    std::vector<Step>   m_aSteps;
+
+    /// Index of the oldest step in m_aSteps
+    unsigned            m_nFirst;
+
+    /// Number of steps in the buffer, including the ones which can be redone
+    unsigned            m_nCount;
+
+    /// Number of steps which can be undone
+    unsigned            m_nPos;
+
+    /// The bitmap as it was after the last step, NULL if there is none yet
+    BitmapBase*         m_pSnapshot;
+
+private:
+    /// Copy construtor is private: This can't be copied
+    UndoBuffer(UndoBuffer &r);
+};
+
+
+/******************************************************************************/
+/**
+ * Return a reference to the step with the given number, counted from the
+ * oldest one.
+ */
+inline UndoBuffer::Step& UndoBuffer::GetStep(unsigned nStep)
+{
+    return m_aSteps[(m_nFirst + nStep) % MC_UNDO_LEN];
+}
+
+
+/******************************************************************************/
+/**
+ * Return true if there is a step which can be undone.
+ */
+inline bool UndoBuffer::CanUndo() const
+{
+    return m_nPos > 0;
+}
+
+
+/******************************************************************************/
+/**
+ * Return true if there is a step which can be redone.
+ */
+inline bool UndoBuffer::CanRedo() const
+{
+    return m_nPos < m_nCount;
+}
+
+#endif // UNDOBUFFER_H